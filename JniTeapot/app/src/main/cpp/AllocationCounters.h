@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+
+#include "types.h"
+#include "panic.h"
+
+#if OPTIMIZED_BUILD
+    #define ENABLE_ALLOCATION_COUNTERS 0
+#else
+    #define ENABLE_ALLOCATION_COUNTERS 1
+#endif
+
+// Process-wide counters for allocations we don't want to see in the render loop once it's warmed up
+// Note: counters only ever increase, FrameAllocations diffs them once per frame
+class AllocationCounters {
+    public:
+        enum Counter {
+            COUNTER_HEAP_SYSCALLS,         // mmap/munmap/madvise/mprotect calls made by Memory
+            COUNTER_FREETYPE_MALLOCS,      // alloc/realloc calls FreeType made through ftlib's FT_Memory
+            COUNTER_GL_BUFFER_ALLOCATIONS, // GlBufferData calls - each one (re)allocates the buffer's storage
+
+            COUNTER_COUNT
+        };
+
+        struct Counts {
+            uint32 counts[COUNTER_COUNT];
+
+            inline uint32 operator[](Counter counter) const { return counts[counter]; }
+
+            inline uint32 Total() const {
+                uint32 total = 0;
+                for(uint32 count : counts) total+= count;
+                return total;
+            }
+
+            inline Counts operator-(const Counts& c) const {
+                Counts result;
+                for(uint32 i = 0; i < COUNTER_COUNT; ++i) result.counts[i] = counts[i] - c.counts[i];
+                return result;
+            }
+        };
+
+    private:
+        static inline std::atomic<uint32> counters[COUNTER_COUNT];
+
+    public:
+        static inline void Count(Counter counter, uint32 n = 1) {
+            #if ENABLE_ALLOCATION_COUNTERS
+                counters[counter].fetch_add(n, std::memory_order_relaxed);
+            #endif
+        }
+
+        static inline Counts Snapshot() {
+            Counts snapshot;
+            for(uint32 i = 0; i < COUNTER_COUNT; ++i) snapshot.counts[i] = counters[i].load(std::memory_order_relaxed);
+            return snapshot;
+        }
+};
+
+// Tracks how many allocations each frame of the render loop made
+// Note: frames after 'warmupFrames' are expected to be allocation free. Set 'panicOnSteadyStateAllocation'
+//       for benchmark runs so a frame that allocates fails the run instead of just being counted
+class FrameAllocations {
+    private:
+        uint32 warmupFrames;
+        bool panicOnSteadyStateAllocation;
+
+        uint32 frameCount;
+        uint32 allocatingFrameCount; //frames after warm-up that allocated
+
+        AllocationCounters::Counts frameStartCounts;
+        AllocationCounters::Counts lastFrameCounts;
+
+    public:
+        inline FrameAllocations(uint32 warmupFrames, bool panicOnSteadyStateAllocation = false):
+            warmupFrames(warmupFrames), panicOnSteadyStateAllocation(panicOnSteadyStateAllocation),
+            frameCount(0), allocatingFrameCount(0),
+            frameStartCounts(AllocationCounters::Snapshot()), lastFrameCounts{} {}
+
+        inline bool IsWarm() const { return frameCount >= warmupFrames; }
+        inline uint32 AllocatingFrameCount() const { return allocatingFrameCount; }
+        inline const AllocationCounters::Counts& LastFrameCounts() const { return lastFrameCounts; }
+
+        // Starts warm-up over. Ex. once background asset loads are done uploading
+        inline void RestartWarmup() { frameCount = 0; }
+
+        // Closes out the current frame. Call once per frame after presenting it
+        inline void NextFrame() {
+            AllocationCounters::Counts counts = AllocationCounters::Snapshot();
+
+            lastFrameCounts = counts - frameStartCounts;
+            frameStartCounts = counts;
+
+            bool isSteadyState = IsWarm();
+            ++frameCount;
+
+            if(!isSteadyState || !lastFrameCounts.Total()) return;
+
+            if(panicOnSteadyStateAllocation) {
+                Panic("Frame allocated after warm-up { frame: %u, heapSyscalls: %u, freeTypeMallocs: %u, glBufferAllocations: %u }",
+                      frameCount,
+                      lastFrameCounts[AllocationCounters::COUNTER_HEAP_SYSCALLS],
+                      lastFrameCounts[AllocationCounters::COUNTER_FREETYPE_MALLOCS],
+                      lastFrameCounts[AllocationCounters::COUNTER_GL_BUFFER_ALLOCATIONS]);
+            }
+
+            //Note: only warn about the first one so a steady leak doesn't flood the log. The rest show up in the overlay
+            if(!allocatingFrameCount++) {
+                Warn("Frame allocated after warm-up { frame: %u, heapSyscalls: %u, freeTypeMallocs: %u, glBufferAllocations: %u }",
+                     frameCount,
+                     lastFrameCounts[AllocationCounters::COUNTER_HEAP_SYSCALLS],
+                     lastFrameCounts[AllocationCounters::COUNTER_FREETYPE_MALLOCS],
+                     lastFrameCounts[AllocationCounters::COUNTER_GL_BUFFER_ALLOCATIONS]);
+            }
+        }
+};
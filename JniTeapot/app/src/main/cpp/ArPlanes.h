@@ -133,14 +133,14 @@ protected:
         if(glBufferBytes < newGlBufferPosition) {
             
             //allocate new buffer. Note: this deletes existing content
-            glBufferData(glBufferTarget, newGlBufferPosition, nullptr, GL_DYNAMIC_DRAW);
+            GlBufferData(glBufferTarget, newGlBufferPosition, nullptr, GL_DYNAMIC_DRAW);
 
             Log("Allocating new glBuffer: { glBufferTarget: %d, oldBufferBytes: %d, newBufferBytes: %d }",
                 glBufferTarget, glBufferBytes, newGlBufferPosition);
 
             //Copy over whole arena
             void* glBufferData = glMapBufferRange(glBufferTarget, 0, newGlBufferPosition, GL_MAP_WRITE_BIT);
-            arena.CopyToBuffer<uint8>(newGlBufferPosition, glBufferData);
+            arena.CopyToBuffer<uint8>(newGlBufferPosition, glBufferData, 1, 1, true);
             glUnmapBuffer(glBufferTarget);
 
             
@@ -149,7 +149,7 @@ protected:
             //copy over only new parts of the arena
             GLuint newBytes = newGlBufferPosition-oldGlBufferPosition;
             void* glBufferData = glMapBufferRange(glBufferTarget, oldGlBufferPosition, newBytes, GL_MAP_WRITE_BIT);
-            arena.CopyToBuffer<uint8>(newBytes, glBufferData);
+            arena.CopyToBuffer<uint8>(newBytes, glBufferData, 1, 1, true);
             glUnmapBuffer(glBufferTarget);
         }
     }
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#if defined(__ANDROID__)
+    #include <jni.h>
+#endif
+
+#include "types.h"
+#include "panic.h"
+#include "hashUtil.h"
+#include "FileManager.h"
+
+// Persistent cache of data derived from assets (decoded textures, interleaved meshes, rendered glyph atlases)
+// so warm starts can skip decoding. Entries are content addressed: the key hashes the source asset's bytes together
+// with the parameters used to process it, so editing an asset or changing how it's processed just misses the cache.
+//
+// Note: every entry is its own file in app-private storage. Hits bump the file's mtime and once the cache grows past
+//       'maxBytes' the least recently used entries are deleted. Stale entries are never hit so they age out the same way.
+//       Cache failures (ex. a full disk) are never fatal, the caller just decodes the asset again
+// Warn: 'Init' must be called before any other thread uses the cache. After that 'Load' and 'Store' are thread safe
+class AssetCache {
+
+    public:
+
+        static constexpr uint64 kDefaultMaxBytes = MB(128);
+
+        struct Chunk {
+            const void* data;
+            uint64 bytes;
+        };
+
+    private:
+
+        //Note: bump when FileHeader changes. Each caller versions its own payload through the params it hashes into the key
+        static constexpr uint32 kCacheMagic   = 'J' | ('T'<<8) | ('A'<<16) | ('C'<<24);
+        static constexpr uint32 kCacheVersion = 1;
+
+        static constexpr char kEntrySuffix[] = ".cache";
+        static constexpr char kTmpSuffix[]   = ".tmp";
+
+        struct FileHeader {
+            uint32 magic;
+            uint32 version;
+            uint64 key;
+            uint64 payloadBytes;
+            uint64 reserved; //Note: pads the payload to 32 bytes so it can be uploaded straight from the mapping
+        };
+
+        static inline char cacheDirectory[PATH_MAX];
+        static inline bool enabled;
+
+        static inline pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        static inline uint64 maxBytes, totalBytes; //Note: guarded by mutex
+
+        static void EntryPath(uint64 key, char (&path)[PATH_MAX]) {
+            snprintf(path, sizeof(path), "%s/%016llx%s", cacheDirectory, (unsigned long long)key, kEntrySuffix);
+        }
+
+        static bool EndsWith(const char* str, const char* suffix) {
+            size_t strLength = strlen(str), suffixLength = strlen(suffix);
+            return strLength >= suffixLength && !strcmp(str + strLength - suffixLength, suffix);
+        }
+
+        static bool WriteAll(int fd, const void* data, uint64 bytes) {
+            while(bytes) {
+                ssize_t written = write(fd, data, bytes);
+                if(written <= 0) return false;
+
+                data = ByteOffset(data, written);
+                bytes-= written;
+            }
+            return true;
+        }
+
+        struct TrimEntry {
+            timespec mtime;
+            uint64 bytes;
+            char name[32];
+        };
+
+        static int CompareTrimEntries(const void* a, const void* b) {
+            const timespec &aTime = ((const TrimEntry*)a)->mtime,
+                           &bTime = ((const TrimEntry*)b)->mtime;
+
+            if(aTime.tv_sec != bTime.tv_sec) return aTime.tv_sec < bTime.tv_sec ? -1 : 1;
+            return (aTime.tv_nsec > bTime.tv_nsec) - (aTime.tv_nsec < bTime.tv_nsec);
+        }
+
+        // Deletes least recently used entries until the cache is at most 'targetBytes'. Leftover temp files are deleted too
+        // Note: requires lock. Recounts 'totalBytes' from disk so it also corrects for overwritten entries
+        static void Trim(uint64 targetBytes, bool deleteTmpFiles) {
+
+            DIR* dir = opendir(cacheDirectory);
+            if(!dir) {
+                Warn("Failed to open asset cache { cacheDirectory: %s, linux errno: %d }", cacheDirectory, errno);
+                return;
+            }
+
+            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
+            Memory::ArenaArray<TrimEntry> entries(&Memory::temporaryArena);
+
+            totalBytes = 0;
+            while(dirent* dirEntry = readdir(dir)) {
+
+                const char* name = dirEntry->d_name;
+                if(deleteTmpFiles && EndsWith(name, kTmpSuffix)) {
+                    unlinkat(dirfd(dir), name, 0);
+                    continue;
+                }
+
+                struct stat fileStat;
+                if(!EndsWith(name, kEntrySuffix) || strlen(name) >= sizeof(TrimEntry::name) ||
+                   fstatat(dirfd(dir), name, &fileStat, AT_SYMLINK_NOFOLLOW) || !S_ISREG(fileStat.st_mode)) continue;
+
+                TrimEntry* entry = entries.Push();
+                entry->mtime = fileStat.st_mtim;
+                entry->bytes = fileStat.st_size;
+                strcpy(entry->name, name);
+
+                totalBytes+= entry->bytes;
+            }
+
+            if(totalBytes > targetBytes) {
+
+                //Note: oldest first
+                qsort(entries.Data(), entries.Count(), sizeof(TrimEntry), CompareTrimEntries);
+
+                uint32 deletedCount = 0;
+                for(const TrimEntry& entry : entries) {
+                    if(totalBytes <= targetBytes) break;
+
+                    if(!unlinkat(dirfd(dir), entry.name, 0)) {
+                        totalBytes-= entry.bytes;
+                        ++deletedCount;
+                    }
+                }
+
+                Log("Trimmed asset cache { deletedCount: %u, totalBytes: %llu, targetBytes: %llu }",
+                    deletedCount, (unsigned long long)totalBytes, (unsigned long long)targetBytes);
+            }
+
+            closedir(dir);
+            Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+        }
+
+    public:
+
+        // Note: creates 'directoryPath' if it doesn't exist and trims it to 'maxBytes'
+        static void Init(const char* directoryPath, uint64 maxCacheBytes = kDefaultMaxBytes) {
+            RUNTIME_ASSERT(directoryPath, "Null directoryPath");
+            RUNTIME_ASSERT(!enabled, "AssetCache already initialized { cacheDirectory: %s }", cacheDirectory);
+
+            int directoryPathLength = snprintf(cacheDirectory, sizeof(cacheDirectory), "%s", directoryPath);
+            RUNTIME_ASSERT(directoryPathLength > 0 && uint32(directoryPathLength) < sizeof(cacheDirectory),
+                           "Cache directory path is too long { directoryPath: %s }", directoryPath);
+
+            if(mkdir(cacheDirectory, 0700) && errno != EEXIST) {
+                Warn("Failed to create asset cache, assets will always be decoded { cacheDirectory: %s, linux errno: %d }", cacheDirectory, errno);
+                return;
+            }
+
+            pthread_mutex_lock(&mutex);
+            maxBytes = maxCacheBytes;
+            Trim(maxBytes, true);
+            pthread_mutex_unlock(&mutex);
+
+            enabled = true;
+            Log("Initialized AssetCache { cacheDirectory: %s, totalBytes: %llu, maxBytes: %llu }",
+                cacheDirectory, (unsigned long long)totalBytes, (unsigned long long)maxBytes);
+        }
+
+        #if defined(__ANDROID__)
+        // Puts the cache in an 'assets' directory under the app's cache directory (Context.getCacheDir())
+        // Note: android may clear the cache directory when storage is low which is fine for us
+        static void Init(JNIEnv* env, jobject jContext, uint64 maxCacheBytes = kDefaultMaxBytes) {
+
+            jclass contextClass = env->GetObjectClass(jContext);
+            jobject jCacheDir = env->CallObjectMethod(jContext, env->GetMethodID(contextClass, "getCacheDir", "()Ljava/io/File;"));
+            RUNTIME_ASSERT(jCacheDir, "Failed to get cache directory { jContext: %p }", jContext);
+
+            jclass fileClass = env->GetObjectClass(jCacheDir);
+            jstring jCachePath = (jstring)env->CallObjectMethod(jCacheDir, env->GetMethodID(fileClass, "getAbsolutePath", "()Ljava/lang/String;"));
+
+            const char* cachePath = env->GetStringUTFChars(jCachePath, nullptr);
+
+            char directoryPath[PATH_MAX];
+            snprintf(directoryPath, sizeof(directoryPath), "%s/assets", cachePath);
+
+            env->ReleaseStringUTFChars(jCachePath, cachePath);
+            env->DeleteLocalRef(jCachePath);
+            env->DeleteLocalRef(fileClass);
+            env->DeleteLocalRef(jCacheDir);
+            env->DeleteLocalRef(contextClass);
+
+            Init(directoryPath, maxCacheBytes);
+        }
+        #endif
+
+        static inline bool Enabled() { return enabled; }
+
+        // Key for data derived from 'sourceBytes' of 'source' with 'params'
+        // Note: 'params' is hashed byte for byte so it can't have padding. Include a version in it and bump it whenever
+        //       the derived data's format or the code that produces it changes
+        template<typename ParamsT>
+        static uint64 Key(const void* source, uint64 sourceBytes, const ParamsT& params) {
+            COMPILE_ASSERT(__has_unique_object_representations(ParamsT), "Cache params can't have padding - it would be hashed");
+
+            return Hash64(&params, sizeof(ParamsT), Hash64(source, sourceBytes, kCacheVersion));
+        }
+
+        // Maps the cached data for 'key' into 'payloadView'. Returns false on a miss
+        // Note: release the view with 'FileManager::UnmapAsset'. The payload is 32 byte aligned
+        static bool Load(uint64 key, FileManager::AssetView* payloadView) {
+            if(!enabled) return false;
+
+            char path[PATH_MAX];
+            EntryPath(key, path);
+
+            FileManager::AssetView view;
+            if(!FileManager::MapFile(path, &view)) return false;
+
+            const FileHeader* header = (const FileHeader*)view.data;
+            if(view.size < sizeof(FileHeader) || header->magic != kCacheMagic || header->version != kCacheVersion ||
+               header->key != key || header->payloadBytes != view.size - sizeof(FileHeader)) {
+
+                Warn("Deleting corrupt asset cache entry { path: %s, bytes: %llu }", path, (unsigned long long)view.size);
+                FileManager::UnmapAsset(&view);
+                unlink(path);
+                return false;
+            }
+
+            //Note: mark the entry as recently used so it's trimmed last
+            utimensat(AT_FDCWD, path, nullptr, 0);
+
+            view.data+= sizeof(FileHeader);
+            view.size = header->payloadBytes;
+
+            *payloadView = view;
+            return true;
+        }
+
+        // Writes 'chunks' back to back as the cached data for 'key'
+        // Note: entries are written to a temp file and renamed so readers never see a partial entry
+        static void Store(uint64 key, const Chunk* chunks, uint32 chunkCount) {
+            if(!enabled) return;
+
+            char path[PATH_MAX], tmpPath[PATH_MAX];
+            EntryPath(key, path);
+            snprintf(tmpPath, sizeof(tmpPath), "%s.%ld%s", path, (long)syscall(SYS_gettid), kTmpSuffix);
+
+            FileHeader header = {
+                .magic = kCacheMagic,
+                .version = kCacheVersion,
+                .key = key,
+                .payloadBytes = 0,
+            };
+            for(uint32 i = 0; i < chunkCount; ++i) header.payloadBytes+= chunks[i].bytes;
+
+            int fd = open(tmpPath, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+            if(fd < 0) {
+                Warn("Failed to create asset cache entry { tmpPath: %s, linux errno: %d }", tmpPath, errno);
+                return;
+            }
+
+            bool written = WriteAll(fd, &header, sizeof(header));
+            for(uint32 i = 0; written && i < chunkCount; ++i) written = WriteAll(fd, chunks[i].data, chunks[i].bytes);
+
+            close(fd);
+
+            if(!written || rename(tmpPath, path)) {
+                Warn("Failed to write asset cache entry { path: %s, bytes: %llu, linux errno: %d }",
+                     path, (unsigned long long)(sizeof(header) + header.payloadBytes), errno);
+
+                unlink(tmpPath);
+                return;
+            }
+
+            pthread_mutex_lock(&mutex);
+
+            //Note: trim below the limit so we don't trim again on the very next store
+            totalBytes+= sizeof(header) + header.payloadBytes;
+            if(totalBytes > maxBytes) Trim(maxBytes - maxBytes/4, false);
+
+            pthread_mutex_unlock(&mutex);
+        }
+
+        template<uint32 kChunkCount>
+        static inline void Store(uint64 key, const Chunk (&chunks)[kChunkCount]) { Store(key, chunks, kChunkCount); }
+
+        static inline void Store(uint64 key, const void* data, uint64 bytes) {
+            Chunk chunk = { .data = data, .bytes = bytes };
+            Store(key, &chunk, 1);
+        }
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <pthread.h>
+#include <unistd.h>
+#include <new>
+
+#include "types.h"
+#include "panic.h"
+#include "mathUtil.h"
+#include "Memory.h"
+#include "FileManager.h"
+
+// Loads assets on a pool of worker threads and hands the results back to the GL thread
+// Note: a worker maps the job's asset and runs 'load' to decode it. 'complete' then runs on the GL thread from 'Update'
+//       so it can upload the result. Queued jobs are started highest priority first, FIFO within a priority
+// Warn: 'Load', 'Cancel', 'Update' and 'Flush' must be called from the GL thread
+class AssetLoader: NoCopyClass {
+    public:
+        enum Priority { PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH, PRIORITY_COUNT };
+        enum Status   { STATUS_LOADED, STATUS_CANCELED };
+
+        struct Job;
+
+        // Runs on a worker thread
+        // Warn: must not touch GL or 'userData' - decode into 'job->arena' (or malloc) and point 'job->result' at it
+        using LoadFunc = void(*)(Job* job);
+
+        // Runs on the GL thread for every job, even canceled ones, so it can release anything 'load' allocated outside 'job->arena'
+        // Warn: if status is STATUS_CANCELED the owner may already be destroyed - don't touch 'userData'
+        using CompleteFunc = void(*)(Job* job, Status status);
+
+        struct Request {
+            const char* assetPath;
+            Priority priority = PRIORITY_NORMAL;
+
+            LoadFunc load;
+            CompleteFunc complete;
+
+            void* userData = nullptr;
+            uint32 userIndex = 0; //Note: lets one owner tell its jobs apart. Ex. which cubemap face a png belongs to
+        };
+
+        struct Job {
+            Request request;
+
+            FileManager::AssetView view; //Note: unmapped after 'complete' unless 'complete' takes it and clears it
+            Memory::Arena arena;         //Note: freed after 'complete'. Blocks are recycled between jobs
+            void* result;
+
+            private:
+                friend AssetLoader;
+
+                enum State { STATE_QUEUED, STATE_LOADING, STATE_COMPLETED };
+
+                Job* next;
+                State state;
+                bool canceled;
+        };
+
+        //Note: jobs live in a generational pool so handles to finished jobs resolve to nullptr
+        using JobPool = Memory::Pool<Job, true>;
+        using Handle = JobPool::Handle;
+
+        static constexpr uint32 kMaxWorkers = 8;
+
+    private:
+
+        struct JobList {
+            Job *head, *tail;
+
+            inline void Push(Job* job) {
+                job->next = nullptr;
+                if(tail) tail->next = job;
+                else     head = job;
+                tail = job;
+            }
+
+            inline Job* Pop() {
+                Job* job = head;
+                if(job && !(head = job->next)) tail = nullptr;
+                return job;
+            }
+
+            inline void Remove(Job* job) {
+                Job* prev = nullptr;
+                for(Job* j = head; j != job; prev = j, j = j->next) {
+                    RUNTIME_ASSERT(j, "Job isn't in list { job: %p }", job);
+                }
+
+                if(prev) prev->next = job->next;
+                else     head = job->next;
+
+                if(tail == job) tail = prev;
+            }
+        };
+
+        pthread_mutex_t mutex;
+        pthread_cond_t jobQueued, jobCompleted;
+
+        pthread_t workers[kMaxWorkers];
+        uint32 numWorkers;
+        bool quit;
+
+        JobPool jobPool; //Note: only touched by the GL thread
+        JobList completedJobs;
+        JobList queuedJobs[PRIORITY_COUNT];
+
+        uint32 pendingJobCount; //jobs that haven't been handed back to 'complete' yet
+
+        inline void Lock()   { pthread_mutex_lock(&mutex); }
+        inline void Unlock() { pthread_mutex_unlock(&mutex); }
+
+        inline Job* Resolve(const Handle& handle) { return jobPool.Resolve(handle); }
+
+        //Note: requires lock
+        inline Job* PopQueuedJob() {
+            for(int32 priority = PRIORITY_COUNT-1; priority >= 0; --priority) {
+                if(Job* job = queuedJobs[priority].Pop()) return job;
+            }
+            return nullptr;
+        }
+
+        //Note: requires lock
+        inline void CompleteJob(Job* job) {
+            job->state = Job::STATE_COMPLETED;
+            completedJobs.Push(job);
+            pthread_cond_signal(&jobCompleted);
+        }
+
+        void WorkerLoop() {
+
+            Lock();
+            for(;;) {
+
+                Job* job;
+                while(!quit && !(job = PopQueuedJob())) pthread_cond_wait(&jobQueued, &mutex);
+                if(quit) break;
+
+                job->state = Job::STATE_LOADING;
+                Unlock();
+
+                //Note: faulting in the mapped pages happens here too, off the GL thread
+                job->view = FileManager::MapAsset(job->request.assetPath);
+                job->request.load(job);
+
+                Lock();
+                CompleteJob(job);
+            }
+            Unlock();
+        }
+
+        static void* WorkerMain(void* loader) {
+            ((AssetLoader*)loader)->WorkerLoop();
+            return nullptr;
+        }
+
+    public:
+
+        static inline uint32 DefaultWorkerCount() {
+
+            //Note: leave a core for the GL thread
+            long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+            return Max(uint32(1), Min(uint32(numCores > 1 ? numCores-1 : 1), kMaxWorkers));
+        }
+
+        AssetLoader(uint32 numWorkers = DefaultWorkerCount()): numWorkers(numWorkers), quit(false), completedJobs{}, queuedJobs{}, pendingJobCount(0) {
+            RUNTIME_ASSERT(InRange(numWorkers, uint32(1), kMaxWorkers), "Invalid worker count { numWorkers: %u, kMaxWorkers: %u }", numWorkers, kMaxWorkers);
+
+            pthread_mutex_init(&mutex, nullptr);
+            pthread_cond_init(&jobQueued, nullptr);
+            pthread_cond_init(&jobCompleted, nullptr);
+
+            for(uint32 i = 0; i < numWorkers; ++i) {
+                RUNTIME_ASSERT(!pthread_create(&workers[i], nullptr, WorkerMain, this), "Failed to create asset worker { i: %u }", i);
+                pthread_setname_np(workers[i], "AssetLoader");
+            }
+
+            Log("Initialized AssetLoader { numWorkers: %u }", numWorkers);
+        }
+
+        ~AssetLoader() {
+
+            Lock();
+            quit = true;
+            pthread_cond_broadcast(&jobQueued);
+            Unlock();
+
+            //Note: workers finish the job they're on before quiting
+            for(uint32 i = 0; i < numWorkers; ++i) pthread_join(workers[i], nullptr);
+
+            //hand back whatever never ran so owners can release it
+            for(JobList& queue : queuedJobs) {
+                while(Job* job = queue.Pop()) {
+                    job->canceled = true;
+                    CompleteJob(job);
+                }
+            }
+            Update();
+
+            pthread_cond_destroy(&jobCompleted);
+            pthread_cond_destroy(&jobQueued);
+            pthread_mutex_destroy(&mutex);
+        }
+
+        inline uint32 PendingJobCount() const { return pendingJobCount; }
+
+        Handle Load(const Request& request) {
+            RUNTIME_ASSERT(request.assetPath, "Null assetPath");
+            RUNTIME_ASSERT(request.load && request.complete, "Request is missing a callback { assetPath: %s }", request.assetPath);
+            RUNTIME_ASSERT(InRange(request.priority, PRIORITY_LOW, PRIORITY_HIGH), "Invalid priority { assetPath: %s, priority: %d }",
+                           request.assetPath, request.priority);
+
+            //Note: pools don't call constructors and the job's arena needs one
+            Job* job = new(jobPool.Allocate()) Job;
+            job->arena.SetTraceName("AssetLoader job");
+
+            job->request = request;
+            job->view = {};
+            job->result = nullptr;
+            job->canceled = false;
+            job->state = Job::STATE_QUEUED;
+
+            Lock();
+            queuedJobs[request.priority].Push(job);
+            ++pendingJobCount;
+
+            pthread_cond_signal(&jobQueued);
+            Unlock();
+
+            return jobPool.GetHandle(job);
+        }
+
+        // Returns true if the job was canceled or false if it already completed
+        // Note: a job that is already loading finishes on its worker, but its owner gets STATUS_CANCELED
+        bool Cancel(const Handle& handle) {
+
+            Lock();
+
+            Job* job = Resolve(handle);
+            bool canceled = job && !job->canceled;
+            if(canceled) {
+                job->canceled = true;
+
+                if(job->state == Job::STATE_QUEUED) {
+                    queuedJobs[job->request.priority].Remove(job);
+                    CompleteJob(job);
+                }
+            }
+
+            Unlock();
+            return canceled;
+        }
+
+        // Calls 'complete' for up to 'maxCompletions' finished jobs. Returns the number of jobs completed
+        // Note: call once per frame. Limit 'maxCompletions' to spread large uploads across frames
+        uint32 Update(uint32 maxCompletions = MaxUint32()) {
+
+            uint32 completions = 0;
+            for(; completions < maxCompletions; ++completions) {
+
+                Lock();
+                Job* job = completedJobs.Pop();
+                Unlock();
+
+                if(!job) break;
+
+                job->request.complete(job, job->canceled ? STATUS_CANCELED : STATUS_LOADED);
+
+                FileManager::UnmapAsset(&job->view);
+
+                //Note: the arena's blocks go back to the shared block pool so the next job picks them up
+                job->~Job();
+                jobPool.Free(job);
+
+                Lock();
+                --pendingJobCount;
+                Unlock();
+            }
+
+            return completions;
+        }
+
+        // Blocks until every pending job completed
+        void Flush() {
+            while(pendingJobCount) {
+
+                Lock();
+                while(!completedJobs.head) pthread_cond_wait(&jobCompleted, &mutex);
+                Unlock();
+
+                Update();
+            }
+        }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string.h>
+
+#include "types.h"
+#include "memUtil.h"
+#include "customAssert.h"
+
+// Layout of the asset pack - every asset in one file so startup maps a single file instead of opening each asset by path
+//
+//   [AssetPackHeader][AssetPackEntry x entryCount, sorted by pathHash][entry paths][padding][entry data][padding][entry data]...
+//
+// Note: entries are found by the hash of their path and then checked against the path itself so a hash collision misses
+//       the pack instead of returning the wrong asset. The packer refuses to build a pack where two paths share a hash.
+//       Entry data starts on a 'kAssetPackAlignment' boundary so uncompressed entries can be handed out as views straight
+//       into the pack's mapping and madvised without touching their neighbours.
+//       The pack is little endian (arm64 and x86) and is built from the assets directory by 'tools/assetPacker.cpp'
+
+constexpr uint32 kAssetPackMagic     = 'J' | ('T'<<8) | ('P'<<16) | ('K'<<24);
+constexpr uint32 kAssetPackVersion   = 2;
+constexpr uint32 kAssetPackAlignment = KB(4);
+
+constexpr const char* kAssetPackPath = "assets.pack";
+
+enum AssetCompression: uint32 { ASSET_COMPRESSION_NONE, ASSET_COMPRESSION_LZ4, ASSET_COMPRESSION_COUNT };
+
+// 64 bit FNV-1a of the asset path relative to the assets directory. Ex. AssetPathHash("fonts/xolonium_regular.ttf")
+// Note: constexpr so it can hash paths at compile time too. Lookups hash at runtime which is a single pass over the path
+constexpr uint64 AssetPathHash(const char* assetPath) {
+    uint64 hash = 0xCBF29CE484222325ULL;
+    for(; *assetPath; ++assetPath) hash = (hash ^ uint8(*assetPath)) * 0x100000001B3ULL;
+    return hash;
+}
+
+struct AssetPackHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 entryCount;
+    uint32 alignment;
+};
+
+struct AssetPackEntry {
+    uint64 pathHash;
+    uint64 offset;       //Note: from the start of the pack
+    uint64 storedBytes;  //Note: bytes in the pack
+    uint64 bytes;        //Note: bytes once decompressed
+    AssetCompression compression;
+    uint32 pathLength;   //Note: paths aren't null terminated
+    uint64 pathOffset;   //Note: from the start of the pack
+};
+
+COMPILE_ASSERT(sizeof(AssetPackHeader) == 16);
+COMPILE_ASSERT(sizeof(AssetPackEntry) == 48);
+
+// Binary searches the index of the pack at 'pack' for 'assetPath'. Returns nullptr if the asset isn't in the pack
+// Note: hashes in a pack are unique so only the entry with a matching hash has to be checked against 'assetPath'
+inline const AssetPackEntry* FindAssetPackEntry(const void* pack, const AssetPackEntry* entries, uint32 entryCount, const char* assetPath) {
+
+    uint64 pathHash = AssetPathHash(assetPath);
+
+    uint32 first = 0, count = entryCount;
+    while(count) {
+        uint32 halfCount = count >> 1;
+        if(entries[first + halfCount].pathHash < pathHash) {
+            first+= halfCount + 1;
+            count-= halfCount + 1;
+        } else {
+            count = halfCount;
+        }
+    }
+
+    if(first == entryCount || entries[first].pathHash != pathHash) return nullptr;
+
+    const AssetPackEntry* entry = entries + first;
+    bool pathMatches = (strlen(assetPath) == entry->pathLength) && !memcmp(ByteOffset(pack, entry->pathOffset), assetPath, entry->pathLength);
+    return pathMatches ? entry : nullptr;
+}
@@ -3,16 +3,33 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/mman.h>
 
-#include <android/asset_manager_jni.h>
+#if defined(__ANDROID__)
+    #include <android/asset_manager_jni.h>
+#endif
 
 #include "types.h"
 #include "Memory.h"
+#include "AssetPack.h"
+#include "compressionUtil.h"
 
 class FileManager {
 
     private:
-        static inline AAssetManager* assetManager;
+        #if defined(__ANDROID__)
+            static inline AAssetManager* assetManager;
+        #endif
+        
+        // Note: when set assets are mapped from files in this directory instead of the apk. Used by host builds
+        //       and for loading assets pushed to the device without reinstalling
+        static inline const char* assetDirectory;
+        
+        // Note: set by 'InitPack'. Assets in the pack are served out of its single mapping instead of being opened by path
+        static inline const AssetPackEntry* packEntries;
+        static inline uint32 packEntryCount;
     
     public:
 
@@ -30,7 +47,40 @@ class FileManager {
         
         static constexpr uint32 kMaxAssetBytes = MaxUint32() - sizeof(AssetBuffer);
         
+        // Read-only view of an asset that points straight at the apk/file pages instead of a copy of them
+        // Warn: data is NOT null terminated - parse it with 'End()' as the bufferEnd. Views must be released with 'UnmapAsset'
+        class AssetView {
+            private:
+                friend FileManager;
+                
+                void* mapping;       //Note: page aligned start of our mmap or nullptr if we didn't mmap the asset
+                size_t mappingBytes;
+                
+                #if defined(__ANDROID__)
+                    AAsset* asset;   //Note: set when data is AAsset_getBuffer's buffer which lives until the asset is closed
+                #endif
+                
+            public:
+                const uint8* data;
+                uint64 size;
+                
+                inline const char* Chars() const { return (const char*)data; }
+                inline const char* End() const   { return (const char*)data + size; }
+        };
+    
+    private:
+        static inline AssetView packView;
+    
+    public:
+        
+        static void InitDirectory(const char* directoryPath) {
+            RUNTIME_ASSERT(directoryPath, "Null directoryPath");
+            
+            assetDirectory = directoryPath;
+            Log("Initialized asset directory { directoryPath: %s }", directoryPath);
+        }
         
+        #if defined(__ANDROID__)
         static void Init(JNIEnv* env, jobject jAssetManager) {
             RUNTIME_ASSERT(!assetManager, "AssetManager already Initialized { requested jAssetManger: %p, assetManager: %p }", jAssetManager, assetManager);
             
@@ -39,34 +89,261 @@ class FileManager {
             
             Log("Initialed assetManger { jAssetManger: %p, assetManager: %p }", jAssetManager, assetManager);
         }
-
-        static AssetBuffer* OpenAsset(const char* assetPath, Memory::Arena* arena) {
-
-            AAsset* asset = AAssetManager_open(assetManager, assetPath, AASSET_MODE_BUFFER);
-            RUNTIME_ASSERT(asset, "Failed to open asset { assetManger: %p, assetPath: %s }", assetManager, assetPath);
-            
-            off_t bytes= AAsset_getLength(asset);
-            RUNTIME_ASSERT(bytes <= kMaxAssetBytes, "Asset exceeds maximum size { assetPath: %s, bytes: %lu, kMaxAssetBytes: u% }",
-                           assetPath, bytes, kMaxAssetBytes);
-            
-            AssetBuffer* buffer = (AssetBuffer*)arena->PushBytes(AssetBuffer::AllocSize(bytes), false);
-            buffer->size = bytes;
-            
-            // Keep reading asset until everything is full
-            uint8* dataEnd = (uint8*)ByteOffset(buffer->data, bytes);
-            while(bytes > 0) {
-               
-                int32 readSize = AAsset_read(asset, ByteOffset(dataEnd, -bytes), bytes);
-                RUNTIME_ASSERT(readSize > 0,
-                               "Failed To Read Asset { asset: %d, assetPath: %s, assetBytes: %d, position: %d, error: %d }",
-                               asset, assetPath, buffer->size, bytes, readSize
-                );
-               
-                bytes-= readSize;
+        #endif
+    
+    private:
+        
+        // Maps [offset, offset+bytes) of 'fd' read-only. mmap needs a page aligned offset so we map from the page
+        // that contains 'offset' and point the view past the head of that page
+        static AssetView MapFileRange(int fd, off_t offset, uint64 bytes, const char* assetPath) {
+            
+            AssetView view = {};
+            view.size = bytes;
+            
+            //Note: mmap fails on empty ranges, an empty view just has no data
+            if(!bytes) return view;
+            
+            size_t pageBytes = sysconf(_SC_PAGESIZE);
+            off_t pageOffset = offset - (offset % pageBytes);
+            size_t headBytes = offset - pageOffset;
+            
+            view.mappingBytes = headBytes + bytes;
+            view.mapping = mmap(nullptr, view.mappingBytes, PROT_READ, MAP_PRIVATE, fd, pageOffset);
+            RUNTIME_ASSERT(view.mapping != MAP_FAILED,
+                           "Failed to map asset { assetPath: %s, offset: %ld, bytes: %llu, linux errno: %d }",
+                           assetPath, (long)offset, (unsigned long long)bytes, errno);
+            
+            // Note: assets are read front to back by every parser we have
+            madvise(view.mapping, view.mappingBytes, MADV_SEQUENTIAL);
+            
+            view.data = (const uint8*)ByteOffset(view.mapping, headBytes);
+            return view;
+        }
+        
+        static void DirectoryAssetPath(const char* assetPath, char (&filePath)[PATH_MAX]) {
+            int filePathLength = snprintf(filePath, sizeof(filePath), "%s/%s", assetDirectory, assetPath);
+            RUNTIME_ASSERT(filePathLength > 0 && uint32(filePathLength) < sizeof(filePath),
+                           "Asset path is too long { assetDirectory: %s, assetPath: %s }", assetDirectory, assetPath);
+        }
+        
+        static AssetView MapDirectoryAsset(const char* assetPath) {
+            
+            char filePath[PATH_MAX];
+            DirectoryAssetPath(assetPath, filePath);
+            
+            AssetView view;
+            RUNTIME_ASSERT(MapFile(filePath, &view), "Failed to open asset { filePath: %s, linux errno: %d }", filePath, errno);
+            return view;
+        }
+        
+        static AssetView MapPackEntry(const AssetPackEntry* entry, const char* assetPath) {
+            
+            const uint8* entryData = packView.data + entry->offset;
+            
+            AssetView view = {};
+            view.size = entry->bytes;
+            
+            switch(entry->compression) {
+                
+                case ASSET_COMPRESSION_NONE: {
+                    
+                    //Note: the whole pack is advised random so tell the kernel to read ahead just for this entry.
+                    //      madvise needs a page aligned address which entries are unless the apk didn't page align the pack
+                    if(packView.mapping && entry->storedBytes) {
+                        void* adviseStart = (void*)AlignedDownPow2(entryData, sysconf(_SC_PAGESIZE));
+                        madvise(adviseStart, ByteDistance(entryData, adviseStart) + entry->storedBytes, MADV_SEQUENTIAL);
+                    }
+                    
+                    view.data = entryData;
+                    return view;
+                }
+                
+                case ASSET_COMPRESSION_LZ4: {
+                    if(!entry->bytes) return view;
+                    
+                    //Note: decompressed into private pages so 'UnmapAsset' releases them like any other mapping
+                    view.mappingBytes = entry->bytes;
+                    view.mapping = mmap(nullptr, view.mappingBytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+                    RUNTIME_ASSERT(view.mapping != MAP_FAILED,
+                                   "Failed to map decompressed asset { assetPath: %s, bytes: %llu, linux errno: %d }",
+                                   assetPath, (unsigned long long)entry->bytes, errno);
+                    
+                    RUNTIME_ASSERT(Lz4DecompressBlock(entryData, entry->storedBytes, (uint8*)view.mapping, entry->bytes),
+                                   "Corrupt lz4 asset in pack { assetPath: %s, storedBytes: %llu, bytes: %llu }",
+                                   assetPath, (unsigned long long)entry->storedBytes, (unsigned long long)entry->bytes);
+                    
+                    mprotect(view.mapping, view.mappingBytes, PROT_READ);
+                    
+                    view.data = (const uint8*)view.mapping;
+                    return view;
+                }
+                
+                default: Panic("Unknown asset compression { assetPath: %s, compression: %u }", assetPath, entry->compression);
+            }
+        }
+    
+    public:
+        
+        // Maps any file on disk read-only. Returns false if the file can't be opened
+        // Note: used for files outside the assets (ex. the asset cache). Release the view with 'UnmapAsset'
+        static bool MapFile(const char* filePath, AssetView* view) {
+            RUNTIME_ASSERT(filePath, "Null filePath");
+            
+            int fd = open(filePath, O_RDONLY|O_CLOEXEC);
+            if(fd < 0) return false;
+            
+            struct stat fileStat;
+            RUNTIME_ASSERT(!fstat(fd, &fileStat), "Failed to stat file { filePath: %s, linux errno: %d }", filePath, errno);
+            
+            *view = MapFileRange(fd, 0, fileStat.st_size, filePath);
+            
+            //Note: the mapping keeps its own reference to the file
+            close(fd);
+            return true;
+        }
+        
+        // Returns true if 'assetPath' can be opened by the directory or apk backend
+        // Note: doesn't look in the pack
+        static bool AssetExists(const char* assetPath) {
+            
+            if(assetDirectory) {
+                char filePath[PATH_MAX];
+                DirectoryAssetPath(assetPath, filePath);
+                return !access(filePath, R_OK);
+            }
+            
+            #if defined(__ANDROID__)
+                AAsset* asset = AAssetManager_open(assetManager, assetPath, AASSET_MODE_UNKNOWN);
+                if(asset) AAsset_close(asset);
+                return asset;
+            #else
+                return false;
+            #endif
+        }
+        
+        // Maps the asset pack built by 'tools/assetPacker.cpp' so later 'MapAsset' calls are served from it.
+        // Returns false and keeps opening assets by path if there's no pack
+        // Warn: must be called after 'Init'/'InitDirectory' and before any asset is mapped on another thread
+        static bool InitPack(const char* packAssetPath = kAssetPackPath) {
+            RUNTIME_ASSERT(!packEntries, "Asset pack already initialized { packAssetPath: %s }", packAssetPath);
+            
+            if(!AssetExists(packAssetPath)) {
+                Log("No asset pack found, opening assets by path { packAssetPath: %s }", packAssetPath);
+                return false;
+            }
+            
+            //Note: the pack must be stored uncompressed in the apk (see 'noCompress' in build.gradle) to be mapped instead of inflated
+            packView = MapAsset(packAssetPath);
+            if(packView.mapping) madvise(packView.mapping, packView.mappingBytes, MADV_RANDOM);
+            
+            const AssetPackHeader* header = (const AssetPackHeader*)packView.data;
+            RUNTIME_ASSERT(packView.size >= sizeof(AssetPackHeader) && header->magic == kAssetPackMagic,
+                           "Invalid asset pack { packAssetPath: %s, size: %llu }", packAssetPath, (unsigned long long)packView.size);
+            
+            RUNTIME_ASSERT(header->version == kAssetPackVersion,
+                           "Asset pack version mismatch - rebuild the pack { packAssetPath: %s, version: %u, kAssetPackVersion: %u }",
+                           packAssetPath, header->version, kAssetPackVersion);
+            
+            const AssetPackEntry* entries = (const AssetPackEntry*)ByteOffset(header, sizeof(AssetPackHeader));
+            RUNTIME_ASSERT(sizeof(AssetPackHeader) + uint64(header->entryCount)*sizeof(AssetPackEntry) <= packView.size,
+                           "Asset pack index is truncated { packAssetPath: %s, entryCount: %u, size: %llu }",
+                           packAssetPath, header->entryCount, (unsigned long long)packView.size);
+            
+            for(uint32 i = 0; i < header->entryCount; ++i) {
+                const AssetPackEntry& entry = entries[i];
+                
+                RUNTIME_ASSERT(!i || entries[i-1].pathHash < entry.pathHash,
+                               "Asset pack index isn't sorted { packAssetPath: %s, i: %u }", packAssetPath, i);
+                
+                RUNTIME_ASSERT(entry.offset <= packView.size && entry.storedBytes <= packView.size - entry.offset,
+                               "Asset pack entry is out of bounds { packAssetPath: %s, i: %u, offset: %llu, storedBytes: %llu }",
+                               packAssetPath, i, (unsigned long long)entry.offset, (unsigned long long)entry.storedBytes);
+                
+                RUNTIME_ASSERT(entry.pathOffset <= packView.size && entry.pathLength <= packView.size - entry.pathOffset,
+                               "Asset pack entry path is out of bounds { packAssetPath: %s, i: %u, pathOffset: %llu, pathLength: %u }",
+                               packAssetPath, i, (unsigned long long)entry.pathOffset, entry.pathLength);
             }
-            AAsset_close(asset);
             
-            *dataEnd = 0; //null terminate data - Note: 'AssetBuffer::AllocSize' reserves 1 extra byte for trailing null
+            packEntryCount = header->entryCount;
+            packEntries = entries;
+            
+            Log("Initialized asset pack { packAssetPath: %s, entryCount: %u, bytes: %llu }",
+                packAssetPath, packEntryCount, (unsigned long long)packView.size);
+            return true;
+        }
+        
+        // Maps an asset without copying it
+        // Note: assets in the pack are served from its mapping, others are opened by path.
+        //       Uncompressed apk assets are mapped straight out of the apk. Compressed assets can't be, so we fall back
+        //       to AAsset_getBuffer which inflates them once into memory owned by the AAsset
+        static AssetView MapAsset(const char* assetPath) {
+            
+            if(packEntries) {
+                
+                //Note: assets missing from the pack (ex. added since it was built) still load by path below
+                if(const AssetPackEntry* entry = FindAssetPackEntry(packView.data, packEntries, packEntryCount, assetPath)) {
+                    return MapPackEntry(entry, assetPath);
+                }
+            }
+            
+            if(assetDirectory) return MapDirectoryAsset(assetPath);
+            
+            #if defined(__ANDROID__)
+                AAsset* asset = AAssetManager_open(assetManager, assetPath, AASSET_MODE_BUFFER);
+                RUNTIME_ASSERT(asset, "Failed to open asset { assetManger: %p, assetPath: %s }", assetManager, assetPath);
+                
+                off64_t offset, bytes;
+                int fd = AAsset_openFileDescriptor64(asset, &offset, &bytes);
+                if(fd >= 0) {
+                    AssetView view = MapFileRange(fd, offset, bytes, assetPath);
+                    
+                    close(fd);
+                    AAsset_close(asset);
+                    return view;
+                }
+                
+                AssetView view = {};
+                view.size = AAsset_getLength64(asset);
+                view.data = (const uint8*)AAsset_getBuffer(asset);
+                RUNTIME_ASSERT(view.data, "Failed to get asset buffer { assetPath: %s, bytes: %llu }", assetPath, (unsigned long long)view.size);
+                
+                view.asset = asset;
+                return view;
+            #else
+                Panic("Failed to map asset - no asset directory set { assetPath: %s }", assetPath);
+            #endif
+        }
+        
+        static void UnmapAsset(AssetView* view) {
+            RUNTIME_ASSERT(view, "Null view");
+            
+            if(view->mapping) {
+                RUNTIME_ASSERT(!munmap(view->mapping, view->mappingBytes),
+                               "Failed to unmap asset { mapping: %p, mappingBytes: %zu, linux errno: %d }",
+                               view->mapping, view->mappingBytes, errno);
+            }
+            
+            #if defined(__ANDROID__)
+                if(view->asset) AAsset_close(view->asset);
+            #endif
+            
+            *view = {};
+        }
+        
+        // Copies an asset into 'arena'. Prefer 'MapAsset' which doesn't copy
+        static AssetBuffer* OpenAsset(const char* assetPath, Memory::Arena* arena) {
+            
+            AssetView view = MapAsset(assetPath);
+            RUNTIME_ASSERT(view.size <= kMaxAssetBytes, "Asset exceeds maximum size { assetPath: %s, bytes: %llu, kMaxAssetBytes: %u }",
+                           assetPath, (unsigned long long)view.size, kMaxAssetBytes);
+            
+            AssetBuffer* buffer = (AssetBuffer*)arena->PushBytes(AssetBuffer::AllocSize(view.size), false);
+            buffer->size = view.size;
+            
+            CopyMemory(buffer->data, (void*)view.data, view.size);
+            buffer->data[view.size] = 0; //null terminate data - Note: 'AssetBuffer::AllocSize' reserves 1 extra byte for trailing null
+            
+            UnmapAsset(&view);
             return buffer;
         }
         
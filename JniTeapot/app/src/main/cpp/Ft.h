@@ -2,14 +2,63 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+
+#include <stdlib.h>
+#include <pthread.h>
 
 #include "types.h"
 #include "panic.h"
+#include "AllocationCounters.h"
 
 FT_Library ftlib;
 
+// Note: FreeType allocates through the FT_Memory it was created with. This is the same as FreeType's
+//       default malloc based allocator except every allocation is counted
+static void* FtAlloc(FT_Memory memory, long bytes) {
+    AllocationCounters::Count(AllocationCounters::COUNTER_FREETYPE_MALLOCS);
+    return malloc(bytes);
+}
+
+static void* FtRealloc(FT_Memory memory, long currentBytes, long newBytes, void* block) {
+    AllocationCounters::Count(AllocationCounters::COUNTER_FREETYPE_MALLOCS);
+    return realloc(block, newBytes);
+}
+
+static void FtFree(FT_Memory memory, void* block) { free(block); }
+
+static FT_MemoryRec_ ftMemory = {
+    .user = nullptr,
+    .alloc = FtAlloc,
+    .free = FtFree,
+    .realloc = FtRealloc,
+};
+
 static CrtGlobalInitFunc FtInit() {
-    FT_Error error = FT_Init_FreeType(&ftlib);
+
+    //Note: this is what FT_Init_FreeType does, but with our own FT_Memory
+    FT_Error error = FT_New_Library(&ftMemory, &ftlib);
     if(error) Panic("Failed to Initialize FreeType library - error: %d", error);
+
+    FT_Add_Default_Modules(ftlib);
+    FT_Set_Default_Properties(ftlib);
+
     Log("Initialed FreeType library at address: %p | ftLib handle: %p", ftlib, &ftlib);
-}
\ No newline at end of file
+}
+
+// Note: FreeType requires creating and destroying faces to be serialized when they share a library.
+//       GlText faces can be created on AssetLoader workers so always go through these
+static pthread_mutex_t ftLibraryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline FT_Error FtNewMemoryFace(const FT_Byte* data, FT_Long bytes, FT_Long faceIndex, FT_Face* face) {
+    pthread_mutex_lock(&ftLibraryMutex);
+    FT_Error error = FT_New_Memory_Face(ftlib, data, bytes, faceIndex, face);
+    pthread_mutex_unlock(&ftLibraryMutex);
+    return error;
+}
+
+static inline void FtDoneFace(FT_Face face) {
+    pthread_mutex_lock(&ftLibraryMutex);
+    FT_Done_Face(face);
+    pthread_mutex_unlock(&ftLibraryMutex);
+}
@@ -134,6 +134,7 @@ class GlCamera {
 
         inline GlTransform GetTransform()        const { return transform; }
         inline Mat4<float> GetProjectionMatrix() const { return projectionMatrix; }
+        inline int         ViewportHeight()      const { return viewportHeight; }
         
         inline Mat4<float> GetViewMatrix() {
             if(flags & FLAG_CAM_TRANSFORM_UPDATED) {
@@ -7,14 +7,21 @@
 
 #include "util.h"
 #include "FileManager.h"
+#include "AssetLoader.h"
+#include "AssetCache.h"
 #include "Memory.h"
+#include "MeshFile.h"
+#include "MeshCodec.h"
+#include "ObjMesh.h"
+#include "GltfMesh.h"
 
 class GlObject : public GlRenderable {
     private:
         
         enum Attribs      { ATTRIB_GEO_VERT, ATTRIB_NORMAL_VERT, ATTRIB_UV_VERT };
         enum TextureUnits { TU_SKY_MAP, TU_DEPTH_TEXTURE};
-        enum Uniforms     { UNIFORM_MIRROR_CONSTANT, UNIFORM_LIGHT_POSITION, UNIFORM_CUBEMAP_MATRIX_INDEX };
+        enum Uniforms     { UNIFORM_MIRROR_CONSTANT, UNIFORM_LIGHT_POSITION, UNIFORM_CUBEMAP_MATRIX_INDEX,
+                            UNIFORM_POSITION_SCALE, UNIFORM_POSITION_OFFSET, UNIFORM_OCTAHEDRAL_NORMALS };
         enum UBlocks      { UBLOCK_OBJECT };
 
         static inline constexpr int kUsePerspectiveDepthMap = 0;
@@ -52,11 +59,35 @@ class GlObject : public GlRenderable {
             }
         );
 
+        //Note: decodes quantized vertices the same way as ComputeMeshPositionTransform and OctahedralDecode in MeshFile.h.
+        //      The uniforms are set by 'UploadMesh'
+        static inline constexpr StringLiteral kVertexDecodeFunctions = Shader(
+
+            ShaderUniform(UNIFORM_POSITION_SCALE)     vec3 positionScale;
+            ShaderUniform(UNIFORM_POSITION_OFFSET)    vec3 positionOffset;
+            ShaderUniform(UNIFORM_OCTAHEDRAL_NORMALS) int octahedralNormals;
+
+            vec3 decodePosition(vec3 position) {
+                return positionOffset + positionScale*position;
+            }
+
+            vec3 decodeNormal(vec3 normal) {
+                if(octahedralNormals == 0) return normal;
+
+                vec3 v = vec3(normal.xy, 1. - abs(normal.x) - abs(normal.y));
+                float t = max(-v.z, 0.);
+                v.xy+= vec2(v.x >= 0. ? -t : t, v.y >= 0. ? -t : t);
+                return v;
+            }
+        );
+
         static inline constexpr StringLiteral kVertexShaderSource = Shader(
             ShaderVersion(kShaderVersion)
             
             ShaderInclude(kObjectBlock)
 
+            ShaderInclude(kVertexDecodeFunctions)
+
             ShaderIn(ATTRIB_GEO_VERT)    vec3 position;
             ShaderIn(ATTRIB_NORMAL_VERT) vec3 normal;
             ShaderIn(ATTRIB_UV_VERT)     vec2 uv;
@@ -67,12 +98,14 @@ class GlObject : public GlRenderable {
 
             void main() {
 
-                vec4 v4Position = vec4(position, 1.);
+                vec3 modelPosition = decodePosition(position);
+
+                vec4 v4Position = vec4(modelPosition, 1.);
                 gl_Position = mvpMatrix*v4Position;
 
-                fragNormal = mat3(normalMatrix) * normal;
+                fragNormal = mat3(normalMatrix) * decodeNormal(normal);
                 fragWorldPosition = (modelMatrix * v4Position).xyz;
-                fragPosition = position;
+                fragPosition = modelPosition;
             }
         );
 
@@ -577,6 +610,7 @@ class GlObject : public GlRenderable {
             ShaderInclude(kObjectBlock)
 
             ShaderInclude(kShaderFunctions)
+            ShaderInclude(kVertexDecodeFunctions)
 
             ShaderUniform(UNIFORM_CUBEMAP_MATRIX_INDEX) int cubemapMatrixIndex;
 
@@ -587,7 +621,7 @@ class GlObject : public GlRenderable {
 
             void main() {
                 
-                vec4 projectedPosition = depthProjection(position, cubemapMatrix[cubemapMatrixIndex]);
+                vec4 projectedPosition = depthProjection(decodePosition(position), cubemapMatrix[cubemapMatrixIndex]);
                 gl_Position = projectedPosition;
 
                 fragXY = projectedPosition.xy;
@@ -628,9 +662,10 @@ class GlObject : public GlRenderable {
         );        
  
         enum Flag {
-            FLAG_NORMAL                = 1<<0,
-            FLAG_UV                    = 1<<1,
-            FLAG_OBJ_TRANSFORM_UPDATED = 1<<2
+            FLAG_NORMAL                = MESH_FLAG_NORMAL,
+            FLAG_UV                    = MESH_FLAG_UV,
+            FLAG_CLOSED                = MESH_FLAG_CLOSED,
+            FLAG_OBJ_TRANSFORM_UPDATED = 1<<3
         };
 
         struct alignas(16) UniformObjectBlock {
@@ -660,392 +695,295 @@ class GlObject : public GlRenderable {
         uint32 flags;
         uint32 numIndices;
         GLenum elementType;
+        uint32 indexStride;
+        
+        //Note: cpu copy of the mesh's lods and meshlets so draws can pick a lod and skip the meshlets that can't be seen.
+        //      The frustums, camera position and lods are in model space and updated with the uniform block
+        Memory::Arena meshletArena;
+        const Meshlet* meshlets;
+        const MeshLod* lods;
+        uint32 numLods;
         
-        inline uint32 AllocateVBO(uint32 numVerts, uint32 vboStride) {
+        Vec3<float> boundsCenter;
+        float boundsRadius;
+        
+        FrustumPlanes viewFrustum, cubemapFrustums[6];
+        Vec3<float> modelCameraPosition;
+        uint32 viewLod, cubemapLods[6];
+        
+        //Note: lods are picked so their error covers at most this many pixels
+        static constexpr float kLodPixelError = 1.f;
+        
+        AssetLoader* assetLoader;
+        AssetLoader::Handle loadJob;
+        
+        inline uint32 AllocateVBO(uint32 numVerts, uint32 vboStride, const void* data = nullptr) {
             uint32 vboBytes = numVerts*vboStride;
             glBindBuffer(GL_ARRAY_BUFFER, vbo);
             
-            glBufferData(GL_ARRAY_BUFFER, vboBytes, nullptr, GL_STATIC_DRAW);
+            GlBufferData(GL_ARRAY_BUFFER, vboBytes, data, GL_STATIC_DRAW);
             GlAssertNoError("Failed to allocate vbo. { numVerts: %u, vboBytes: %u, vboStride: %u }",
                             numVerts, vboBytes, vboStride);
             
             return vboBytes;
         }
 
-        inline uint32 AllocateElementsBuffer(uint32 numIndices, uint32 indexStride) {
+        inline uint32 AllocateElementsBuffer(uint32 numIndices, uint32 indexStride, const void* data = nullptr) {
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
             uint32 elementBufferBytes = numIndices*indexStride;
 
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementBufferBytes, nullptr, GL_STATIC_DRAW);
+            GlBufferData(GL_ELEMENT_ARRAY_BUFFER, elementBufferBytes, data, GL_STATIC_DRAW);
             GlAssertNoError("Failed to allocate element buffer { numIndices: %u, elementBufferBytes: %u, indexStride: %u }",
                             numIndices, elementBufferBytes, indexStride);
             
             return elementBufferBytes;
         }
         
-        template<uint32 kAttribute, typename ArenaT>
-        static inline uint32 InterleaveVboWithArena(const Memory::Arena* arena, uint32 numElements, void* vboPtr, uint32 vboStride, uint32 vboOffset) {
-            
-            glEnableVertexAttribArray(kAttribute);
-            glVertexAttribPointer(kAttribute, GlAttributeSize<ArenaT>(),
-                                  GlAttributeType<ArenaT>(), GL_FALSE, vboStride, reinterpret_cast<void*>(vboOffset));
-    
-            arena->CopyToBuffer<ArenaT>(numElements, ByteOffset(vboPtr, vboOffset), sizeof(ArenaT), vboStride);
-            return vboOffset + sizeof(Vec3<float>);
-        }
+        // Mesh file ready to upload and the mapping it lives in
+        struct Mesh {
+            MeshFileView file;
+            FileManager::AssetView cacheView; //Note: set when the mesh file was mapped from the asset cache
+        };
         
-        struct UploadBufferParams {
-
-            struct Indices {
-                uint vertex;
-                uint uv;
-                uint normal;
-            };        
-            
-            Memory::Arena geoVertArena, normalVertArena, uvVertArena;
-            
-            Memory::Arena* indicesArena;
-            Memory::Region indicesStartRegion, indicesStopRegion;
-            
-            uint32 numIndices, numGeoVerts, numNormalVerts, numUvVerts;
+        //Note: hashed into an obj's or glb's cache key. Bump version when 'ObjMesh::Build' changes the meshes it builds
+        struct MeshCacheParams {
+            uint32 version;
+            uint32 creaseDegrees; //Note: not a float so the params have a unique byte representation
+            MeshVertexFormat vertexFormat;
+        };
+        static constexpr MeshCacheParams kMeshCacheParams = {
+            .version = 8,
+            .creaseDegrees = 60,
+            .vertexFormat = kMeshVertexFormatCompact,
         };
         
-        template<typename ElementT>
-        void UploadBuffers(UploadBufferParams* params) {
-    
-            numIndices = params->numIndices;
-            uint32 numVerts = params->numGeoVerts;
-
-            // Sanity Check that numbers make sense. 
-            // Note: vertices can be used with multiple vertices. 
-            //       `minIndices` is the logical lower bound on number of indices needed to represent all vertices
-            uint32 minIndices = 3*numVerts;
-            if(numIndices <= minIndices) {
-                Warn("Num verts [%d] needs at least [%d] num indicies, but got [%d] num indicies? Ignoring extra vertices.",
-                    numVerts, minIndices, numIndices);
-            }
-
-            elementType = GlAttributeType<ElementT>();
-                        
-            // compute vbo stride
-            // Note: vbo always contain geoVerts & normals (we compute them if not provided). UV is optional
-            uint32 vboStride = 2*sizeof(Vec3<float>);
-            if(flags&FLAG_UV) vboStride+= sizeof(Vec2<float>);
+        static inline bool HasExtension(const char* assetPath, const char* extension) {
+            size_t pathLength = strlen(assetPath), extensionLength = strlen(extension);
+            return pathLength >= extensionLength && !strcmp(assetPath + pathLength - extensionLength, extension);
+        }
+        
+        // Returns the mesh in 'assetView'. Mesh files are used as is, so are glbs that are already laid out like one.
+        // Other glbs and objs come from the asset cache or are parsed and cached
+        // Note: doesn't touch GL or the object so it can run on an AssetLoader worker. 
+        //       A mesh file's or glb's view points into 'assetView' so keep it mapped until the mesh is uploaded. Release the mesh with 'ReleaseMesh'.
+        //       Objs and glbs are parsed and built on up to 'maxThreads' threads
+        static Mesh LoadMesh(const FileManager::AssetView& assetView, const char* assetPath, Memory::Arena* arena, uint32 maxThreads) {
             
-            // allocate buffers
-            glBindVertexArray(vao);
-            uint32 vboBytes = AllocateVBO(numVerts, vboStride);
-            uint32 elementBufferBytes = AllocateElementsBuffer(params->numIndices, sizeof(ElementT));
+            Mesh mesh = {};
             
-            void* vboPtr = glMapBufferRange(GL_ARRAY_BUFFER, 0, vboBytes, GL_MAP_WRITE_BIT);
-            GlAssert(vboPtr, "Failed to map vbo buffer");
-    
-            void* elementPtr = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, elementBufferBytes, GL_MAP_WRITE_BIT) ;
-            GlAssert(elementPtr, "Failed to map element buffer");
-    
-            //upload geoVerts
-            uint32 vboOffset = InterleaveVboWithArena<ATTRIB_GEO_VERT, Vec3<float>>(&params->geoVertArena, numVerts, vboPtr, vboStride, 0);
+            if(HasExtension(assetPath, kMeshFileExtension)) {
+                RUNTIME_ASSERT(ReadMeshFile(assetView.data, assetView.size, &mesh.file),
+                               "Invalid mesh file { assetPath: %s, bytes: %llu }", assetPath, (unsigned long long)assetView.size);
+                return mesh;
+            }
             
-            using Indicies = UploadBufferParams::Indices;
-
-            // TODO: Now that we support 'shuffled' normal indicies cleanup this code and
-            //       and allow for UV Indices as well
-
-            if(flags&FLAG_NORMAL) {
-
-                // Flatten normalVertArena into buffer
-                uint32 numNormalVerts = params->numNormalVerts;
-                uint32 normalBufferBytes = numNormalVerts * sizeof(Vec3<float>);
-                Vec3<float>* normalBuffer = static_cast<Vec3<float>*>(params->normalVertArena.Flatten(normalBufferBytes));
-                
-                // Create tmpBuffer for vertex ordered buffer
-                // TODO: we assign an average normal direction to vertex in the VBO. 
-                //       This is technically wrong IE: cube can have two different normal directions per vertex
-                //       what we really should do is have a separate normal buffer that is indexed indirectly in vertex shader via an index     
-                Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-                Vec3<float>* tmpVertexOrderedNormalBuffer = static_cast<Vec3<float>*>(Memory::temporaryArena.PushBytes(numVerts * sizeof(Vec3<float>), true, alignof(Vec3<float>))); 
-
-                //Translate indices to type T and copy to GL_ELEMENT_ARRAY_BUFFER
-                Memory::TranslateRegionsToBuffer(
-                    params->indicesStartRegion, params->indicesStopRegion,
-                    params->numIndices, elementPtr,
-                    sizeof(Indicies), sizeof(ElementT),
-                    
-                    [&](void* regionElement, void* bufferElement) {
-                        
-                        Indicies* indices = static_cast<Indicies*>(regionElement);
-
-                        // add normal vector to vertex's average normal vector 
-                        uint32 vertexIndex = indices->vertex;
-                        tmpVertexOrderedNormalBuffer[indices->vertex]+= normalBuffer[indices->normal];
-
-                        // Translate vertexIndex to ElementT type
-                        *static_cast<ElementT*>(bufferElement) = ElementT(vertexIndex);
-                    }
-                );
-
-                // Copy average normal direction to VBO
-                for(uint32 i = 0; i < numVerts; ++i) {
-
-                    Vec3<float>* vboNormal = static_cast<Vec3<float>*>(ByteOffset(vboPtr, vboOffset + vboStride*i));
-                    *vboNormal = tmpVertexOrderedNormalBuffer[i].Normalize();
-                }
-
-                // Enable normal vertex 
-                glEnableVertexAttribArray(ATTRIB_NORMAL_VERT);
-                glVertexAttribPointer(
-                    ATTRIB_NORMAL_VERT, GlAttributeSize<Vec3<float>>(),
-                    GlAttributeType<Vec3<float>>(), GL_FALSE, 
-                    vboStride, reinterpret_cast<void*>(vboOffset)
-                );
-                vboOffset+= sizeof(Vec3<float>);                
-
-                // free tmpVertexOrderedNormalBuffer
-                Memory::temporaryArena.FreeBaseRegion(tmpRegion);
-
-            } else  {
-                
-                //TODO: clean this up and break out to function  
-                
-                Log("Normals not provided in obj file. Computing normals.");
-                
-                //create a temporary block of vectors filled with 0's to compute intermediate math on
-                Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-                Vec3<float>* tmpNormals = (Vec3<float>*)Memory::temporaryArena.PushBytes(numVerts*sizeof(Vec3<float>), true);
+            //Note: the json is tiny next to the vertices so it's parsed before the cache is checked
+            GltfMesh glb;
+            bool isGlb = HasExtension(assetPath, kGlbExtension);
+            if(isGlb) {
+                RUNTIME_ASSERT(glb.Parse(assetView.data, assetView.size),
+                               "Invalid glb { assetPath: %s, bytes: %llu }", assetPath, (unsigned long long)assetView.size);
                 
-                auto computeNormalsAndTranslateIndices = [&](void* regionElements, void* bufferElements) {
-                    Indicies* indices = static_cast<Indicies*>(regionElements);
-                    int index1 = indices[0].vertex,
-                        index2 = indices[1].vertex,
-                        index3 = indices[2].vertex;
-    
-                    //get corresponding vertices from vbo
-                    Vec3<float> *v1 = (Vec3<float>*)ByteOffset(vboPtr, vboStride*index1),
-                                *v2 = (Vec3<float>*)ByteOffset(vboPtr, vboStride*index2),
-                                *v3 = (Vec3<float>*)ByteOffset(vboPtr, vboStride*index3);
-    
-                    //compute the add normal vector
-                    Vec3<float> crossProduct = (*v2 - *v1).Cross(*v3 - *v1).Normalize();
-                    tmpNormals[index1]+= crossProduct;
-                    tmpNormals[index2]+= crossProduct;
-                    tmpNormals[index3]+= crossProduct;
-    
-                    //translate indices to T
-                    ElementT* translatedIndices = (ElementT*)bufferElements;
-                    translatedIndices[0] = (ElementT)index1;
-                    translatedIndices[1] = (ElementT)index2;
-                    translatedIndices[2] = (ElementT)index3;
-                };
-                
-                //compute smooth normals while translating indices to type T and copying to GL_ELEMENT_ARRAY_BUFFER
-                Memory::TranslateRegionsToBuffer(params->indicesStartRegion, params->indicesStopRegion,
-                                                 (params->numIndices)/3, elementPtr,
-                                                 3*sizeof(Indicies), 3*sizeof(ElementT),
-                                                 computeNormalsAndTranslateIndices);
-
-                //average normals and interleave in vbo
-                glEnableVertexAttribArray(ATTRIB_NORMAL_VERT);
-                glVertexAttribPointer(ATTRIB_NORMAL_VERT, 3, GL_FLOAT, GL_FALSE, vboStride, reinterpret_cast<void*>(vboOffset));
-                
-                Memory::TranslateRegionsToBuffer(tmpRegion, Memory::temporaryArena.CreateRegion(),
-                                                 numVerts, ByteOffset(vboPtr, vboOffset),
-                                                 sizeof(Vec3<float>), vboStride,
-                                                 [&](void* regionElement, void* bufferElement){ *(Vec3<float>*)bufferElement = ((Vec3<float>*)regionElement)->Normalize(); });
-    
-                Memory::temporaryArena.FreeBaseRegion(tmpRegion);
-                vboOffset+= sizeof(Vec3<float>);
+                if(glb.ViewMeshFile(arena, &mesh.file)) return mesh;
             }
             
-            //upload uvVerts - TODO: TEST THIS WITH FILE
-            if(flags&FLAG_UV) {
-
-                uint32 numUvVerts = params->numUvVerts;
-                RUNTIME_ASSERT(numUvVerts == 0, "UV not supported!");
+            uint64 cacheKey = AssetCache::Key(assetView.data, assetView.size, kMeshCacheParams);
+            if(AssetCache::Load(cacheKey, &mesh.cacheView)) {
+                if(ReadMeshFile(mesh.cacheView.data, mesh.cacheView.size, &mesh.file)) return mesh;
                 
-                // NOTE: THIS CODE BELOW ONLY WORKS IF EACH uvIndex == geoIndex
-                // vboOffset = InterleaveVboWithArena<ATTRIB_UV_VERT, Vec2<float>>(&params->uvVertArena, numVerts, vboPtr, vboStride, vboOffset);
+                Warn("Ignoring invalid cached mesh { assetPath: %s, bytes: %llu }", assetPath, (unsigned long long)mesh.cacheView.size);
+                FileManager::UnmapAsset(&mesh.cacheView);
             }
             
-            glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-            glUnmapBuffer(GL_ARRAY_BUFFER);
+            float creaseAngle = ToRadians(float(kMeshCacheParams.creaseDegrees));
+            if(isGlb) {
+                mesh.file = glb.Build(arena, creaseAngle, true, kMeshCacheParams.vertexFormat, maxThreads);
+            } else {
+                ObjMesh obj;
+                obj.Parse(assetView.Chars(), assetView.End(), maxThreads);
+                mesh.file = obj.Build(arena, creaseAngle, true, kMeshCacheParams.vertexFormat, maxThreads);
+            }
             
-            glBindVertexArray(0);
+            AssetCache::Store(cacheKey, mesh.file.data, mesh.file.bytes);
+            return mesh;
         }
         
-        char* LoadVertex(char* strPtr, UploadBufferParams* params) {
-            char mode = *++strPtr;
-            switch(mode) {
+        static void ReleaseMesh(Mesh* mesh) {
+            FileManager::UnmapAsset(&mesh->cacheView);
+            *mesh = {};
+        }
         
-                //geometry vertex
-                case ' ':
-                case '\t': {
-                    ++params->numGeoVerts;
+        // Decodes a compressed mesh's vertices and indices straight into the mapped vbo and element buffer
+        // Note: the vao has to be bound since it holds the element buffer binding
+        void UploadCompressedBuffers(const MeshFileView& file) {
             
-                    Vec3<float>* v = params->geoVertArena.PushType<Vec3<float>>();
-                    v->x = StrToFloat(++strPtr, &strPtr);
-                    v->y = StrToFloat(++strPtr, &strPtr);
-                    v->z = StrToFloat(++strPtr, &strPtr);
+            const MeshFileHeader& header = *file.header;
             
-                } break;
+            //Note: glMapBufferRange fails with 0 size
+            auto Decode = [](GLenum target, uint32 bytes, const auto& decode) {
+                if(!bytes) return;
+                
+                //Note: the driver can lose a mapped buffer's contents (ex. when the display mode changes) in which case
+                //      glUnmapBuffer fails and it has to be decoded again
+                for(bool decoded = false; !decoded;) {
+                    void* buffer = glMapBufferRange(target, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                    GlAssert(buffer, "Failed to map buffer { target: 0x%X, bytes: %u }", target, bytes);
+                    
+                    RUNTIME_ASSERT(decode(buffer), "Corrupt compressed mesh { target: 0x%X, bytes: %u }", target, bytes);
+                    decoded = glUnmapBuffer(target);
+                }
+            };
             
-                //texture vertex
-                case 't': {
-                    ++params->numUvVerts;
+            uint32 vboBytes = AllocateVBO(header.vertexCount, header.vertexStride);
+            Decode(GL_ARRAY_BUFFER, vboBytes, [&](void* vertices) {
+                return DecodeMeshVertices(vertices, header.vertexCount, header.vertexStride, (const uint8*)file.vertices, header.vertexBytes);
+            });
             
-                    Vec2<float>* v = params->uvVertArena.PushType<Vec2<float>>();
-                    v->x = StrToFloat(++strPtr, &strPtr);
-                    v->y = StrToFloat(++strPtr, &strPtr);
+            uint32 elementBufferBytes = AllocateElementsBuffer(header.indexCount, header.indexStride);
+            Decode(GL_ELEMENT_ARRAY_BUFFER, elementBufferBytes, [&](void* indices) {
+                return DecodeMeshIndices(indices, header.indexCount, header.indexStride, header.vertexCount, (const uint8*)file.indices, header.indexBytes);
+            });
+        }
+        
+        // Replaces the current mesh with 'file'
+        // Note: vertices and indices go straight from the mesh file to glBufferData so a mapped file is never copied on the cpu.
+        //       Compressed ones are decoded straight into the mapped buffers
+        void UploadMesh(const MeshFileView& file) {
             
-                } break;
-
-                //normal vertex
-                case 'n': {
-                    ++params->numNormalVerts;
+            //Note: indexed by MeshAttributeType and MeshComponentType
+            static constexpr GLuint kAttributeLocations[] = { ATTRIB_GEO_VERT, ATTRIB_NORMAL_VERT, ATTRIB_UV_VERT };
+            COMPILE_ASSERT(ArrayCount(kAttributeLocations) == MESH_ATTRIBUTE_COUNT);
             
-                    Vec3<float>* v = params->normalVertArena.PushType<Vec3<float>>();
-                    v->x = StrToFloat(++strPtr, &strPtr);
-                    v->y = StrToFloat(++strPtr, &strPtr);
-                    v->z = StrToFloat(++strPtr, &strPtr);
+            static constexpr GLenum kComponentTypes[] = { GL_FLOAT, GL_HALF_FLOAT, GL_SHORT, GL_INT_2_10_10_10_REV };
+            static constexpr GLboolean kNormalizedComponents[] = { GL_FALSE, GL_FALSE, GL_TRUE, GL_TRUE };
+            COMPILE_ASSERT(ArrayCount(kComponentTypes) == MESH_COMPONENT_COUNT && ArrayCount(kNormalizedComponents) == MESH_COMPONENT_COUNT);
             
-                } break;
-        
-                default: {
-                    Panic("Unsupported Vertex mode: %d[%c]", mode, mode);
-                }
+            const MeshFileHeader& header = *file.header;
+            
+            flags = (flags & ~(FLAG_NORMAL|FLAG_UV|FLAG_CLOSED)) | (header.flags & (FLAG_NORMAL|FLAG_UV|FLAG_CLOSED));
+            numIndices = header.indexCount;
+            indexStride = header.indexStride;
+            
+            //Note: the file can be unmapped after the upload so the lods and meshlets are copied
+            meshletArena.FreeAll();
+            numLods = header.lodCount;
+            lods = (const MeshLod*)meshletArena.PushBytes(numLods*sizeof(MeshLod), false, alignof(MeshLod));
+            meshlets = (const Meshlet*)meshletArena.PushBytes(header.meshletCount*sizeof(Meshlet), false, alignof(Meshlet));
+            memcpy((MeshLod*)lods, file.lods, numLods*sizeof(MeshLod));
+            memcpy((Meshlet*)meshlets, file.meshlets, header.meshletCount*sizeof(Meshlet));
+            
+            Vec3<float> boundsMin(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+                        boundsMax(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+            boundsCenter = (boundsMin + boundsMax) * .5f;
+            boundsRadius = .5f*(boundsMax - boundsMin).Norm();
+            
+            //Note: lods are picked when the uniform block updates so force an update for the new mesh
+            flags|= FLAG_OBJ_TRANSFORM_UPDATED;
+            
+            switch(header.indexStride) {
+                case sizeof(uint8):  elementType = GlAttributeType<uint8>();  break;
+                case sizeof(uint16): elementType = GlAttributeType<uint16>(); break;
+                default:             elementType = GlAttributeType<uint32>(); break;
             }
-            return strPtr;
-        }
-        
-        char* LoadFace(char* strPtr, UploadBufferParams* params) {
             
-            params->numIndices+= 3;
-    
-            auto assertValidVertexCount = [](int32 vertexCount) {
-                RUNTIME_ASSERT(vertexCount >= 0, "Overflowed maximum allowed number of vertices [%d]", MaxInt32());
-            };
-
-            int32 numGeoVerts    = params->numGeoVerts;
-            int32 numUvVerts     = params->numUvVerts;
-            int32 numNormalVerts = params->numNormalVerts;
-
-            assertValidVertexCount(numGeoVerts);
-            assertValidVertexCount(numUvVerts);
-            assertValidVertexCount(numNormalVerts);
+            glBindVertexArray(vao);
+            if(header.flags&MESH_FLAG_COMPRESSED) {
+                UploadCompressedBuffers(file);
+            } else {
+                AllocateVBO(header.vertexCount, header.vertexStride, file.vertices);
+                AllocateElementsBuffer(header.indexCount, header.indexStride, file.indices);
+            }
             
-            using Indices = UploadBufferParams::Indices;
-            Indices* indiciesArray = static_cast<Indices*>(params->indicesArena->PushBytes(3*sizeof(Indices)));
-
-            // TODO: Right now we only support triangles, but obj files can have arbitrary number of vertices in polygon
-            //       at least throw a warning/error if we are truncating the polygon to just its first triangle 
-            for(int i = 0; i < 3; ++i) {
-
-                Indices& indicies = indiciesArray[i];
-
-                // TODO: Pull out this code duplication into function
-
-                //get vertIndex
-                {
-                    int geoIndex = StrToInt(++strPtr, &strPtr);
-                    indicies.vertex = (geoIndex <= 0) ? geoIndex + numGeoVerts : geoIndex - 1;
-                    RUNTIME_ASSERT(indicies.vertex < numGeoVerts, "Geometry vertex not defined { geoIndex: %d, numGeoVerts: %d }", geoIndex, numGeoVerts);
-                }
- 
-                if(*strPtr != '/') continue;
-
-                //get uvIndex
-                {
-                    flags|= FLAG_UV;
+            //Note: attributes the mesh doesn't have keep their default value
+            for(uint32 i = 0; i < MESH_ATTRIBUTE_COUNT; ++i) glDisableVertexAttribArray(kAttributeLocations[i]);
             
-                    int uvIndex = StrToInt(++strPtr, &strPtr);
-                    indicies.uv = (uvIndex <= 0) ? uvIndex + numUvVerts : uvIndex - 1; 
-                    RUNTIME_ASSERT(indicies.uv == 0 || indicies.uv < numUvVerts, "UV vertex not defined { uvIndex: %d, numUvVerts: %d }", uvIndex, numUvVerts);
-                }
-        
-                if(*strPtr != '/') continue; 
- 
-                //get normalIndex
-                {
-                    flags|= FLAG_NORMAL;
+            MeshPositionTransform positionTransform = {};
+            bool octahedralNormals = false;
             
-                    int normalIndex = StrToInt(++strPtr, &strPtr);
-                    indicies.normal = (normalIndex <= 0) ? normalIndex + numNormalVerts : normalIndex - 1; 
-                    RUNTIME_ASSERT(indicies.normal < numNormalVerts, "Normal vertex not defined { normalIndex: %d, numNormalVerts: %d }", normalIndex, numNormalVerts);
-                }
+            for(uint32 i = 0; i < header.attributeCount; ++i) {
+                const MeshAttribute& attribute = file.attributes[i];
+                
+                GLuint location = kAttributeLocations[attribute.type];
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, attribute.componentCount, kComponentTypes[attribute.componentType],
+                                      kNormalizedComponents[attribute.componentType], header.vertexStride,
+                                      reinterpret_cast<void*>(uintptr_t(attribute.offset)));
+                
+                if(attribute.type == MESH_ATTRIBUTE_POSITION) positionTransform = ComputeMeshPositionTransform(header, attribute);
+                if(attribute.type == MESH_ATTRIBUTE_NORMAL)   octahedralNormals = (attribute.componentCount == 2);
             }
             
-            return strPtr;
+            glBindVertexArray(0);
+            
+            //Note: the depth program never reads normals so its 'octahedralNormals' is optimized out
+            for(GLuint program : { glProgram, glProgramRenderDepthTexture }) {
+                glProgramUniform3fv(program, UNIFORM_POSITION_SCALE, 1, &positionTransform.scale);
+                glProgramUniform3fv(program, UNIFORM_POSITION_OFFSET, 1, &positionTransform.offset);
+            }
+            glProgramUniform1i(glProgram, UNIFORM_OCTAHEDRAL_NORMALS, octahedralNormals);
+            GlAssertNoError("Failed to set vertex decode uniforms { octahedralNormals: %d }", octahedralNormals);
         }
         
-        void LoadObject(const FileManager::AssetBuffer* buffer) {
-    
-            UploadBufferParams uploadParams = {
-                .indicesArena = &Memory::temporaryArena,
-                .indicesStartRegion = Memory::temporaryArena.CreateRegion()
+        // Note: drawn while the real mesh is loading. Unit cube in model space
+        void UploadPlaceholder() {
+            
+            ObjMesh cube;
+            for(uint32 i = 0; i < 8; ++i) {
+                *cube.geoVerts.Push() = Vec3<float>((i&1) ? .5f : -.5f, (i&2) ? .5f : -.5f, (i&4) ? .5f : -.5f);
+            }
+            
+            static constexpr uint8 kCubeIndices[] = {
+                0,2,1, 1,2,3, //-z
+                4,5,6, 5,7,6, //+z
+                0,1,4, 1,5,4, //-y
+                2,6,3, 3,6,7, //+y
+                0,4,2, 2,4,6, //-x
+                1,3,5, 3,7,5, //+x
             };
+            for(uint8 index : kCubeIndices) *cube.indices.Push() = { .vertex = index };
+            
+            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
+            UploadMesh(cube.Build(&Memory::temporaryArena));
+            Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+        }
         
-            char* ptr = (char*)buffer->data;
-            for(;;) {
-                ptr = SkipWhiteSpace(ptr);
-                
-                char c = *ptr;
-                switch(c) {
-
-                    //eof - Finish processing and return
-                    case 0: {
-                        
-                        uploadParams.indicesStopRegion = Memory::temporaryArena.CreateRegion();
-                        
-                             if(!LargerThan8Bit(uploadParams.numGeoVerts))  UploadBuffers<uint8>(&uploadParams);
-                        else if(!LargerThan16Bit(uploadParams.numGeoVerts)) UploadBuffers<uint16>(&uploadParams);
-                        else UploadBuffers<uint32>(&uploadParams);
-    
-                        uploadParams.indicesArena->FreeBaseRegion(uploadParams.indicesStartRegion);
-                        return;
-                    }
-                    
-                    //ignore comments
-                    case '#': break;
-    
-                    //handle vertices
-                    case 'v': ptr = LoadVertex(ptr, &uploadParams);
-                    break;
+        // Runs on an AssetLoader worker
+        // Note: the workers already load meshes side by side so the mesh is parsed on the worker instead of spawning more threads
+        static void LoadMeshJob(AssetLoader::Job* job) {
+            
+            Mesh* mesh = job->arena.PushType<Mesh>();
+            *mesh = LoadMesh(job->view, job->request.assetPath, &job->arena, 1);
+            
+            job->result = mesh;
+        }
         
-                    
-                    //Note: faces - defined by indices in the form 'v/vt/vn' where vt and vn are optional
-                    case 'f': ptr = LoadFace(ptr, &uploadParams);
-                    break;
-
-                    // TODO: this is just to stop annoying calls to panic for common obj tags
-                    //       we really should be checking the full word, not just the start character 
-                    case 'o': Warn("Ignoring objected tag 'o'?");
-                    break;
-
-                    case 's': Warn("Ignoring smooth shading tag 's'?");
-                    break;
-
-                    case 'm': Warn("Ignoring material tag 'mtllib'?");
-                    break;
-
-                    case 'u': Warn("Ignoring use material tag 'usemtl'?");
-                    break;
-                    
-                    default: {
-                        Panic("Unknown object command: %d[%c]", c, c);
-                    }
-                }
-
-                //advance to next line
-                ptr = SkipLine(ptr);
+        static void UploadMeshJob(AssetLoader::Job* job, AssetLoader::Status status) {
+            
+            Mesh* mesh = (Mesh*)job->result;
+            if(!mesh) return; //Note: canceled before it was loaded
+            
+            if(status == AssetLoader::STATUS_LOADED) {
+                GlObject* object = (GlObject*)job->request.userData;
+                object->UploadMesh(mesh->file);
+                
+                Log("Loaded object { object: %p, assetPath: %s, numIndices: %u, cached: %d }",
+                    object, job->request.assetPath, object->numIndices, bool(mesh->cacheView.data));
             }
+            
+            //Note: the mesh file lives in the job's arena, the job's view or the cache mapping
+            ReleaseMesh(mesh);
         }
-
-    public:
         
-        GlObject(const char* objPath, GlCamera* camera, GlSkybox* skybox, const GlTransform& transform = GlTransform()):
+        GlObject(GlCamera* camera, GlSkybox* skybox, const GlTransform& transform, AssetLoader* assetLoader):
                     GlRenderable(camera),
                     skybox(skybox),
                     transform(transform),
-                    flags(FLAG_OBJ_TRANSFORM_UPDATED) {
+                    flags(FLAG_OBJ_TRANSFORM_UPDATED),
+                    meshlets(nullptr),
+                    lods(nullptr),
+                    numLods(0),
+                    assetLoader(assetLoader),
+                    loadJob{} {
             
             SetCamera(camera);
             
@@ -1065,19 +1003,55 @@ class GlObject : public GlRenderable {
             
             //bind uniform block to program
             glBindBufferBase(GL_UNIFORM_BUFFER, UBLOCK_OBJECT, uniformObjectBlockBuffer);
-            glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformObjectBlock), nullptr, GL_DYNAMIC_DRAW);
+            GlBufferData(GL_UNIFORM_BUFFER, sizeof(UniformObjectBlock), nullptr, GL_DYNAMIC_DRAW);
             GlAssertNoError("Failed to bind UniformBlock [%d] to uniformBlockBuffer [%d]", UBLOCK_OBJECT, uniformObjectBlockBuffer);
+        }
+
+    public:
+        
+        // Loads an obj, a glb or a mesh file (.mesh, see MeshFile.h). Mesh files and glbs laid out like them are uploaded
+        // straight from their mapping
+        // Note: if 'assetLoader' is set the mesh is loaded in the background and a placeholder is drawn until it's ready
+        GlObject(const char* assetPath, GlCamera* camera, GlSkybox* skybox, const GlTransform& transform = GlTransform(),
+                 AssetLoader* assetLoader = nullptr, AssetLoader::Priority priority = AssetLoader::PRIORITY_NORMAL):
+                    GlObject(camera, skybox, transform, assetLoader) {
             
-            // load obj
+            if(assetLoader) {
+                UploadPlaceholder();
+                
+                loadJob = assetLoader->Load(AssetLoader::Request {
+                    .assetPath = assetPath,
+                    .priority = priority,
+                    .load = LoadMeshJob,
+                    .complete = UploadMeshJob,
+                    .userData = this,
+                });
+                return;
+            }
+            
+            // load mesh
             Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-            FileManager::AssetBuffer* buffer = FileManager::OpenAsset(objPath, &Memory::temporaryArena);
-            LoadObject(buffer);
+            FileManager::AssetView assetView = FileManager::MapAsset(assetPath);
+            
+            Mesh mesh = LoadMesh(assetView, assetPath, &Memory::temporaryArena, ObjMesh::DefaultParseThreadCount());
+            UploadMesh(mesh.file);
             
+            ReleaseMesh(&mesh);
+            FileManager::UnmapAsset(&assetView);
             Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+        }
+        
+        // Uploads a mesh file that's already in memory. Ex. one the caller mapped with 'FileManager::MapAsset' and 'ReadMeshFile'
+        // Note: 'meshFile' is only read during the constructor
+        GlObject(const MeshFileView& meshFile, GlCamera* camera, GlSkybox* skybox, const GlTransform& transform = GlTransform()):
+                    GlObject(camera, skybox, transform, nullptr) {
             
+            UploadMesh(meshFile);
         }
         
         ~GlObject() {
+            if(assetLoader) assetLoader->Cancel(loadJob);
+            
             glDeleteVertexArrays(1, &vao);
             glDeleteBuffers(ArrayCount(glBuffers), glBuffers);
             glDeleteProgram(glProgram);
@@ -1110,7 +1084,10 @@ class GlObject : public GlRenderable {
                 GlAssert(uniformObjectBlock, "Failed to map uniformObjectBlock");
       
                 //upload mvpMatrix
-                uniformObjectBlock->mvpMatrix = camera->Matrix() * transformMatrix;
+                Mat4<float> mvpMatrix = camera->Matrix() * transformMatrix;
+                uniformObjectBlock->mvpMatrix = mvpMatrix;
+                viewFrustum = ComputeFrustumPlanes(mvpMatrix);
+                viewLod = SelectLod(mvpMatrix, camera->ViewportHeight());
                 
                 //upload mvMatrix
                 if(flags&FLAG_OBJ_TRANSFORM_UPDATED) {
@@ -1124,6 +1101,12 @@ class GlObject : public GlRenderable {
                 GlTransform cameraTransform = camera->GetTransform();
                 uniformObjectBlock->cameraPosition = cameraTransform.position;                
 
+                Mat4<float> inverseTransformMatrix = transform.InverseMatrix();
+                Vec4<float> cameraPosition(cameraTransform.position.x, cameraTransform.position.y, cameraTransform.position.z, 1.f);
+                modelCameraPosition = Vec3<float>(inverseTransformMatrix.Row1().Dot(cameraPosition),
+                                                  inverseTransformMatrix.Row2().Dot(cameraPosition),
+                                                  inverseTransformMatrix.Row3().Dot(cameraPosition));
+
                 //Update cubemap projetion matrices
                 {
                     //TODO: add constexpr support to directions and Mat4!
@@ -1186,8 +1169,13 @@ class GlObject : public GlRenderable {
                         Mat4<float> cubemapViewMatrix = cubemapCameraTransform.InverseMatrix();
                         Mat4<float> modelViewMatrix = cubemapViewMatrix * transformMatrix;
                         
-                        uniformObjectBlock->cubemapMatrix[i] = cubemapProjectionMatrix * modelViewMatrix;
+                        Mat4<float> cubemapMatrix = cubemapProjectionMatrix * modelViewMatrix;
+                        uniformObjectBlock->cubemapMatrix[i] = cubemapMatrix;
                         uniformObjectBlock->cubemapMatrix[i+6] = negCubemapProjectionMatrix * modelViewMatrix;
+                        
+                        //Note: the perspective depth map divides by abs(w) so its clip space isn't a frustum. Those faces are never culled
+                        if constexpr(!kUsePerspectiveDepthMap) cubemapFrustums[i] = ComputeFrustumPlanes(cubemapMatrix);
+                        cubemapLods[i] = SelectLod(cubemapMatrix, skybox->CubeMapSize());
                     }
                 }
 
@@ -1196,6 +1184,53 @@ class GlObject : public GlRenderable {
         }
 
 
+        // Returns the coarsest lod whose error covers at most 'kLodPixelError' pixels when 'matrix' projects the mesh onto
+        // a 'viewportSize' pixel tall viewport
+        // Note: the error is scaled by how far clip space y moves per model space unit and divided by the distance to the
+        //       closest point of the bounding sphere. |w| keeps it working with the perspective depth map's abs(w) divide
+        uint32 SelectLod(Mat4<float> matrix, float viewportSize) const {
+            
+            Vec4<float> rowY = matrix.Row2(), rowW = matrix.Row4();
+            
+            float w = FastAbs(rowW.x*boundsCenter.x + rowW.y*boundsCenter.y + rowW.z*boundsCenter.z + rowW.w) -
+                      boundsRadius*Vec3<float>(rowW.x, rowW.y, rowW.z).Norm();
+            if(w <= 0.f) return 0; //Note: the camera is inside the bounds
+            
+            float pixelsPerUnit = .5f*viewportSize * Vec3<float>(rowY.x, rowY.y, rowY.z).Norm() / w;
+            
+            uint32 lod = 0;
+            while(lod+1 < numLods && lods[lod+1].error*pixelsPerUnit <= kLodPixelError) ++lod;
+            return lod;
+        }
+        
+        // Draws the meshlets of 'lod' that 'cull' doesn't reject or the whole lod if it doesn't have any
+        // Note: GLES 3.1 has no multi draw so visible meshlets next to each other in the element buffer are merged into one draw
+        template<typename CullFunc>
+        void DrawMeshlets(const MeshLod& lod, CullFunc cull) {
+            
+            auto DrawRange = [&](uint32 start, uint32 end) {
+                if(end > start) glDrawElements(GL_TRIANGLES, end - start, elementType, reinterpret_cast<void*>(uintptr_t(start*indexStride)));
+            };
+            
+            if(!lod.meshletCount) {
+                DrawRange(lod.indexOffset, lod.indexOffset + lod.indexCount);
+                return;
+            }
+            
+            uint32 rangeStart = 0, rangeEnd = 0;
+            for(uint32 i = lod.meshletOffset; i < lod.meshletOffset + lod.meshletCount; ++i) {
+                const Meshlet& meshlet = meshlets[i];
+                if(cull(meshlet)) continue;
+                
+                if(meshlet.indexOffset != rangeEnd) {
+                    DrawRange(rangeStart, rangeEnd);
+                    rangeStart = meshlet.indexOffset;
+                }
+                rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+            }
+            DrawRange(rangeStart, rangeEnd);
+        }
+
         void RenderToDepthTexture(const GlContext* context) {
             
             skybox->AttachFBO();
@@ -1253,22 +1288,27 @@ class GlObject : public GlRenderable {
                 // glClear(GL_DEPTH_BUFFER_BIT);
                 // glClearDepthf(1.f);
 
+                const MeshLod& lod = lods[cubemapLods[i]];
+                
                 if constexpr(kUsePerspectiveDepthMap) {
 
+                    auto DrawAll = [](const Meshlet&) { return false; };
+                    
                     //draw ray moving towards cubemap face
                     glDepthRangef(.5f, 1.f);
                     glUniform1i(UNIFORM_CUBEMAP_MATRIX_INDEX, i);
-                    glDrawElements(GL_TRIANGLES, numIndices, elementType, nullptr);
+                    DrawMeshlets(lod, DrawAll);
 
                     //draw ray moving away from cubemap face
                     glDepthRangef(0.f, .5f);
                     glUniform1i(UNIFORM_CUBEMAP_MATRIX_INDEX, i+6);
-                    glDrawElements(GL_TRIANGLES, numIndices, elementType, nullptr);
+                    DrawMeshlets(lod, DrawAll);
 
                 } else {
 
+                    //Note: both sides of the mesh land in the depth map so only the frustum culls
                     glUniform1i(UNIFORM_CUBEMAP_MATRIX_INDEX, i);
-                    glDrawElements(GL_TRIANGLES, numIndices, elementType, nullptr);
+                    DrawMeshlets(lod, [&](const Meshlet& meshlet) { return MeshletOutsideFrustum(meshlet, cubemapFrustums[i]); });
 
                 } 
 
@@ -1336,7 +1376,11 @@ class GlObject : public GlRenderable {
             glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->CubeMapDepthTexture());
             GlAssertNoError("Failed to set skybox depth texture");
 
-            glDrawElements(GL_TRIANGLES, numIndices, elementType, 0);
+            //Note: face culling is off so the inside of an open mesh shows through its holes. Only closed meshes are cone culled
+            bool coneCull = flags&FLAG_CLOSED;
+            DrawMeshlets(lods[viewLod], [&](const Meshlet& meshlet) {
+                return MeshletOutsideFrustum(meshlet, viewFrustum) || (coneCull && MeshletBackFacing(meshlet, modelCameraPosition));
+            });
             GlAssertNoError("Failed to Draw");
 
             glClearDepthf(1.f);
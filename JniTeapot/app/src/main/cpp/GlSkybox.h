@@ -5,6 +5,8 @@
 #include "GlRenderable.h"
 
 #include "FileManager.h"
+#include "AssetLoader.h"
+#include "AssetCache.h"
 #include "lodepng/lodepng.h"
 
 #include "mat.h"
@@ -407,7 +409,7 @@ class GlSkybox : public GlRenderable {
             };
         };
 
-        GLint textureSize;
+        GLint textureSize, maxCubeMapSize;
         bool generateMipmaps;
 
         inline void GenerateCubemapMipmap() {
@@ -445,6 +447,284 @@ class GlSkybox : public GlRenderable {
             }
         }
 
+        struct CubemapFace {
+            const uint8* levels; //Note: RGBA8 mip chain, largest level first and tightly packed
+            uint width, height;
+            uint32 levelCount;
+            
+            void* allocation;                 //Note: malloc'd levels or nullptr if they're read straight from 'cacheView'
+            FileManager::AssetView cacheView;
+        };
+        
+        //Note: hashed into the face's cache key. Bump version when the cached layout or the mip filter changes
+        struct FaceCacheParams {
+            uint32 version;
+            uint32 format;
+        };
+        static constexpr FaceCacheParams kFaceCacheParams = { .version = 1, .format = GL_RGBA8 };
+        
+        struct CachedFaceHeader {
+            uint32 width, height, levelCount, reserved;
+        };
+        
+        const char* cubemapImages[6]; //Note: only kept around for logging
+        CubemapFace loadedFaces[6];   //Note: faces that finished loading but are waiting on the rest
+        uint32 loadedFaceCount;
+        
+        AssetLoader* assetLoader;
+        AssetLoader::Handle faceJobs[6];
+        
+        static inline uint MipSize(uint size, uint32 level) { return Max(size >> level, 1u); }
+        
+        static uint32 MipLevelCount(uint width, uint height) {
+            uint32 levelCount = 1;
+            for(uint size = Max(width, height); size > 1; size>>= 1) ++levelCount;
+            return levelCount;
+        }
+        
+        static uint64 MipChainBytes(uint width, uint height, uint32 levelCount) {
+            uint64 bytes = 0;
+            for(uint32 level = 0; level < levelCount; ++level) bytes+= 4ull*MipSize(width, level)*MipSize(height, level);
+            return bytes;
+        }
+        
+        // 2x2 box filters 'src' into the next smaller mip level
+        // Note: odd sizes clamp the last row/column
+        static void DownsampleMip(const uint8* src, uint srcWidth, uint srcHeight, uint8* dst, uint dstWidth, uint dstHeight) {
+            for(uint y = 0; y < dstHeight; ++y) {
+                
+                const uint8 *row0 = src + 4*srcWidth*Min(2*y,   srcHeight-1),
+                            *row1 = src + 4*srcWidth*Min(2*y+1, srcHeight-1);
+                
+                for(uint x = 0; x < dstWidth; ++x, dst+= 4) {
+                    uint x0 = 4*Min(2*x, srcWidth-1),
+                         x1 = 4*Min(2*x+1, srcWidth-1);
+                    
+                    for(uint c = 0; c < 4; ++c) dst[c] = (row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2;
+                }
+            }
+        }
+        
+        // Returns a face's mip chain from the asset cache or decodes 'png' and caches it
+        // Note: doesn't touch GL so it can run on an AssetLoader worker. Release the face with 'ReleaseFace'
+        static CubemapFace LoadFace(const uint8* png, uint64 pngBytes, const char* assetPath) {
+            
+            CubemapFace face = {};
+            
+            uint64 cacheKey = AssetCache::Key(png, pngBytes, kFaceCacheParams);
+            if(AssetCache::Load(cacheKey, &face.cacheView)) {
+                
+                const CachedFaceHeader* header = (const CachedFaceHeader*)face.cacheView.data;
+                if(face.cacheView.size >= sizeof(CachedFaceHeader) &&
+                   header->levelCount == MipLevelCount(header->width, header->height) &&
+                   face.cacheView.size == sizeof(CachedFaceHeader) + MipChainBytes(header->width, header->height, header->levelCount)) {
+                    
+                    face.levels = face.cacheView.data + sizeof(CachedFaceHeader);
+                    face.width = header->width;
+                    face.height = header->height;
+                    face.levelCount = header->levelCount;
+                    return face;
+                }
+                
+                Warn("Ignoring cached cubemap face with a bad header { assetPath: %s, bytes: %llu }", assetPath, (unsigned long long)face.cacheView.size);
+                FileManager::UnmapAsset(&face.cacheView);
+            }
+            
+            uchar* bitmap;
+            uint error = lodepng_decode_memory(&bitmap, &face.width, &face.height, png, pngBytes, LodePNGColorType::LCT_RGBA, 8);
+            RUNTIME_ASSERT(!error, "Failed to decode cubemap face { assetPath: %s, error: %u [%s] }", assetPath, error, lodepng_error_text(error));
+            
+            //Note: grow lodepng's bitmap to hold the rest of the mip chain after level 0
+            face.levelCount = MipLevelCount(face.width, face.height);
+            uint64 chainBytes = MipChainBytes(face.width, face.height, face.levelCount);
+            
+            uint8* levels = (uint8*)realloc(bitmap, chainBytes);
+            RUNTIME_ASSERT(levels, "Failed to allocate cubemap mip chain { assetPath: %s, chainBytes: %llu }", assetPath, (unsigned long long)chainBytes);
+            
+            uint8* level = levels;
+            for(uint32 i = 1; i < face.levelCount; ++i) {
+                uint srcWidth = MipSize(face.width, i-1), srcHeight = MipSize(face.height, i-1);
+                uint8* nextLevel = level + 4ull*srcWidth*srcHeight;
+                
+                DownsampleMip(level, srcWidth, srcHeight, nextLevel, MipSize(face.width, i), MipSize(face.height, i));
+                level = nextLevel;
+            }
+            
+            face.levels = levels;
+            face.allocation = levels;
+            
+            CachedFaceHeader header = { .width = face.width, .height = face.height, .levelCount = face.levelCount };
+            const AssetCache::Chunk chunks[] = {
+                { .data = &header, .bytes = sizeof(header) },
+                { .data = levels,  .bytes = chainBytes },
+            };
+            AssetCache::Store(cacheKey, chunks);
+            
+            return face;
+        }
+        
+        static void ReleaseFace(CubemapFace* face) {
+            free(face->allocation);
+            FileManager::UnmapAsset(&face->cacheView);
+            *face = {};
+        }
+        
+        // (Re)allocates every cubemap texture at 'size' and fills colorTexture with 'faces'
+        void UploadCubemap(const CubemapFace (&faces)[6], GLint size) {
+            
+            textureSize = size;
+            for(int i = 0; i < 6; ++i) {
+                
+                //TODO: pass in desired width and height so that we can use small initial texture
+                //      but still render to the camera texture at camera resolution
+                //      may require some software magnification/minification of initial texture?
+                //Note: faces carry their own mip chain so we only generate mips if they don't have one
+                uint32 levelCount = generateMipmaps ? faces[i].levelCount : 1;
+                const uint8* levelData = faces[i].levels;
+                
+                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
+                for(uint32 level = 0; level < levelCount; ++level) {
+                    
+                    GLint levelSize = MipSize(size, level);
+                    glTexImage2D(
+                        GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                        level,            //mipmap level
+                        GL_RGBA8,         //internal format
+                        levelSize,
+                        levelSize,
+                        0,                //border must be 0
+                        GL_RGBA,          //input format
+                        GL_UNSIGNED_BYTE, //input type
+                        levelData
+                    );
+                    
+                    levelData+= 4*levelSize*levelSize;
+                }
+
+                //TODO: see if we split 32 bit float across 2 16 bit channels and still have mipmapping work
+                //      (requires us to make an EGL 3.2 context)
+                //      otherwise we need to implement our own mipmapping!
+                //      (mipmapping only supports color renderable and texture filterable)
+
+                //TODO: make sure we have extension GL_EXT_color_buffer_float enabled
+                glBindTexture(GL_TEXTURE_CUBE_MAP, depthColorTexture);
+                glTexImage2D(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                    0,        //mipmap level
+                    GL_RG32F, //internal format
+                    size,
+                    size,
+                    0,        //border must be 0
+                    GL_RG,    //input format
+                    GL_FLOAT, //input type
+                    nullptr   //input data
+                );
+                             
+                glBindTexture(GL_TEXTURE_CUBE_MAP, depthTexture);
+                glTexImage2D(
+                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                    0,                      //mipmap level
+                    GL_DEPTH_COMPONENT32F,  //internal format //TODO: Make sure this works .. may need to use 24 bit instead
+                    size,
+                    size,
+                    0,                      //border must be 0
+                    GL_DEPTH_COMPONENT,     //input format
+                    GL_FLOAT,               //input type
+                    nullptr                 //input data
+                ); 
+
+                GlAssertNoError("Failed to set cubemap image { maxCubeMapSize: %d, side: %d, size: %d }", maxCubeMapSize, i, size);
+            }
+    
+            if(generateMipmaps) {
+                
+                //Generate depthColorTexture mipMap
+                glBindTexture(GL_TEXTURE_CUBE_MAP, depthColorTexture);
+                GenerateCubemapMipmap();
+                
+                //Generate colorTexture mipMap
+                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
+                if(faces[0].levelCount == 1) GenerateCubemapMipmap();
+                
+            } else {
+                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
+            }
+        }
+        
+        // Validates 'loadedFaces', uploads them and releases them
+        void UploadLoadedFaces() {
+            
+            for(int i = 0; i < 6; ++i) {
+                const CubemapFace& face = loadedFaces[i];
+                
+                RUNTIME_ASSERT(face.width == face.height,
+                              "Cubemap width must equal height. { side: %d, assetPath: '%s', width: %u, height: %u }",
+                               i, cubemapImages[i], face.width, face.height);
+                
+                RUNTIME_ASSERT(face.width < maxCubeMapSize,
+                               "Cubemap width is too large { maxCubeMapSize: %d, side: %d, assetPath: '%s', width: %u, height: %u }",
+                               maxCubeMapSize, i, cubemapImages[i], face.width, face.height);
+
+                RUNTIME_ASSERT(face.height < maxCubeMapSize,
+                               "Cubemap height is too large { maxCubeMapSize: %d, side: %d, assetPath: '%s', width: %u, height: %u }",
+                               maxCubeMapSize, i, cubemapImages[i], face.width, face.height);
+
+                RUNTIME_ASSERT(face.width == loadedFaces[0].width,
+                              "Cubmap must be cube complete (all textures in cubemap have same dimensions). Current image doesn't match textureSize: %d "
+                              "{ side: %d, assetPath: '%s', width: %u, height: %u }",
+                              loadedFaces[0].width, i, cubemapImages[i], face.width, face.height);
+            }
+            
+            UploadCubemap(loadedFaces, loadedFaces[0].width);
+            
+            for(CubemapFace& face : loadedFaces) ReleaseFace(&face);
+            
+            Log("Loaded cubemap { size: %d, posX: %s }", textureSize, cubemapImages[0]);
+        }
+        
+        // Note: flat gray cubemap used while the real faces are loading
+        void UploadPlaceholder() {
+            
+            static constexpr GLint kPlaceholderSize = 16;
+            
+            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
+            
+            uint32* texels = (uint32*)Memory::temporaryArena.PushBytes(kPlaceholderSize*kPlaceholderSize*sizeof(uint32));
+            for(int i = 0; i < kPlaceholderSize*kPlaceholderSize; ++i) texels[i] = 0xFF808080; //Note: little endian RGBA8 (128, 128, 128, 255)
+            
+            CubemapFace placeholderFace = { .levels = (uint8*)texels, .width = kPlaceholderSize, .height = kPlaceholderSize, .levelCount = 1 };
+            const CubemapFace faces[6] = { placeholderFace, placeholderFace, placeholderFace, placeholderFace, placeholderFace, placeholderFace };
+            UploadCubemap(faces, kPlaceholderSize);
+            
+            Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+        }
+        
+        // Runs on an AssetLoader worker
+        static void DecodeFaceJob(AssetLoader::Job* job) {
+            
+            CubemapFace* face = job->arena.PushType<CubemapFace>();
+            *face = LoadFace(job->view.data, job->view.size, job->request.assetPath);
+            
+            job->result = face;
+        }
+        
+        static void UploadFaceJob(AssetLoader::Job* job, AssetLoader::Status status) {
+            
+            CubemapFace* face = (CubemapFace*)job->result;
+            if(!face) return; //Note: canceled before it was loaded
+            
+            if(status == AssetLoader::STATUS_CANCELED) {
+                ReleaseFace(face);
+                return;
+            }
+            
+            //Note: faces can finish in any order, swap the placeholder out once all six are in
+            GlSkybox* skybox = (GlSkybox*)job->request.userData;
+            skybox->loadedFaces[job->request.userIndex] = *face;
+            
+            if(++skybox->loadedFaceCount == 6) skybox->UploadLoadedFaces();
+        }
+
     public:
         struct SkyboxParams {
             struct Cubemap {
@@ -471,8 +751,12 @@ class GlSkybox : public GlRenderable {
         inline GLuint CubeMapDepthSampler() const { return sampler; }
         inline GLuint CubeMapDepthTexture() const { return depthColorTexture; }   //TODO: REname / remove this function?     
         
-        GlSkybox(const SkyboxParams &params)
-        : GlRenderable(params.camera), generateMipmaps(params.generateMipmaps) {
+        //Note: width and height of every face of the color and depth cubemaps
+        inline GLint CubeMapSize() const { return textureSize; }
+        
+        // Note: if 'assetLoader' is set the cubemap images are loaded in the background and the skybox starts out flat gray
+        GlSkybox(const SkyboxParams &params, AssetLoader* assetLoader = nullptr, AssetLoader::Priority priority = AssetLoader::PRIORITY_NORMAL)
+        : GlRenderable(params.camera), generateMipmaps(params.generateMipmaps), loadedFaces{}, loadedFaceCount(0), assetLoader(assetLoader), faceJobs{} {
     
             glProgramDraw             = GlContext::CreateGlProgram(kVertexShaderDraw, kFragmentShaderDraw);
             glProgramWrite            = GlContext::CreateGlProgram(kVertexShaderWrite, kFragmentShaderWrite);
@@ -487,7 +771,7 @@ class GlSkybox : public GlRenderable {
             GlAssertNoError("Failed to create uniform buffer");
     
             glBindBufferBase(GL_UNIFORM_BUFFER, UBLOCK_SKY_BOX, uniformBuffer);
-            glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformBlock), nullptr, GL_DYNAMIC_DRAW);
+            GlBufferData(GL_UNIFORM_BUFFER, sizeof(UniformBlock), nullptr, GL_DYNAMIC_DRAW);
             GlAssertNoError("Failed to bind uniform buffer to: %u", UBLOCK_SKY_BOX);
             
             glGenSamplers(1, &sampler);
@@ -511,112 +795,37 @@ class GlSkybox : public GlRenderable {
             GlAssertNoError("Failed to create textures");
     
             //TODO: only do this once -- make an interface in glContext that we can query and doesn't rely on static
-            int maxCubeMapSize;
             glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxCubeMapSize);
             Log("maxCubeMapSize { %d }", maxCubeMapSize);
-                        
-            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-        
-            for(int i = 0; i < ArrayCount(params.cubemapImages); ++i) {
-                
-                FileManager::AssetBuffer* pngBuffer = FileManager::OpenAsset(params.cubemapImages[i], &Memory::temporaryArena);
-                
-                uchar* bitmap;
-                uint width, height;
-                lodepng_decode_memory(&bitmap, &width, &height,
-                                      pngBuffer->data, pngBuffer->size,
-                                      LodePNGColorType::LCT_RGBA, 8);
-                
-                RUNTIME_ASSERT(width == height,
-                              "Cubemap width must equal height. { side: %d, assetPath: '%s', width: %u, height: %u }",
-                               i, params.cubemapImages[i], width, height);
-                
-                RUNTIME_ASSERT(width < maxCubeMapSize,
-                               "Cubemap width is too large { maxCubeMapSize: %d, side: %d, assetPath: '%s', width: %u, height: %u }",
-                               maxCubeMapSize, i, params.cubemapImages[i], width, height);
-
-                RUNTIME_ASSERT(height < maxCubeMapSize,
-                               "Cubemap height is too large { maxCubeMapSize: %d, side: %d, assetPath: '%s', width: %u, height: %u }",
-                               maxCubeMapSize, i, params.cubemapImages[i], width, height);
-
-                RUNTIME_ASSERT(i == 0 || textureSize == width,
-                              "Cubmap must be cube complete (all textures in cubemap have same dimensions). Current image doesn't match textureSize: %d "
-                              "{ side: %d, assetPath: '%s', width: %u, height: %u }",
-                              textureSize, i, params.cubemapImages[i], width, height);
-                
-                textureSize = width;
-                
-                //TODO: pass in desired width and height so that we can use small initial texture
-                //      but still render to the camera texture at camera resolution
-                //      may require some software magnification/minification of initial texture?
-                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
-                glTexImage2D(
-                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0,               //mipmap level
-                    GL_RGBA8,        //internal format
-                    width,
-                    height,
-                    0,                //border must be 0
-                    GL_RGBA,          //input format
-                    GL_UNSIGNED_BYTE, //input type
-                    bitmap
-                );
-
-                //TODO: see if we split 32 bit float across 2 16 bit channels and still have mipmapping work
-                //      (requires us to make an EGL 3.2 context)
-                //      otherwise we need to implement our own mipmapping!
-                //      (mipmapping only supports color renderable and texture filterable)
-
-                //TODO: make sure we have extension GL_EXT_color_buffer_float enabled
-                glBindTexture(GL_TEXTURE_CUBE_MAP, depthColorTexture);
-                glTexImage2D(
-                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0,        //mipmap level
-                    GL_RG32F, //internal format
-                    width,
-                    height,
-                    0,        //border must be 0
-                    GL_RG,    //input format
-                    GL_FLOAT, //input type
-                    nullptr   //input data
-                );
-                             
-                glBindTexture(GL_TEXTURE_CUBE_MAP, depthTexture);
-                glTexImage2D(
-                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0,                      //mipmap level
-                    GL_DEPTH_COMPONENT32F,  //internal format //TODO: Make sure this works .. may need to use 24 bit instead
-                    width,
-                    height,
-                    0,                      //border must be 0
-                    GL_DEPTH_COMPONENT,     //input format
-                    GL_FLOAT,               //input type
-                    nullptr                 //input data
-                ); 
-
-                GlAssertNoError("Failed to set cubemap image { maxCubeMapSize: %d, side: %d, assetPath: '%s', width: %u, height: %u }",
-                                maxCubeMapSize, i, params.cubemapImages[i], width, height);
+            
+            for(int i = 0; i < ArrayCount(params.cubemapImages); ++i) cubemapImages[i] = params.cubemapImages[i];
+            
+            if(assetLoader) {
+                UploadPlaceholder();
                 
-                free(bitmap);
-                Memory::temporaryArena.FreeBaseRegion(tmpRegion);
-    
-                Log("Loaded cubemap { i: %d, size: %d, assetPath: %s }", i, textureSize, params.cubemapImages[i]);
-            }
-    
-            if(generateMipmaps) {
+                //Note: one job per face so all six pngs decode in parallel
+                for(int i = 0; i < ArrayCount(params.cubemapImages); ++i) {
+                    faceJobs[i] = assetLoader->Load(AssetLoader::Request {
+                        .assetPath = params.cubemapImages[i],
+                        .priority = priority,
+                        .load = DecodeFaceJob,
+                        .complete = UploadFaceJob,
+                        .userData = this,
+                        .userIndex = uint32(i),
+                    });
+                }
                 
-                //Generate depthColorTexture mipMap
-                glBindTexture(GL_TEXTURE_CUBE_MAP, depthColorTexture);
-                GenerateCubemapMipmap();
+            } else {
                 
-                //Generate colorTexture mipMap
-                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
-                GenerateCubemapMipmap();
+                for(int i = 0; i < ArrayCount(params.cubemapImages); ++i) {
+                    FileManager::AssetView pngView = FileManager::MapAsset(params.cubemapImages[i]);
+                    loadedFaces[i] = LoadFace(pngView.data, pngView.size, params.cubemapImages[i]);
+                    FileManager::UnmapAsset(&pngView);
+                }
                 
-            } else {
-                glBindTexture(GL_TEXTURE_CUBE_MAP, colorTexture);
+                UploadLoadedFaces();
             }
-
+            
             // //create render buffer
             // //TODO: clean this up in destructor!
             // //TODO: each cubemap face should have its own depth renderbuffer! (so we can render more than 1 object at a time)
@@ -647,6 +856,11 @@ class GlSkybox : public GlRenderable {
         }
         
         ~GlSkybox() {
+            if(assetLoader) {
+                for(const AssetLoader::Handle& faceJob : faceJobs) assetLoader->Cancel(faceJob);
+                for(CubemapFace& face : loadedFaces) ReleaseFace(&face);
+            }
+            
             glDeleteFramebuffers(1, &writeFrameBuffer);
             glDeleteBuffers(1, &uniformBuffer);
             glDeleteSamplers(1, &sampler);
@@ -7,6 +7,8 @@
 #include "util.h"
 #include "GlContext.h"
 #include "FileManager.h"
+#include "AssetLoader.h"
+#include "AssetCache.h"
 
 class GlText {
 
@@ -189,12 +191,29 @@ class GlText {
             uint32 SCI;
         };
         
+        //Note: hashed into the glyph atlas' cache key with the font's bytes. Bump version when packing or the atlas layout changes
+        struct AtlasCacheParams {
+            uint32 version;
+            uint32 fontIndex;
+            uint32 targetGlyphSize;
+            uint32 startChar, endChar;
+            uint32 maxTextureSize;
+        };
+        static constexpr uint32 kAtlasCacheVersion = 1;
+        
+        // Cached glyph atlas: [AtlasHeader][GlyphData x numGlyphs][VertexGlyphData x numGlyphs][texture]
+        struct AtlasHeader {
+            uint32 textureWidth, textureHeight;
+            uint32 numGlyphs;
+            uint32 reserved; //Note: keeps the glyph data 8 byte aligned
+        };
+        
         FT_Face face;
         
         Memory::Arena memoryArena;
         Memory::Region baseRegion, stringRegion;
 
-        FileManager::AssetBuffer* fontAssetBuffer;
+        FileManager::AssetView fontAssetView;
         GlyphData* offsetGlyphData;
         StringAttrib* stringAttribData;
         
@@ -376,17 +395,10 @@ class GlText {
             textureMetrics->maxSize = maxTextureSize;
         }
         
-        void PackGlyphs(void* texture, TextureMetrics* textureMetrics, GlyphSortData* glyphSortData, uint8 numGlyphs) {
+        //Note: fills in 'vgData' on the cpu instead of a mapped buffer so it can be cached along with the texture
+        void PackGlyphs(void* texture, VertexGlyphData* vgData, TextureMetrics* textureMetrics, GlyphSortData* glyphSortData, uint8 numGlyphs) {
         
-            // map VertexGlyphData into memory
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexGlyphDataBuffer);
-            GlAssertNoError("Failed to bind vertexGlyphDataBuffer: %u ", vertexGlyphDataBuffer);
-    
-            GLuint vgBytes = numGlyphs*sizeof(VertexGlyphData);
-            glBufferData(GL_SHADER_STORAGE_BUFFER, vgBytes, nullptr, GL_STATIC_DRAW);
-            GlAssertNoError("Failed to allocate vertexGlyphDataBuffer { vgBytes: %u [%u glyphs] } ", vgBytes, numGlyphs);
-    
-            VertexGlyphData* offsetVgData = (VertexGlyphData*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, vgBytes, GL_MAP_WRITE_BIT) - startChar;
+            VertexGlyphData* offsetVgData = vgData - startChar;
             
 
             FT_Error ftError;
@@ -469,11 +481,21 @@ class GlText {
                 //TODO: this only helps with first row - find way to make this better!
                 if(sRect.bottom < minRow0Height) minRow0Height = sRect.bottom;
             }
-            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
             
             textureMetrics->size.y = textureHeight;
         }
         
+        inline
+        void UploadVertexGlyphData(const VertexGlyphData* vgData, uint8 numGlyphs) {
+            
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexGlyphDataBuffer);
+            GlAssertNoError("Failed to bind vertexGlyphDataBuffer: %u ", vertexGlyphDataBuffer);
+    
+            GLuint vgBytes = numGlyphs*sizeof(VertexGlyphData);
+            GlBufferData(GL_SHADER_STORAGE_BUFFER, vgBytes, vgData, GL_STATIC_DRAW);
+            GlAssertNoError("Failed to upload vertexGlyphDataBuffer { vgBytes: %u [%u glyphs] } ", vgBytes, numGlyphs);
+        }
+        
         inline
         void UploadRenderedTexture(void* fontTextureData, Vec2<uint32> fontTextureSize) {
     
@@ -502,14 +524,14 @@ class GlText {
     
             //Note: index 0 is default scale color so gpu buffer needs to be params.stringAttribSize+1 elements
             GLuint scBytes = size * sizeof(StringAttrib);
-            glBufferData(GL_SHADER_STORAGE_BUFFER, scBytes, nullptr, GL_DYNAMIC_DRAW);
+            GlBufferData(GL_SHADER_STORAGE_BUFFER, scBytes, nullptr, GL_DYNAMIC_DRAW);
             GlAssertNoError("Failed to allocate stringAttribBuffer { scBytes: %u } ", scBytes);
         }
         
         void BindAndAllocateVertexAttributeBufferBytes(uint32 bytes) {
             
             glBindBuffer(GL_ARRAY_BUFFER, vertexAttributeBuffer);
-            glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+            GlBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
 
             GlAssertNoError("Failed to allocate vertexAttributeBuffer { buffer: %u, oldBytes: %u, oldNumChars: %u, newBytes: %u, newNumChars: %u } ",
                              vertexAttributeBuffer, vertexAttributeBufferBytes, vertexAttributeBufferBytes/sizeof(VertexAttributeData), bytes, bytes/sizeof(VertexAttributeData));
@@ -520,6 +542,31 @@ class GlText {
             vertexAttributeBufferBytes = bytes;
         }
         
+        // Uploads a glyph atlas from the asset cache. Returns false if 'cacheView' doesn't hold an atlas for 'numGlyphs'
+        bool UploadCachedAtlas(const FileManager::AssetView& cacheView, GlyphData* glyphData, uint8 numGlyphs) {
+            
+            if(cacheView.size < sizeof(AtlasHeader)) return false;
+            
+            const AtlasHeader& header = *(const AtlasHeader*)cacheView.data;
+            if(header.numGlyphs != numGlyphs || !header.textureWidth || !header.textureHeight ||
+               header.textureWidth > maxTextureSize || header.textureHeight > maxTextureSize) return false;
+            
+            uint64 glyphDataBytes = numGlyphs*sizeof(GlyphData),
+                   vgBytes        = numGlyphs*sizeof(VertexGlyphData),
+                   textureBytes   = uint64(header.textureWidth)*header.textureHeight;
+            if(cacheView.size != sizeof(AtlasHeader) + glyphDataBytes + vgBytes + textureBytes) return false;
+            
+            const void* cachedGlyphData = ByteOffset(cacheView.data, sizeof(AtlasHeader));
+            const void* cachedVgData    = ByteOffset(cachedGlyphData, glyphDataBytes);
+            const void* cachedTexture   = ByteOffset(cachedVgData, vgBytes);
+            
+            memcpy(glyphData, cachedGlyphData, glyphDataBytes);
+            UploadVertexGlyphData((const VertexGlyphData*)cachedVgData, numGlyphs);
+            UploadRenderedTexture((void*)cachedTexture, Vec2(header.textureWidth, header.textureHeight));
+            
+            return true;
+        }
+        
         //Note: lower 8 bits are reserved for glyphIndex
         inline constexpr uint32 StringAttribBitIndexIncrement() { return 1 << 8; }
         inline uint32 StringAttribBitIndex(uint32 saBits) { return saBits >> 8; }
@@ -536,6 +583,7 @@ class GlText {
         }
         
         inline void SetStringAttrib(const StringAttrib& stringAttrib) {
+            if(!fontTexture) return; //Note: font is still loading
 
             // add one to current index
             stringAttribBitIndex+= StringAttribBitIndexIncrement();
@@ -546,6 +594,7 @@ class GlText {
         }
         
         inline void SetColor(uint32 rgba) {
+            if(!fontTexture) return;
             SetStringAttrib({
                 .scale = stringAttribData[StringAttribIndex()].scale,
                 .rgba = rgba,
@@ -554,6 +603,7 @@ class GlText {
         }
 
         inline void SetDepth(float depth) {
+            if(!fontTexture) return;
             SetStringAttrib({
                 .scale = stringAttribData[StringAttribIndex()].scale,
                 .rgba = stringAttribData[StringAttribIndex()].rgba,
@@ -562,6 +612,7 @@ class GlText {
         }
 
         inline void SetScale(Vec2<float> scale) {
+            if(!fontTexture) return;
             SetStringAttrib({
                 .scale = scale,
                 .rgba = stringAttribData[StringAttribIndex()].rgba,
@@ -569,19 +620,43 @@ class GlText {
             });
         }
         
-        GlText(GlContext* context, const char* assetPath, int fontIndex = 0): glTextures{}, pushedBytes{0}, stringAttribBitIndex{0}, uploadStringAttribBitIndex{0} {
+        // Note: if 'assetLoader' is set the font is loaded in the background. Strings pushed before it's ready are dropped
+        GlText(GlContext* context, const char* assetPath, int fontIndex = 0,
+               AssetLoader* assetLoader = nullptr, AssetLoader::Priority priority = AssetLoader::PRIORITY_HIGH):
+               glTextures{}, pushedBytes{0}, stringAttribBitIndex{0}, uploadStringAttribBitIndex{0} {
             
-            //load font into memory
-            fontAssetBuffer = FileManager::OpenAsset(assetPath, &memoryArena);
+            memoryArena.SetTraceName("GlText");
     
             baseRegion = memoryArena.CreateRegion();
             stringRegion = memoryArena.CreateRegion();
             
-            // WARNING: This requires fontBuffer to stay valid across lifetime of text object
-            FT_Error ftError;
-            RUNTIME_ASSERT(!(ftError = FT_New_Memory_Face(ftlib, fontAssetBuffer->data, fontAssetBuffer->size, fontIndex, &face)),
-                           "Failed to load font face { ftError: %d, assetPath: %s, fontIndex: %d }",
-                           ftError, assetPath, fontIndex);
+            this->assetLoader = assetLoader;
+            renderPending = false;
+            
+            if(assetLoader) {
+                face = nullptr;
+                fontAssetView = {};
+                
+                loadJob = assetLoader->Load(AssetLoader::Request {
+                    .assetPath = assetPath,
+                    .priority = priority,
+                    .load = LoadFaceJob,
+                    .complete = CompleteFaceJob,
+                    .userData = this,
+                    .userIndex = uint32(fontIndex),
+                });
+                
+            } else {
+                
+                //map font - FreeType reads glyphs straight out of the mapped pages
+                fontAssetView = FileManager::MapAsset(assetPath);
+                
+                // WARNING: This requires fontAssetView to stay mapped across lifetime of text object
+                FT_Error ftError;
+                RUNTIME_ASSERT(!(ftError = FtNewMemoryFace(fontAssetView.data, fontAssetView.size, fontIndex, &face)),
+                               "Failed to load font face { ftError: %d, assetPath: %s, fontIndex: %d }",
+                               ftError, assetPath, fontIndex);
+            }
             
             
             glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
@@ -636,7 +711,10 @@ class GlText {
         
         inline
         ~GlText() {
-            FT_Done_Face(face); //Warn: Must be called before we free memory - uses font stored in memoryArena
+            if(assetLoader) assetLoader->Cancel(loadJob);
+            
+            if(face) FtDoneFace(face); //Warn: Must be called before we unmap the font - face reads from fontAssetView
+            FileManager::UnmapAsset(&fontAssetView);
             
             glDeleteTextures(ArrayCount(glTextures), glTextures);
             glDeleteBuffers(ArrayCount(glBuffers), glBuffers);
@@ -662,16 +740,71 @@ class GlText {
                   endChar     = kDefaultEndChar,
                   unknownChar = kDefaultUnknownChar;
         };
+    
+    private:
+        AssetLoader* assetLoader;
+        AssetLoader::Handle loadJob;
+        
+        RenderParams pendingRenderParams; //Note: RenderTexture was called before the font finished loading
+        bool renderPending;
+        
+        // Runs on an AssetLoader worker
+        static void LoadFaceJob(AssetLoader::Job* job) {
+            
+            FT_Face* face = job->arena.PushType<FT_Face>();
+            
+            FT_Error ftError;
+            RUNTIME_ASSERT(!(ftError = FtNewMemoryFace(job->view.data, job->view.size, job->request.userIndex, face)),
+                           "Failed to load font face { ftError: %d, assetPath: %s, fontIndex: %u }",
+                           ftError, job->request.assetPath, job->request.userIndex);
+            
+            job->result = face;
+        }
+        
+        static void CompleteFaceJob(AssetLoader::Job* job, AssetLoader::Status status) {
+            
+            FT_Face* face = (FT_Face*)job->result;
+            if(!face) return; //Note: canceled before it was loaded
+            
+            if(status == AssetLoader::STATUS_CANCELED) {
+                FtDoneFace(*face);
+                return;
+            }
+            
+            GlText* text = (GlText*)job->request.userData;
+            text->face = *face;
+            
+            //Note: take the mapping from the job - the face reads from it for as long as it lives
+            text->fontAssetView = job->view;
+            job->view = {};
+            
+            Log("Loaded font { text: %p, assetPath: %s, face: %p }", text, job->request.assetPath, text->face);
+            
+            if(text->renderPending) {
+                text->renderPending = false;
+                text->RenderTexture(text->pendingRenderParams);
+            }
+        }
+    
+    public:
         
         template<typename... ArgT>
         void PushString(Vec2<float> position, const char* fmt, ArgT... args) {
-            RUNTIME_ASSERT(fontTexture, "No font texture - Call RenderTexture first");
+            if(!fontTexture) {
+                //Note: strings pushed while the font is still loading are dropped
+                RUNTIME_ASSERT(renderPending, "No font texture - Call RenderTexture first");
+                return;
+            }
             
             int strChars = snprintf(nullptr, 0, fmt , args...),
                 strBytes = strChars+1;
         
-            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-            char* str = (char*)Memory::temporaryArena.PushBytes(strBytes);
+            //Note: string only lives for this frame. Threads without a frame arena format it in a scratch region instead
+            Memory::Arena* frameArena = Memory::CurrentFrameArena();
+            Memory::Arena* strArena = frameArena ? frameArena : &Memory::temporaryArena;
+            Memory::Region tmpRegion = strArena->CreateRegion();
+
+            char* str = (char*)strArena->PushBytes(strBytes);
             sprintf(str, fmt, args...);
     
             uint32 attributeBytes = strChars*sizeof(VertexAttributeData);
@@ -700,12 +833,19 @@ class GlText {
                 
                 position.x+= scale.x * gData.advance.x;
             }
-    
-            Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+
+            if(!frameArena) strArena->FreeBaseRegion(tmpRegion);
         }
         
         void RenderTexture(const RenderParams& params) {
             
+            //Note: render once the font is loaded
+            if(!face) {
+                pendingRenderParams = params;
+                renderPending = true;
+                return;
+            }
+            
             startChar = params.startChar;
             endChar = params.endChar;
             RUNTIME_ASSERT( startChar <= endChar,
@@ -732,15 +872,42 @@ class GlText {
             uint8 numGlyphs = endChar - startChar + 1; //+1 to include the end char
             SetupMemoryArena(stringAttribSize, numGlyphs);
             AllocateStringAttribBuffer(stringAttribSize);
-    
-            // prepare tmp memory
-            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
-            GlyphSortData* glyphSortData = (GlyphSortData*)Memory::temporaryArena.PushBytes(sizeof(GlyphSortData) * numGlyphs);
             
             // set default stringAttrib
             *stringAttribData = params.renderStringAttrib;
             uploadStringAttribBitIndex = 0; // Note: upload default scale next draw call
+            
+            // skip rasterizing the glyphs if we already rendered this atlas
+            //Note: maxTextureSize is part of the key because it limits the packing
+            GlyphData* glyphData = offsetGlyphData + startChar;
+            const AtlasCacheParams cacheParams = {
+                .version = kAtlasCacheVersion,
+                .fontIndex = uint32(face->face_index),
+                .targetGlyphSize = params.targetGlyphSize,
+                .startChar = startChar,
+                .endChar = endChar,
+                .maxTextureSize = uint32(maxTextureSize),
+            };
+            uint64 cacheKey = AssetCache::Key(fontAssetView.data, fontAssetView.size, cacheParams);
+            
+            FileManager::AssetView cacheView;
+            if(AssetCache::Load(cacheKey, &cacheView)) {
+                
+                bool uploaded = UploadCachedAtlas(cacheView, glyphData, numGlyphs);
+                if(!uploaded) Warn("Ignoring cached font texture with a bad header { face: %p, faceName: %s, bytes: %llu }", face, face->family_name, (unsigned long long)cacheView.size);
+                
+                FileManager::UnmapAsset(&cacheView);
+                if(uploaded) {
+                    Log("Loaded cached font texture { face: %p, faceName: %s, targetGlyphSize: %d, startChar: '%c'[%d], endChar: '%c'[%d] }",
+                        face, face->family_name, params.targetGlyphSize, startChar,startChar, endChar,endChar);
+                    return;
+                }
+            }
     
+            // prepare tmp memory
+            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
+            GlyphSortData* glyphSortData = (GlyphSortData*)Memory::temporaryArena.PushBytes(sizeof(GlyphSortData) * numGlyphs);
+            VertexGlyphData* vgData = (VertexGlyphData*)Memory::temporaryArena.PushBytes(sizeof(VertexGlyphData) * numGlyphs, false, alignof(VertexGlyphData));
             
             // get glyph texture size s
             SetFontSize(params.targetGlyphSize);
@@ -756,9 +923,13 @@ class GlText {
 
             // pack the glyph bitmaps into tmpTexture
             // Note: 'PackGlyphs' requires 'textureMetrics.size.x' and sets 'textureMetrics.size.y'
-            uint32 maxTextureBytes = textureMetrics.size.x * textureMetrics.maxSize.y;
-            void* tmpTexture = Memory::temporaryArena.PushBytes(maxTextureBytes);
-            PackGlyphs(tmpTexture, &textureMetrics, glyphSortData, numGlyphs);
+            //       tmpTexture is zeroed and sized for the pow2 height below so the gutters and rows we upload past the
+            //       packed glyphs are blank
+            uint32 pow2MaxTextureHeight = Pow2RoundUp(textureMetrics.maxSize.y),
+                   maxTextureRows       = (pow2MaxTextureHeight <= maxTextureSize) ? pow2MaxTextureHeight : textureMetrics.maxSize.y;
+            uint32 maxTextureBytes = textureMetrics.size.x * maxTextureRows;
+            void* tmpTexture = Memory::temporaryArena.PushBytes(maxTextureBytes, true);
+            PackGlyphs(tmpTexture, vgData, &textureMetrics, glyphSortData, numGlyphs);
             
             // set the texture height to a power of 2 if possible to improve performance
             uint32 minTextureHeight = textureMetrics.size.y, //Note: var polled out so we can log it
@@ -766,7 +937,23 @@ class GlText {
             if(pow2TextureHeight <= maxTextureSize) textureMetrics.size.y = pow2TextureHeight;
     
             // upload to GPU
+            UploadVertexGlyphData(vgData, numGlyphs);
             UploadRenderedTexture(tmpTexture, textureMetrics.size);
+            
+            // cache the atlas for next launch
+            const AtlasHeader atlasHeader = {
+                .textureWidth = textureMetrics.size.x,
+                .textureHeight = textureMetrics.size.y,
+                .numGlyphs = numGlyphs,
+            };
+            const AssetCache::Chunk chunks[] = {
+                { .data = &atlasHeader, .bytes = sizeof(atlasHeader) },
+                { .data = glyphData,    .bytes = numGlyphs*sizeof(GlyphData) },
+                { .data = vgData,       .bytes = numGlyphs*sizeof(VertexGlyphData) },
+                { .data = tmpTexture,   .bytes = textureMetrics.size.Area() },
+            };
+            AssetCache::Store(cacheKey, chunks);
+            
             Memory::temporaryArena.FreeBaseRegion(tmpRegion);
     
             
@@ -823,7 +1010,7 @@ class GlText {
                 //      instead of CopyToBuffer which is slower and preserves ordering
                 Memory::ForEachRegion(stringRegion, memoryArena.CreateRegion(),
                                       [&](void *chunk, uint32 chunkBytes) {
-                                          CopyMemory(attributeBuffer, chunk, chunkBytes);
+                                          CopyMemoryNonTemporal(attributeBuffer, chunk, chunkBytes);
                                           attributeBuffer+=chunkBytes;
                                       });
     
@@ -849,6 +1036,7 @@ class GlText {
         }
         
         inline void Clear() {
+            if(!fontTexture) return; //Note: font is still loading
             
             //Note: without this check 'uploadStringAttribBitIndex' needs to be cleared to 0 and we'll reupload the default stringAttrib each time
             //      Clear is called - which might be every frame!
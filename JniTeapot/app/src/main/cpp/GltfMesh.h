@@ -0,0 +1,762 @@
+#pragma once
+
+#include <string.h>
+
+#include "util.h"
+#include "Memory.h"
+#include "Json.h"
+#include "mat.h"
+#include "Quaternion.h"
+#include "MeshFile.h"
+#include "ObjMesh.h"
+
+// A binary glTF 2.0 (.glb) - a json chunk that describes the scene and a binary chunk with the vertices and indices
+//
+//   [GlbHeader][GlbChunkHeader][json][GlbChunkHeader][binary]
+//
+// Note: doesn't touch GL so it can run on AssetLoader workers and in the host mesh converter. Only the binary chunk
+//       is read, buffers with a uri aren't supported
+//
+// Note: every primitive of every mesh in the default scene is loaded into a single mesh with the node transforms applied.
+//       The renderer draws a mesh with a single material so materials are parsed but not drawn.
+//       Uvs keep glTF's top left origin
+
+constexpr uint32 kGlbMagic     = 'g' | ('l'<<8) | ('T'<<16) | ('F'<<24);
+constexpr uint32 kGlbVersion   = 2;
+constexpr uint32 kGlbChunkJson = 'J' | ('S'<<8) | ('O'<<16) | ('N'<<24);
+constexpr uint32 kGlbChunkBin  = 'B' | ('I'<<8) | ('N'<<16);
+
+constexpr const char* kGlbExtension = ".glb";
+
+struct GlbHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 length; //Note: of the whole file
+};
+
+struct GlbChunkHeader {
+    uint32 length; //Note: of the chunk's data
+    uint32 type;
+};
+
+//Note: same values as the GL enums
+enum GltfComponentType: uint32 {
+    GLTF_COMPONENT_BYTE           = 5120,
+    GLTF_COMPONENT_UNSIGNED_BYTE  = 5121,
+    GLTF_COMPONENT_SHORT          = 5122,
+    GLTF_COMPONENT_UNSIGNED_SHORT = 5123,
+    GLTF_COMPONENT_UNSIGNED_INT   = 5125,
+    GLTF_COMPONENT_FLOAT          = 5126,
+};
+
+enum GltfPrimitiveMode: uint32 {
+    GLTF_MODE_POINTS, GLTF_MODE_LINES, GLTF_MODE_LINE_LOOP, GLTF_MODE_LINE_STRIP,
+    GLTF_MODE_TRIANGLES, GLTF_MODE_TRIANGLE_STRIP, GLTF_MODE_TRIANGLE_FAN
+};
+
+// Returns the bytes taken up by one component of 'type' or 0 if it isn't a valid accessor component type
+constexpr uint32 GltfComponentBytes(uint32 type) {
+    switch(type) {
+        case GLTF_COMPONENT_BYTE:
+        case GLTF_COMPONENT_UNSIGNED_BYTE:  return 1;
+        case GLTF_COMPONENT_SHORT:
+        case GLTF_COMPONENT_UNSIGNED_SHORT: return 2;
+        case GLTF_COMPONENT_UNSIGNED_INT:
+        case GLTF_COMPONENT_FLOAT:          return 4;
+        default:                            return 0;
+    }
+}
+
+class GltfMesh {
+
+    public:
+
+        struct BufferView {
+            const uint8* data;  //Note: nullptr when the view isn't in the binary chunk
+            uint32 byteLength;
+            uint32 byteStride;  //Note: 0 when the elements are tightly packed
+        };
+
+        struct Accessor {
+            const uint8* data; //Note: first element or nullptr when the accessor is all zeros
+
+            int32 bufferView; //Note: -1 when the accessor is all zeros
+            uint32 byteOffset; //Note: from the start of the buffer view
+
+            uint32 count, stride;
+            uint32 componentType, componentCount;
+            bool normalized;
+
+            bool hasBounds;
+            float min[3], max[3]; //Note: the first 3 components
+
+            bool valid; //Note: false when the accessor reads past its buffer view or uses something we don't support
+        };
+
+        struct Primitive {
+            int32 position, normal, uv, indices; //Note: accessor indices or -1 when the primitive doesn't have one
+            int32 material;
+            uint32 mode;
+        };
+
+        struct Mesh {
+            uint32 firstPrimitive, primitiveCount;
+        };
+
+        struct Material {
+            const char* name; //Note: points into the json with escapes intact
+            uint32 nameLength;
+
+            float baseColor[4];
+            float metallic, roughness;
+            bool doubleSided;
+        };
+
+        // A node that draws a mesh
+        struct Instance {
+            uint32 mesh;
+            Mat4<float> matrix; //Note: model space of the whole glb
+        };
+
+        Memory::Arena arena;
+
+        Memory::ArenaArray<BufferView> bufferViews{&arena};
+        Memory::ArenaArray<Accessor> accessors{&arena};
+        Memory::ArenaArray<Primitive> primitives{&arena};
+        Memory::ArenaArray<Mesh> meshes{&arena};
+        Memory::ArenaArray<Material> materials{&arena};
+        Memory::ArenaArray<Instance> instances{&arena};
+
+    private:
+
+        static inline bool IsIdentity(const Mat4<float>& matrix) {
+            return !memcmp(matrix.values, Mat4<float>::identity.values, sizeof(matrix.values));
+        }
+
+        // Returns the local transform of 'node'. Either its 'matrix' or the product of its translation, rotation and scale
+        static Mat4<float> NodeMatrix(const JsonValue* node) {
+
+            float values[16];
+            if(JsonNumbers(JsonMember(node, "matrix"), values, 16)) return Mat4<float>(values); //Note: column major like Mat4
+
+            float translation[3] = { 0.f, 0.f, 0.f },
+                  rotation[4]    = { 0.f, 0.f, 0.f, 1.f },
+                  scale[3]       = { 1.f, 1.f, 1.f };
+
+            JsonNumbers(JsonMember(node, "translation"), translation, 3);
+            JsonNumbers(JsonMember(node, "rotation"), rotation, 4);
+            JsonNumbers(JsonMember(node, "scale"), scale, 3);
+
+            //Note: exporters write rotations with a few digits so they aren't always unit length
+            Quaternion<float> quaternion(rotation[0], rotation[1], rotation[2], rotation[3]);
+            float norm = quaternion.Norm();
+            quaternion = norm > 0.f ? Quaternion<float>(quaternion/norm) : Quaternion<float>::identity;
+
+            Mat4<float> result = quaternion.Matrix();
+            result.column[0]*= scale[0];
+            result.column[1]*= scale[1];
+            result.column[2]*= scale[2];
+            result.column[3] = Vec4<float>(translation[0], translation[1], translation[2], 1.f);
+            return result;
+        }
+
+        // Reads the components of element 'i' of 'accessor' into 'values' the way GL reads attributes
+        static void ReadAccessor(const Accessor& accessor, uint32 i, float* values) {
+
+            if(!accessor.data) {
+                for(uint32 j = 0; j < accessor.componentCount; ++j) values[j] = 0.f;
+                return;
+            }
+
+            const uint8* element = accessor.data + uint64(i)*accessor.stride;
+            bool normalized = accessor.normalized;
+
+            //Note: elements are only aligned to their component size so they're loaded with memcpy
+            for(uint32 j = 0; j < accessor.componentCount; ++j) {
+                switch(accessor.componentType) {
+                    case GLTF_COMPONENT_BYTE: {
+                        int8 value = ((const int8*)element)[j];
+                        values[j] = normalized ? Max(value/127.f, -1.f) : value;
+                    } break;
+
+                    case GLTF_COMPONENT_UNSIGNED_BYTE: {
+                        uint8 value = element[j];
+                        values[j] = normalized ? value/255.f : value;
+                    } break;
+
+                    case GLTF_COMPONENT_SHORT: {
+                        int16 value;
+                        memcpy(&value, element + j*sizeof(value), sizeof(value));
+                        values[j] = normalized ? Max(value/32767.f, -1.f) : value;
+                    } break;
+
+                    case GLTF_COMPONENT_UNSIGNED_SHORT: {
+                        uint16 value;
+                        memcpy(&value, element + j*sizeof(value), sizeof(value));
+                        values[j] = normalized ? value/65535.f : value;
+                    } break;
+
+                    case GLTF_COMPONENT_UNSIGNED_INT: {
+                        uint32 value;
+                        memcpy(&value, element + j*sizeof(value), sizeof(value));
+                        values[j] = value;
+                    } break;
+
+                    default: memcpy(values + j, element + j*sizeof(float), sizeof(float)); break;
+                }
+            }
+        }
+
+        // Returns the xyz of 'matrix' times ['v', 'w']
+        static inline Vec3<float> Transform(const Mat4<float>& matrix, const float* v, float w) {
+            return Vec3<float>(matrix.a1*v[0] + matrix.a2*v[1] + matrix.a3*v[2] + matrix.a4*w,
+                               matrix.b1*v[0] + matrix.b2*v[1] + matrix.b3*v[2] + matrix.b4*w,
+                               matrix.c1*v[0] + matrix.c2*v[1] + matrix.c3*v[2] + matrix.c4*w);
+        }
+        
+        static uint32 ReadIndex(const Accessor& accessor, uint32 i) {
+
+            if(!accessor.data) return 0;
+
+            const uint8* element = accessor.data + uint64(i)*accessor.stride;
+            switch(accessor.componentType) {
+                case GLTF_COMPONENT_UNSIGNED_BYTE:  return *element;
+                case GLTF_COMPONENT_UNSIGNED_SHORT: { uint16 index; memcpy(&index, element, sizeof(index)); return index; }
+                default:                            { uint32 index; memcpy(&index, element, sizeof(index)); return index; }
+            }
+        }
+
+        // Returns true if 'accessor' is -1 or a valid accessor with 'componentCount' components
+        inline bool ValidAttribute(int32 accessor, uint32 componentCount) const {
+            return accessor < 0 || (uint32(accessor) < accessors.Count() && accessors[accessor].valid && accessors[accessor].componentCount == componentCount);
+        }
+
+        bool ParseAccessors(const JsonValue* root, uint64 binBytes, const uint8* bin) {
+
+            const JsonValue* buffers = JsonMember(root, "buffers");
+
+            //Note: the binary chunk is the first buffer and doesn't have a uri
+            const JsonValue* glbBuffer = JsonElement(buffers, 0);
+            uint32 glbBufferBytes = 0;
+            bool hasGlbBuffer = bin && glbBuffer && !JsonMember(glbBuffer, "uri") && JsonUint(JsonMember(glbBuffer, "byteLength"), &glbBufferBytes) &&
+                                glbBufferBytes <= binBytes;
+
+            const JsonValue* bufferViewsJson = JsonMember(root, "bufferViews");
+            bufferViews.Push(JsonCount(bufferViewsJson));
+
+            for(uint32 i = 0; i < bufferViews.Count(); ++i) {
+                const JsonValue* bufferViewJson = JsonElement(bufferViewsJson, i);
+
+                uint32 buffer = ~uint32(0), byteOffset = 0, byteLength = 0, byteStride = 0;
+                JsonUint(JsonMember(bufferViewJson, "buffer"), &buffer);
+                JsonUint(JsonMember(bufferViewJson, "byteOffset"), &byteOffset);
+                JsonUint(JsonMember(bufferViewJson, "byteLength"), &byteLength);
+                JsonUint(JsonMember(bufferViewJson, "byteStride"), &byteStride);
+
+                bool inBin = hasGlbBuffer && buffer == 0 && uint64(byteOffset) + byteLength <= glbBufferBytes;
+                bufferViews[i] = {
+                    .data = inBin ? bin + byteOffset : nullptr,
+                    .byteLength = byteLength,
+                    .byteStride = byteStride,
+                };
+            }
+
+            const JsonValue* accessorsJson = JsonMember(root, "accessors");
+            accessors.Push(JsonCount(accessorsJson));
+
+            for(uint32 i = 0; i < accessors.Count(); ++i) {
+                const JsonValue* accessorJson = JsonElement(accessorsJson, i);
+
+                Accessor& accessor = accessors[i];
+                accessor = {
+                    .bufferView = -1,
+                    .normalized = JsonBool(JsonMember(accessorJson, "normalized"), false),
+                };
+
+                uint32 bufferView;
+                bool hasBufferView = JsonUint(JsonMember(accessorJson, "bufferView"), &bufferView);
+                if(hasBufferView) accessor.bufferView = int32(bufferView);
+
+                JsonUint(JsonMember(accessorJson, "byteOffset"), &accessor.byteOffset);
+                JsonUint(JsonMember(accessorJson, "componentType"), &accessor.componentType);
+                JsonUint(JsonMember(accessorJson, "count"), &accessor.count);
+
+                const JsonValue* type = JsonMember(accessorJson, "type");
+                accessor.componentCount = JsonStringEquals(type, "SCALAR") ? 1 :
+                                          JsonStringEquals(type, "VEC2")   ? 2 :
+                                          JsonStringEquals(type, "VEC3")   ? 3 :
+                                          JsonStringEquals(type, "VEC4")   ? 4 : 0;
+
+                float min[4], max[4];
+                if(accessor.componentCount >= 3 &&
+                   JsonNumbers(JsonMember(accessorJson, "min"), min, accessor.componentCount) &&
+                   JsonNumbers(JsonMember(accessorJson, "max"), max, accessor.componentCount)) {
+
+                    accessor.hasBounds = true;
+                    memcpy(accessor.min, min, sizeof(accessor.min));
+                    memcpy(accessor.max, max, sizeof(accessor.max));
+                }
+
+                uint32 elementBytes = GltfComponentBytes(accessor.componentType)*accessor.componentCount;
+
+                //Note: sparse accessors patch a few elements over the buffer view and aren't worth supporting yet
+                accessor.valid = elementBytes && !JsonMember(accessorJson, "sparse") && (!hasBufferView || bufferView < bufferViews.Count());
+                if(!accessor.valid || !hasBufferView) continue;
+
+                const BufferView& view = bufferViews[bufferView];
+                accessor.stride = view.byteStride ? view.byteStride : elementBytes;
+
+                uint64 accessorBytes = accessor.count ? uint64(accessor.stride)*(accessor.count-1) + elementBytes : 0;
+                accessor.valid = view.data && accessor.stride >= elementBytes && uint64(accessor.byteOffset) + accessorBytes <= view.byteLength;
+
+                if(accessor.valid) accessor.data = view.data + accessor.byteOffset;
+            }
+
+            return true;
+        }
+
+        bool ParseMeshes(const JsonValue* root) {
+
+            const JsonValue* materialsJson = JsonMember(root, "materials");
+            materials.Push(JsonCount(materialsJson));
+
+            for(uint32 i = 0; i < materials.Count(); ++i) {
+                const JsonValue* materialJson = JsonElement(materialsJson, i);
+                const JsonValue* pbr = JsonMember(materialJson, "pbrMetallicRoughness");
+                const JsonValue* name = JsonMember(materialJson, "name");
+
+                Material& material = materials[i];
+                material = {
+                    .name = name && name->type == JSON_STRING ? name->string : "",
+                    .nameLength = name && name->type == JSON_STRING ? name->count : 0,
+                    .baseColor = { 1.f, 1.f, 1.f, 1.f },
+                    .metallic = float(JsonNumber(JsonMember(pbr, "metallicFactor"), 1.)),
+                    .roughness = float(JsonNumber(JsonMember(pbr, "roughnessFactor"), 1.)),
+                    .doubleSided = JsonBool(JsonMember(materialJson, "doubleSided"), false),
+                };
+                JsonNumbers(JsonMember(pbr, "baseColorFactor"), material.baseColor, 4);
+            }
+
+            const JsonValue* meshesJson = JsonMember(root, "meshes");
+            meshes.Push(JsonCount(meshesJson));
+
+            for(uint32 i = 0; i < meshes.Count(); ++i) {
+                const JsonValue* primitivesJson = JsonMember(JsonElement(meshesJson, i), "primitives");
+
+                meshes[i] = {
+                    .firstPrimitive = primitives.Count(),
+                    .primitiveCount = JsonCount(primitivesJson),
+                };
+
+                for(uint32 j = 0; j < meshes[i].primitiveCount; ++j) {
+                    const JsonValue* primitiveJson = JsonElement(primitivesJson, j);
+                    const JsonValue* attributes = JsonMember(primitiveJson, "attributes");
+
+                    auto AccessorIndex = [](const JsonValue* value) {
+                        uint32 index;
+                        return JsonUint(value, &index) && index <= uint32(__INT32_MAX__) ? int32(index) : -1;
+                    };
+
+                    Primitive primitive = {
+                        .position = AccessorIndex(JsonMember(attributes, "POSITION")),
+                        .normal = AccessorIndex(JsonMember(attributes, "NORMAL")),
+                        .uv = AccessorIndex(JsonMember(attributes, "TEXCOORD_0")),
+                        .indices = AccessorIndex(JsonMember(primitiveJson, "indices")),
+                        .material = AccessorIndex(JsonMember(primitiveJson, "material")),
+                        .mode = GLTF_MODE_TRIANGLES,
+                    };
+                    JsonUint(JsonMember(primitiveJson, "mode"), &primitive.mode);
+
+                    if(primitive.position < 0 || !ValidAttribute(primitive.position, 3) || !ValidAttribute(primitive.normal, 3) ||
+                       !ValidAttribute(primitive.uv, 2) || !ValidAttribute(primitive.indices, 1)) {
+
+                        Warn("Invalid glb primitive { mesh: %u, position: %d, normal: %d, uv: %d, indices: %d }",
+                             i, primitive.position, primitive.normal, primitive.uv, primitive.indices);
+                        return false;
+                    }
+
+                    //Note: glTF only allows unsigned indices
+                    if(primitive.indices >= 0 && accessors[primitive.indices].componentType == GLTF_COMPONENT_FLOAT) {
+                        Warn("Invalid glb index type { mesh: %u, componentType: %u }", i, accessors[primitive.indices].componentType);
+                        return false;
+                    }
+
+                    if(primitive.material >= int32(materials.Count())) primitive.material = -1;
+
+                    *primitives.Push() = primitive;
+                }
+            }
+
+            return true;
+        }
+
+        // Finds every node in the default scene that draws a mesh and its transform
+        // Note: a glb without scenes draws every mesh untransformed
+        bool ParseInstances(const JsonValue* root) {
+
+            const JsonValue* nodesJson = JsonMember(root, "nodes");
+            const JsonValue* scenesJson = JsonMember(root, "scenes");
+
+            uint32 sceneIndex = 0;
+            JsonUint(JsonMember(root, "scene"), &sceneIndex);
+
+            const JsonValue* scene = JsonElement(scenesJson, sceneIndex);
+            if(!scene) {
+                for(uint32 i = 0; i < meshes.Count(); ++i) *instances.Push() = { .mesh = i, .matrix = Mat4<float>::identity };
+                return true;
+            }
+
+            Memory::Region tmpRegion = Memory::temporaryArena.CreateRegion();
+
+            struct Node {
+                uint32 node;
+                Mat4<float> parentMatrix;
+            };
+            Memory::ArenaArray<Node> stack(&Memory::temporaryArena);
+
+            const JsonValue* rootNodes = JsonMember(scene, "nodes");
+            for(uint32 i = 0; i < JsonCount(rootNodes); ++i) {
+                Node* entry = stack.Push();
+                entry->parentMatrix = Mat4<float>::identity;
+                if(!JsonUint(JsonElement(rootNodes, i), &entry->node)) entry->node = ~uint32(0);
+            }
+
+            //Note: nodes have to form trees so a node seen twice means the file is corrupt. This keeps cycles from looping forever
+            uint32 nodeCount = JsonCount(nodesJson);
+            bool* visited = (bool*)Memory::temporaryArena.PushBytes(nodeCount*sizeof(bool), true);
+
+            bool valid = true;
+            while(stack.Count()) {
+                Node entry = stack[stack.Count()-1];
+                stack.Pop();
+
+                if(entry.node >= nodeCount || visited[entry.node]) {
+                    Warn("Invalid glb node { node: %u, nodeCount: %u }", entry.node, nodeCount);
+                    valid = false;
+                    break;
+                }
+                visited[entry.node] = true;
+
+                const JsonValue* nodeJson = JsonElement(nodesJson, entry.node);
+                Mat4<float> matrix = entry.parentMatrix * NodeMatrix(nodeJson);
+
+                uint32 mesh;
+                if(JsonUint(JsonMember(nodeJson, "mesh"), &mesh)) {
+                    if(mesh >= meshes.Count()) {
+                        Warn("Invalid glb node mesh { node: %u, mesh: %u, meshCount: %u }", entry.node, mesh, meshes.Count());
+                        valid = false;
+                        break;
+                    }
+                    *instances.Push() = { .mesh = mesh, .matrix = matrix };
+                }
+
+                const JsonValue* children = JsonMember(nodeJson, "children");
+                for(uint32 i = 0; i < JsonCount(children); ++i) {
+                    Node* childEntry = stack.Push();
+                    childEntry->parentMatrix = matrix;
+                    if(!JsonUint(JsonElement(children, i), &childEntry->node)) childEntry->node = ~uint32(0);
+                }
+            }
+
+            Memory::temporaryArena.FreeBaseRegion(tmpRegion);
+            return valid;
+        }
+
+    public:
+
+        inline GltfMesh() {
+            arena.SetTraceName("GltfMesh");
+        }
+
+        // Parses the glb in 'bytes' of 'data'. Returns false if it isn't a glb we can load
+        // Note: never reads out of bounds so it's safe to call on corrupt files. The accessors point into 'data' so keep
+        //       it around while the mesh is used
+        bool Parse(const void* data, uint64 bytes) {
+
+            if(bytes < sizeof(GlbHeader) + sizeof(GlbChunkHeader)) return false;
+
+            GlbHeader header;
+            memcpy(&header, data, sizeof(header));
+            if(header.magic != kGlbMagic || header.version != kGlbVersion || header.length > bytes) return false;
+
+            GlbChunkHeader jsonHeader;
+            memcpy(&jsonHeader, ByteOffset(data, sizeof(header)), sizeof(jsonHeader));
+
+            uint64 jsonOffset = sizeof(GlbHeader) + sizeof(GlbChunkHeader);
+            if(jsonHeader.type != kGlbChunkJson || jsonOffset + jsonHeader.length > header.length) return false;
+
+            const char* json = (const char*)ByteOffset(data, jsonOffset);
+
+            //Note: chunks are 4 byte aligned. The binary chunk is optional
+            const uint8* bin = nullptr;
+            uint64 binBytes = 0;
+
+            uint64 binHeaderOffset = (jsonOffset + jsonHeader.length + 3) & ~uint64(3);
+            if(binHeaderOffset + sizeof(GlbChunkHeader) <= header.length) {
+                GlbChunkHeader binHeader;
+                memcpy(&binHeader, ByteOffset(data, binHeaderOffset), sizeof(binHeader));
+
+                uint64 binOffset = binHeaderOffset + sizeof(GlbChunkHeader);
+                if(binHeader.type == kGlbChunkBin && binOffset + binHeader.length <= header.length) {
+                    bin = (const uint8*)ByteOffset(data, binOffset);
+                    binBytes = binHeader.length;
+                }
+            }
+
+            const JsonValue* root = ParseJson(json, json + jsonHeader.length, &arena, &Memory::temporaryArena);
+            if(!root) {
+                Warn("Invalid glb json { jsonBytes: %u }", jsonHeader.length);
+                return false;
+            }
+
+            const JsonValue* version = JsonMember(JsonMember(root, "asset"), "version");
+            if(!version || version->type != JSON_STRING || !version->count || version->string[0] != '2') {
+                Warn("Unsupported glTF version { version: %.*s }", version && version->type == JSON_STRING ? int(version->count) : 0,
+                     version && version->type == JSON_STRING ? version->string : "");
+                return false;
+            }
+
+            return ParseAccessors(root, binBytes, bin) && ParseMeshes(root) && ParseInstances(root);
+        }
+
+        // Points 'view' straight at the glb's vertices and indices when they're already laid out like a mesh file.
+        // Returns false when the mesh has to be rebuilt with 'Build' instead
+        // Note: that's a single untransformed mesh whose primitives share one interleaved float vertex buffer view and
+        //       have their indices back to back in another. The header and attributes are allocated in 'arena',
+        //       the vertices and indices point into the glb. Meshes built this way have no meshlets or lods
+        bool ViewMeshFile(Memory::Arena* arena, MeshFileView* view) const {
+
+            if(instances.Count() != 1 || !IsIdentity(instances[0].matrix)) return false;
+
+            const Mesh& mesh = meshes[instances[0].mesh];
+            if(!mesh.primitiveCount) return false;
+
+            const Primitive& first = primitives[mesh.firstPrimitive];
+
+            //Note: indexed by MeshAttributeType
+            int32 attributeAccessors[] = { first.position, first.normal, first.uv };
+            COMPILE_ASSERT(ArrayCount(attributeAccessors) == MESH_ATTRIBUTE_COUNT);
+
+            const Accessor& position = accessors[first.position];
+            if(position.bufferView < 0 || position.componentType != GLTF_COMPONENT_FLOAT || !position.hasBounds) return false;
+
+            MeshAttribute attributes[MESH_ATTRIBUTE_COUNT];
+            uint32 attributeCount = 0;
+
+            for(uint32 type = 0; type < MESH_ATTRIBUTE_COUNT; ++type) {
+                if(attributeAccessors[type] < 0) continue;
+
+                const Accessor& accessor = accessors[attributeAccessors[type]];
+
+                //Note: snorm normals are fine (KHR_mesh_quantization) but anything else would need decoding
+                MeshComponentType componentType;
+                if(accessor.componentType == GLTF_COMPONENT_FLOAT && !accessor.normalized) componentType = MESH_COMPONENT_FLOAT32;
+                else if(type == MESH_ATTRIBUTE_NORMAL && accessor.componentType == GLTF_COMPONENT_SHORT && accessor.normalized) componentType = MESH_COMPONENT_SNORM16;
+                else return false;
+
+                //Note: interleaved attributes share a buffer view and their byte offsets are their offsets in the vertex
+                if(accessor.bufferView != position.bufferView || accessor.stride != position.stride || accessor.count != position.count ||
+                   accessor.byteOffset >= accessor.stride) return false;
+
+                attributes[attributeCount++] = {
+                    .type = MeshAttributeType(type),
+                    .componentType = componentType,
+                    .componentCount = accessor.componentCount,
+                    .offset = accessor.byteOffset,
+                };
+            }
+
+            //Note: the vbo is uploaded a whole vertex at a time so the buffer view has to cover the last one too
+            const BufferView& vertexView = bufferViews[position.bufferView];
+            if(uint64(position.count)*position.stride > vertexView.byteLength) return false;
+
+            const Accessor* firstIndices = first.indices >= 0 ? &accessors[first.indices] : nullptr;
+            if(!firstIndices || firstIndices->bufferView < 0) return false;
+
+            uint32 indexStride = GltfComponentBytes(firstIndices->componentType);
+            uint32 indexCount = 0;
+
+            for(uint32 i = 0; i < mesh.primitiveCount; ++i) {
+                const Primitive& primitive = primitives[mesh.firstPrimitive + i];
+
+                if(primitive.mode != GLTF_MODE_TRIANGLES || primitive.position != first.position || primitive.normal != first.normal ||
+                   primitive.uv != first.uv || primitive.indices < 0) return false;
+
+                const Accessor& indices = accessors[primitive.indices];
+                if(indices.bufferView != firstIndices->bufferView || indices.componentType != firstIndices->componentType ||
+                   indices.stride != indexStride || indices.count%3 ||
+                   indices.byteOffset != firstIndices->byteOffset + indexCount*indexStride) return false;
+
+                indexCount+= indices.count;
+            }
+
+            //Note: gl would read indices past the end of the vbo otherwise
+            for(uint32 i = 0; i < indexCount; ++i) {
+                uint32 index = ReadIndex(*firstIndices, i);
+                if(index >= position.count) return false;
+            }
+
+            MeshFileHeader* header = arena->PushType<MeshFileHeader>(true, alignof(MeshFileHeader));
+            *header = {
+                .magic = kMeshFileMagic,
+                .version = kMeshFileVersion,
+                .flags = (first.normal >= 0 ? uint32(MESH_FLAG_NORMAL) : 0) | (first.uv >= 0 ? uint32(MESH_FLAG_UV) : 0),
+                .attributeCount = attributeCount,
+                .vertexCount = position.count,
+                .vertexStride = position.stride,
+                .indexCount = indexCount,
+                .indexStride = indexStride,
+                .meshletCount = 0,
+                .lodCount = 1,
+                .vertexBytes = position.count*position.stride,
+                .indexBytes = indexCount*indexStride,
+                .boundsMin = { position.min[0], position.min[1], position.min[2] },
+                .boundsMax = { position.max[0], position.max[1], position.max[2] },
+            };
+
+            MeshAttribute* headerAttributes = (MeshAttribute*)arena->PushBytes(attributeCount*sizeof(MeshAttribute), false, alignof(MeshAttribute));
+            memcpy(headerAttributes, attributes, attributeCount*sizeof(MeshAttribute));
+
+            MeshLod* lod = arena->PushType<MeshLod>(false, alignof(MeshLod));
+            *lod = { .indexOffset = 0, .indexCount = indexCount, .meshletOffset = 0, .meshletCount = 0, .error = 0.f };
+
+            *view = {
+                .header = header,
+                .attributes = headerAttributes,
+                .vertices = vertexView.data,
+                .indices = firstIndices->data,
+                .meshlets = nullptr,
+                .lods = lod,
+                .data = header,
+                .bytes = 0, //Note: the mesh isn't contiguous so there's no file to store
+            };
+            return true;
+        }
+
+        // Builds every instance into a mesh file like 'ObjMesh::Build'. The mesh file is allocated in 'arena'
+        // Note: strips and fans are turned into triangle lists, points and lines are skipped.
+        //       Normals are generated with 'creaseAngle' on up to 'maxThreads' threads unless every primitive has them
+        MeshFileView Build(Memory::Arena* arena, float creaseAngle = ObjMesh::kDefaultCreaseAngle, bool optimizeOverdraw = true,
+                           const MeshVertexFormat& vertexFormat = kMeshVertexFormatFloat32,
+                           uint32 maxThreads = ObjMesh::DefaultParseThreadCount()) const {
+
+            auto IsTriangles = [](const Primitive& primitive) { return primitive.mode >= GLTF_MODE_TRIANGLES && primitive.mode <= GLTF_MODE_TRIANGLE_FAN; };
+
+            bool hasNormals = true, hasUvs = false;
+            for(const Instance& instance : instances) {
+                const Mesh& mesh = meshes[instance.mesh];
+                for(uint32 i = mesh.firstPrimitive; i < mesh.firstPrimitive + mesh.primitiveCount; ++i) {
+                    if(!IsTriangles(primitives[i])) continue;
+
+                    hasNormals&= primitives[i].normal >= 0;
+                    hasUvs|= primitives[i].uv >= 0;
+                }
+            }
+
+            ObjMesh obj;
+            obj.flags = (hasNormals ? MESH_FLAG_NORMAL : 0) | (hasUvs ? MESH_FLAG_UV : 0);
+
+            for(const Instance& instance : instances) {
+                const Mesh& mesh = meshes[instance.mesh];
+
+                Mat4<float> matrix = instance.matrix;
+                Mat4<float> normalMatrix = matrix.Inverse().Transpose();
+
+                //Note: a mirrored transform turns triangles inside out so their winding is flipped back
+                float determinant = matrix.a1*(matrix.b2*matrix.c3 - matrix.b3*matrix.c2) -
+                                    matrix.a2*(matrix.b1*matrix.c3 - matrix.b3*matrix.c1) +
+                                    matrix.a3*(matrix.b1*matrix.c2 - matrix.b2*matrix.c1);
+                bool flipWinding = determinant < 0.f;
+
+                for(uint32 i = mesh.firstPrimitive; i < mesh.firstPrimitive + mesh.primitiveCount; ++i) {
+                    const Primitive& primitive = primitives[i];
+
+                    if(!IsTriangles(primitive)) {
+                        Warn("Skipping glb primitive that isn't triangles { mesh: %u, mode: %u }", instance.mesh, primitive.mode);
+                        continue;
+                    }
+
+                    const Accessor& position = accessors[primitive.position];
+                    uint32 vertexCount = position.count;
+                    uint32 vertexOffset = obj.geoVerts.Count();
+
+                    //Note: accessors of one primitive have to have the same count but corrupt files could say otherwise
+                    bool validCounts = (primitive.normal < 0 || accessors[primitive.normal].count == vertexCount) &&
+                                       (primitive.uv < 0 || accessors[primitive.uv].count == vertexCount);
+                    if(!validCounts) {
+                        Warn("Skipping glb primitive with mismatched attribute counts { mesh: %u, vertexCount: %u }", instance.mesh, vertexCount);
+                        continue;
+                    }
+
+                    uint32 cornerCount = primitive.indices >= 0 ? accessors[primitive.indices].count : vertexCount;
+                    uint32 triangleCount = primitive.mode == GLTF_MODE_TRIANGLES ? cornerCount/3 : (cornerCount >= 3 ? cornerCount - 2 : 0);
+
+                    auto Corner = [&](uint32 i) { return primitive.indices >= 0 ? ReadIndex(accessors[primitive.indices], i) : i; };
+
+                    bool validIndices = true;
+                    for(uint32 j = 0; j < cornerCount; ++j) validIndices&= Corner(j) < vertexCount;
+                    if(!validIndices) {
+                        Warn("Skipping glb primitive with out of range indices { mesh: %u, vertexCount: %u }", instance.mesh, vertexCount);
+                        continue;
+                    }
+
+                    //Note: the arrays share the obj's arena so grow them once per primitive rather than once per doubling
+                    obj.geoVerts.Reserve(obj.geoVerts.Count() + vertexCount);
+                    if(hasNormals) obj.normalVerts.Reserve(obj.normalVerts.Count() + vertexCount);
+                    if(hasUvs)     obj.uvVerts.Reserve(obj.uvVerts.Count() + vertexCount);
+
+                    for(uint32 j = 0; j < vertexCount; ++j) {
+
+                        float values[3];
+                        ReadAccessor(position, j, values);
+                        *obj.geoVerts.Push() = Transform(matrix, values, 1.f);
+
+                        if(hasNormals) {
+                            ReadAccessor(accessors[primitive.normal], j, values);
+                            Vec3<float> normal = Transform(normalMatrix, values, 0.f);
+
+                            float norm = normal.Norm();
+                            *obj.normalVerts.Push() = norm > 0.f ? normal/norm : normal;
+                        }
+
+                        if(hasUvs) {
+                            if(primitive.uv >= 0) ReadAccessor(accessors[primitive.uv], j, values);
+                            else                  values[0] = values[1] = 0.f;
+
+                            *obj.uvVerts.Push() = Vec2<float>(values[0], values[1]);
+                        }
+                    }
+
+                    ObjMesh::Indices* corners = obj.indices.Push(3*triangleCount);
+                    for(uint32 j = 0; j < triangleCount; ++j) {
+
+                        uint32 triangle[3];
+                        switch(primitive.mode) {
+                            case GLTF_MODE_TRIANGLES: {
+                                triangle[0] = Corner(3*j); triangle[1] = Corner(3*j + 1); triangle[2] = Corner(3*j + 2);
+                            } break;
+
+                            //Note: every other strip triangle is wound backwards so its first two corners are swapped
+                            case GLTF_MODE_TRIANGLE_STRIP: {
+                                triangle[0] = Corner(j + (j&1)); triangle[1] = Corner(j + 1 - (j&1)); triangle[2] = Corner(j + 2);
+                            } break;
+
+                            default: {
+                                triangle[0] = Corner(0); triangle[1] = Corner(j + 1); triangle[2] = Corner(j + 2);
+                            } break;
+                        }
+
+                        if(flipWinding) Swap(triangle[1], triangle[2]);
+
+                        for(uint32 k = 0; k < 3; ++k) {
+                            uint32 vertex = vertexOffset + triangle[k];
+                            corners[3*j + k] = { .vertex = vertex, .uv = vertex, .normal = vertex };
+                        }
+                    }
+                }
+            }
+
+            RUNTIME_ASSERT(obj.indices.Count(), "Glb doesn't have any triangles { instanceCount: %u }", instances.Count());
+            return obj.Build(arena, creaseAngle, optimizeOverdraw, vertexFormat, maxThreads);
+        }
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <string.h>
+
+#include "types.h"
+#include "Memory.h"
+#include "stringUtil.h"
+
+// Minimal json reader. The whole document is parsed into a tree of JsonValues in one pass
+// Note: strings point into the json and keep their escapes so they're only good for comparing against plain keys and
+//       logging. Numbers are doubles so integers up to 2^53 are exact
+
+enum JsonType: uint8 { JSON_NULL, JSON_FALSE, JSON_TRUE, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+struct JsonValue {
+    JsonType type;
+    uint32 count; //Note: chars in a string, elements in an array or members in an object
+
+    const char* key; //Note: set on object members
+    uint32 keyLength;
+
+    union {
+        double number;
+        const char* string;
+        const JsonValue* elements; //Note: array elements or object members
+    };
+
+    inline const JsonValue* begin() const { return (type == JSON_ARRAY || type == JSON_OBJECT) ? elements : nullptr; }
+    inline const JsonValue* end() const   { return (type == JSON_ARRAY || type == JSON_OBJECT) ? elements + count : nullptr; }
+};
+
+//Note: the accessors below take nullptr for a missing value so lookups can be chained. Ex. JsonMember(JsonMember(root, "asset"), "version")
+
+// Returns the member of 'object' called 'name' or nullptr if 'object' isn't an object or doesn't have one
+inline const JsonValue* JsonMember(const JsonValue* object, const char* name) {
+    if(!object || object->type != JSON_OBJECT) return nullptr;
+
+    uint32 nameLength = strlen(name);
+    for(const JsonValue& member : *object) {
+        if(member.keyLength == nameLength && !memcmp(member.key, name, nameLength)) return &member;
+    }
+    return nullptr;
+}
+
+// Returns element 'i' of 'array' or nullptr if 'array' isn't an array or is too short
+inline const JsonValue* JsonElement(const JsonValue* array, uint32 i) {
+    return array && array->type == JSON_ARRAY && i < array->count ? array->elements + i : nullptr;
+}
+
+// Returns the number of elements in 'array' or 0 if it isn't an array
+inline uint32 JsonCount(const JsonValue* array) {
+    return array && array->type == JSON_ARRAY ? array->count : 0;
+}
+
+inline double JsonNumber(const JsonValue* value, double defaultValue) {
+    return value && value->type == JSON_NUMBER ? value->number : defaultValue;
+}
+
+inline bool JsonBool(const JsonValue* value, bool defaultValue) {
+    return value && (value->type == JSON_TRUE || value->type == JSON_FALSE) ? value->type == JSON_TRUE : defaultValue;
+}
+
+// Stores 'value' in 'result' if it's a whole number that fits in a uint32. Returns false and leaves 'result' alone otherwise
+inline bool JsonUint(const JsonValue* value, uint32* result) {
+    if(!value || value->type != JSON_NUMBER || value->number < 0. || value->number > double(~uint32(0)) ||
+       value->number != double(uint32(value->number))) return false;
+
+    *result = uint32(value->number);
+    return true;
+}
+
+inline bool JsonStringEquals(const JsonValue* value, const char* str) {
+    return value && value->type == JSON_STRING && value->count == strlen(str) && !memcmp(value->string, str, value->count);
+}
+
+// Reads 'count' numbers from the array 'value' into 'result'. Returns false and leaves 'result' alone if it doesn't have them
+inline bool JsonNumbers(const JsonValue* value, float* result, uint32 count) {
+    if(JsonCount(value) != count) return false;
+
+    for(const JsonValue& element : *value) {
+        if(element.type != JSON_NUMBER) return false;
+    }
+
+    for(uint32 i = 0; i < count; ++i) result[i] = float(value->elements[i].number);
+    return true;
+}
+
+//Note: corrupt files could nest deep enough to blow the stack otherwise
+constexpr uint32 kMaxJsonDepth = 64;
+
+struct JsonParser {
+    const char* str;
+    const char* end;
+
+    Memory::Arena* arena;
+    Memory::ArenaArray<JsonValue> stack; //Note: elements of the containers being parsed. Moved to 'arena' once the container ends
+};
+
+// Parses the string at 'parser->str' into 'string' and 'length' without the quotes
+inline bool ParseJsonString(JsonParser* parser, const char** string, uint32* length) {
+
+    if(StrPeek(parser->str, parser->end) != '"') return false;
+
+    const char* start = ++parser->str;
+    for(; parser->str < parser->end; ++parser->str) {
+        char c = *parser->str;
+
+        if(c == '"') {
+            *string = start;
+            *length = parser->str++ - start;
+            return true;
+        }
+
+        if(c == '\\') ++parser->str; //Note: skip the escaped char so \" doesn't end the string
+        else if(uint8(c) < 0x20) return false;
+    }
+
+    return false;
+}
+
+inline bool ParseJsonNumber(JsonParser* parser, double* number) {
+
+    const char *start = parser->str,
+               *str = start,
+               *end = parser->end;
+
+    auto SkipDigits = [&]() {
+        const char* digitsStart = str;
+        while(InRange(StrPeek(str, end), '0', '9')) ++str;
+        return str != digitsStart;
+    };
+
+    if(StrPeek(str, end) == '-') ++str;
+
+    const char* digitsStart = str;
+    if(!SkipDigits()) return false;
+
+    bool integral = true;
+    if(StrPeek(str, end) == '.') {
+        ++str;
+        if(!SkipDigits()) return false;
+        integral = false;
+    }
+
+    if(LowerCase(StrPeek(str, end)) == 'e') {
+        ++str;
+        if(StrPeek(str, end) == '+' || StrPeek(str, end) == '-') ++str;
+        if(!SkipDigits()) return false;
+        integral = false;
+    }
+
+    //Note: StrToFloat rounds to a float so integers that fit in a double exactly are parsed separately. Ex. byte offsets past 2^24
+    if(integral && str - digitsStart <= 15) {
+        double digits = double(StrDigits<uint64>((char*)digitsStart, ~uint64(0), nullptr, str));
+        *number = (*start == '-') ? -digits : digits;
+    } else {
+        *number = StrToFloat((char*)start, nullptr, str);
+    }
+
+    parser->str = str;
+    return true;
+}
+
+inline bool ParseJsonValue(JsonParser* parser, JsonValue* value, uint32 depth) {
+
+    parser->str = SkipWhiteSpace<const char>(parser->str, parser->end);
+
+    auto ParseLiteral = [&](const char* literal, JsonType type) {
+        uint32 length = strlen(literal);
+        if(uint64(parser->end - parser->str) < length || memcmp(parser->str, literal, length)) return false;
+
+        parser->str+= length;
+        value->type = type;
+        return true;
+    };
+
+    *value = {};
+    switch(StrPeek(parser->str, parser->end)) {
+        case 'n': return ParseLiteral("null", JSON_NULL);
+        case 't': return ParseLiteral("true", JSON_TRUE);
+        case 'f': return ParseLiteral("false", JSON_FALSE);
+
+        case '"': {
+            value->type = JSON_STRING;
+            return ParseJsonString(parser, &value->string, &value->count);
+        }
+
+        case '[':
+        case '{': {
+            if(depth >= kMaxJsonDepth) return false;
+
+            bool isObject = (*parser->str++ == '{');
+            char closer = isObject ? '}' : ']';
+
+            uint32 stackStart = parser->stack.Count();
+
+            parser->str = SkipWhiteSpace<const char>(parser->str, parser->end);
+            if(StrPeek(parser->str, parser->end) == closer) {
+                ++parser->str;
+
+            } else {
+
+                for(;;) {
+                    const char* key = nullptr;
+                    uint32 keyLength = 0;
+
+                    if(isObject) {
+                        parser->str = SkipWhiteSpace<const char>(parser->str, parser->end);
+                        if(!ParseJsonString(parser, &key, &keyLength)) return false;
+
+                        parser->str = SkipWhiteSpace<const char>(parser->str, parser->end);
+                        if(StrPeek(parser->str, parser->end) != ':') return false;
+                        ++parser->str;
+                    }
+
+                    JsonValue element;
+                    if(!ParseJsonValue(parser, &element, depth+1)) return false;
+
+                    element.key = key;
+                    element.keyLength = keyLength;
+                    parser->stack.PushBack(element);
+
+                    parser->str = SkipWhiteSpace<const char>(parser->str, parser->end);
+                    char c = StrPeek(parser->str, parser->end);
+                    if(c != ',' && c != closer) return false;
+
+                    ++parser->str;
+                    if(c == closer) break;
+                }
+            }
+
+            //Note: nested containers already moved their elements off the stack so ours are on top
+            uint32 count = parser->stack.Count() - stackStart;
+            JsonValue* elements = (JsonValue*)parser->arena->PushBytes(count*sizeof(JsonValue), false, alignof(JsonValue));
+            if(count) memcpy(elements, parser->stack.Data() + stackStart, count*sizeof(JsonValue));
+            parser->stack.Pop(count);
+
+            value->type = isObject ? JSON_OBJECT : JSON_ARRAY;
+            value->count = count;
+            value->elements = elements;
+            return true;
+        }
+
+        default: {
+            value->type = JSON_NUMBER;
+            return ParseJsonNumber(parser, &value->number);
+        }
+    }
+}
+
+// Parses the json in ['json', 'jsonEnd'). Returns the root value or nullptr if it isn't valid json
+// Note: values are allocated in 'arena' and point into 'json' so both have to outlive them.
+//       'scratchArena' holds the values while they're parsed and has to be a different arena than 'arena'
+inline const JsonValue* ParseJson(const char* json, const char* jsonEnd, Memory::Arena* arena, Memory::Arena* scratchArena) {
+
+    RUNTIME_ASSERT(arena != scratchArena, "Json values can't be allocated in the scratch arena");
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+
+    JsonParser parser = {
+        .str = json,
+        .end = jsonEnd,
+        .arena = arena,
+        .stack = Memory::ArenaArray<JsonValue>(scratchArena),
+    };
+
+    JsonValue* root = arena->PushType<JsonValue>(false, alignof(JsonValue));
+
+    bool valid = ParseJsonValue(&parser, root, 0) && SkipWhiteSpace<const char>(parser.str, jsonEnd) == jsonEnd;
+
+    scratchArena->FreeBaseRegion(tmpRegion);
+    return valid ? root : nullptr;
+}
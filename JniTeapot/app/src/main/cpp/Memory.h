@@ -1,46 +1,490 @@
 #pragma once
 
 #include <errno.h>
+#include <atomic>
 
 #include "types.h"
 #include "util.h"
+#include "Sequence.h"
+#include "AllocationCounters.h"
 
 #define ENABLE_MEMORY_STATS 1
 
+// Note: records every arena allocation by call site so they can be dumped with Memory::DumpTrace.
+//		 This is slow and takes a lock per allocation, only turn it on for profiling builds
+#define ENABLE_MEMORY_TRACING 0
+
+#if ENABLE_MEMORY_TRACING
+	#include <fcntl.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <time.h>
+	#include <unistd.h>
+
+	// Note: default arguments are evaluated at the call site so MEMORY_TRACE_PARAM captures whoever called the
+	//		 allocating function. Internal functions take MEMORY_TRACE_DECL and forward it with MEMORY_TRACE_ARG
+	#define MEMORY_TRACE_PARAM , Memory::TraceSite traceSite = Memory::TraceSite::Current()
+	#define MEMORY_TRACE_DECL  , Memory::TraceSite traceSite
+	#define MEMORY_TRACE_ARG   , traceSite
+	#define MEMORY_TRACE_HERE  , Memory::TraceSite{ __FILE__, __builtin_FUNCTION(), __LINE__ }
+#else
+	#define MEMORY_TRACE_PARAM
+	#define MEMORY_TRACE_DECL
+	#define MEMORY_TRACE_ARG
+	#define MEMORY_TRACE_HERE
+#endif
+
 class Memory {
 		
     private:
 
 		// TODO: consider passing in blockSize or querying system for page size
 		static constexpr uint kMinBlockSize = KB(4); // size of a normal linux page
+		static constexpr uint kCacheLineSize = 64;
+		static constexpr uint kHugePageSize = MB(2); // size of a arm64/x86_64 linux huge page
+
+		// Note: headers are padded so the first byte of every block is aligned for any SIMD type without padding
+		static constexpr uint kBlockHeaderAlignment = 16;
+
+		#if ENABLE_MEMORY_TRACING
+			struct TraceSiteStats;
+		#endif
 
-	    struct Block {
+	    struct alignas(kBlockHeaderAlignment) Block {
             Block* previousBlock;
             uint32 bytes;
             uint32 position;
    
 			#if ENABLE_MEMORY_STATS
                 uint32 padBytes;
+                bool hugePages;
+			#endif
+
+			#if ENABLE_MEMORY_TRACING
+				TraceSiteStats* traceSiteStats; //call site that created the block
+				uint64 traceTimeNs;				//time the block was created
 			#endif
 
             inline uint32 FreeBytes() { return bytes - position; }
         };
+        COMPILE_ASSERT(sizeof(Block) % kBlockHeaderAlignment == 0, "Block header isn't padded to kBlockHeaderAlignment");
 		
 		static inline Block emptyBlock = {};
-		
+
+		// Process-wide cache of freed blocks shared by every arena on every thread.
+		// Note: blocks are binned into power of 2 size classes. Each class is a fixed array of slots that are
+		//		 claimed/released with a single CAS, so the pool is lock-free and never has to read a block it
+		//		 doesn't own (no ABA problem). The number of slots doubles as the per class retention cap.
+		class BlockPool {
+			public:
+				static constexpr uint32 kMaxPooledBlockBytes  = MB(1);
+				static constexpr uint32 kSlotsPerSizeClass    = 16;
+				static constexpr uint32 kDefaultRetainedBytes = MB(8);
+
+			private:
+				static constexpr uint32 kNumSizeClasses = __builtin_ctz(kMaxPooledBlockBytes) - __builtin_ctz(kMinBlockSize) + 1;
+				
+				struct alignas(kCacheLineSize) SizeClass {
+					std::atomic<Block*> slots[kSlotsPerSizeClass];
+				};
+
+				static inline SizeClass sizeClasses[kNumSizeClasses];
+				
+				static inline std::atomic<uint32> maxRetainedBytes = kDefaultRetainedBytes;
+				static inline std::atomic<uint32> retainedBytes, retainedBlocks;
+
+				static inline SizeClass& GetSizeClass(uint32 blockBytes) {
+					return sizeClasses[__builtin_ctz(blockBytes) - __builtin_ctz(kMinBlockSize)];
+				}
+
+				// Removes any block from 'sizeClass'. Returns nullptr if the class is empty
+				static inline Block* PopSizeClass(SizeClass& sizeClass, uint32 blockBytes) {
+					for(std::atomic<Block*>& slot : sizeClass.slots) {
+
+						Block* block = slot.load(std::memory_order_relaxed);
+						if(block && slot.compare_exchange_strong(block, nullptr, std::memory_order_acquire, std::memory_order_relaxed)) {
+							retainedBytes.fetch_sub(blockBytes, std::memory_order_relaxed);
+							retainedBlocks.fetch_sub(1, std::memory_order_relaxed);
+							return block;
+						}
+					}
+					return nullptr;
+				}
+
+				// Places 'block' into 'sizeClass' without checking the retention cap. Returns false if the class is full
+				static inline bool PushSizeClass(SizeClass& sizeClass, Block* block, uint32 blockBytes) {
+					for(std::atomic<Block*>& slot : sizeClass.slots) {
+						
+						Block* emptySlot = nullptr;
+						if(!slot.load(std::memory_order_relaxed) &&
+						   slot.compare_exchange_strong(emptySlot, block, std::memory_order_release, std::memory_order_relaxed)) {
+							retainedBytes.fetch_add(blockBytes, std::memory_order_relaxed);
+							retainedBlocks.fetch_add(1, std::memory_order_relaxed);
+							return true;
+						}
+					}
+					return false;
+				}
+
+			public:
+
+				// Returns the number of bytes that are actually allocated for a block that needs at least 'minBytes'
+				// Note: poolable blocks are rounded to their size class, larger blocks are rounded to a whole page
+				static constexpr uint32 BlockBytes(uint32 minBytes) {
+					return (minBytes <= kMinBlockSize) ? kMinBlockSize :
+						   (minBytes <= kMaxPooledBlockBytes) ? Pow2RoundUp(minBytes) :
+						   CeilFraction(minBytes, kMinBlockSize)*kMinBlockSize;
+				}
+
+				static constexpr bool IsPoolable(uint32 blockBytes) { return blockBytes <= kMaxPooledBlockBytes; }
+
+				static inline uint32 RetainedBytes()  { return retainedBytes.load(std::memory_order_relaxed); }
+				static inline uint32 RetainedBlocks() { return retainedBlocks.load(std::memory_order_relaxed); }
+
+				// Returns a recycled block of exactly 'blockBytes' or nullptr if there isn't one
+				// Note: recycled blocks are NOT zeroed
+				static inline Block* Pop(uint32 blockBytes) {
+					if(!IsPoolable(blockBytes)) return nullptr;
+					return PopSizeClass(GetSizeClass(blockBytes), blockBytes);
+				}
+
+				// Returns true if the pool took ownership of 'block', false if the caller still needs to free it
+				static inline bool Push(Block* block) {
+					uint32 blockBytes = block->bytes;
+					if(!IsPoolable(blockBytes)) return false;
+
+					//Note: retention cap is soft - racing pushes may overshoot it by at most a few blocks
+					if(RetainedBytes() + blockBytes > maxRetainedBytes.load(std::memory_order_relaxed)) return false;
+					
+					return PushSizeClass(GetSizeClass(blockBytes), block, blockBytes);
+				}
+
+				// Lets the kernel reclaim the physical memory of every pooled block while keeping them mapped
+				// Note: blocks are pulled out of the pool while they are decommitted so we never race a thread that
+				//		 popped and started writing to the block
+				static void Decommit() {
+					for(uint32 i = 0; i < kNumSizeClasses; ++i) {
+						
+						uint32 blockBytes = kMinBlockSize << i;
+						Block* blocks[kSlotsPerSizeClass];
+
+						uint32 numBlocks = 0;
+						while(numBlocks < kSlotsPerSizeClass && (blocks[numBlocks] = PopSizeClass(sizeClasses[i], blockBytes))) ++numBlocks;
+
+						for(uint32 j = 0; j < numBlocks; ++j) {
+							RUNTIME_ASSERT(HeapDecommit(blocks[j], blockBytes),
+										   "Failed to decommit pooled block { block: %p, bytes: %u, Linux errno: %d }",
+										   blocks[j], blockBytes, errno);
+							CountSyscalls(1);
+
+							if(!PushSizeClass(sizeClasses[i], blocks[j], blockBytes)) {
+								HeapFree(blocks[j], blockBytes);
+								CountSyscalls(1);
+							}
+						}
+					}
+				}
+
+				// Sets the maximum number of bytes the pool holds on to and frees any blocks over the new cap
+				static void SetMaxRetainedBytes(uint32 bytes) {
+					maxRetainedBytes.store(bytes, std::memory_order_relaxed);
+
+					//Note: free largest blocks first
+					for(int32 i = kNumSizeClasses-1; i >= 0 && RetainedBytes() > bytes; --i) {
+						
+						uint32 blockBytes = kMinBlockSize << i;
+						for(Block* block; RetainedBytes() > bytes && (block = PopSizeClass(sizeClasses[i], blockBytes));) {
+							RUNTIME_ASSERT(HeapFree(block, blockBytes),
+										   "Failed to free pooled block { block: %p, bytes: %u, Linux errno: %d }",
+										   block, blockBytes, errno);
+							CountSyscalls(1);
+						}
+					}
+				}
+		};
+
     public:
 		
 		#if ENABLE_MEMORY_STATS
-			static inline uint32 memoryBytes;
-			static inline uint32 memoryPadBytes;
-			static inline uint32 memoryUnusedBytes;
-			static inline uint32 memoryBlockReservedBytes;
+			struct Stats {
+				uint32 memoryBytes;
+				uint32 memoryPadBytes;
+				uint32 memoryUnusedBytes;
+				uint32 memoryBlockReservedBytes;
 			
-			static inline uint32 memoryBlockCount;
-			static inline uint32 memoryBlockReserveCount;
+				uint32 memoryBlockCount;
+				uint32 memoryBlockReserveCount;
+				uint32 memoryHugeBlockCount;
+				
+				uint32 memorySyscallCount; //total number of mmap/munmap/madvise/mprotect calls made by Memory
+
+				uint32 poolBytes;
+				uint32 poolBlockCount;
+
+				uint32 objectPoolSlotCount;	    //slots carved out by every Memory::Pool
+				uint32 objectPoolFreeSlotCount; //slots sitting in a Memory::Pool free list
+			};
+
+		private:
+
+			// Note: every thread gets its own cache line of counters so arenas on different threads don't contend.
+			//		 Counters are still atomic because a block can be freed on a different thread than it was created on
+			//		 which also means a single thread's counters can go negative. Only their sum is meaningful.
+			struct alignas(kCacheLineSize) ThreadStats {
+				std::atomic<int32> memoryBytes;
+				std::atomic<int32> memoryPadBytes;
+				std::atomic<int32> memoryUnusedBytes;
+				std::atomic<int32> memoryBlockReservedBytes;
+				
+				std::atomic<int32> memoryBlockCount;
+				std::atomic<int32> memoryBlockReserveCount;
+				std::atomic<int32> memoryHugeBlockCount;
+				
+				std::atomic<int32> memorySyscallCount;
+
+				std::atomic<int32> objectPoolSlotCount;
+				std::atomic<int32> objectPoolFreeSlotCount;
+			};
+
+			//Note: threads past kMaxStatsThreads share slots. This is still correct, just slower
+			static constexpr uint32 kMaxStatsThreads = 32;
+			static inline ThreadStats threadStats[kMaxStatsThreads];
+			static inline std::atomic<uint32> threadStatsCount;
+			static inline thread_local ThreadStats* localThreadStats;
+
+			static inline ThreadStats* LocalThreadStats() {
+				if(!localThreadStats) {
+					uint32 index = threadStatsCount.fetch_add(1, std::memory_order_relaxed);
+					localThreadStats = &threadStats[index % kMaxStatsThreads];
+				}
+				return localThreadStats;
+			}
+
+			static inline void StatAdd(std::atomic<int32> ThreadStats::* stat, int32 delta) {
+				(LocalThreadStats()->*stat).fetch_add(delta, std::memory_order_relaxed);
+			}
+
+		public:
+
+			// Returns the sum of every thread's memory counters
+			// Note: counters are read without synchronization so totals may be off by in-flight allocations
+			static Stats GlobalStats() {
+				int32 bytes = 0, padBytes = 0, unusedBytes = 0, blockReservedBytes = 0, blockCount = 0, blockReserveCount = 0, hugeBlockCount = 0, syscallCount = 0, objectSlotCount = 0, objectFreeSlotCount = 0;
+				
+				uint32 numThreadStats = Min(threadStatsCount.load(std::memory_order_relaxed), kMaxStatsThreads);
+				for(uint32 i = 0; i < numThreadStats; ++i) {
+					const ThreadStats& stats = threadStats[i];
+					bytes+=              stats.memoryBytes.load(std::memory_order_relaxed);
+					padBytes+=           stats.memoryPadBytes.load(std::memory_order_relaxed);
+					unusedBytes+=        stats.memoryUnusedBytes.load(std::memory_order_relaxed);
+					blockReservedBytes+= stats.memoryBlockReservedBytes.load(std::memory_order_relaxed);
+					blockCount+=         stats.memoryBlockCount.load(std::memory_order_relaxed);
+					blockReserveCount+=  stats.memoryBlockReserveCount.load(std::memory_order_relaxed);
+					hugeBlockCount+=     stats.memoryHugeBlockCount.load(std::memory_order_relaxed);
+					syscallCount+=       stats.memorySyscallCount.load(std::memory_order_relaxed);
+					objectSlotCount+=    stats.objectPoolSlotCount.load(std::memory_order_relaxed);
+					objectFreeSlotCount+=stats.objectPoolFreeSlotCount.load(std::memory_order_relaxed);
+				}
+
+				return Stats {
+					.memoryBytes              = uint32(bytes),
+					.memoryPadBytes           = uint32(padBytes),
+					.memoryUnusedBytes        = uint32(unusedBytes),
+					.memoryBlockReservedBytes = uint32(blockReservedBytes),
+					.memoryBlockCount         = uint32(blockCount),
+					.memoryBlockReserveCount  = uint32(blockReserveCount),
+					.memoryHugeBlockCount     = uint32(hugeBlockCount),
+					.memorySyscallCount       = uint32(syscallCount),
+					.poolBytes                = BlockPool::RetainedBytes(),
+					.poolBlockCount           = BlockPool::RetainedBlocks(),
+					.objectPoolSlotCount      = uint32(objectSlotCount),
+					.objectPoolFreeSlotCount  = uint32(objectFreeSlotCount),
+				};
+			}
 		#endif
 
+	#if ENABLE_MEMORY_TRACING
+		public:
+			
+			struct TraceSite {
+				const char* file;
+				const char* func;
+				uint32 line;
+
+				// Note: the builtins are evaluated where the outermost default argument is used, not here
+				static constexpr TraceSite Current(const char* file = __builtin_FILE(), const char* func = __builtin_FUNCTION(), uint32 line = __builtin_LINE()) {
+					return TraceSite { .file = file, .func = func, .line = line };
+				}
+			};
+
+		private:
+
+			// Totals for every allocation a single call site made from arenas with the same name
+			struct TraceSiteStats {
+				TraceSite site;
+				const char* arenaName;
+
+				uint64 pushCount, pushBytes;
+				uint64 liveBytes, peakLiveBytes;
+				uint64 pushFreeCount, pushLifetimeNs, pushMaxLifetimeNs;
+				
+				uint64 blockCount, blockBytes; //Note: VirtualArena commits count as blocks
+				uint64 blockFreeCount, blockLifetimeNs;
+			};
+
+			// A live allocation. Arenas keep a stack of these that mirrors their own so FreeBaseRegion knows what it freed
+			struct TraceRecord {
+				TraceSiteStats* siteStats;
+				Block* block;
+				uint32 position;
+				uint32 bytes;
+				uint64 timeNs;
+			};
+
+			static constexpr uint32 kMaxTraceSites = 4096;
+			COMPILE_ASSERT(IsPow2(kMaxTraceSites), "kMaxTraceSites must be a power of 2");
+
+			//Note: open addressed hash table keyed by call site and arena name. Guarded by traceLock
+			static inline TraceSiteStats traceSites[kMaxTraceSites];
+			static inline uint32 traceSiteCount;
+			static inline std::atomic_flag traceLock = ATOMIC_FLAG_INIT;
+
+			static inline void LockTrace()   { while(traceLock.test_and_set(std::memory_order_acquire)); }
+			static inline void UnlockTrace() { traceLock.clear(std::memory_order_release); }
+
+			static inline uint64 TraceTimeNs() {
+				timespec ts;
+				clock_gettime(CLOCK_MONOTONIC, &ts);
+				return 1000000000ULL*ts.tv_sec + ts.tv_nsec;
+			}
+
+			// Returns the stats for 'site' in arenas named 'arenaName'. Adds them to the table if they don't exist yet
+			// Note: string literals are unique in a build so sites are compared by pointer
+			// Warn: must be called with traceLock held
+			static TraceSiteStats* FindTraceSite(const TraceSite& site, const char* arenaName) {
+				
+				uint64 hash = (uint64(site.file) ^ (uint64(arenaName) << 7) ^ (uint64(site.line) << 32)) * 0x9E3779B97F4A7C15ULL;
+				for(uint32 i = (hash >> 32) & (kMaxTraceSites-1);; i = (i+1) & (kMaxTraceSites-1)) {
+					TraceSiteStats& siteStats = traceSites[i];
+					
+					if(!siteStats.site.file) {
+						RUNTIME_ASSERT(++traceSiteCount < kMaxTraceSites, "Ran out of memory trace sites { kMaxTraceSites: %u }", kMaxTraceSites);
+						
+						siteStats.site = site;
+						siteStats.arenaName = arenaName;
+						return &siteStats;
+					}
+					
+					if(siteStats.site.file == site.file && siteStats.site.line == site.line &&
+					   siteStats.site.func == site.func && siteStats.arenaName == arenaName) return &siteStats;
+				}
+			}
+
+			static inline const char* TraceFileName(const char* path) {
+				const char* slash = strrchr(path, '/');
+				return slash ? slash+1 : path;
+			}
+
+			static int CompareTraceSites(const void* a, const void* b) {
+				const TraceSiteStats *siteA = (const TraceSiteStats*)a,
+									 *siteB = (const TraceSiteStats*)b;
+
+				if(int cmp = strcmp(TraceFileName(siteA->site.file), TraceFileName(siteB->site.file))) return cmp;
+				if(siteA->site.line != siteB->site.line) return siteA->site.line < siteB->site.line ? -1 : 1;
+				if(int cmp = strcmp(siteA->site.func, siteB->site.func)) return cmp;
+				return strcmp(siteA->arenaName, siteB->arenaName);
+			}
+
+		public:
+
+			// Writes a table of every traced call site to 'filePath'
+			// Note: rows are sorted by call site and don't contain addresses so dumps from different builds can be diffed.
+			//		 Lifetimes are in microseconds and only include allocations that have been freed
+			static void DumpTrace(const char* filePath) {
+				
+				LockTrace();
+				
+				uint32 numSites = 0;
+				uint32 sitesBytes = Max(traceSiteCount, uint32(1))*sizeof(TraceSiteStats);
+				
+				TraceSiteStats* sites = HeapAllocate(sitesBytes);
+				RUNTIME_ASSERT(sites != InvalidHeapPtr, "Failed to allocate memory trace dump { numSites: %u, Linux errno: %d }", traceSiteCount, errno);
+				
+				for(const TraceSiteStats& siteStats : traceSites) {
+					if(siteStats.site.file) sites[numSites++] = siteStats;
+				}
+				
+				UnlockTrace();
+
+				qsort(sites, numSites, sizeof(TraceSiteStats), CompareTraceSites);
+
+				int fd = open(filePath, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+				RUNTIME_ASSERT(fd >= 0, "Failed to open memory trace file { filePath: '%s', Linux errno: %d }", filePath, errno);
+
+				dprintf(fd, "# site | function | arena | pushes | pushBytes | liveBytes | peakLiveBytes | avgLifetimeUs | maxLifetimeUs | blocks | blockBytes | avgBlockLifetimeUs\n");
+				for(uint32 i = 0; i < numSites; ++i) {
+					const TraceSiteStats& siteStats = sites[i];
+
+					dprintf(fd, "%s:%u | %s | %s | %llu | %llu | %llu | %llu | %llu | %llu | %llu | %llu | %llu\n",
+							TraceFileName(siteStats.site.file), siteStats.site.line, siteStats.site.func, siteStats.arenaName,
+							(unsigned long long)siteStats.pushCount, (unsigned long long)siteStats.pushBytes,
+							(unsigned long long)siteStats.liveBytes, (unsigned long long)siteStats.peakLiveBytes,
+							(unsigned long long)(siteStats.pushFreeCount ? siteStats.pushLifetimeNs / siteStats.pushFreeCount / 1000 : 0),
+							(unsigned long long)(siteStats.pushMaxLifetimeNs / 1000),
+							(unsigned long long)siteStats.blockCount, (unsigned long long)siteStats.blockBytes,
+							(unsigned long long)(siteStats.blockFreeCount ? siteStats.blockLifetimeNs / siteStats.blockFreeCount / 1000 : 0));
+				}
+
+				RUNTIME_ASSERT(!close(fd), "Failed to close memory trace file { filePath: '%s', Linux errno: %d }", filePath, errno);
+				HeapFree(sites, sitesBytes);
+
+				Log("Dumped memory trace { filePath: '%s', numSites: %u }", filePath, numSites);
+			}
+	#endif
+
+	private:
+
+		static inline void CountSyscalls(int32 count) {
+			#if ENABLE_MEMORY_STATS
+				StatAdd(&ThreadStats::memorySyscallCount, count);
+			#endif
+			AllocationCounters::Count(AllocationCounters::COUNTER_HEAP_SYSCALLS, count);
+		}
+
+	public:
+
+		// Lets the kernel reclaim the physical memory of blocks cached by the block pool
+		// Note: call this after large one-off allocations (asset loading) to drop the RSS without giving up the mappings
+		static inline void DecommitBlockPool() { BlockPool::Decommit(); }
+
+		// Sets the maximum number of bytes of freed blocks that are cached for reuse across all threads
+		static inline void SetBlockPoolRetainedBytes(uint32 bytes) { BlockPool::SetMaxRetainedBytes(bytes); }
+
+		enum HugePages {
+			HUGE_PAGES_NONE,		// always use normal pages
+			HUGE_PAGES_TRANSPARENT, // madvise large blocks so the kernel can back them with transparent huge pages
+			HUGE_PAGES_EXPLICIT,	// map large blocks from the hugetlbfs pool, falls back to transparent huge pages if it's empty
+		};
+
+		// Controls how big the blocks of an arena get as it grows.
+		// Note: every new block is double the size of the last one, starting at 'minBlockBytes' and capped at 'maxBlockBytes'.
+		//		 Requests that don't fit in a block of the current size still get a block that's just big enough for them.
+		struct GrowthPolicy {
+			uint32 minBlockBytes;
+			uint32 maxBlockBytes;
+			
+			// Note: only blocks of at least kHugePageSize use huge pages
+			HugePages hugePages;
+		};
+
+		// Note: default blocks stay small enough to be recycled by the block pool
+		static constexpr GrowthPolicy kDefaultGrowthPolicy = { .minBlockBytes = kMinBlockSize, .maxBlockBytes = MB(1), .hugePages = HUGE_PAGES_NONE };
+
+		// Note: for arenas that hold whole assets (files, meshes, images)
+		static constexpr GrowthPolicy kLargeGrowthPolicy = { .minBlockBytes = KB(64), .maxBlockBytes = MB(32), .hugePages = HUGE_PAGES_TRANSPARENT };
+
 		class Arena;
+		class VirtualArena;
 		
 		class Region {
 			friend Arena;
@@ -64,28 +508,204 @@ class Memory {
         class Arena: NoCopyClass {
         	private:
 	            friend Memory;
+	            friend VirtualArena;
 	    
 	            Block* currentBlock;
 	            Block* reservedBlock;
+
+	            uint32 virtualBytes; //bytes of address space reserved by a VirtualArena. 0 for block arenas
+	            
+	            GrowthPolicy growthPolicy;
+	            uint32 nextBlockBytes;
 	
 				#if ENABLE_MEMORY_STATS
-	                uint32 arenaBytes;		 //usedBytes + unusedBytes
-	                uint32 arenaPadBytes;	 //unusedBytes caused from block alignment
-	                uint32 arenaUnusedBytes; //unused bytes at end of blocks + reserveBlock bytes
-	                uint32 arenaBlockCount;  //number of blocks (includes reserveBlock)
+	                uint32 arenaBytes;		   //usedBytes + unusedBytes
+	                uint32 arenaPadBytes;	   //unusedBytes caused from block alignment
+	                uint32 arenaUnusedBytes;   //unused bytes at end of blocks + reserveBlock bytes
+	                uint32 arenaBlockCount;    //number of blocks (includes reserveBlock)
+	                uint32 arenaSyscallCount;  //number of mmap/munmap/madvise/mprotect calls made by the arena
+				#endif
+
+				#if ENABLE_MEMORY_TRACING
+					const char* traceName;
+					
+					//Note: trace records are mapped directly so tracing doesn't show up in memory stats
+					TraceRecord* traceRecords;
+					uint32 traceRecordCount, traceRecordCapacity;
 				#endif
 				
-		        inline Block* CreateBlock(uint32 minSize, Block* previousBlock) {
-			        uint32 blockBytes = Max(sizeof(Block) + minSize, kMinBlockSize);
+				inline void CountArenaSyscalls(uint32 count) {
+					#if ENABLE_MEMORY_STATS
+						arenaSyscallCount+= count;
+					#endif
+					CountSyscalls(count);
+				}
+
+				inline void InitTrace(const char* name) {
+					#if ENABLE_MEMORY_TRACING
+						traceName = name;
+						traceRecords = nullptr;
+						traceRecordCount = traceRecordCapacity = 0;
+					#endif
+				}
+
+				// Records that 'bytes' were pushed at 'ptr' in 'block'
+				inline void TracePush(Block* block, void* ptr, uint32 bytes MEMORY_TRACE_DECL) {
+					#if ENABLE_MEMORY_TRACING
+						if(traceRecordCount == traceRecordCapacity) {
+							uint32 newCapacity = Max(2*traceRecordCapacity, uint32(kMinBlockSize/sizeof(TraceRecord)));
+							
+							TraceRecord* newRecords = HeapAllocate(newCapacity*sizeof(TraceRecord));
+							RUNTIME_ASSERT(newRecords != InvalidHeapPtr, "Failed to grow memory trace records { arena: %p, capacity: %u, Linux errno: %d }", this, newCapacity, errno);
+							
+							if(traceRecords) {
+								CopyMemory(newRecords, traceRecords, traceRecordCount*sizeof(TraceRecord));
+								HeapFree(traceRecords, traceRecordCapacity*sizeof(TraceRecord));
+							}
+							
+							traceRecords = newRecords;
+							traceRecordCapacity = newCapacity;
+						}
+
+						LockTrace();
+						
+						TraceSiteStats* siteStats = FindTraceSite(traceSite, traceName);
+						siteStats->pushCount++;
+						siteStats->pushBytes+= bytes;
+						siteStats->liveBytes+= bytes;
+						siteStats->peakLiveBytes = Max(siteStats->peakLiveBytes, siteStats->liveBytes);
+						
+						UnlockTrace();
+
+						traceRecords[traceRecordCount++] = TraceRecord {
+							.siteStats = siteStats,
+							.block = block,
+							.position = uint32(ByteDistance(ptr, block)),
+							.bytes = bytes,
+							.timeNs = TraceTimeNs(),
+						};
+					#endif
+				}
+
+				// Records a new block (or VirtualArena commit) of 'bytes'. 'block' is null for commits
+				inline void TraceBlock(Block* block, uint32 bytes MEMORY_TRACE_DECL) {
+					#if ENABLE_MEMORY_TRACING
+						LockTrace();
+						
+						TraceSiteStats* siteStats = FindTraceSite(traceSite, traceName);
+						siteStats->blockCount++;
+						siteStats->blockBytes+= bytes;
+						
+						UnlockTrace();
+
+						if(block) {
+							block->traceSiteStats = siteStats;
+							block->traceTimeNs = TraceTimeNs();
+						}
+					#endif
+				}
+
+				inline void TraceFreeBlock(Block* block) {
+					#if ENABLE_MEMORY_TRACING
+						uint64 lifetimeNs = TraceTimeNs() - block->traceTimeNs;
+						
+						LockTrace();
+						block->traceSiteStats->blockFreeCount++;
+						block->traceSiteStats->blockLifetimeNs+= lifetimeNs;
+						UnlockTrace();
+					#endif
+				}
+
+				// Records that everything in 'block' from 'position' on was freed
+				// Note: blocks are freed from the top of the arena down so the freed records are always on top of the stack
+				inline void TraceFree(Block* block, uint32 position) {
+					#if ENABLE_MEMORY_TRACING
+						if(!traceRecordCount) return;
+						
+						uint64 timeNs = TraceTimeNs();
+						
+						LockTrace();
+						for(; traceRecordCount; --traceRecordCount) {
+							const TraceRecord& record = traceRecords[traceRecordCount-1];
+							if(record.block != block || record.position < position) break;
+
+							uint64 lifetimeNs = timeNs - record.timeNs;
+							
+							TraceSiteStats* siteStats = record.siteStats;
+							siteStats->liveBytes-= record.bytes;
+							siteStats->pushFreeCount++;
+							siteStats->pushLifetimeNs+= lifetimeNs;
+							siteStats->pushMaxLifetimeNs = Max(siteStats->pushMaxLifetimeNs, lifetimeNs);
+						}
+						UnlockTrace();
+					#endif
+				}
+				
+				// Maps a new zeroed block of 'blockBytes'
+				// Note: huge blocks are aligned to kHugePageSize
+				inline Block* MapBlock(uint32 blockBytes, bool hugeBlock) {
+					
+					if(!hugeBlock) {
+						Block* block = HeapAllocate(blockBytes);
+						CountArenaSyscalls(1);
+						return block;
+					}
+
+					if(growthPolicy.hugePages == HUGE_PAGES_EXPLICIT) {
+						Block* block = HeapAllocateHugePages(blockBytes);
+						CountArenaSyscalls(1);
+						
+						if(block != InvalidHeapPtr) return block;
+						Warn("Failed to map explicit huge pages, falling back to transparent huge pages { arena: %p, bytes: %u, Linux errno: %d }",
+							 this, blockBytes, errno);
+					}
+
+					//Note: transparent huge pages only back 2MB aligned ranges so we over allocate and trim the ends
+					void* memory = HeapAllocate(blockBytes + kHugePageSize);
+					CountArenaSyscalls(1);
+					if(memory == InvalidHeapPtr) return (Block*)memory;
+
+					uint32 headBytes = AlignUpOffsetPow2(memory, kHugePageSize);
+					uint32 tailBytes = kHugePageSize - headBytes;
+					
+					Block* block = (Block*)ByteOffset(memory, headBytes);
+					if(headBytes) HeapFree(memory, headBytes);
+					if(tailBytes) HeapFree(ByteOffset(block, blockBytes), tailBytes);
+					
+					//Note: failing to advise isn't fatal, THP may just be disabled
+					HeapAdviseHugePages(block, blockBytes);
+					CountArenaSyscalls(bool(headBytes) + bool(tailBytes) + 1);
+					
+					return block;
+				}
+				
+		        // Note: blocks are page aligned. They are only zeroed if 'zeroMemory' is set or if they were freshly mapped
+		        // Note: blocks grow geometrically according to the arena's growthPolicy
+		        inline Block* CreateBlock(uint32 minSize, Block* previousBlock, bool zeroMemory MEMORY_TRACE_DECL) {
+			        
+			        uint32 requestBytes = Max(uint32(sizeof(Block) + minSize), nextBlockBytes);
+			        nextBlockBytes = Min(2*uint64(nextBlockBytes), uint64(growthPolicy.maxBlockBytes));
+			        
+			        bool hugeBlock = growthPolicy.hugePages != HUGE_PAGES_NONE && requestBytes >= kHugePageSize;
+			        uint32 blockBytes = hugeBlock ? CeilFraction(requestBytes, kHugePageSize)*kHugePageSize : BlockPool::BlockBytes(requestBytes);
+			        
 			        RUNTIME_ASSERT(blockBytes > sizeof(Block),
 						        	"Block Allocation is too small for header { arena: %p,  bytes: %d, sizeof(Block): %d } ",
 						        	this, blockBytes, sizeof(Block));
 			
-			        // Note: this memory is page aligned and zeroed
-			        Block* block = HeapAllocate(blockBytes);
-			        if(block == InvalidHeapPtr) {
-				        Panic("Failed to allocate memory block { arena: %p, bytes requested: %d, Linux errno: %d } ",
-				        	  this, blockBytes, errno);
+			        //Note: huge blocks are never small enough to be pooled
+			        Block* block = hugeBlock ? nullptr : BlockPool::Pop(blockBytes);
+			        if(block) {
+				        if(zeroMemory) FillMemory(ByteOffset(block, sizeof(Block)), 0, minSize);
+			        
+			        } else {
+
+				        // Note: this memory is page aligned and zeroed
+				        block = MapBlock(blockBytes, hugeBlock);
+				        if(block == InvalidHeapPtr) {
+					        Panic("Failed to allocate memory block { arena: %p, bytes requested: %d, Linux errno: %d } ",
+					        	  this, blockBytes, errno);
+				        }
 			        }
 			
 			        block->bytes = blockBytes;
@@ -95,24 +715,32 @@ class Memory {
 			        #if ENABLE_MEMORY_STATS
 			            uint32 freeBytes = blockBytes - sizeof(Block);
 			        
+			            block->padBytes = 0;
+			            block->hugePages = hugeBlock;
+
+			            if(hugeBlock) StatAdd(&ThreadStats::memoryHugeBlockCount, 1);
+
 			            arenaBlockCount++;
 				        arenaBytes+= blockBytes;
 				        arenaUnusedBytes+= freeBytes;
 
-				        memoryBlockCount++;
-				        memoryBytes+= blockBytes;
-				        memoryUnusedBytes+= freeBytes;
+				        StatAdd(&ThreadStats::memoryBlockCount, 1);
+				        StatAdd(&ThreadStats::memoryBytes, blockBytes);
+		            StatAdd(&ThreadStats::memoryUnusedBytes, freeBytes);
 			        #endif
+			        
+			        TraceBlock(block, blockBytes MEMORY_TRACE_ARG);
 			
 			        return block;
 		        }
 		
+				// Note: blocks are handed back to the shared block pool and are only unmapped if the pool is full
 				inline void FreeBlock(Block* block) {
 			
 			        #if ENABLE_MEMORY_STATS
-			            RUNTIME_ASSERT(memoryBlockCount && arenaBlockCount,
-			                        	"Trying to free more blocks than allocated { arena: %p, memoryBlockCount: %d, arenaBlockCount: %d }",
-			                        	this, memoryBlockCount, arenaBlockCount);
+			            RUNTIME_ASSERT(arenaBlockCount,
+			                        	"Trying to free more blocks than allocated { arena: %p, arenaBlockCount: %d }",
+			                        	this, arenaBlockCount);
 				
 			            uint32 freeBytes = block->FreeBytes();
 				
@@ -121,24 +749,31 @@ class Memory {
 				        arenaUnusedBytes-= freeBytes;
 				        arenaPadBytes-= block->padBytes;
 				
-				        memoryBlockCount--;
-				        memoryBytes-= block->bytes;
-				        memoryUnusedBytes-= freeBytes;
-				        memoryPadBytes-= block->padBytes;
+				        StatAdd(&ThreadStats::memoryBlockCount, -1);
+				        StatAdd(&ThreadStats::memoryBytes, -int32(block->bytes));
+				        StatAdd(&ThreadStats::memoryUnusedBytes, -int32(freeBytes));
+				        StatAdd(&ThreadStats::memoryPadBytes, -int32(block->padBytes));
+				        
+				        if(block->hugePages) StatAdd(&ThreadStats::memoryHugeBlockCount, -1);
 			        #endif
 			
+			        TraceFreeBlock(block);
+			        
+			        if(BlockPool::Push(block)) return;
+
 			        RUNTIME_ASSERT(HeapFree(block, block->bytes),
 						        	"Failed to free Memory block { arena: %p, block: %p, bytes: %d, Linux errno: %d }",
 						        	this, block, block->bytes, errno);
+			        CountArenaSyscalls(1);
 		        }
 	
-				inline Block* CreateBlockWithT(Block* previousBlock, uint32 tBytes, uint8 alignment, void** tPtr) {
+				inline Block* CreateBlockWithT(Block* previousBlock, uint32 tBytes, uint8 alignment, bool zeroMemory, void** tPtr MEMORY_TRACE_DECL) {
 			
 					uint8 alignmentOffset = AlignUpOffsetPow2((void *)sizeof(Block), alignment);
 					uint32 alignedSize = tBytes+alignmentOffset;
 			
-					// Note: AllocateBlock is page aligned and zero
-					Block* newBlock = CreateBlock(alignedSize, previousBlock);
+					// Note: CreateBlock is page aligned
+					Block* newBlock = CreateBlock(alignedSize, previousBlock, zeroMemory MEMORY_TRACE_ARG);
 					newBlock->position+= alignedSize;
 			
 					*tPtr = ByteOffset(newBlock, sizeof(Block)+alignmentOffset);
@@ -149,8 +784,8 @@ class Memory {
 						arenaPadBytes+= alignmentOffset;
 						arenaUnusedBytes-= alignedSize;
 				
-						memoryPadBytes+= alignmentOffset;
-						memoryUnusedBytes-= alignedSize;
+						StatAdd(&ThreadStats::memoryPadBytes, alignmentOffset);
+						StatAdd(&ThreadStats::memoryUnusedBytes, -int32(alignedSize));
 					#endif
 			
 					return newBlock;
@@ -177,38 +812,167 @@ class Memory {
 						arenaPadBytes+= alignmentOffset;
 						arenaUnusedBytes-= alignedBytes;
 				
-						memoryPadBytes+= alignmentOffset;
-						memoryUnusedBytes-= alignedBytes;
+						StatAdd(&ThreadStats::memoryPadBytes, alignmentOffset);
+						StatAdd(&ThreadStats::memoryUnusedBytes, -int32(alignedBytes));
                     #endif
 					
 					return tPos;
 		        }
 		        
+				inline bool IsVirtual() const { return virtualBytes; }
+
+				// Note: VirtualArenas that use huge pages commit whole huge pages at a time
+				inline uint32 VirtualCommitBytes() const { return growthPolicy.hugePages == HUGE_PAGES_NONE ? kMinBlockSize : kHugePageSize; }
+
+				// Grows the committed part of a VirtualArena's only block so it has at least 'minFreeBytes' free
+				inline void CommitVirtualBytes(uint32 minFreeBytes MEMORY_TRACE_DECL) {
+					
+					uint64 minBytes = uint64(currentBlock->position) + minFreeBytes;
+					if(minBytes > virtualBytes) {
+						Panic("VirtualArena ran out of reserved address space { arena: %p, reservedBytes: %u, requestedBytes: %llu }",
+							  this, virtualBytes, minBytes);
+					}
+
+					//Note: commit geometrically so steady growth doesn't make a syscall per page
+					uint32 commitBytes = VirtualCommitBytes();
+					uint32 oldBytes = currentBlock->bytes;
+					uint32 newBytes = Min(Max(2*uint64(oldBytes), CeilFraction(minBytes, commitBytes)*commitBytes), uint64(virtualBytes));
+					
+					RUNTIME_ASSERT(HeapCommit(ByteOffset(currentBlock, oldBytes), newBytes - oldBytes),
+								   "Failed to commit VirtualArena pages { arena: %p, oldBytes: %u, newBytes: %u, Linux errno: %d }",
+								   this, oldBytes, newBytes, errno);
+					CountArenaSyscalls(1);
+
+					currentBlock->bytes = newBytes;
+					TraceBlock(nullptr, newBytes - oldBytes MEMORY_TRACE_ARG);
+
+					#if ENABLE_MEMORY_STATS
+						uint32 deltaBytes = newBytes - oldBytes;
+						
+						arenaBytes+= deltaBytes;
+						arenaUnusedBytes+= deltaBytes;
+						
+						StatAdd(&ThreadStats::memoryBytes, deltaBytes);
+						StatAdd(&ThreadStats::memoryUnusedBytes, deltaBytes);
+					#endif
+				}
+
+				// Note: used by VirtualArena
+				// Note: explicit huge pages can't be committed on demand so VirtualArenas treat them as transparent huge pages
+				inline Arena(uint32 preallocatedBytes, uint32 reserveBytes, HugePages hugePages MEMORY_TRACE_DECL):
+					reservedBlock(nullptr), growthPolicy({ .hugePages = hugePages }), nextBlockBytes(0) {
+                    
+                    InitTrace("VirtualArena");
+                    
+                    #if ENABLE_MEMORY_STATS
+                        arenaBytes = 0;
+                        arenaPadBytes = 0;
+                        arenaUnusedBytes = 0;
+                        arenaBlockCount = 1;
+                        arenaSyscallCount = 0;
+                        
+                        StatAdd(&ThreadStats::memoryBlockCount, 1);
+                        if(hugePages != HUGE_PAGES_NONE) StatAdd(&ThreadStats::memoryHugeBlockCount, 1);
+                    #endif
+
+					uint32 commitBytes = VirtualCommitBytes();
+					virtualBytes = CeilFraction(reserveBytes, commitBytes)*commitBytes;
+
+					RUNTIME_ASSERT(virtualBytes > sizeof(Block), "VirtualArena reservation is smaller than block header { arena: %p, reserveBytes: %u }", this, reserveBytes);
+
+					if(hugePages == HUGE_PAGES_NONE) {
+						currentBlock = HeapReserve(virtualBytes);
+						CountArenaSyscalls(1);
+					
+					} else {
+
+						//Note: transparent huge pages only back 2MB aligned ranges so we over reserve and trim the ends
+						void* reservation = HeapReserve(uint64(virtualBytes) + kHugePageSize);
+						CountArenaSyscalls(1);
+						
+						if(reservation != InvalidHeapPtr) {
+							uint32 headBytes = AlignUpOffsetPow2(reservation, kHugePageSize);
+							uint32 tailBytes = kHugePageSize - headBytes;
+
+							currentBlock = (Block*)ByteOffset(reservation, headBytes);
+							if(headBytes) HeapFree(reservation, headBytes);
+							if(tailBytes) HeapFree(ByteOffset(currentBlock, virtualBytes), tailBytes);
+							
+							HeapAdviseHugePages(currentBlock, virtualBytes);
+							CountArenaSyscalls(bool(headBytes) + bool(tailBytes) + 1);
+						
+						} else currentBlock = (Block*)reservation;
+					}
+					
+					if(currentBlock == InvalidHeapPtr) {
+						Panic("Failed to reserve VirtualArena address space { arena: %p, bytes requested: %u, Linux errno: %d } ",
+							  this, virtualBytes, errno);
+					}
+
+					//Note: only the first page is committed up front, the rest is committed by 'CommitVirtualBytes' as the arena grows
+					RUNTIME_ASSERT(HeapCommit(currentBlock, commitBytes), "Failed to commit VirtualArena header { arena: %p, Linux errno: %d }", this, errno);
+					CountArenaSyscalls(1);
+					
+					currentBlock->previousBlock = &emptyBlock;
+					currentBlock->bytes = commitBytes;
+					currentBlock->position = sizeof(Block);
+
+					#if ENABLE_MEMORY_STATS
+						currentBlock->padBytes = 0;
+						currentBlock->hugePages = (hugePages != HUGE_PAGES_NONE);
+						
+						arenaBytes+= commitBytes;
+						arenaUnusedBytes+= commitBytes - sizeof(Block);
+						
+						StatAdd(&ThreadStats::memoryBytes, commitBytes);
+						StatAdd(&ThreadStats::memoryUnusedBytes, commitBytes - sizeof(Block));
+					#endif
+
+					TraceBlock(currentBlock, commitBytes MEMORY_TRACE_ARG);
+					if(preallocatedBytes > currentBlock->FreeBytes()) CommitVirtualBytes(preallocatedBytes MEMORY_TRACE_ARG);
+				}
+
         	public:
 		
 				//Creates a new memory arena. If specificed 'preallocatedBytes'
 				//is used to reserve at least that many bytes in the arena 
 				//Note: Arenas are page aligned
-				inline Arena(uint32 preallocatedBytes = 0): reservedBlock(nullptr) {
+				//Note: 'growthPolicy' controls how big new blocks get as the arena grows
+				inline Arena(uint32 preallocatedBytes = 0, const GrowthPolicy& growthPolicy = kDefaultGrowthPolicy MEMORY_TRACE_PARAM):
+					reservedBlock(nullptr), virtualBytes(0), growthPolicy(growthPolicy), nextBlockBytes(growthPolicy.minBlockBytes) {
+                    
+                    RUNTIME_ASSERT(growthPolicy.minBlockBytes <= growthPolicy.maxBlockBytes,
+                    			   "Arena growthPolicy minBlockBytes is larger than maxBlockBytes { arena: %p, minBlockBytes: %u, maxBlockBytes: %u }",
+                    			   this, growthPolicy.minBlockBytes, growthPolicy.maxBlockBytes);
+                    
                     #if ENABLE_MEMORY_STATS
                         arenaBytes = 0;
                         arenaPadBytes = 0;
                         arenaUnusedBytes = 0;
                         arenaBlockCount = 0;
+                        arenaSyscallCount = 0;
                     #endif
+                    
+                    InitTrace("Arena");
 		            
-					currentBlock = preallocatedBytes ? CreateBlock(preallocatedBytes, &emptyBlock) : &emptyBlock;
+					currentBlock = preallocatedBytes ? CreateBlock(preallocatedBytes, &emptyBlock, false MEMORY_TRACE_ARG) : &emptyBlock;
 				}
 	    		
 				//TODO: make this return a pointer wrapper type that can cast to any pointer type
 				//Increases the size of the arena to fit at least 'bytes' of memory
 				//Returns a pointer to the first free byte
-				void* PushBytes(size_t bytes, bool zeroMemory = false, uint8 alignment = 1) {
+				void* PushBytes(size_t bytes, bool zeroMemory = false, uint8 alignment = 1 MEMORY_TRACE_PARAM) {
 					RUNTIME_ASSERT(IsPow2Safe(alignment), "Alignment must be a power of 2. { alignment: %d }", alignment);
 					RUNTIME_ASSERT(currentBlock, "Null arena block - should be initialized to emptyBlock! { arena: %p } ", this);
 
 					void* tPosition = ExtendBlockWithT(currentBlock, bytes, alignment, zeroMemory);
-					if(!tPosition) {
+					if(!tPosition && IsVirtual()) {
+						
+						//Note: VirtualArenas never create new blocks, they just commit more of their reservation
+						CommitVirtualBytes(bytes + alignment MEMORY_TRACE_ARG);
+						tPosition = ExtendBlockWithT(currentBlock, bytes, alignment, zeroMemory);
+					
+					} else if(!tPosition) {
 
 						//check to see if we can reuse the reserved block
 						if(reservedBlock) {
@@ -216,19 +980,20 @@ class Memory {
 							tPosition = ExtendBlockWithT(reservedBlock, bytes, alignment, zeroMemory);
 							if(tPosition) {
 								#if ENABLE_MEMORY_STATS
-									memoryBlockReserveCount--;
-									memoryBlockReservedBytes-= reservedBlock->bytes;
+									StatAdd(&ThreadStats::memoryBlockReserveCount, -1);
+									StatAdd(&ThreadStats::memoryBlockReservedBytes, -int32(reservedBlock->bytes));
 								#endif
 
 								reservedBlock->previousBlock = currentBlock;
 								currentBlock = reservedBlock;
 								reservedBlock = nullptr;
 								
-							} else currentBlock = CreateBlockWithT(currentBlock, bytes, alignment, &tPosition);
+								} else currentBlock = CreateBlockWithT(currentBlock, bytes, alignment, zeroMemory, &tPosition MEMORY_TRACE_ARG);
 
-						} else currentBlock = CreateBlockWithT(currentBlock, bytes, alignment, &tPosition);
+						} else currentBlock = CreateBlockWithT(currentBlock, bytes, alignment, zeroMemory, &tPosition MEMORY_TRACE_ARG);
 					}
 
+					TracePush(currentBlock, tPosition, bytes MEMORY_TRACE_ARG);
 					return tPosition;
 				}
         		
@@ -236,13 +1001,18 @@ class Memory {
 				//Returns a pointer to the newly allocated type
 				//Note: No constructors are called durring allocation
 		        template<class T>
-		        T* PushType(bool zeroMemory = false, uint8 alignment = 1) { return (T*)PushBytes(sizeof(T), zeroMemory, alignment); }
+		        T* PushType(bool zeroMemory = false, uint8 alignment = 1 MEMORY_TRACE_PARAM) { return (T*)PushBytes(sizeof(T), zeroMemory, alignment MEMORY_TRACE_ARG); }
 
-                inline void Reserve(uint32 bytes) {
+                inline void Reserve(uint32 bytes MEMORY_TRACE_PARAM) {
                 
 		            //check current block
                     if(bytes < currentBlock->FreeBytes()) return;
                     
+                    if(IsVirtual()) {
+                    	CommitVirtualBytes(bytes MEMORY_TRACE_ARG);
+                    	return;
+                    }
+                    
                     //check reserve block
                     if(reservedBlock) {
                         if(bytes < reservedBlock->FreeBytes()) return;
@@ -250,15 +1020,47 @@ class Memory {
                     }
                 
                     //create new reserve block
-                    reservedBlock = CreateBlock(bytes, currentBlock);
+                    reservedBlock = CreateBlock(bytes, currentBlock, false MEMORY_TRACE_ARG);
 		        }
 		        
 		        inline bool IsEmptyRegion(Region r) const {
 				    return r.block == currentBlock && r.position == currentBlock->position;
 				}
+
+				// Grows the allocation that ends at 'end' by 'bytes' without moving it
+				// Returns false if 'end' isn't the top of the arena or the current block doesn't have room
+				// Note: VirtualArenas can always grow their top allocation in place
+				inline bool ExtendInPlace(const void* end, uint32 bytes MEMORY_TRACE_PARAM) {
+					if(ByteOffset(currentBlock, currentBlock->position) != end) return false;
+
+					if(bytes > currentBlock->FreeBytes()) {
+						if(!IsVirtual()) return false;
+						CommitVirtualBytes(bytes MEMORY_TRACE_ARG);
+					}
+
+					PushBytes(bytes, false, 1 MEMORY_TRACE_ARG);
+					return true;
+				}
 		        
 				//Creates a new memory region in the arena that starts at the current position
 		        inline Region CreateRegion() const { return Region(currentBlock, currentBlock->position); }
+
+				//Returns the region at the very start of the arena
+		        inline Region BaseRegion() const { return IsVirtual() ? Region(currentBlock, sizeof(Block)) : kEmptyRegion; }
+
+				#if ENABLE_MEMORY_STATS
+					//Note: useful for comparing what different GrowthPolicies cost
+					inline uint32 BlockCount() const   { return arenaBlockCount; }
+					inline uint32 SyscallCount() const { return arenaSyscallCount; }
+				#endif
+
+				// Labels the arena's allocations in memory traces
+				// Warn: 'name' must outlive the trace, use a string literal
+				inline void SetTraceName(const char* name) {
+					#if ENABLE_MEMORY_TRACING
+						traceName = name;
+					#endif
+				}
 		        
 		        //TODO: make  a FreeRegion that can take in a startRegion and endRegion and use ForEachRegion to free blocks in range and merge start and stop block if needed
 		        
@@ -266,6 +1068,7 @@ class Memory {
 		        inline void FreeBaseRegion(const Region& region) {
 		        	
 			        RUNTIME_ASSERT(currentBlock != &emptyBlock || region.block == &emptyBlock, "Trying to free past start of arena { Arena: %p }", this);
+			        RUNTIME_ASSERT(!IsVirtual() || region.block == currentBlock, "Trying to free past start of VirtualArena { Arena: %p }", this);
 			        RUNTIME_ASSERT(region.block == &emptyBlock || region.position >= sizeof(Block),
 			                    	"Region position is smaller than block header { Arena: %p, regionPosition: %d, sizeof(Block): %d }",
 			                    	this, region.position, sizeof(Block));
@@ -273,6 +1076,7 @@ class Memory {
 			        Block *popBlock = currentBlock;
 			        while(popBlock != region.block) {
 			        	
+			        	TraceFree(popBlock, 0);
 			        	currentBlock = popBlock->previousBlock;
 
 				        // TODO: make sure this gets optimized into 2 loops
@@ -282,10 +1086,10 @@ class Memory {
 								arenaPadBytes-= popBlock->padBytes;
 								arenaUnusedBytes+= popBlock->position - sizeof(Block);
 							
-								memoryBlockReserveCount++;
-								memoryPadBytes-= popBlock->padBytes;
-								memoryUnusedBytes+= popBlock->position - sizeof(Block);
-								memoryBlockReservedBytes+= popBlock->bytes;
+								StatAdd(&ThreadStats::memoryBlockReserveCount, 1);
+								StatAdd(&ThreadStats::memoryPadBytes, -int32(popBlock->padBytes));
+								StatAdd(&ThreadStats::memoryUnusedBytes, popBlock->position - sizeof(Block));
+								StatAdd(&ThreadStats::memoryBlockReservedBytes, popBlock->bytes);
 							
 								popBlock->padBytes = 0;
 							#endif
@@ -307,45 +1111,66 @@ class Memory {
 						        	"non-zero region position for emptyBlock { arena: %p, regionPosition: %d }",
 						        	this, region.position);
 			        
+			        TraceFree(currentBlock, region.position);
 					currentBlock->position = region.position;
 		        }
 			       
 				//Frees all blocks from the arena
-				inline void FreeAll() { FreeBaseRegion(kEmptyRegion); }
+				//Note: growth starts over so one large frame doesn't leave every block after it at the grown size
+				inline void FreeAll() {
+					FreeBaseRegion(BaseRegion());
+					nextBlockBytes = growthPolicy.minBlockBytes;
+				}
 				
 				// Returns true if `[baseRegion, baseRegion+bytes]` range is flat (AKA is a contigious buffer)
-				inline bool IsFlat(Region baseRegion, uint32 bytes) {
-					return baseRegion.block == currentBlock && bytes <= currentBlock->bytes;
+				// Note: this is always true for VirtualArenas as long as the range is committed
+				inline bool IsFlat(Region baseRegion, uint32 bytes) const {
+					
+					//Note: the empty region is flat if the arena only has a single block
+					if(baseRegion.block == &emptyBlock && currentBlock->previousBlock == &emptyBlock) baseRegion = Region(currentBlock, sizeof(Block));
+
+					return baseRegion.block == currentBlock && baseRegion.position + bytes <= currentBlock->bytes;
 				}
 
 				// Flattens everything from in `[baseRegion, baseRegion+bytes]` range into a contigious buffer
 				// Note: Flatten frees all information on the arena after `baseRegion + bytes`
 				// Note: If [baseRegion, baseRegion+bytes] isn't already flat, Flatten invalidates and pointers and Regions after 'baseRegion'
 				// Returns: pointer to start of flat contiguous buffer
-				inline void* Flatten(const Region& baseRegion, uint32 bytes) {
+				inline void* Flatten(const Region& baseRegion, uint32 bytes MEMORY_TRACE_PARAM) {
 
 					// TODO: Test this for memory leaks!
 
+					//Note: VirtualArenas are always flat, we just need to make sure the pages are committed
+					if(IsVirtual() && baseRegion.position + bytes > currentBlock->bytes) {
+						TraceFree(currentBlock, baseRegion.position + bytes);
+						currentBlock->position = baseRegion.position;
+						CommitVirtualBytes(bytes MEMORY_TRACE_ARG);
+					}
+
 					// Already flat, just return current buffer
 					if(IsFlat(baseRegion, bytes)) {
-						currentBlock->position = bytes;
-						return ByteOffset(baseRegion.block, sizeof(Block));
+						uint32 basePosition = (baseRegion.block == currentBlock) ? baseRegion.position : sizeof(Block);
+						
+						TraceFree(currentBlock, basePosition + bytes);
+						currentBlock->position = basePosition + bytes;
+						return ByteOffset(currentBlock, basePosition);
 					}
 
 					//Allocate new block
 					// TODO: See if we can use reserve block instead of creating new one? 
 					// 		 May not be worth it because we're most likely flattening a large region?
-					Block* newBlock = CreateBlock(bytes, baseRegion.block);
+					Block* newBlock = CreateBlock(bytes, baseRegion.block, false MEMORY_TRACE_ARG);
 					void* newBuffer = ByteOffset(newBlock, sizeof(Block));
 
 					// copy data to new block
-					CopyToBuffer<uint8>(bytes, newBuffer);
+					Memory::CopyRegionsToBuffer<uint8>(baseRegion, CreateRegion(), bytes, newBuffer);
 					newBlock->position+= bytes;
 
 					//Free old data and 
 					FreeBaseRegion(baseRegion);
 					currentBlock = newBlock; 
-
+					
+					TracePush(newBlock, newBuffer, bytes MEMORY_TRACE_ARG);
 					return newBuffer;
 				}
 
@@ -353,16 +1178,32 @@ class Memory {
 				// Note: Flatten frees all information on the arena after `bytes`
 				// Note: If arena isn't already flat, Flatten invalidates and pointers and Regions
 				// Returns: pointer to start of flat contiguous buffer
-				inline void* Flatten(uint32 bytes) { return Flatten(kEmptyRegion, bytes); }
+				inline void* Flatten(uint32 bytes MEMORY_TRACE_PARAM) { return Flatten(BaseRegion(), bytes MEMORY_TRACE_ARG); }
 
 				//Frees any reserved blocks for the area
 				// TODO: Rename this? 
 		        inline void Pack() {
+			        
+			        //Note: VirtualArenas keep their pages committed, but let the kernel reclaim everything past the current position
+			        if(IsVirtual()) {
+				        void* freeStart = ByteOffset(currentBlock, currentBlock->position);
+				        freeStart = ByteOffset(freeStart, AlignUpOffsetPow2(freeStart, kMinBlockSize));
+				        
+				        uint32 freeBytes = ByteDistance(ByteOffset(currentBlock, currentBlock->bytes), freeStart);
+				        if(freeBytes) {
+					        RUNTIME_ASSERT(HeapDecommit(freeStart, freeBytes),
+					        			   "Failed to decommit VirtualArena pages { arena: %p, bytes: %u, Linux errno: %d }",
+					        			   this, freeBytes, errno);
+					        CountArenaSyscalls(1);
+				        }
+				        return;
+			        }
+			        
 			        if(reservedBlock) {
 				
 				        #if ENABLE_MEMORY_STATS
-			        	    memoryBlockReserveCount--;
-			        	    memoryBlockReservedBytes-= reservedBlock->bytes;
+			        	    StatAdd(&ThreadStats::memoryBlockReserveCount, -1);
+			        	    StatAdd(&ThreadStats::memoryBlockReservedBytes, -int32(reservedBlock->bytes));
 						#endif
 
 				        FreeBlock(reservedBlock);
@@ -371,6 +1212,30 @@ class Memory {
 		        }
 		
 				~Arena() {
+					
+					#if ENABLE_MEMORY_TRACING
+						//Note: close out every live allocation before the trace records are released
+						FreeBaseRegion(BaseRegion());
+						if(traceRecords) HeapFree(traceRecords, traceRecordCapacity*sizeof(TraceRecord));
+					#endif
+
+					if(IsVirtual()) {
+						#if ENABLE_MEMORY_STATS
+							StatAdd(&ThreadStats::memoryBlockCount, -1);
+							StatAdd(&ThreadStats::memoryBytes, -int32(arenaBytes));
+							StatAdd(&ThreadStats::memoryUnusedBytes, -int32(arenaUnusedBytes));
+							StatAdd(&ThreadStats::memoryPadBytes, -int32(arenaPadBytes));
+							
+							if(currentBlock->hugePages) StatAdd(&ThreadStats::memoryHugeBlockCount, -1);
+						#endif
+
+						RUNTIME_ASSERT(HeapFree(currentBlock, virtualBytes),
+									   "Failed to free VirtualArena { arena: %p, bytes: %u, Linux errno: %d }",
+									   this, virtualBytes, errno);
+						CountSyscalls(1);
+						return;
+					}
+
                     FreeBaseRegion(kEmptyRegion);
 					Pack();
 				}
@@ -381,24 +1246,315 @@ class Memory {
 											  uint32 regionStride, uint32 bufferStride,
 											  const TranslatorFuncT& translator) {
 			
-					Memory::TranslateRegionsToBuffer(kEmptyRegion, CreateRegion(),
+					Memory::TranslateRegionsToBuffer(BaseRegion(), CreateRegion(),
 													 numElements, buffer,
 													 regionStride, bufferStride,
 													 translator);
 				}
 				
 				//Note: Copies whole arena of type 'ArenaT' to contiguous buffer
+				//Note: set 'nonTemporal' when 'buffer' is write-only (mapped GL buffers)
 				template <typename ArenaT>
 				inline void CopyToBuffer(uint32 numElements, void* buffer,
-										 uint32 regionStride=sizeof(ArenaT), uint32 bufferStride=sizeof(ArenaT)) const {
+										 uint32 regionStride=sizeof(ArenaT), uint32 bufferStride=sizeof(ArenaT),
+										 bool nonTemporal = false) const {
 					
-					Memory::CopyRegionsToBuffer<ArenaT>(kEmptyRegion, CreateRegion(),
+					Memory::CopyRegionsToBuffer<ArenaT>(BaseRegion(), CreateRegion(),
 														numElements, buffer,
-														regionStride, bufferStride);
+														regionStride, bufferStride,
+														nonTemporal);
 				}
         };
 
-        static inline Arena temporaryArena = Arena(0);
+        // Arena that reserves a large range of address space up front and commits pages on demand.
+        // Note: VirtualArenas only ever have a single block so everything pushed to them is contiguous. This makes
+        //       'IsFlat'/'Flatten' O(1) and lets 'ForEachRegion' visit the whole arena as a single forward chunk
+        // Warn: the reservation is never grown. Pushing past 'reserveBytes' panics
+        class VirtualArena: public Arena {
+        	public:
+        		static constexpr uint32 kDefaultReserveBytes = (sizeof(void*) == 8) ? GB(1) : MB(64);
+
+        		//Note: 'hugePages' backs the arena with transparent huge pages once it commits more than kHugePageSize
+        		inline VirtualArena(uint32 reserveBytes = kDefaultReserveBytes, uint32 preallocatedBytes = 0, HugePages hugePages = HUGE_PAGES_NONE MEMORY_TRACE_PARAM):
+        			Arena(preallocatedBytes, reserveBytes, hugePages MEMORY_TRACE_ARG) {}
+        };
+
+	private:
+		static inline thread_local Arena* currentFrameArena;
+
+	public:
+
+		// Arena for data that only lives for the current frame. Owned by the render loop's FrameArena
+		// Note: nothing pushed here needs to be freed, it's released when the frame is recycled.
+		//       Returns nullptr on threads without a FrameArena, like the asset loader's workers, so shared code can
+		//       fall back to a scratch region
+		static inline Arena* CurrentFrameArena() { return currentFrameArena; }
+
+        // Rotates through 'kNumFrames' arenas, one per frame in flight.
+        // Note: data pushed during a frame stays valid until 'NextFrame' has been called kNumFrames times so buffers
+        //       that the GPU may still be reading from aren't overwritten. Frames are VirtualArenas so recycling
+        //       a frame just resets its position which is O(1)
+        // Warn: only one FrameArena can be active per thread
+        template<uint32 kNumFrames>
+        class FrameArena: NoCopyClass {
+        	private:
+        		VirtualArena arenas[kNumFrames];
+        		uint32 frameIndex;
+
+        		static inline VirtualArena CreateFrame(int /*frame*/, uint32 reserveBytes) { return VirtualArena(reserveBytes); }
+
+        		template<int... kFrames>
+        		inline FrameArena(uint32 reserveBytes, Sequence<kFrames...>):
+        			arenas{ CreateFrame(kFrames, reserveBytes)... }, frameIndex(0) {
+
+        			RUNTIME_ASSERT(!currentFrameArena, "FrameArena already exists on this thread { currentFrameArena: %p }", currentFrameArena);
+        			currentFrameArena = &arenas[0];
+        			
+        			for(VirtualArena& arena : arenas) arena.SetTraceName("FrameArena");
+        		}
+
+        	public:
+        		//Note: per-frame data is small so frames reserve much less than a default VirtualArena. That keeps the
+        		//      address space cost of kNumFrames reservations reasonable on 32 bit abis
+        		static constexpr uint32 kDefaultReserveBytes = (sizeof(void*) == 8) ? MB(64) : MB(8);
+
+        		// Note: each of the 'kNumFrames' frames reserves 'reserveBytes' of address space
+        		inline FrameArena(uint32 reserveBytes = kDefaultReserveBytes):
+        			FrameArena(reserveBytes, IncreasingSequence<0, kNumFrames-1>()) {}
+
+        		inline ~FrameArena() { currentFrameArena = nullptr; }
+
+        		inline Arena* Current() { return &arenas[frameIndex]; }
+
+        		// Recycles the oldest frame and makes it current. Call after presenting a frame
+        		inline void NextFrame() {
+        			frameIndex = (frameIndex+1) % kNumFrames;
+
+        			arenas[frameIndex].FreeAll();
+        			currentFrameArena = &arenas[frameIndex];
+        		}
+        };
+
+		// Contiguous growable array that lives in an arena
+		// Note: when the array sits at the top of its arena it grows in place, otherwise it's relocated to the top
+		//		 of the arena with double the capacity. Giving an array its own VirtualArena means it never relocates.
+		// Warn: relocation leaves the old storage in the arena until the arena is freed past it
+		// Warn: no constructors or destructors are called, 'T' must be trivially copyable
+		template<typename T>
+		class ArenaArray: NoCopyClass {
+			private:
+				COMPILE_ASSERT(__is_trivially_copyable(T), "ArenaArray elements are relocated with memcpy");
+
+				// Note: start with at least a cache line worth of elements
+				static constexpr uint32 kMinCapacity = Max(uint32(1), uint32(kCacheLineSize / sizeof(T)));
+
+				Arena* arena;
+				T* data;
+				uint32 count, capacity;
+
+			public:
+				inline ArenaArray(Arena* arena, uint32 initialCapacity = 0): arena(arena), data(nullptr), count(0), capacity(0) {
+					if(initialCapacity) Reserve(initialCapacity);
+				}
+
+				inline ArenaArray(ArenaArray&& array): NoCopyClass(), arena(array.arena), data(array.data), count(array.count), capacity(array.capacity) {
+					array.data = nullptr;
+					array.count = array.capacity = 0;
+				}
+
+				inline ArenaArray& operator=(ArenaArray&& array) {
+					arena = array.arena;
+					data = array.data;
+					count = array.count;
+					capacity = array.capacity;
+
+					array.data = nullptr;
+					array.count = array.capacity = 0;
+					return *this;
+				}
+
+				inline uint32 Count() const    { return count; }
+				inline uint32 Capacity() const { return capacity; }
+				inline uint32 Bytes() const    { return count*sizeof(T); }
+				
+				inline T* Data() { return data; }
+				inline const T* Data() const { return data; }
+
+				inline T& operator[](uint32 i) { return data[i]; }
+				inline const T& operator[](uint32 i) const { return data[i]; }
+
+				inline T* begin() { return data; }
+				inline T* end()   { return data + count; }
+				
+				inline const T* begin() const { return data; }
+				inline const T* end() const   { return data + count; }
+
+				// Note: keeps the storage around for reuse
+				inline void Clear() { count = 0; }
+
+				// Removes the last 'n' elements
+				inline void Pop(uint32 n = 1) { count-= n; }
+
+				// Makes sure the array can hold at least 'minCapacity' elements without growing
+				inline void Reserve(uint32 minCapacity MEMORY_TRACE_PARAM) {
+					if(minCapacity <= capacity) return;
+
+					uint32 newCapacity = Max(minCapacity, 2*capacity, kMinCapacity);
+					if(data && arena->ExtendInPlace(data + capacity, (newCapacity - capacity)*sizeof(T) MEMORY_TRACE_ARG)) {
+						capacity = newCapacity;
+						return;
+					}
+
+					T* newData = (T*)arena->PushBytes(newCapacity*sizeof(T), false, alignof(T) MEMORY_TRACE_ARG);
+					if(count) CopyMemory(newData, data, count*sizeof(T));
+					
+					data = newData;
+					capacity = newCapacity;
+				}
+
+				// Appends 'n' uninitialized elements to the array
+				// Returns a pointer to the first new element
+				inline T* Push(uint32 n = 1 MEMORY_TRACE_PARAM) {
+					Reserve(count + n MEMORY_TRACE_ARG);
+
+					T* elements = data + count;
+					count+= n;
+					return elements;
+				}
+
+				inline T* PushBack(const T& value MEMORY_TRACE_PARAM) {
+					T* element = Push(1 MEMORY_TRACE_ARG);
+					*element = value;
+					return element;
+				}
+		};
+
+		// Fixed size allocator for objects of type 'T' that can be freed individually in O(1)
+		// Note: slots are carved out of an arena a block at a time and recycled through an intrusive free list
+		//		 so the pool never fragments. Slots are cache line aligned so objects never share a cache line.
+		// Note: if 'kUseGenerations' is set every slot keeps a generation counter that is bumped when it is freed
+		//		 which lets 'Handles' detect that the object they pointed to was freed (stale handles)
+		// Warn: Pools are not thread-safe
+		template<typename T, bool kUseGenerations = false>
+		class Pool: NoCopyClass {
+			private:
+				
+				struct alignas(Max(kCacheLineSize, alignof(T))) Slot {
+					union {
+						Slot* nextFreeSlot;
+						alignas(T) uint8 value[sizeof(T)];
+					};
+					
+					//Note: only used when kUseGenerations is set
+					uint32 generation;
+				};
+				COMPILE_ASSERT(alignof(Slot) <= MaxUint8(), "Pool slot alignment doesn't fit in PushBytes' uint8 alignment");
+
+				// Note: carve at least a page worth of slots at a time
+				static constexpr uint32 kSlotsPerBatch = Max(uint32(1), uint32(kMinBlockSize / sizeof(Slot)));
+
+				Arena arena;
+				Slot* freeSlot;
+				
+				uint32 slotCount, freeSlotCount;
+
+				static inline Slot* ToSlot(T* object) {
+					//Note: value is the first member of slot
+					return reinterpret_cast<Slot*>(object);
+				}
+
+				inline void CarveSlots() {
+					
+					Slot* slots = (Slot*)arena.PushBytes(kSlotsPerBatch*sizeof(Slot), true, alignof(Slot));
+					
+					//Note: link slots in address order so consecutive allocations are adjacent in memory
+					for(uint32 i = 0; i < kSlotsPerBatch-1; ++i) slots[i].nextFreeSlot = &slots[i+1];
+					slots[kSlotsPerBatch-1].nextFreeSlot = freeSlot;
+					freeSlot = slots;
+
+					slotCount+= kSlotsPerBatch;
+					freeSlotCount+= kSlotsPerBatch;
+
+					#if ENABLE_MEMORY_STATS
+						StatAdd(&ThreadStats::objectPoolSlotCount, kSlotsPerBatch);
+						StatAdd(&ThreadStats::objectPoolFreeSlotCount, kSlotsPerBatch);
+					#endif
+				}
+
+			public:
+				
+				struct Handle {
+					T* object;
+					uint32 generation;
+				};
+
+				inline Pool(uint32 preallocatedObjects = 0):
+					arena(preallocatedObjects*sizeof(Slot), kDefaultGrowthPolicy), freeSlot(nullptr), slotCount(0), freeSlotCount(0) {
+					
+					arena.SetTraceName("Pool");
+				}
+				
+				~Pool() {
+					#if ENABLE_MEMORY_STATS
+						StatAdd(&ThreadStats::objectPoolSlotCount, -int32(slotCount));
+						StatAdd(&ThreadStats::objectPoolFreeSlotCount, -int32(freeSlotCount));
+					#endif
+				}
+
+				inline uint32 SlotCount() const     { return slotCount; }
+				inline uint32 FreeSlotCount() const { return freeSlotCount; }
+				inline uint32 UsedSlotCount() const { return slotCount - freeSlotCount; }
+
+				// Returns memory for a single 'T'
+				// Note: No constructors are called durring allocation
+				inline T* Allocate(bool zeroMemory = false) {
+					if(!freeSlot) CarveSlots();
+
+					Slot* slot = freeSlot;
+					freeSlot = slot->nextFreeSlot;
+					--freeSlotCount;
+
+					#if ENABLE_MEMORY_STATS
+						StatAdd(&ThreadStats::objectPoolFreeSlotCount, -1);
+					#endif
+					
+					if(zeroMemory) FillMemory(slot->value, 0, sizeof(T));
+					return reinterpret_cast<T*>(slot->value);
+				}
+
+				// Returns 'object' to the pool
+				// Note: No destructors are called
+				inline void Free(T* object) {
+					RUNTIME_ASSERT(object, "Trying to free null object to pool { pool: %p }", this);
+
+					Slot* slot = ToSlot(object);
+					if constexpr(kUseGenerations) ++slot->generation;
+					
+					slot->nextFreeSlot = freeSlot;
+					freeSlot = slot;
+					++freeSlotCount;
+
+					#if ENABLE_MEMORY_STATS
+						StatAdd(&ThreadStats::objectPoolFreeSlotCount, 1);
+					#endif
+				}
+
+				inline Handle GetHandle(T* object) const {
+					COMPILE_ASSERT(kUseGenerations, "Handles require a Pool with kUseGenerations set");
+					return Handle { .object = object, .generation = ToSlot(object)->generation };
+				}
+
+				// Returns the object 'handle' refers to or nullptr if it has been freed
+				inline T* Resolve(const Handle& handle) const {
+					COMPILE_ASSERT(kUseGenerations, "Handles require a Pool with kUseGenerations set");
+					if(!handle.object || ToSlot(handle.object)->generation != handle.generation) return nullptr;
+					return handle.object;
+				}
+		};
+
+        // Per-thread scratch arena
+        // Note: Arenas are not thread-safe, but they can be created/freed on any thread. Blocks are recycled through a shared lock-free pool
+        static inline thread_local Arena temporaryArena = Arena(0, kDefaultGrowthPolicy MEMORY_TRACE_HERE);
 		
 		//Note: calls 'func(void* chunk, uint32 chunkBytes)' for each chunk in [startRegion, stopRegion] inclusive
 		//Warn: ForEachRegion iterates blocks in reverse order from when they were pushed to the region
@@ -459,13 +1615,23 @@ class Memory {
 		}
 		
 		//Note: Copies Region of type 'RegionT' to contiguous buffer
+		//Note: copies whole chunks at a time with 'CopyStrided' so matching strides are a single memcpy per chunk.
+		//		set 'nonTemporal' when 'buffer' is write-only (mapped GL buffers)
 		template <typename RegionT>
 		static inline void CopyRegionsToBuffer(const Region& startRegion, const Region& stopRegion, uint32 numElements, void* buffer,
-											   uint32 regionStride=sizeof(RegionT), uint32 bufferStride=sizeof(RegionT)) {
+											   uint32 regionStride=sizeof(RegionT), uint32 bufferStride=sizeof(RegionT),
+											   bool nonTemporal = false) {
 
-			TranslateRegionsToBuffer(startRegion, stopRegion,
-									numElements, buffer,
-									regionStride, bufferStride,
-									[](void *src, void *dst) { CopyMemory(dst, src, sizeof(RegionT)); });
+			void* bufferEnd = ByteOffset(buffer, bufferStride*numElements);
+			
+			//Note: ForEachRegion iterates chunks backwards so we copy to buffer in reverse to maintain chunk ordering
+			ForEachRegion(startRegion, stopRegion,
+				          [&](void *chunk, uint32 chunkBytes) {
+							  
+							  uint32 chunkElements = chunkBytes/regionStride;
+							  bufferEnd = NegByteOffset(bufferEnd, bufferStride*chunkElements);
+							  
+							  CopyStrided(bufferEnd, bufferStride, chunk, regionStride, sizeof(RegionT), chunkElements, nonTemporal);
+						  });
 		}
 };
\ No newline at end of file
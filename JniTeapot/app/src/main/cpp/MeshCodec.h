@@ -0,0 +1,594 @@
+#pragma once
+
+#include <string.h>
+
+#include "types.h"
+#include "util.h"
+#include "Memory.h"
+#include "MeshFile.h"
+
+// Lossless compression for the vertices and indices of mesh files. Compressed meshes (MESH_FLAG_COMPRESSED) are decoded
+// straight into the mapped gl buffers when they're uploaded
+//
+//   Indices  - every triangle is coded against FIFOs of recently seen edges and vertices. A triangle that shares an edge with
+//              a recent one is a single byte as long as its last vertex is new or recent. Anything else is a zigzag varint delta
+//              from the last vertex that was coded that way
+//   Vertices - 16 vertices at a time. Every byte of a vertex is delta coded against the same byte of the vertex before it,
+//              zigzagged and bit packed with 0, 2, 4 or 8 bits per byte. The decoder undoes it with simd prefix sums over
+//              byte planes and transposes the planes back into vertices
+//
+// Note: the index codec is at its best on triangles ordered by OptimizeVertexCache and the vertex codec on vertices ordered by
+//       OptimizeVertexFetch, which is how ObjMesh::Build lays them out. Decoders never read out of bounds and return false on
+//       corrupt data so they're safe to run on any file
+//
+// Warn: decoding is far slower than uploading a raw mesh straight from its mapping. Indices decode at ~0.3-0.6GB/s (~10-12ns a triangle)
+//       and vertices at ~1.5-3GB/s against ~35GB/s for a memcpy (benchmarks/meshCodecBenchmark.cpp, g++ on x86-64).
+//       Only compress meshes where apk size matters more than load time - the meshes the app ships are raw
+
+constexpr uint32 kMeshIndexEdgeFifoSize   = 16;
+constexpr uint32 kMeshIndexVertexFifoSize = 16;
+
+// Index codes - one per triangle followed by the data of every triangle and kMeshIndexPadding zeros
+//
+//   code <  0xC0 - shares an edge: [rotation:2][edge:4][third:2]. The triangle rotated left by 'rotation' starts with recent
+//                  edge 'edge'. 'third' is 0 for the next new vertex, 1-2 for recent vertex 0-1 and 3 for a delta
+//   code >= 0xC0 - doesn't share an edge: [11][a:2][b:2][c:2]. Each is 0 for the next new vertex, 1 for a recent vertex
+//                  (slot in the next data byte) and 2 for a delta
+//
+// Note: edges are remembered backwards - the triangle next to edge a->b walks it as b->a.
+//       Deltas are at most 4 varint bytes so the decoder can read them whole, the padding keeps that read in bounds
+constexpr uint8 kMeshIndexNoEdge = 0xC0;
+constexpr uint32 kMeshIndexPadding = 4;
+constexpr uint32 kMeshIndexMaxDelta = (1u << 27) - 1;
+
+enum MeshIndexVertexCode: uint32 { MESH_INDEX_NEXT, MESH_INDEX_RECENT, MESH_INDEX_DELTA };
+
+// FIFOs of recent edges and vertices that the index encoder and decoder update the same way
+struct MeshIndexCodecState {
+    uint32 edges[kMeshIndexEdgeFifoSize][2];
+    uint32 vertices[kMeshIndexVertexFifoSize];
+    uint32 edgeHead, vertexHead;
+
+    uint32 next; //Note: new vertices are numbered by first use
+    uint32 last; //Note: deltas are from the last vertex coded as one
+
+    //Note: empty slots are invalid vertices so corrupt codes that use them fail the bounds check
+    inline MeshIndexCodecState(): edgeHead(0), vertexHead(0), next(0), last(0) {
+        memset(edges, 0xFF, sizeof(edges));
+        memset(vertices, 0xFF, sizeof(vertices));
+    }
+
+    // Slot 0 is the most recent
+    inline const uint32* Edge(uint32 slot) const { return edges[(edgeHead - 1 - slot) & (kMeshIndexEdgeFifoSize-1)]; }
+    inline uint32 Vertex(uint32 slot) const      { return vertices[(vertexHead - 1 - slot) & (kMeshIndexVertexFifoSize-1)]; }
+
+    inline void PushEdge(uint32 a, uint32 b) {
+        uint32* edge = edges[edgeHead++ & (kMeshIndexEdgeFifoSize-1)];
+        edge[0] = a;
+        edge[1] = b;
+    }
+
+    inline void PushVertex(uint32 v) { vertices[vertexHead++ & (kMeshIndexVertexFifoSize-1)] = v; }
+};
+
+//Note: a code per triangle, up to a 4 byte varint per index and the padding
+constexpr uint64 MeshIndexEncodeBound(uint32 indexCount) { return indexCount/3 + uint64(indexCount)*4 + kMeshIndexPadding; }
+
+inline uint32 LoadMeshIndex(const void* indices, uint32 indexStride, uint32 i) {
+    switch(indexStride) {
+        case sizeof(uint8):  return ((const uint8*)indices)[i];
+        case sizeof(uint16): return ((const uint16*)indices)[i];
+        default:             return ((const uint32*)indices)[i];
+    }
+}
+
+// Compresses 'indexCount' indices of 'indexStride' bytes into 'dst'. Returns the compressed size
+// Note: 'dst' must hold MeshIndexEncodeBound(indexCount) bytes and 'indexCount' has to be a multiple of 3
+inline uint64 EncodeMeshIndices(uint8* dst, const void* indices, uint32 indexCount, uint32 indexStride) {
+
+    RUNTIME_ASSERT(indexCount%3 == 0, "Only triangle lists can be compressed { indexCount: %u }", indexCount);
+
+    uint32 triangleCount = indexCount/3;
+    uint8* codes = dst;
+    uint8* data = dst + triangleCount;
+
+    MeshIndexCodecState state;
+
+    // Codes 'v' with the next new vertex, one of the first 'recentSlots' recent vertices or a delta
+    // Returns MESH_INDEX_NEXT, MESH_INDEX_DELTA or MESH_INDEX_RECENT + the recent slot
+    auto EncodeVertex = [&](uint32 v, uint32 recentSlots) -> uint32 {
+        if(v == state.next) {
+            state.PushVertex(state.next++);
+            return MESH_INDEX_NEXT;
+        }
+
+        for(uint32 slot = 0; slot < recentSlots; ++slot) {
+            if(state.Vertex(slot) == v) return MESH_INDEX_RECENT + slot;
+        }
+
+        int32 delta = int32(v - state.last);
+        RUNTIME_ASSERT(delta >= -int32(kMeshIndexMaxDelta) && delta <= int32(kMeshIndexMaxDelta),
+                       "Index delta is too large to compress { delta: %d }", delta);
+
+        uint32 zigzag = (uint32(delta) << 1) ^ uint32(delta >> 31);
+        for(; zigzag >= 0x80; zigzag>>= 7) *data++ = uint8(zigzag | 0x80);
+        *data++ = uint8(zigzag);
+
+        state.last = v;
+        state.PushVertex(v);
+        return ~0u;
+    };
+
+    for(uint32 t = 0; t < triangleCount; ++t) {
+
+        uint32 tri[3];
+        for(uint32 i = 0; i < 3; ++i) tri[i] = LoadMeshIndex(indices, indexStride, 3*t + i);
+
+        uint32 rotation, edge;
+        auto FindEdge = [&]() {
+            for(rotation = 0; rotation < 3; ++rotation) {
+                for(edge = 0; edge < kMeshIndexEdgeFifoSize; ++edge) {
+                    const uint32* recentEdge = state.Edge(edge);
+                    if(recentEdge[0] == tri[rotation] && recentEdge[1] == tri[(rotation+1)%3]) return true;
+                }
+            }
+            return false;
+        };
+
+        if(FindEdge()) {
+
+            uint32 x = tri[rotation], y = tri[(rotation+1)%3], z = tri[(rotation+2)%3];
+
+            //Note: 'EncodeVertex' returns MESH_INDEX_RECENT + slot which is already the 1-2 the code wants
+            uint32 third = EncodeVertex(z, 2);
+            if(third == ~0u) third = 3;
+
+            codes[t] = uint8((rotation << 6) | (edge << 2) | third);
+
+            state.PushEdge(z, y);
+            state.PushEdge(x, z);
+
+        } else {
+
+            uint8 code = kMeshIndexNoEdge;
+            for(uint32 i = 0; i < 3; ++i) {
+                uint32 vertexCode = EncodeVertex(tri[i], kMeshIndexVertexFifoSize);
+
+                if(vertexCode == ~0u) {
+                    vertexCode = MESH_INDEX_DELTA;
+
+                } else if(vertexCode >= MESH_INDEX_RECENT) {
+                    *data++ = uint8(vertexCode - MESH_INDEX_RECENT);
+                    vertexCode = MESH_INDEX_RECENT;
+                }
+
+                code|= uint8(vertexCode << (4 - 2*i));
+            }
+            codes[t] = code;
+
+            state.PushEdge(tri[1], tri[0]);
+            state.PushEdge(tri[2], tri[1]);
+            state.PushEdge(tri[0], tri[2]);
+        }
+    }
+
+    memset(data, 0, kMeshIndexPadding);
+    data+= kMeshIndexPadding;
+
+    return data - dst;
+}
+
+//Note: where each vertex of an edge's triangle goes for each rotation - vertex x goes to rotation, y after it and z after that
+constexpr uint8 kMeshIndexRotations[][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 } };
+
+template<typename IndexT>
+inline bool DecodeMeshIndices(IndexT* dst, uint32 indexCount, uint32 vertexCount, const uint8* src, uint64 srcBytes) {
+
+    if(indexCount%3) return false;
+
+    uint32 triangleCount = indexCount/3;
+    if(srcBytes < uint64(triangleCount) + kMeshIndexPadding) return false;
+
+    const uint8* codes = src;
+    const uint8 *data = src + triangleCount,
+                *dataEnd = src + srcBytes - kMeshIndexPadding;
+
+    //Note: mirrors MeshIndexCodecState with locals so the heads can stay in registers.
+    //      The vertex FIFO has twice the slots it needs so a vertex can be stored at the head whether or not it's pushed
+    //      without overwriting one that's still in the FIFO
+    constexpr uint32 kVertexSlots = 2*kMeshIndexVertexFifoSize;
+
+    uint32 edgeStarts[kMeshIndexEdgeFifoSize], edgeEnds[kMeshIndexEdgeFifoSize], vertices[kVertexSlots];
+    memset(edgeStarts, 0xFF, sizeof(edgeStarts));
+    memset(edgeEnds, 0xFF, sizeof(edgeEnds));
+    memset(vertices, 0xFF, sizeof(vertices));
+
+    uint32 edgeHead = 0, vertexHead = 0, next = 0, last = 0;
+
+    auto PushEdge = [&](uint32 a, uint32 b) {
+        edgeStarts[edgeHead & (kMeshIndexEdgeFifoSize-1)] = a;
+        edgeEnds[edgeHead++ & (kMeshIndexEdgeFifoSize-1)] = b;
+    };
+
+    // The data is decoded ahead of the triangles into items - recent slots and zigzagged deltas. Slots are always below 0x80
+    // so they're single byte varints and every item can be decoded the same way without knowing which code it belongs to
+    // Note: a triangle takes at most 3 items, 2 more than the chunk so the ones left over can be moved to the front
+    constexpr uint32 kItemChunk = 64;
+    uint32 items[kItemChunk + 2] = {}, itemIndex = 0, itemCount = 0;
+    bool itemStart = true;
+
+    auto DecodeItems = [&]() {
+
+        //Note: the triangles took more items than there were
+        if(itemIndex > itemCount) return false;
+
+        uint32 left = itemCount - itemIndex;
+        items[0] = items[itemIndex];
+        items[1] = items[itemIndex + 1];
+        itemIndex = 0;
+
+        // Decodes a varint at every byte and keeps the ones that start after a byte without its top bit set. Unlike walking
+        // from varint to varint no byte waits on the length of the one before it
+        // Note: reads past the end of the data land in the padding. Stops after the last byte of the chunk's last varint
+        uint32 corrupt = 0;
+        for(itemCount = left; (itemCount < kItemChunk || !itemStart) && data < dataEnd; ++data) {
+
+            uint32 w;
+            memcpy(&w, data, sizeof(w));
+
+            uint32 stops = ~w & 0x80808080u;
+            corrupt|= (stops == 0) & itemStart;
+
+            uint32 length = (__builtin_ctz(stops | 0x80000000u) + 1) / 8;
+            items[itemCount] = ((w & 0x7F) | ((w >> 1) & (0x7F << 7)) | ((w >> 2) & (0x7F << 14)) | ((w >> 3) & (0x7F << 21))) &
+                               ((1u << (7*length)) - 1);
+
+            itemCount+= itemStart;
+            itemStart = !(w & 0x80);
+        }
+
+        return !corrupt;
+    };
+
+    // Decodes a delta when 'isDelta' is set and otherwise the vertex in recent 'slot', where slot ~0u is the next new vertex.
+    // Doesn't branch on which it is - the next new vertex is stored at the head of the FIFO first so it can be read back
+    // like a recent one and the delta is masked in
+    // Note: masks rather than ternaries so there's nothing for the compiler to turn back into a data dependent branch
+    auto DecodeVertex = [&](uint32 slot, uint32 isDelta) {
+
+        uint32 item = items[itemIndex],
+               isNext = (slot == ~0u) & (isDelta ^ 1);
+
+        vertices[vertexHead & (kVertexSlots-1)] = next;
+
+        uint32 delta = last + ((item >> 1) ^ (0u - (item & 1))),
+               recent = vertices[(vertexHead - 1 - slot) & (kVertexSlots-1)],
+               v = recent ^ ((recent ^ delta) & (0u - isDelta));
+
+        next+= isNext;
+        last^= (last ^ delta) & (0u - isDelta);
+        itemIndex+= isDelta;
+
+        vertices[vertexHead & (kVertexSlots-1)] = v;
+        vertexHead+= isNext | isDelta;
+        return v;
+    };
+
+    for(uint32 t = 0; t < triangleCount; ++t, dst+= 3) {
+
+        if(itemIndex + 3 > itemCount && !DecodeItems()) return false;
+
+        uint8 code = codes[t];
+        uint32 x, y, z;
+
+        if(code < kMeshIndexNoEdge) {
+
+            uint32 third = code & 3,
+                   edge = (edgeHead - 1 - ((code >> 2) & 15)) & (kMeshIndexEdgeFifoSize-1);
+
+            x = edgeStarts[edge];
+            y = edgeEnds[edge];
+            z = DecodeVertex(third - 1, third == 3);
+
+            //Note: rotation is 0, 1 or 2 since the top 2 bits are 11 without an edge
+            const uint8* rotation = kMeshIndexRotations[code >> 6];
+            dst[rotation[0]] = IndexT(x);
+            dst[rotation[1]] = IndexT(y);
+            dst[rotation[2]] = IndexT(z);
+
+            PushEdge(z, y);
+            PushEdge(x, z);
+
+        } else {
+
+            //Note: 3 isn't a vertex code
+            if(code & (code >> 1) & 0x15) return false;
+
+            //Note: recent slots are the next item. Slots past the FIFO are caught once the triangle is done
+            uint32 slots = 0;
+            auto DecodeNoEdgeVertex = [&](uint32 vertexCode) {
+                uint32 isRecent = (vertexCode == MESH_INDEX_RECENT),
+                       slot = items[itemIndex] & (0u - isRecent);
+
+                slots|= slot;
+                itemIndex+= isRecent;
+                return DecodeVertex(slot | (isRecent - 1), vertexCode == MESH_INDEX_DELTA);
+            };
+
+            x = DecodeNoEdgeVertex((code >> 4) & 3);
+            y = DecodeNoEdgeVertex((code >> 2) & 3);
+            z = DecodeNoEdgeVertex(code & 3);
+
+            if(slots >= kMeshIndexVertexFifoSize) return false;
+
+            dst[0] = IndexT(x);
+            dst[1] = IndexT(y);
+            dst[2] = IndexT(z);
+
+            PushEdge(y, x);
+            PushEdge(z, y);
+            PushEdge(x, z);
+        }
+
+        //Note: gl would read past the end of the vbo otherwise
+        if(Max(x, Max(y, z)) >= vertexCount) return false;
+    }
+
+    //Note: every item has to be used and the last varint has to end with the data
+    return itemIndex == itemCount && itemStart && data == dataEnd;
+}
+
+// Decompresses 'srcBytes' of 'src' into 'indexCount' indices of 'indexStride' bytes in 'dst'
+// Returns false if the indices are corrupt or reference a vertex past 'vertexCount'
+// Note: 'dst' is only written to so it can be a mapped gl buffer
+inline bool DecodeMeshIndices(void* dst, uint32 indexCount, uint32 indexStride, uint32 vertexCount, const uint8* src, uint64 srcBytes) {
+    switch(indexStride) {
+        case sizeof(uint8):  return vertexCount <= 0x100   && DecodeMeshIndices((uint8*)dst, indexCount, vertexCount, src, srcBytes);
+        case sizeof(uint16): return vertexCount <= 0x10000 && DecodeMeshIndices((uint16*)dst, indexCount, vertexCount, src, srcBytes);
+        case sizeof(uint32): return DecodeMeshIndices((uint32*)dst, indexCount, vertexCount, src, srcBytes);
+        default:             return false;
+    }
+}
+
+constexpr uint32 kMeshVertexGroupSize = 16;
+constexpr uint32 kMeshVertexMaxStride = 256;
+
+// Bytes taken up by a byte plane of a group packed with 'packing' - the 2 bit code in the group's header. 0, 4, 8 or 16
+//
+//   [header: 2 bits per byte of the vertex][byte plane 0][byte plane 1]...
+//
+// Note: byte j of a plane packed with 2 bits holds vertices j, j+4, j+8 and j+12 from the low bits up.
+//       Byte j of a plane packed with 4 bits holds vertices j and j+8
+constexpr uint32 MeshVertexPackedBytes(uint32 packing) { return (2u << packing) & ~3u; }
+
+// Bytes taken up by the 4 byte planes each header byte describes so a group is sized with a lookup per header byte
+struct MeshVertexHeaderBytesTable {
+    uint8 bytes[256];
+
+    constexpr MeshVertexHeaderBytesTable(): bytes() {
+        for(uint32 header = 0; header < 256; ++header) {
+            for(uint32 shift = 0; shift < 8; shift+= 2) bytes[header]+= MeshVertexPackedBytes((header >> shift) & 3);
+        }
+    }
+};
+constexpr MeshVertexHeaderBytesTable kMeshVertexHeaderBytes;
+
+// Returns true if vertices with 'vertexStride' bytes can be compressed
+constexpr bool MeshVertexCodecSupports(uint32 vertexStride) {
+    return vertexStride && vertexStride%4 == 0 && vertexStride <= kMeshVertexMaxStride;
+}
+
+constexpr uint64 MeshVertexEncodeBound(uint32 vertexCount, uint32 vertexStride) {
+    uint64 groups = (uint64(vertexCount) + kMeshVertexGroupSize-1) / kMeshVertexGroupSize;
+    return groups * (vertexStride/4 + uint64(kMeshVertexGroupSize)*vertexStride);
+}
+
+// Compresses 'vertexCount' vertices of 'vertexStride' bytes into 'dst'. Returns the compressed size
+// Note: 'dst' must hold MeshVertexEncodeBound(vertexCount, vertexStride) bytes. See MeshVertexCodecSupports for the strides it takes
+inline uint64 EncodeMeshVertices(uint8* dst, const void* vertices, uint32 vertexCount, uint32 vertexStride) {
+
+    RUNTIME_ASSERT(MeshVertexCodecSupports(vertexStride), "Unsupported vertex stride { vertexStride: %u }", vertexStride);
+
+    const uint8* src = (const uint8*)vertices;
+    uint8* out = dst;
+
+    uint8 lastVertex[kMeshVertexMaxStride] = {};
+
+    for(uint32 first = 0; first < vertexCount; first+= kMeshVertexGroupSize) {
+
+        uint8* headers = out;
+        out+= vertexStride/4;
+        memset(headers, 0, vertexStride/4);
+
+        for(uint32 k = 0; k < vertexStride; ++k) {
+
+            //Note: the last group is padded with its last vertex so the padding is all zero deltas
+            uint8 plane[kMeshVertexGroupSize], maxValue = 0;
+            for(uint32 i = 0; i < kMeshVertexGroupSize; ++i) {
+                uint8 b = src[uint64(Min(first + i, vertexCount - 1))*vertexStride + k];
+
+                int8 delta = int8(uint8(b - lastVertex[k]));
+                lastVertex[k] = b;
+
+                plane[i] = uint8((delta << 1) ^ (delta >> 7));
+                maxValue|= plane[i];
+            }
+
+            uint8 packing = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+            headers[k/4]|= uint8(packing << (2*(k%4)));
+
+            switch(packing) {
+                case 1: {
+                    for(uint32 j = 0; j < 4; ++j) *out++ = uint8(plane[j] | (plane[j+4] << 2) | (plane[j+8] << 4) | (plane[j+12] << 6));
+                } break;
+
+                case 2: {
+                    for(uint32 j = 0; j < 8; ++j) *out++ = uint8(plane[j] | (plane[j+8] << 4));
+                } break;
+
+                case 3: {
+                    memcpy(out, plane, sizeof(plane));
+                    out+= sizeof(plane);
+                } break;
+            }
+        }
+    }
+
+    return out - dst;
+}
+
+//Note: 16 bytes that arithmetic works on lane by lane. Compiles to neon and sse registers
+typedef uint8  MeshVertexBytes16 __attribute__((vector_size(16)));
+typedef uint16 MeshVertexShorts8 __attribute__((vector_size(16)));
+typedef uint32 MeshVertexUints4  __attribute__((vector_size(16)));
+typedef uint64 MeshVertexUlongs2 __attribute__((vector_size(16)));
+
+// Unpacks a byte plane packed with 'packing' and adds it onto 'previous' - the plane of the group before it
+inline MeshVertexBytes16 DecodeMeshVertexPlane(const uint8* src, uint32 packing, MeshVertexBytes16 previous) {
+
+    //Note: every lane of the group starts from the last vertex of the group before it
+    MeshVertexBytes16 base = __builtin_shufflevector(previous, previous, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15);
+
+    MeshVertexBytes16 zigzag;
+    switch(packing) {
+        case 0: return base;
+
+        case 1: {
+            uint32 packed;
+            memcpy(&packed, src, sizeof(packed));
+            zigzag = (MeshVertexBytes16)(MeshVertexUints4{ packed, packed >> 2, packed >> 4, packed >> 6 }) & 3;
+        } break;
+
+        case 2: {
+            uint64 packed;
+            memcpy(&packed, src, sizeof(packed));
+            zigzag = (MeshVertexBytes16)(MeshVertexUlongs2{ packed, packed >> 4 }) & 15;
+        } break;
+
+        default: memcpy(&zigzag, src, sizeof(zigzag)); break;
+    }
+
+    MeshVertexBytes16 zero = {},
+                      delta = (zigzag >> 1) ^ (zero - (zigzag & 1));
+
+    //Note: inclusive prefix sum across the lanes in 4 shifted adds
+    delta+= __builtin_shufflevector(zero, delta, 0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30);
+    delta+= __builtin_shufflevector(zero, delta, 0, 1, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29);
+    delta+= __builtin_shufflevector(zero, delta, 0, 1, 2, 3, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27);
+    delta+= __builtin_shufflevector(zero, delta, 0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23);
+
+    return base + delta;
+}
+
+// Transposes 4 byte planes of a group back into 4 bytes of each of its 16 vertices
+inline void StoreMeshVertexPlanes(uint8* dst, uint32 vertexStride, const MeshVertexBytes16* planes) {
+
+    MeshVertexBytes16 b01lo = __builtin_shufflevector(planes[0], planes[1], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23),
+                      b01hi = __builtin_shufflevector(planes[0], planes[1], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31),
+                      b23lo = __builtin_shufflevector(planes[2], planes[3], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23),
+                      b23hi = __builtin_shufflevector(planes[2], planes[3], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+
+    MeshVertexUints4 vertices[4] = {
+        (MeshVertexUints4)__builtin_shufflevector((MeshVertexShorts8)b01lo, (MeshVertexShorts8)b23lo, 0, 8, 1, 9, 2, 10, 3, 11),
+        (MeshVertexUints4)__builtin_shufflevector((MeshVertexShorts8)b01lo, (MeshVertexShorts8)b23lo, 4, 12, 5, 13, 6, 14, 7, 15),
+        (MeshVertexUints4)__builtin_shufflevector((MeshVertexShorts8)b01hi, (MeshVertexShorts8)b23hi, 0, 8, 1, 9, 2, 10, 3, 11),
+        (MeshVertexUints4)__builtin_shufflevector((MeshVertexShorts8)b01hi, (MeshVertexShorts8)b23hi, 4, 12, 5, 13, 6, 14, 7, 15),
+    };
+
+    for(uint32 i = 0; i < kMeshVertexGroupSize; ++i) {
+        uint32 bytes = vertices[i/4][i%4];
+        memcpy(dst + i*vertexStride, &bytes, sizeof(bytes));
+    }
+}
+
+// Decompresses 'srcBytes' of 'src' into 'vertexCount' vertices of 'vertexStride' bytes in 'dst'. Returns false if the vertices are corrupt
+// Note: 'dst' is only written to, front to back, so it can be a mapped gl buffer
+inline bool DecodeMeshVertices(void* dst, uint32 vertexCount, uint32 vertexStride, const uint8* src, uint64 srcBytes) {
+
+    if(!MeshVertexCodecSupports(vertexStride)) return false;
+
+    const uint8* srcEnd = src + srcBytes;
+    uint32 headerBytes = vertexStride/4;
+
+    MeshVertexBytes16 planes[kMeshVertexMaxStride] = {};
+
+    //Note: the last group is decoded here when it's short so we don't write past the end of 'dst'
+    uint8 tail[kMeshVertexGroupSize*kMeshVertexMaxStride];
+
+    for(uint32 first = 0; first < vertexCount; first+= kMeshVertexGroupSize) {
+
+        if(uint64(srcEnd - src) < headerBytes) return false;
+        const uint8* headers = src;
+        src+= headerBytes;
+
+        //Note: checks the whole group is there up front so planes can be loaded without bounds checks
+        uint64 groupBytes = 0;
+        for(uint32 i = 0; i < headerBytes; ++i) groupBytes+= kMeshVertexHeaderBytes.bytes[headers[i]];
+        if(uint64(srcEnd - src) < groupBytes) return false;
+
+        uint32 groupVertices = Min(vertexCount - first, kMeshVertexGroupSize);
+        uint8* groupDst = groupVertices == kMeshVertexGroupSize ? (uint8*)dst + uint64(first)*vertexStride : tail;
+
+        for(uint32 k = 0; k < vertexStride; k+= 4) {
+
+            uint8 header = headers[k/4];
+            for(uint32 j = 0; j < 4; ++j) {
+                uint32 packing = (header >> (2*j)) & 3;
+
+                planes[k+j] = DecodeMeshVertexPlane(src, packing, planes[k+j]);
+                src+= MeshVertexPackedBytes(packing);
+            }
+
+            StoreMeshVertexPlanes(groupDst + k, vertexStride, planes + k);
+        }
+
+        if(groupDst == tail) memcpy((uint8*)dst + uint64(first)*vertexStride, tail, groupVertices*vertexStride);
+    }
+
+    return src == srcEnd;
+}
+
+// Returns a copy of 'mesh' with compressed vertices and indices allocated in 'arena'.
+// Returns 'mesh' as is when it's already compressed, can't be compressed or doesn't get any smaller
+// Note: compressed meshes have to be decoded with DecodeMeshVertices and DecodeMeshIndices before they're drawn
+inline MeshFileView CompressMeshFile(const MeshFileView& mesh, Memory::Arena* arena) {
+
+    const MeshFileHeader& header = *mesh.header;
+    if((header.flags&MESH_FLAG_COMPRESSED) || !mesh.bytes || !MeshVertexCodecSupports(header.vertexStride) || header.indexCount%3) return mesh;
+
+    //Note: the streams are encoded in place so the file is allocated with room for the worst case and the layout is
+    //      computed again once their sizes are known
+    MeshFileLayout maxLayout = ComputeMeshFileLayout(header.attributeCount,
+                                                     MeshVertexEncodeBound(header.vertexCount, header.vertexStride),
+                                                     MeshIndexEncodeBound(header.indexCount),
+                                                     header.meshletCount, header.lodCount);
+
+    //Note: the file is zeroed so padding is deterministic
+    void* file = arena->PushBytes(maxLayout.bytes, true, kMeshFileAlignment);
+
+    uint64 vertexBytes = EncodeMeshVertices((uint8*)ByteOffset(file, maxLayout.vertexOffset), mesh.vertices, header.vertexCount, header.vertexStride);
+
+    MeshFileLayout layout = ComputeMeshFileLayout(header.attributeCount, vertexBytes, MeshIndexEncodeBound(header.indexCount), 0, 0);
+    uint64 indexBytes = EncodeMeshIndices((uint8*)ByteOffset(file, layout.indexOffset), mesh.indices, header.indexCount, header.indexStride);
+
+    layout = ComputeMeshFileLayout(header.attributeCount, vertexBytes, indexBytes, header.meshletCount, header.lodCount);
+    if(layout.bytes >= mesh.bytes) return mesh;
+
+    MeshFileHeader* compressedHeader = (MeshFileHeader*)file;
+    *compressedHeader = header;
+    compressedHeader->flags|= MESH_FLAG_COMPRESSED;
+    compressedHeader->vertexBytes = vertexBytes;
+    compressedHeader->indexBytes = indexBytes;
+    compressedHeader->vertexOffset = layout.vertexOffset;
+    compressedHeader->indexOffset = layout.indexOffset;
+    compressedHeader->meshletOffset = layout.meshletOffset;
+    compressedHeader->lodOffset = layout.lodOffset;
+
+    memcpy(ByteOffset(file, sizeof(MeshFileHeader)), mesh.attributes, header.attributeCount*sizeof(MeshAttribute));
+    memcpy(ByteOffset(file, layout.meshletOffset), mesh.meshlets, header.meshletCount*sizeof(Meshlet));
+    memcpy(ByteOffset(file, layout.lodOffset), mesh.lods, header.lodCount*sizeof(MeshLod));
+
+    MeshFileView view;
+    RUNTIME_ASSERT(ReadMeshFile(file, layout.bytes, &view), "Compressed an invalid mesh file { bytes: %llu }", (unsigned long long)layout.bytes);
+    return view;
+}
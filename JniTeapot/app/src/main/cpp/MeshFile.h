@@ -0,0 +1,342 @@
+#pragma once
+
+#include <string.h>
+
+#include "types.h"
+#include "memUtil.h"
+#include "customAssert.h"
+#include "vec.h"
+
+// Layout of a binary mesh (.mesh) - a mesh that's ready to hand to glBufferData so loading it is just a mmap
+//
+//   [MeshFileHeader][MeshAttribute x attributeCount][padding][interleaved vertices][padding][indices][padding][Meshlet x meshletCount][MeshLod x lodCount]
+//
+// Note: vertices and indices start on a 'kMeshFileAlignment' boundary from the start of the file so they can be uploaded
+//       straight out of a mapping. Meshes are little endian and are converted from obj by 'tools/meshConverter.cpp'.
+//       The asset cache stores parsed objs in this format too
+//
+// Note: attributes can be quantized to save vertex bandwidth and are decoded in the vertex shader
+//         - positions that aren't MESH_COMPONENT_FLOAT32 are stored relative to the bounds, [-1, 1] maps to [boundsMin, boundsMax]
+//         - normals with 2 components are octahedral encoded (see OctahedralEncode)
+//
+// Note: meshlets split the indices into small runs of triangles with bounds so whole runs can be culled before they're drawn
+//
+// Note: every lod is its own range of indices and meshlets into the same vertices. Lod 0 is the full mesh and
+//       each lod after it has fewer triangles and a larger error
+//
+// Note: shipped meshes can be MESH_FLAG_COMPRESSED - the vertices and indices are then 'vertexBytes' and 'indexBytes'
+//       of compressed data that's decoded with DecodeMeshVertices and DecodeMeshIndices (see MeshCodec.h)
+
+constexpr uint32 kMeshFileMagic     = 'J' | ('T'<<8) | ('M'<<16) | ('S'<<24);
+constexpr uint32 kMeshFileVersion   = 5;
+constexpr uint32 kMeshFileAlignment = 16;
+
+constexpr const char* kMeshFileExtension = ".mesh";
+
+enum MeshFlag: uint32 {
+    MESH_FLAG_NORMAL     = 1<<0, //Note: normals came from the source mesh instead of being computed
+    MESH_FLAG_UV         = 1<<1,
+    MESH_FLAG_CLOSED     = 1<<2, //Note: every edge is shared by two triangles so back faces are never seen
+    MESH_FLAG_COMPRESSED = 1<<3, //Note: the vertices and indices have to be decoded before they're uploaded
+};
+
+enum MeshAttributeType: uint32 { MESH_ATTRIBUTE_POSITION, MESH_ATTRIBUTE_NORMAL, MESH_ATTRIBUTE_UV, MESH_ATTRIBUTE_COUNT };
+enum MeshComponentType: uint32 {
+    MESH_COMPONENT_FLOAT32,
+    MESH_COMPONENT_FLOAT16,
+    MESH_COMPONENT_SNORM16,          //Note: [-1, 1] in an int16
+    MESH_COMPONENT_SNORM_10_10_10_2, //Note: 4 components packed into a uint32 [x:10 y:10 z:10 w:2] like GL_INT_2_10_10_10_REV
+    MESH_COMPONENT_COUNT
+};
+
+struct MeshAttribute {
+    MeshAttributeType type;
+    MeshComponentType componentType;
+    uint32 componentCount;
+    uint32 offset; //Note: from the start of the vertex
+};
+
+struct MeshFileHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 flags;
+
+    uint32 attributeCount;
+    uint32 vertexCount, vertexStride;
+    uint32 indexCount, indexStride; //Note: indexStride is 1, 2 or 4 bytes. indexCount covers every lod
+    uint32 meshletCount, lodCount;
+    uint32 vertexBytes, indexBytes; //Note: count*stride unless the mesh is MESH_FLAG_COMPRESSED
+
+    float boundsMin[3], boundsMax[3]; //Note: model space aabb of the positions
+
+    uint64 vertexOffset, indexOffset, meshletOffset, lodOffset; //Note: from the start of the file
+};
+
+// A run of triangles in the index buffer and the model space bounds of everything in it
+struct Meshlet {
+    uint32 indexOffset, indexCount;
+    
+    float center[3], radius; //Note: bounding sphere
+    
+    //Note: cone that holds every triangle's normal. The whole meshlet faces away from a camera at 'c' when
+    //      dot(center - c, coneAxis) >= coneCutoff*length(center - c) + radius. A cutoff of 1 never culls
+    float coneAxis[3], coneCutoff;
+};
+
+// A level of detail - the indices and meshlets that draw it
+struct MeshLod {
+    uint32 indexOffset, indexCount;
+    uint32 meshletOffset, meshletCount;
+    float error; //Note: furthest the surface strays from lod 0 in model space units
+};
+
+COMPILE_ASSERT(sizeof(MeshAttribute) == 16);
+COMPILE_ASSERT(sizeof(MeshFileHeader) == 104);
+COMPILE_ASSERT(sizeof(Meshlet) == 40);
+COMPILE_ASSERT(sizeof(MeshLod) == 20);
+
+// Returns the bytes taken up by 'componentCount' components of 'type' or 0 if they can't be stored that way
+constexpr uint32 MeshAttributeBytes(MeshComponentType type, uint32 componentCount) {
+    switch(type) {
+        case MESH_COMPONENT_FLOAT32:          return componentCount*sizeof(float);
+        case MESH_COMPONENT_FLOAT16:          
+        case MESH_COMPONENT_SNORM16:          return componentCount*sizeof(uint16);
+        case MESH_COMPONENT_SNORM_10_10_10_2: return componentCount == 4 ? sizeof(uint32) : 0;
+        default:                              return 0;
+    }
+}
+
+// Component types the vertices of a mesh are built with
+struct MeshVertexFormat {
+    MeshComponentType position, normal, uv;
+};
+
+//Note: 24 bytes per vertex, 32 with uvs
+constexpr MeshVertexFormat kMeshVertexFormatFloat32 = {
+    .position = MESH_COMPONENT_FLOAT32,
+    .normal   = MESH_COMPONENT_FLOAT32,
+    .uv       = MESH_COMPONENT_FLOAT32,
+};
+
+//Note: 12 bytes per vertex, 16 with uvs. Positions are within 1/65534th of the bounds and normals within a few hundredths of a degree
+constexpr MeshVertexFormat kMeshVertexFormatCompact = {
+    .position = MESH_COMPONENT_SNORM16,
+    .normal   = MESH_COMPONENT_SNORM16,
+    .uv       = MESH_COMPONENT_FLOAT16,
+};
+
+// Maps a unit vector onto the [-1, 1] square by projecting it onto an octahedron and folding the bottom half over the top
+inline Vec2<float> OctahedralEncode(const Vec3<float>& v) {
+    
+    float l1Norm = FastAbs(v.x) + FastAbs(v.y) + FastAbs(v.z);
+    if(l1Norm == 0.f) return Vec2<float>(0.f, 0.f);
+    
+    Vec2<float> p(v.x/l1Norm, v.y/l1Norm);
+    if(v.z < 0.f) {
+        p = Vec2<float>((1.f - FastAbs(p.y)) * (p.x >= 0.f ? 1.f : -1.f),
+                        (1.f - FastAbs(p.x)) * (p.y >= 0.f ? 1.f : -1.f));
+    }
+    return p;
+}
+
+//Note: mirrored by 'decodeNormal' in GlObject's vertex shaders. Result isn't normalized
+inline Vec3<float> OctahedralDecode(const Vec2<float>& p) {
+    
+    Vec3<float> v(p.x, p.y, 1.f - FastAbs(p.x) - FastAbs(p.y));
+    
+    float t = Max(-v.z, 0.f);
+    v.x+= v.x >= 0.f ? -t : t;
+    v.y+= v.y >= 0.f ? -t : t;
+    return v;
+}
+
+// Stores 'componentCount' floats from 'values' into 'dst' as 'type'
+// Note: snorm components are clamped to [-1, 1]. Packed types need all 4 components
+inline void EncodeMeshComponents(MeshComponentType type, const float* values, uint32 componentCount, void* dst) {
+    
+    auto Snorm = [](float value, float maxValue) { return int32(__builtin_roundf(Max(-1.f, Min(1.f, value)) * maxValue)); };
+    
+    switch(type) {
+        case MESH_COMPONENT_FLOAT32: memcpy(dst, values, componentCount*sizeof(float)); break;
+        
+        case MESH_COMPONENT_FLOAT16: {
+            for(uint32 i = 0; i < componentCount; ++i) ((uint16*)dst)[i] = FloatToHalf(values[i]);
+        } break;
+        
+        case MESH_COMPONENT_SNORM16: {
+            for(uint32 i = 0; i < componentCount; ++i) ((int16*)dst)[i] = int16(Snorm(values[i], 32767.f));
+        } break;
+        
+        case MESH_COMPONENT_SNORM_10_10_10_2: {
+            uint32 packed = 0;
+            for(uint32 i = 0; i < 3; ++i) packed|= uint32(Snorm(values[i], 511.f) & 0x3FF) << (10*i);
+            packed|= uint32(Snorm(values[3], 1.f) & 0x3) << 30;
+            
+            memcpy(dst, &packed, sizeof(packed));
+        } break;
+        
+        default: RUNTIME_ASSERT(false, "Unknown mesh component type { type: %u }", type);
+    }
+}
+
+// Loads 'componentCount' components of 'type' from 'src' into 'values' the way GL does with normalized attributes
+inline void DecodeMeshComponents(MeshComponentType type, const void* src, uint32 componentCount, float* values) {
+    
+    switch(type) {
+        case MESH_COMPONENT_FLOAT32: memcpy(values, src, componentCount*sizeof(float)); break;
+        
+        case MESH_COMPONENT_FLOAT16: {
+            for(uint32 i = 0; i < componentCount; ++i) values[i] = HalfToFloat(((const uint16*)src)[i]);
+        } break;
+        
+        case MESH_COMPONENT_SNORM16: {
+            for(uint32 i = 0; i < componentCount; ++i) values[i] = Max(-1.f, ((const int16*)src)[i] / 32767.f);
+        } break;
+        
+        case MESH_COMPONENT_SNORM_10_10_10_2: {
+            uint32 packed;
+            memcpy(&packed, src, sizeof(packed));
+            
+            //Note: shift each field to the top so the arithmetic shift back down sign extends it
+            for(uint32 i = 0; i < 3; ++i) values[i] = Max(-1.f, (int32(packed << (22 - 10*i)) >> 22) / 511.f);
+            values[3] = Max(-1.f, float(int32(packed) >> 30));
+        } break;
+        
+        default: RUNTIME_ASSERT(false, "Unknown mesh component type { type: %u }", type);
+    }
+}
+
+struct MeshFileLayout {
+    uint64 vertexOffset, indexOffset, meshletOffset, lodOffset;
+    uint64 bytes;
+};
+
+constexpr MeshFileLayout ComputeMeshFileLayout(uint32 attributeCount, uint64 vertexBytes, uint64 indexBytes, uint32 meshletCount, uint32 lodCount) {
+
+    MeshFileLayout layout = {};
+
+    uint64 offset = sizeof(MeshFileHeader) + uint64(attributeCount)*sizeof(MeshAttribute);
+    layout.vertexOffset = offset = (offset + kMeshFileAlignment - 1) & ~uint64(kMeshFileAlignment - 1);
+
+    offset+= vertexBytes;
+    layout.indexOffset = offset = (offset + kMeshFileAlignment - 1) & ~uint64(kMeshFileAlignment - 1);
+
+    offset+= indexBytes;
+    layout.meshletOffset = offset = (offset + kMeshFileAlignment - 1) & ~uint64(kMeshFileAlignment - 1);
+
+    //Note: meshlets are a multiple of 4 bytes so lods are always aligned
+    layout.lodOffset = offset+= uint64(meshletCount)*sizeof(Meshlet);
+
+    layout.bytes = offset + uint64(lodCount)*sizeof(MeshLod);
+    return layout;
+}
+
+// Pointers into a mesh file
+struct MeshFileView {
+    const MeshFileHeader* header;
+    const MeshAttribute* attributes;
+    const void *vertices, *indices;
+    const Meshlet* meshlets;
+    const MeshLod* lods;
+
+    const void* data; //Note: the whole file
+    uint64 bytes;
+};
+
+// Validates the mesh file in 'bytes' of 'data' and points 'view' at it. Returns false if it isn't a valid mesh file
+// Note: never reads out of bounds so it's safe to call on corrupt files. 'data' must be 8 byte aligned
+inline bool ReadMeshFile(const void* data, uint64 bytes, MeshFileView* view) {
+
+    if(bytes < sizeof(MeshFileHeader)) return false;
+
+    const MeshFileHeader* header = (const MeshFileHeader*)data;
+    if(header->magic != kMeshFileMagic || header->version != kMeshFileVersion) return false;
+
+    if(header->indexStride != sizeof(uint8) && header->indexStride != sizeof(uint16) && header->indexStride != sizeof(uint32)) return false;
+    if(!header->vertexStride || header->attributeCount > MESH_ATTRIBUTE_COUNT) return false;
+
+    //Note: compressed streams are checked when they're decoded
+    if(!(header->flags&MESH_FLAG_COMPRESSED) && (header->vertexBytes != uint64(header->vertexCount)*header->vertexStride ||
+                                                  header->indexBytes != uint64(header->indexCount)*header->indexStride)) return false;
+
+    MeshFileLayout layout = ComputeMeshFileLayout(header->attributeCount, header->vertexBytes, header->indexBytes, header->meshletCount, header->lodCount);
+    if(header->vertexOffset != layout.vertexOffset || header->indexOffset != layout.indexOffset ||
+       header->meshletOffset != layout.meshletOffset || header->lodOffset != layout.lodOffset || bytes != layout.bytes) return false;
+
+    //Note: every attribute has to fit in the vertex and positions are required
+    const MeshAttribute* attributes = (const MeshAttribute*)ByteOffset(data, sizeof(MeshFileHeader));
+    bool hasPosition = false;
+    for(uint32 i = 0; i < header->attributeCount; ++i) {
+        const MeshAttribute& attribute = attributes[i];
+
+        if(attribute.type >= MESH_ATTRIBUTE_COUNT || attribute.componentType >= MESH_COMPONENT_COUNT ||
+           !attribute.componentCount || attribute.componentCount > 4) return false;
+        
+        uint32 attributeBytes = MeshAttributeBytes(attribute.componentType, attribute.componentCount);
+        if(!attributeBytes || uint64(attribute.offset) + attributeBytes > header->vertexStride) return false;
+
+        hasPosition|= (attribute.type == MESH_ATTRIBUTE_POSITION);
+    }
+    if(!hasPosition) return false;
+
+    //Note: meshlets are drawn straight from the index buffer so they have to stay inside it and on whole triangles
+    const Meshlet* meshlets = (const Meshlet*)ByteOffset(data, header->meshletOffset);
+    for(uint32 i = 0; i < header->meshletCount; ++i) {
+        const Meshlet& meshlet = meshlets[i];
+        if(meshlet.indexOffset%3 || meshlet.indexCount%3 || uint64(meshlet.indexOffset) + meshlet.indexCount > header->indexCount) return false;
+    }
+
+    //Note: lod 0 is always there so a mesh can be drawn without looking at the others
+    const MeshLod* lods = (const MeshLod*)ByteOffset(data, header->lodOffset);
+    if(!header->lodCount) return false;
+    for(uint32 i = 0; i < header->lodCount; ++i) {
+        const MeshLod& lod = lods[i];
+        if(lod.indexOffset%3 || lod.indexCount%3 || uint64(lod.indexOffset) + lod.indexCount > header->indexCount ||
+           uint64(lod.meshletOffset) + lod.meshletCount > header->meshletCount) return false;
+    }
+
+    //Note: gl would read vertices past the end of the vbo otherwise. Compressed indices are checked as they're decoded
+    if(!(header->flags&MESH_FLAG_COMPRESSED)) {
+        const void* indices = ByteOffset(data, header->indexOffset);
+        
+        uint32 maxIndex = 0;
+        switch(header->indexStride) {
+            case sizeof(uint8):  for(uint32 i = 0; i < header->indexCount; ++i) maxIndex = Max(maxIndex, uint32(((const uint8*)indices)[i]));  break;
+            case sizeof(uint16): for(uint32 i = 0; i < header->indexCount; ++i) maxIndex = Max(maxIndex, uint32(((const uint16*)indices)[i])); break;
+            case sizeof(uint32): for(uint32 i = 0; i < header->indexCount; ++i) maxIndex = Max(maxIndex, ((const uint32*)indices)[i]);         break;
+        }
+        if(header->indexCount && maxIndex >= header->vertexCount) return false;
+    }
+
+    *view = {
+        .header = header,
+        .attributes = attributes,
+        .vertices = ByteOffset(data, header->vertexOffset),
+        .indices = ByteOffset(data, header->indexOffset),
+        .meshlets = meshlets,
+        .lods = lods,
+        .data = data,
+        .bytes = bytes,
+    };
+    return true;
+}
+
+// How the position attribute of a mesh maps to model space - position = offset + scale*attribute
+struct MeshPositionTransform {
+    Vec3<float> scale, offset;
+};
+
+inline MeshPositionTransform ComputeMeshPositionTransform(const MeshFileHeader& header, const MeshAttribute& position) {
+    
+    if(position.componentType == MESH_COMPONENT_FLOAT32) return { .scale = Vec3<float>(1.f, 1.f, 1.f), .offset = Vec3<float>(0.f, 0.f, 0.f) };
+    
+    return {
+        .scale = Vec3<float>(.5f*(header.boundsMax[0] - header.boundsMin[0]),
+                             .5f*(header.boundsMax[1] - header.boundsMin[1]),
+                             .5f*(header.boundsMax[2] - header.boundsMin[2])),
+        
+        .offset = Vec3<float>(.5f*(header.boundsMax[0] + header.boundsMin[0]),
+                              .5f*(header.boundsMax[1] + header.boundsMin[1]),
+                              .5f*(header.boundsMax[2] + header.boundsMin[2])),
+    };
+}
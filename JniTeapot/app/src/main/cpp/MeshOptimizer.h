@@ -0,0 +1,807 @@
+#pragma once
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "util.h"
+#include "Memory.h"
+#include "vec.h"
+#include "mat.h"
+#include "MeshFile.h"
+#include "hashUtil.h"
+
+// Reorders triangle lists so the gpu does less work drawing them
+//
+//   OptimizeVertexCache - orders triangles so recently shaded vertices get reused from the post transform cache
+//   OptimizeOverdraw    - orders clusters of triangles so the ones that occlude the most are drawn first
+//   OptimizeVertexFetch - orders vertices by first use so vertex fetches stream through memory
+//   SimplifyMesh        - collapses edges to build lower detail triangle lists over the same vertices
+//   BuildMeshlets       - splits the triangles into meshlets that can be culled on the cpu (see MeshletOutsideFrustum and MeshletBackFacing)
+//
+// Note: run them in that order. Every function works on uint32 indices in place and takes an arena for scratch memory
+
+// Number of vertices the gpu's post transform cache is assumed to hold when analyzing and clustering meshes
+// Note: this is a FIFO cache - mobile gpus are somewhere between 8 and 32 entries
+constexpr uint32 kVertexCacheSize = 16;
+
+struct VertexCacheStats {
+    uint32 misses;
+    float acmr; //Note: average cache miss ratio - vertex shader runs per triangle. 0.5 is the best a big grid can do, 3 is the worst
+    float atvr; //Note: average transformed vertex ratio - vertex shader runs per vertex. 1 is ideal
+};
+
+// Marks 'a', 'b' and 'c' as used in a FIFO cache that tracks when vertices were inserted with 'timestamps'
+// Returns the number of misses
+inline uint32 UpdateVertexCache(uint32 a, uint32 b, uint32 c, uint32* timestamps, uint32* timestamp, uint32 cacheSize = kVertexCacheSize) {
+    uint32 misses = 0;
+    for(uint32 vertex : { a, b, c }) {
+        if(*timestamp - timestamps[vertex] > cacheSize) {
+            timestamps[vertex] = (*timestamp)++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+// Simulates drawing 'indices' through a FIFO cache with 'cacheSize' entries
+inline VertexCacheStats AnalyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount, Memory::Arena* scratchArena,
+                                           uint32 cacheSize = kVertexCacheSize) {
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+    uint32* timestamps = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), true, alignof(uint32));
+
+    //Note: start past the cache size so every vertex misses the first time
+    uint32 timestamp = cacheSize + 1;
+
+    VertexCacheStats stats = {};
+    for(uint32 i = 0; i+3 <= indexCount; i+= 3) stats.misses+= UpdateVertexCache(indices[i], indices[i+1], indices[i+2], timestamps, &timestamp, cacheSize);
+
+    scratchArena->FreeBaseRegion(tmpRegion);
+
+    stats.acmr = indexCount  ? float(stats.misses) / (indexCount/3) : 0.f;
+    stats.atvr = vertexCount ? float(stats.misses) / vertexCount : 0.f;
+    return stats;
+}
+
+// Reorders triangles so they reuse vertices that are still in the post transform cache
+// Note: this is Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". Triangles are emitted greedily by score - vertices
+//       score higher the more recently they were used and the fewer triangles they have left so we finish off fans
+//       instead of leaving stragglers. It works for any cache size so it doesn't need to know the gpu's
+inline void OptimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount, Memory::Arena* scratchArena) {
+
+    //Note: LRU cache that's being modeled. Bigger than the FIFO we analyze with since LRU entries are worth less
+    constexpr uint32 kCacheSize = 32;
+    constexpr uint32 kMaxValence = 32;
+
+    constexpr float kCacheDecayPower   = 1.5f,
+                    kLastTriangleScore = .75f,
+                    kValenceBoostScale = 2.f,
+                    kValenceBoostPower = .5f;
+
+    constexpr uint32 kNone = ~uint32(0);
+
+    uint32 numTriangles = indexCount/3;
+    if(numTriangles < 2) return;
+
+    // precompute the scores for every cache position and remaining triangle count
+    float cacheScores[kCacheSize], valenceScores[kMaxValence + 1];
+    for(uint32 i = 0; i < kCacheSize; ++i) {
+        //Note: the last triangle's vertices get a fixed score so it doesn't matter which order they were in
+        cacheScores[i] = i < 3 ? kLastTriangleScore : __builtin_powf(1.f - float(i-3)/(kCacheSize-3), kCacheDecayPower);
+    }
+
+    valenceScores[0] = 0.f;
+    for(uint32 i = 1; i <= kMaxValence; ++i) valenceScores[i] = kValenceBoostScale * __builtin_powf(float(i), -kValenceBoostPower);
+
+    auto VertexScore = [&](int32 cachePosition, uint32 remainingTriangles) {
+        if(!remainingTriangles) return -1.f;
+
+        float score = valenceScores[Min(remainingTriangles, kMaxValence)];
+        if(cachePosition >= 0) score+= cacheScores[cachePosition];
+        return score;
+    };
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+
+    // bucket triangles by vertex
+    // Note: the first 'remainingTriangles[v]' entries in v's bucket are the triangles that haven't been emitted
+    uint32* triangleListStart = (uint32*)scratchArena->PushBytes((vertexCount+1)*sizeof(uint32), true, alignof(uint32));
+    for(uint32 i = 0; i < indexCount; ++i) ++triangleListStart[indices[i]+1];
+    for(uint32 i = 0; i < vertexCount; ++i) triangleListStart[i+1]+= triangleListStart[i];
+
+    uint32* remainingTriangles = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), true, alignof(uint32));
+    uint32* triangleList = (uint32*)scratchArena->PushBytes(indexCount*sizeof(uint32), false, alignof(uint32));
+    for(uint32 i = 0; i < indexCount; ++i) {
+        uint32 vertex = indices[i];
+        triangleList[triangleListStart[vertex] + remainingTriangles[vertex]++] = i/3;
+    }
+
+    float* vertexScores = (float*)scratchArena->PushBytes(vertexCount*sizeof(float), false, alignof(float));
+    for(uint32 i = 0; i < vertexCount; ++i) vertexScores[i] = VertexScore(-1, remainingTriangles[i]);
+
+    float* triangleScores = (float*)scratchArena->PushBytes(numTriangles*sizeof(float), false, alignof(float));
+    bool* emitted = (bool*)scratchArena->PushBytes(numTriangles*sizeof(bool), true);
+
+    uint32 bestTriangle = 0;
+    for(uint32 i = 0; i < numTriangles; ++i) {
+        const uint32* triangle = indices + 3*i;
+        triangleScores[i] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+        if(triangleScores[i] > triangleScores[bestTriangle]) bestTriangle = i;
+    }
+
+    //Note: room for the emitted triangle's vertices on top of a full cache
+    uint32 cache[kCacheSize+3], newCache[kCacheSize+3];
+    uint32 cacheCount = 0;
+
+    uint32* output = (uint32*)scratchArena->PushBytes(indexCount*sizeof(uint32), false, alignof(uint32));
+    uint32 deadEndCursor = 0;
+
+    for(uint32 i = 0; i < numTriangles; ++i) {
+
+        //Note: nothing in the cache has triangles left so start again from the first triangle we haven't emitted
+        if(bestTriangle == kNone) {
+            while(emitted[deadEndCursor]) ++deadEndCursor;
+            bestTriangle = deadEndCursor;
+        }
+
+        const uint32* triangle = indices + 3*bestTriangle;
+        memcpy(output + 3*i, triangle, 3*sizeof(uint32));
+        emitted[bestTriangle] = true;
+
+        // remove the triangle from its vertices' buckets
+        for(uint32 j = 0; j < 3; ++j) {
+            uint32 vertex = triangle[j];
+            uint32* bucket = triangleList + triangleListStart[vertex];
+
+            uint32 last = --remainingTriangles[vertex];
+            for(uint32 k = 0; k <= last; ++k) {
+                if(bucket[k] == bestTriangle) {
+                    bucket[k] = bucket[last];
+                    break;
+                }
+            }
+        }
+
+        // move the triangle's vertices to the front of the cache
+        uint32 newCacheCount = 0;
+        for(uint32 j = 0; j < 3; ++j) {
+            uint32 vertex = triangle[j];
+            if(j && (vertex == triangle[0] || (j == 2 && vertex == triangle[1]))) continue;
+            newCache[newCacheCount++] = vertex;
+        }
+        for(uint32 j = 0; j < cacheCount; ++j) {
+            uint32 vertex = cache[j];
+            if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) newCache[newCacheCount++] = vertex;
+        }
+
+        // rescore everything that moved in (or fell out of) the cache and push the change down to its triangles
+        for(uint32 j = 0; j < newCacheCount; ++j) {
+            uint32 vertex = newCache[j];
+
+            int32 cachePosition = j < kCacheSize ? j : -1;
+            float score = VertexScore(cachePosition, remainingTriangles[vertex]);
+            float scoreDelta = score - vertexScores[vertex];
+
+            vertexScores[vertex] = score;
+
+            const uint32* bucket = triangleList + triangleListStart[vertex];
+            for(uint32 k = 0; k < remainingTriangles[vertex]; ++k) triangleScores[bucket[k]]+= scoreDelta;
+        }
+
+        cacheCount = Min(newCacheCount, kCacheSize);
+        memcpy(cache, newCache, cacheCount*sizeof(uint32));
+
+        // the next triangle is the best one that uses a cached vertex
+        bestTriangle = kNone;
+        float bestScore = -1.f;
+        for(uint32 j = 0; j < cacheCount; ++j) {
+            uint32 vertex = cache[j];
+
+            const uint32* bucket = triangleList + triangleListStart[vertex];
+            for(uint32 k = 0; k < remainingTriangles[vertex]; ++k) {
+                uint32 candidate = bucket[k];
+                if(triangleScores[candidate] > bestScore) {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, output, indexCount*sizeof(uint32));
+    scratchArena->FreeBaseRegion(tmpRegion);
+}
+
+// Reorders clusters of triangles so the ones facing away from the middle of the mesh - the ones most likely to occlude the
+// rest - are drawn first and early depth testing can reject more fragments
+// Note: run after OptimizeVertexCache. Clusters are split where the cache would be cold anyways and at points where
+//       a cluster's ACMR is within 'threshold' times the ACMR of the whole run so we give up at most that much cache efficiency.
+//       'positions' is read as a Vec3<float> at the start of each 'positionStride' sized vertex.
+//       This is the approach from "Triangle Order Optimization for Graphics Hardware Computation Culling" (Nehab et al.)
+inline void OptimizeOverdraw(uint32* indices, uint32 indexCount, const void* positions, uint32 positionStride, uint32 vertexCount,
+                             Memory::Arena* scratchArena, float threshold = 1.05f) {
+
+    struct Cluster {
+        uint32 start, end; //Note: triangles
+        float sortKey;
+    };
+
+    uint32 numTriangles = indexCount/3;
+    if(numTriangles < 2) return;
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+
+    uint32* timestamps = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), true, alignof(uint32));
+    uint32 timestamp = kVertexCacheSize + 1;
+
+    auto TriangleMisses = [&](uint32 triangle) {
+        const uint32* index = indices + 3*triangle;
+        return UpdateVertexCache(index[0], index[1], index[2], timestamps, &timestamp);
+    };
+    auto FlushCache = [&]() { timestamp+= kVertexCacheSize + 1; };
+
+    // hard boundaries - triangles that miss on every vertex start an unconnected patch so splitting there costs nothing
+    Memory::ArenaArray<uint32> hardBoundaries(scratchArena);
+    for(uint32 i = 0; i < numTriangles; ++i) {
+        if(TriangleMisses(i) == 3 || !i) *hardBoundaries.Push() = i;
+    }
+
+    // soft boundaries - split patches into clusters as soon as they reach the patch's ACMR times 'threshold'
+    Memory::ArenaArray<Cluster> clusters(scratchArena);
+    for(uint32 i = 0; i < hardBoundaries.Count(); ++i) {
+
+        uint32 start = hardBoundaries[i],
+               end = i+1 < hardBoundaries.Count() ? hardBoundaries[i+1] : numTriangles;
+
+        FlushCache();
+        uint32 patchMisses = 0;
+        for(uint32 j = start; j < end; ++j) patchMisses+= TriangleMisses(j);
+
+        float maxAcmr = threshold * float(patchMisses)/(end - start);
+
+        FlushCache();
+        uint32 clusterStart = start, clusterMisses = 0;
+        for(uint32 j = start; j < end; ++j) {
+            clusterMisses+= TriangleMisses(j);
+
+            if(float(clusterMisses)/(j+1 - clusterStart) <= maxAcmr) {
+                *clusters.Push() = { .start = clusterStart, .end = j+1 };
+
+                FlushCache();
+                clusterStart = j+1;
+                clusterMisses = 0;
+            }
+        }
+
+        //Note: whatever is left never reached the target so it joins the last cluster
+        if(clusterStart < end) {
+            if(clusters.Count() && clusters[clusters.Count()-1].end == clusterStart && clusters[clusters.Count()-1].start >= start) {
+                clusters[clusters.Count()-1].end = end;
+            } else {
+                *clusters.Push() = { .start = clusterStart, .end = end };
+            }
+        }
+    }
+
+    auto Position = [&](uint32 vertex) -> const Vec3<float>& { return *(const Vec3<float>*)ByteOffset(positions, vertex*positionStride); };
+
+    Vec3<float> meshCentroid(0.f, 0.f, 0.f);
+    for(uint32 i = 0; i < vertexCount; ++i) meshCentroid+= Position(i);
+    meshCentroid/= float(Max(vertexCount, uint32(1)));
+
+    // sort clusters by how far they face out of the mesh
+    for(Cluster& cluster : clusters) {
+
+        Vec3<float> centroid(0.f, 0.f, 0.f), normal(0.f, 0.f, 0.f);
+        float area = 0.f;
+
+        for(uint32 i = cluster.start; i < cluster.end; ++i) {
+            const uint32* index = indices + 3*i;
+            const Vec3<float> &v1 = Position(index[0]), &v2 = Position(index[1]), &v3 = Position(index[2]);
+
+            //Note: the cross product is twice the area of the triangle pointed along its normal so weigh by it
+            Vec3<float> cross = (v2 - v1).Cross(v3 - v1);
+            float triangleArea = cross.Norm();
+
+            centroid+= (v1 + v2 + v3) * (triangleArea/3.f);
+            normal+= cross;
+            area+= triangleArea;
+        }
+
+        float normalLength = normal.Norm();
+        cluster.sortKey = (area > 0.f && normalLength > 0.f) ? (centroid/area - meshCentroid).Dot(normal/normalLength) : 0.f;
+    }
+
+    qsort(clusters.Data(), clusters.Count(), sizeof(Cluster), [](const void* a, const void* b) {
+        float aKey = ((const Cluster*)a)->sortKey, bKey = ((const Cluster*)b)->sortKey;
+        return (aKey < bKey) - (aKey > bKey); //Note: largest key first
+    });
+
+    uint32* output = (uint32*)scratchArena->PushBytes(indexCount*sizeof(uint32), false, alignof(uint32));
+    uint32* outputPtr = output;
+    for(const Cluster& cluster : clusters) {
+        uint32 clusterIndices = 3*(cluster.end - cluster.start);
+        memcpy(outputPtr, indices + 3*cluster.start, clusterIndices*sizeof(uint32));
+        outputPtr+= clusterIndices;
+    }
+
+    memcpy(indices, output, 3*numTriangles*sizeof(uint32));
+    scratchArena->FreeBaseRegion(tmpRegion);
+}
+
+// Renumbers vertices in the order 'indices' first uses them and moves 'vertices' to match so the gpu fetches them in order
+// Returns the number of vertices that are used - unused ones are dropped off the end
+inline uint32 OptimizeVertexFetch(void* vertices, uint32 vertexStride, uint32 vertexCount, uint32* indices, uint32 indexCount,
+                                  Memory::Arena* scratchArena) {
+
+    constexpr uint32 kUnused = ~uint32(0);
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+
+    uint32* remap = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), false, alignof(uint32));
+    memset(remap, 0xFF, vertexCount*sizeof(uint32));
+
+    uint32 usedCount = 0;
+    for(uint32 i = 0; i < indexCount; ++i) {
+        uint32& newIndex = remap[indices[i]];
+        if(newIndex == kUnused) newIndex = usedCount++;
+
+        indices[i] = newIndex;
+    }
+
+    void* oldVertices = scratchArena->PushBytes(vertexCount*vertexStride, false, 16);
+    memcpy(oldVertices, vertices, vertexCount*vertexStride);
+
+    for(uint32 i = 0; i < vertexCount; ++i) {
+        if(remap[i] != kUnused) memcpy(ByteOffset(vertices, remap[i]*vertexStride), ByteOffset(oldVertices, i*vertexStride), vertexStride);
+    }
+
+    scratchArena->FreeBaseRegion(tmpRegion);
+    return usedCount;
+}
+
+// Plane error quadric from "Surface Simplification Using Quadric Error Metrics" (Garland & Heckbert)
+// Note: doubles since the error is the small difference of large squared terms. 'weight' is the total weight of the
+//       planes so Evaluate returns the weighted mean squared distance to them
+struct Quadric {
+    double a00, a11, a22, a01, a02, a12; //Note: symmetric A = sum(n*n^T)
+    double b0, b1, b2;                   //Note: b = sum(d*n)
+    double c;                            //Note: c = sum(d*d)
+    double weight;
+    
+    // adds the plane dot(normal, p) + d = 0. 'normal' has to be unit length
+    inline void AddPlane(const Vec3<float>& normal, float d, float planeWeight) {
+        double x = normal.x, y = normal.y, z = normal.z, w = planeWeight;
+        
+        a00+= w*x*x; a11+= w*y*y; a22+= w*z*z;
+        a01+= w*x*y; a02+= w*x*z; a12+= w*y*z;
+        b0+=  w*d*x; b1+=  w*d*y; b2+=  w*d*z;
+        c+=   w*d*d;
+        weight+= w;
+    }
+    
+    inline void operator+=(const Quadric& q) {
+        a00+= q.a00; a11+= q.a11; a22+= q.a22;
+        a01+= q.a01; a02+= q.a02; a12+= q.a12;
+        b0+= q.b0; b1+= q.b1; b2+= q.b2;
+        c+= q.c;
+        weight+= q.weight;
+    }
+    
+    // Returns the mean squared distance from 'p' to the planes
+    inline double Evaluate(const Vec3<float>& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        
+        double error = x*x*a00 + y*y*a11 + z*z*a22 + 2.*(x*y*a01 + x*z*a02 + y*z*a12) + 2.*(x*b0 + y*b1 + z*b2) + c;
+        return weight > 0. ? Max(error/weight, 0.) : 0.;
+    }
+};
+
+// Collapses edges of the triangles in 'indices' until at most 'targetIndexCount' indices are left or the next collapse would move
+// the surface more than 'targetError'. The remaining triangles are written to 'destination' and the number of indices written is returned.
+// 'resultError' gets the furthest the surface moved. Errors are in the same units as the positions
+// Note: vertices only collapse onto other vertices so the result indexes the same vertices as 'indices'. Vertices that share their position
+//       with another vertex (hard edges and uv seams) are never collapsed and vertices on open borders only slide along the border
+//       so seams and silhouettes hold their shape. 'positions' is read as a Vec3<float> at the start of each 'positionStride' sized vertex.
+//       'destination' has to hold 'indexCount' indices and can't overlap 'indices'
+inline uint32 SimplifyMesh(uint32* destination, const uint32* indices, uint32 indexCount, const void* positions, uint32 positionStride,
+                           uint32 vertexCount, uint32 targetIndexCount, float targetError, Memory::Arena* scratchArena, float* resultError = nullptr) {
+    
+    enum VertexKind: uint8 {
+        VERTEX_MANIFOLD, //Note: free to collapse onto any neighbor
+        VERTEX_BORDER,   //Note: only collapses along an open edge
+        VERTEX_LOCKED,   //Note: shares a position with another vertex or sits on a non-manifold edge
+    };
+    
+    constexpr uint64 kEmptySlot = ~uint64(0);
+    constexpr float kBorderWeight = 10.f; //Note: borders are held in place by planes through them this many times stronger than faces
+    
+    auto Position = [&](uint32 vertex) -> const Vec3<float>& { return *(const Vec3<float>*)ByteOffset(positions, vertex*positionStride); };
+    
+    uint32 numIndices = indexCount - indexCount%3;
+    memcpy(destination, indices, numIndices*sizeof(uint32));
+    
+    double maxError = 0.;
+    
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+    
+    // find the vertices that share a position
+    // Note: open addressing with linear probing. positionIds[v] is the first vertex with v's position
+    uint32 numPositionSlots = Pow2RoundUp(Max(2*vertexCount, uint32(16)));
+    uint32* positionSlots = (uint32*)scratchArena->PushBytes(numPositionSlots*sizeof(uint32), false, alignof(uint32));
+    memset(positionSlots, 0xFF, numPositionSlots*sizeof(uint32));
+    
+    uint32* positionIds = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), false, alignof(uint32));
+    bool* sharedPositions = (bool*)scratchArena->PushBytes(vertexCount*sizeof(bool), true, alignof(bool));
+    
+    for(uint32 i = 0; i < vertexCount; ++i) {
+        const Vec3<float>& position = Position(i);
+        
+        for(uint32 slot = Hash64(&position, sizeof(position)) & (numPositionSlots-1);; slot = (slot+1) & (numPositionSlots-1)) {
+            uint32 vertex = positionSlots[slot];
+            if(vertex == ~uint32(0)) {
+                positionSlots[slot] = positionIds[i] = i;
+                break;
+            }
+            
+            if(!memcmp(&Position(vertex), &position, sizeof(position))) {
+                positionIds[i] = vertex;
+                sharedPositions[i] = sharedPositions[vertex] = true;
+                break;
+            }
+        }
+    }
+    
+    // scratch that's rebuilt every pass
+    uint32 numEdgeSlots = Pow2RoundUp(Max(2*numIndices, uint32(16)));
+    uint64* edgeSlots  = (uint64*)scratchArena->PushBytes(numEdgeSlots*sizeof(uint64), false, alignof(uint64));
+    uint32* edgeCounts = (uint32*)scratchArena->PushBytes(numEdgeSlots*sizeof(uint32), false, alignof(uint32));
+    
+    VertexKind* vertexKinds = (VertexKind*)scratchArena->PushBytes(vertexCount*sizeof(VertexKind), false, alignof(VertexKind));
+    bool* collapsedVertices = (bool*)scratchArena->PushBytes(vertexCount*sizeof(bool), false, alignof(bool));
+    uint32* remap = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), false, alignof(uint32));
+    
+    uint32* triangleListStart = (uint32*)scratchArena->PushBytes((vertexCount+1)*sizeof(uint32), false, alignof(uint32));
+    uint32* triangleListEnd   = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), false, alignof(uint32));
+    uint32* triangleList      = (uint32*)scratchArena->PushBytes(numIndices*sizeof(uint32), false, alignof(uint32));
+    
+    struct Collapse {
+        uint32 vertex, target;
+        float error; //Note: squared
+    };
+    //Note: every corner's edge can collapse either way
+    Collapse* collapses = (Collapse*)scratchArena->PushBytes(2*numIndices*sizeof(Collapse), false, alignof(Collapse));
+    
+    //Note: edges are keyed on positions so the two sides of a seam are still the same edge
+    auto Edge = [&](uint32 from, uint32 to) { return (uint64(positionIds[from]) << 32) | positionIds[to]; };
+    
+    auto EdgeSlot = [&](uint64 edge) {
+        uint32 slot = Hash64(&edge, sizeof(edge)) & (numEdgeSlots-1);
+        while(edgeSlots[slot] != kEmptySlot && edgeSlots[slot] != edge) slot = (slot+1) & (numEdgeSlots-1);
+        return slot;
+    };
+    
+    auto EdgeCount = [&](uint32 from, uint32 to) {
+        uint32 slot = EdgeSlot(Edge(from, to));
+        return edgeSlots[slot] == kEmptySlot ? 0 : edgeCounts[slot];
+    };
+    
+    auto CountEdges = [&]() {
+        memset(edgeSlots, 0xFF, numEdgeSlots*sizeof(uint64));
+        for(uint32 i = 0; i < numIndices; ++i) {
+            uint64 edge = Edge(destination[i], destination[i%3 == 2 ? i-2 : i+1]);
+            
+            uint32 slot = EdgeSlot(edge);
+            if(edgeSlots[slot] == kEmptySlot) {
+                edgeSlots[slot] = edge;
+                edgeCounts[slot] = 0;
+            }
+            ++edgeCounts[slot];
+        }
+    };
+    
+    // sum the planes of the faces around every vertex
+    // Note: open edges also get a plane through them perpendicular to their face so the border keeps its outline
+    CountEdges();
+    
+    Quadric* quadrics = (Quadric*)scratchArena->PushBytes(vertexCount*sizeof(Quadric), true, alignof(Quadric));
+    for(uint32 i = 0; i < numIndices; i+= 3) {
+        const uint32* triangle = destination + i;
+        const Vec3<float> &v1 = Position(triangle[0]), &v2 = Position(triangle[1]), &v3 = Position(triangle[2]);
+        
+        //Note: weighted by area so big faces hold their shape better than slivers
+        Vec3<float> normal = (v2 - v1).Cross(v3 - v1);
+        float area = normal.Norm();
+        if(area == 0.f) continue;
+        
+        normal/= area;
+        for(uint32 j = 0; j < 3; ++j) quadrics[triangle[j]].AddPlane(normal, -normal.Dot(v1), area);
+        
+        for(uint32 j = 0; j < 3; ++j) {
+            uint32 from = triangle[j], to = triangle[(j+1)%3];
+            if(EdgeCount(to, from)) continue;
+            
+            Vec3<float> edge = Position(to) - Position(from);
+            Vec3<float> borderNormal = edge.Cross(normal);
+            float edgeLength = borderNormal.Norm();
+            if(edgeLength == 0.f) continue;
+            
+            borderNormal/= edgeLength;
+            
+            float d = -borderNormal.Dot(Position(from));
+            quadrics[from].AddPlane(borderNormal, d, kBorderWeight*edgeLength*edgeLength);
+            quadrics[to].AddPlane(borderNormal, d, kBorderWeight*edgeLength*edgeLength);
+        }
+    }
+    
+    while(numIndices > targetIndexCount) {
+        
+        // classify vertices by the edges around them
+        CountEdges();
+        
+        for(uint32 i = 0; i < vertexCount; ++i) vertexKinds[i] = sharedPositions[i] ? VERTEX_LOCKED : VERTEX_MANIFOLD;
+        for(uint32 i = 0; i < numIndices; ++i) {
+            uint32 from = destination[i], to = destination[i%3 == 2 ? i-2 : i+1];
+            
+            VertexKind kind = EdgeCount(from, to) > 1 ? VERTEX_LOCKED :
+                              !EdgeCount(to, from)    ? VERTEX_BORDER : VERTEX_MANIFOLD;
+            
+            vertexKinds[from] = Max(vertexKinds[from], kind);
+            vertexKinds[to]   = Max(vertexKinds[to], kind);
+        }
+        
+        // bucket the triangles around every vertex
+        // Note: triangleListStart[v] is where the triangles that use vertex v start in triangleList
+        memset(triangleListStart, 0, (vertexCount+1)*sizeof(uint32));
+        for(uint32 i = 0; i < numIndices; ++i) ++triangleListStart[destination[i] + 1];
+        for(uint32 i = 0; i < vertexCount; ++i) triangleListStart[i+1]+= triangleListStart[i];
+        
+        memcpy(triangleListEnd, triangleListStart, vertexCount*sizeof(uint32));
+        for(uint32 i = 0; i < numIndices; ++i) triangleList[triangleListEnd[destination[i]]++] = i/3;
+        
+        // find every edge that can collapse and what it costs
+        uint32 numCollapses = 0;
+        for(uint32 i = 0; i < numIndices; ++i) {
+            uint32 from = destination[i], to = destination[i%3 == 2 ? i-2 : i+1];
+            if(from == to) continue;
+            
+            bool borderEdge = !EdgeCount(to, from);
+            for(uint32 j = 0; j < 2; ++j) {
+                uint32 vertex = j ? to : from,
+                       target = j ? from : to;
+                
+                //Note: the target can't share its position or the triangles across the seam would pick up this side's attributes
+                if(sharedPositions[target]) continue;
+                if(vertexKinds[vertex] == VERTEX_LOCKED || (vertexKinds[vertex] == VERTEX_BORDER && !borderEdge)) continue;
+                
+                Quadric quadric = quadrics[vertex];
+                quadric+= quadrics[target];
+                collapses[numCollapses++] = { .vertex = vertex, .target = target, .error = float(quadric.Evaluate(Position(target))) };
+            }
+        }
+        
+        qsort(collapses, numCollapses, sizeof(Collapse), [](const void* a, const void* b) {
+            float aError = ((const Collapse*)a)->error, bError = ((const Collapse*)b)->error;
+            return (aError > bError) - (aError < bError);
+        });
+        
+        // collapse the cheapest edges that don't flip any triangles
+        // Note: a vertex that collapsed or was collapsed onto is left alone until the next pass so the triangle lists stay valid.
+        //       Interior collapses remove 2 triangles and border ones remove 1
+        for(uint32 i = 0; i < vertexCount; ++i) remap[i] = i;
+        memset(collapsedVertices, 0, vertexCount*sizeof(bool));
+        
+        uint32 trianglesToRemove = (numIndices - targetIndexCount + 2)/3,
+               removedTriangles = 0;
+        
+        float maxSquaredError = targetError*targetError;
+        for(uint32 i = 0; i < numCollapses && removedTriangles < trianglesToRemove; ++i) {
+            const Collapse& collapse = collapses[i];
+            if(collapse.error > maxSquaredError) break;
+            if(collapsedVertices[collapse.vertex] || collapsedVertices[collapse.target]) continue;
+            
+            const Vec3<float> &vertexPosition = Position(collapse.vertex),
+                              &targetPosition = Position(collapse.target);
+            
+            bool flips = false;
+            for(uint32 j = triangleListStart[collapse.vertex]; j < triangleListEnd[collapse.vertex] && !flips; ++j) {
+                const uint32* triangle = destination + 3*triangleList[j];
+                
+                uint32 corners[] = { remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] };
+                if(corners[0] == collapse.target || corners[1] == collapse.target || corners[2] == collapse.target) continue;
+                
+                //Note: rotate the collapsing vertex to the front
+                uint32 k = corners[0] == collapse.vertex ? 0 : corners[1] == collapse.vertex ? 1 : 2;
+                const Vec3<float> &v2 = Position(corners[(k+1)%3]), &v3 = Position(corners[(k+2)%3]);
+                
+                Vec3<float> normal = (v2 - vertexPosition).Cross(v3 - vertexPosition),
+                            collapsedNormal = (v2 - targetPosition).Cross(v3 - targetPosition);
+                
+                flips = collapsedNormal.Dot(normal) <= 0.f;
+            }
+            if(flips) continue;
+            
+            remap[collapse.vertex] = collapse.target;
+            quadrics[collapse.target]+= quadrics[collapse.vertex];
+            collapsedVertices[collapse.vertex] = collapsedVertices[collapse.target] = true;
+            
+            removedTriangles+= vertexKinds[collapse.vertex] == VERTEX_BORDER ? 1 : 2;
+            maxError = Max(maxError, double(collapse.error));
+        }
+        
+        if(!removedTriangles) break;
+        
+        // drop the triangles that collapsed
+        uint32 remainingIndices = 0;
+        for(uint32 i = 0; i < numIndices; i+= 3) {
+            uint32 a = remap[destination[i]], b = remap[destination[i+1]], c = remap[destination[i+2]];
+            if(a == b || b == c || c == a) continue;
+            
+            destination[remainingIndices++] = a;
+            destination[remainingIndices++] = b;
+            destination[remainingIndices++] = c;
+        }
+        numIndices = remainingIndices;
+    }
+    
+    scratchArena->FreeBaseRegion(tmpRegion);
+    
+    if(resultError) *resultError = float(Sqrt(float(maxError)));
+    return numIndices;
+}
+
+// Most vertices and triangles in a meshlet. Small enough that most meshlets face one way
+constexpr uint32 kMeshletMaxVertices  = 64,
+                 kMeshletMaxTriangles = 124;
+
+// Returns the bounding sphere and normal cone of triangles ['firstTriangle', 'endTriangle')
+// Note: 'positions' is read as a Vec3<float> at the start of each 'positionStride' sized vertex
+inline Meshlet ComputeMeshletBounds(const uint32* indices, uint32 firstTriangle, uint32 endTriangle, const void* positions, uint32 positionStride) {
+    
+    auto Position = [&](uint32 vertex) -> const Vec3<float>& { return *(const Vec3<float>*)ByteOffset(positions, vertex*positionStride); };
+    
+    const uint32 *firstIndex = indices + 3*firstTriangle,
+                 *endIndex   = indices + 3*endTriangle;
+    
+    //Note: the sphere is centered on the aabb. It's a little looser than the smallest sphere but a lot cheaper to find
+    Vec3<float> boundsMin = Position(*firstIndex), boundsMax = boundsMin;
+    for(const uint32* index = firstIndex; index < endIndex; ++index) {
+        const Vec3<float>& p = Position(*index);
+        boundsMin = Vec3<float>(Min(boundsMin.x, p.x), Min(boundsMin.y, p.y), Min(boundsMin.z, p.z));
+        boundsMax = Vec3<float>(Max(boundsMax.x, p.x), Max(boundsMax.y, p.y), Max(boundsMax.z, p.z));
+    }
+    
+    Vec3<float> center = (boundsMin + boundsMax) * .5f;
+    
+    float radiusSquared = 0.f;
+    for(const uint32* index = firstIndex; index < endIndex; ++index) radiusSquared = Max(radiusSquared, (Position(*index) - center).NormSquared());
+    
+    // the cone's axis is the average normal and it's wide enough to hold the normal furthest from it
+    Vec3<float> axis(0.f, 0.f, 0.f);
+    for(const uint32* index = firstIndex; index < endIndex; index+= 3) {
+        const Vec3<float> &v1 = Position(index[0]), &v2 = Position(index[1]), &v3 = Position(index[2]);
+        
+        Vec3<float> normal = (v2 - v1).Cross(v3 - v1);
+        float normalLength = normal.Norm();
+        if(normalLength > 0.f) axis+= normal / normalLength; //Note: degenerate triangles can't be seen from any side
+    }
+    
+    float axisLength = axis.Norm();
+    float minDot = axisLength > 0.f ? 1.f : -1.f;
+    if(axisLength > 0.f) {
+        axis/= axisLength;
+        
+        for(const uint32* index = firstIndex; index < endIndex; index+= 3) {
+            const Vec3<float> &v1 = Position(index[0]), &v2 = Position(index[1]), &v3 = Position(index[2]);
+            
+            Vec3<float> normal = (v2 - v1).Cross(v3 - v1);
+            float normalLength = normal.Norm();
+            if(normalLength > 0.f) minDot = Min(minDot, axis.Dot(normal) / normalLength);
+        }
+    }
+    
+    //Note: cones wider than a hemisphere face every way so they get a cutoff that never culls
+    return {
+        .indexOffset = 3*firstTriangle,
+        .indexCount  = 3*(endTriangle - firstTriangle),
+        .center      = { center.x, center.y, center.z },
+        .radius      = Sqrt(radiusSquared),
+        .coneAxis    = { axis.x, axis.y, axis.z },
+        .coneCutoff  = minDot > 0.f ? Sqrt(1.f - minDot*minDot) : 1.f,
+    };
+}
+
+// Splits the triangles into meshlets of consecutive triangles with at most 'maxVertices' unique vertices and 'maxTriangles'
+// triangles and pushes them onto 'meshlets'
+// Note: the triangle order is kept so the vertex cache and overdraw orders survive and a meshlet is a single range of indices.
+//       'positions' is read as a Vec3<float> at the start of each 'positionStride' sized vertex
+inline void BuildMeshlets(Memory::ArenaArray<Meshlet>* meshlets, const uint32* indices, uint32 indexCount, const void* positions, uint32 positionStride,
+                          uint32 vertexCount, Memory::Arena* scratchArena,
+                          uint32 maxVertices = kMeshletMaxVertices, uint32 maxTriangles = kMeshletMaxTriangles) {
+    
+    RUNTIME_ASSERT(maxVertices >= 3 && maxTriangles, "Meshlets can't hold a triangle { maxVertices: %u, maxTriangles: %u }", maxVertices, maxTriangles);
+    
+    uint32 numTriangles = indexCount/3;
+    
+    //Note: a triangle adds at most 3 vertices so every meshlet but the last holds at least Min(maxTriangles, maxVertices/3) triangles.
+    //      Reserving that many up front means 'meshlets' never grows so it can share an arena with the scratch memory
+    uint32 minTriangles = Min(maxTriangles, maxVertices/3);
+    meshlets->Reserve(meshlets->Count() + (numTriangles + minTriangles - 1)/minTriangles);
+    
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+    
+    //Note: a vertex is in the current meshlet when it's tagged with the meshlet's number
+    uint32* vertexTags = (uint32*)scratchArena->PushBytes(vertexCount*sizeof(uint32), false, alignof(uint32));
+    memset(vertexTags, 0xFF, vertexCount*sizeof(uint32));
+    
+    uint32 meshletStart = 0, meshletVertices = 0, meshletTag = 0;
+    
+    for(uint32 i = 0; i < numTriangles; ++i) {
+        uint32 a = indices[3*i], b = indices[3*i+1], c = indices[3*i+2];
+        
+        auto NewVertices = [&]() {
+            return uint32(vertexTags[a] != meshletTag) +
+                   uint32(vertexTags[b] != meshletTag && b != a) +
+                   uint32(vertexTags[c] != meshletTag && c != a && c != b);
+        };
+        
+        uint32 newVertices = NewVertices();
+        if(meshletVertices + newVertices > maxVertices || i - meshletStart == maxTriangles) {
+            *meshlets->Push() = ComputeMeshletBounds(indices, meshletStart, i, positions, positionStride);
+            
+            meshletStart = i;
+            meshletVertices = 0;
+            ++meshletTag;
+            
+            newVertices = NewVertices();
+        }
+        
+        vertexTags[a] = vertexTags[b] = vertexTags[c] = meshletTag;
+        meshletVertices+= newVertices;
+    }
+    
+    if(meshletStart < numTriangles) *meshlets->Push() = ComputeMeshletBounds(indices, meshletStart, numTriangles, positions, positionStride);
+    
+    scratchArena->FreeBaseRegion(tmpRegion);
+}
+
+// Planes around everything a matrix projects into clip space in the space it projects from. Ex. model space for an mvp matrix
+struct FrustumPlanes {
+    float planes[6][4]; //Note: normalized so dot(plane.xyz, p) + plane.w is the distance from the plane. Positive is inside
+};
+
+inline FrustumPlanes ComputeFrustumPlanes(const Mat4<float>& matrix) {
+    
+    //Note: a point is in clip space when -w <= x, y, z <= w so each plane is the w row plus or minus another row
+    FrustumPlanes frustum;
+    for(uint32 i = 0; i < 3; ++i) {
+        for(uint32 j = 0; j < 4; ++j) {
+            float wRow = matrix.components[j][3], row = matrix.components[j][i];
+            frustum.planes[2*i][j]   = wRow + row;
+            frustum.planes[2*i+1][j] = wRow - row;
+        }
+    }
+    
+    for(float* plane : frustum.planes) {
+        float norm = Sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+        if(norm > 0.f) for(uint32 j = 0; j < 4; ++j) plane[j]/= norm;
+    }
+    return frustum;
+}
+
+inline bool MeshletOutsideFrustum(const Meshlet& meshlet, const FrustumPlanes& frustum) {
+    for(const float* plane : frustum.planes) {
+        float distance = plane[0]*meshlet.center[0] + plane[1]*meshlet.center[1] + plane[2]*meshlet.center[2] + plane[3];
+        if(distance < -meshlet.radius) return true;
+    }
+    return false;
+}
+
+// Returns true if every triangle in 'meshlet' faces away from 'cameraPosition'
+// Note: 'cameraPosition' is in the same space as the meshlet, model space
+inline bool MeshletBackFacing(const Meshlet& meshlet, const Vec3<float>& cameraPosition) {
+    Vec3<float> direction(meshlet.center[0] - cameraPosition.x, meshlet.center[1] - cameraPosition.y, meshlet.center[2] - cameraPosition.z);
+    return direction.Dot(Vec3<float>(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2])) >=
+           meshlet.coneCutoff*direction.Norm() + meshlet.radius;
+}
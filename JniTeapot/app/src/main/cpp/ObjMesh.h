@@ -0,0 +1,1080 @@
+#pragma once
+
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__aarch64__)
+    #include <arm_neon.h>
+#elif defined(__SSE__)
+    #include <xmmintrin.h>
+#endif
+
+#include "util.h"
+#include "Memory.h"
+#include "MeshFile.h"
+#include "hashUtil.h"
+#include "MeshOptimizer.h"
+
+// An obj parsed into flat arrays that can be built into a mesh file (see MeshFile.h)
+// Note: doesn't touch GL so it can run on AssetLoader workers and in the host mesh converter
+class ObjMesh {
+    
+    public:
+        
+        struct Indices {
+            uint vertex;
+            uint uv;
+            uint normal;
+        };        
+        
+        //Note: the arrays share one arena. Parse counts every record before it pushes any so each parse grows
+        //      an array once to its exact size instead of reserving address space for the largest obj up front
+        Memory::Arena arena{0, Memory::kLargeGrowthPolicy};
+
+        Memory::ArenaArray<Vec3<float>> geoVerts{&arena};
+        Memory::ArenaArray<Vec3<float>> normalVerts{&arena};
+        Memory::ArenaArray<Vec2<float>> uvVerts{&arena};
+        
+        Memory::ArenaArray<Indices> indices{&arena};
+        
+        uint32 flags = 0; //MESH_FLAG_NORMAL and MESH_FLAG_UV if the obj provided them
+        
+        //Note: generated normals are smooth across edges sharper than this
+        static constexpr float kDefaultCreaseAngle = ToRadians(60.f);
+        
+        //Note: the lod chain stops at 'kMaxLodCount' lods or once the surface would move more than 'kMaxLodError' times the mesh's radius
+        static constexpr uint32 kMaxLodCount = 5;
+        static constexpr float kMaxLodError  = .05f;
+        
+        inline ObjMesh() { arena.SetTraceName("ObjMesh"); }
+        
+    private:
+        
+        //Note: faces written as 'v//vn' set MESH_FLAG_UV without any uvs
+        inline bool HasUvs() const { return (flags&MESH_FLAG_UV) && uvVerts.Count(); }
+        
+        //Note: welded vertices are hashed and compared bytewise so there can't be any padding
+        struct Vertex {
+            Vec3<float> position, normal;
+            Vec2<float> uv;
+        };
+        COMPILE_ASSERT(sizeof(Vertex) == 2*sizeof(Vec3<float>) + sizeof(Vec2<float>), "Vertex can't have padding");
+        
+        //Note: 4 floats that arithmetic works on lane by lane. Compiles to neon and sse registers
+        typedef float Float4 __attribute__((vector_size(16)));
+        typedef int32 Int4 __attribute__((vector_size(16))); //Note: comparing Float4s gives an Int4 with every bit of a true lane set
+        
+        static inline Float4 Sqrt(Float4 v) {
+            #if defined(__aarch64__)
+                return (Float4)vsqrtq_f32((float32x4_t)v);
+            #elif defined(__SSE__)
+                return (Float4)_mm_sqrt_ps((__m128)v);
+            #else
+                for(uint32 i = 0; i < 4; ++i) v[i] = ::Sqrt(v[i]);
+                return v;
+            #endif
+        }
+        
+        static inline Float4 LoadFloat4(const Vec3<float>& v) { return Float4{v.x, v.y, v.z, 0.f}; }
+        
+        // Transposes the xyz of 4 vectors into 'x', 'y' and 'z' lanes
+        static inline void Transpose(Float4 v0, Float4 v1, Float4 v2, Float4 v3, Float4* x, Float4* y, Float4* z) {
+            Float4 xy01 = __builtin_shufflevector(v0, v1, 0, 4, 1, 5),
+                   xy23 = __builtin_shufflevector(v2, v3, 0, 4, 1, 5),
+                   zw01 = __builtin_shufflevector(v0, v1, 2, 6, 3, 7),
+                   zw23 = __builtin_shufflevector(v2, v3, 2, 6, 3, 7);
+            
+            *x = __builtin_shufflevector(xy01, xy23, 0, 1, 4, 5);
+            *y = __builtin_shufflevector(xy01, xy23, 2, 3, 6, 7);
+            *z = __builtin_shufflevector(zw01, zw23, 0, 1, 4, 5);
+        }
+        
+        //Note: face normals are stored SoA so the simd kernel writes whole registers
+        struct FaceNormals {
+            float *x, *y, *z;
+            
+            inline Vec3<float> operator[](uint32 face) const { return Vec3<float>(x[face], y[face], z[face]); }
+        };
+        
+        // Computes the unit normals of faces ['firstFace', 'endFace')
+        // Note: 4 faces at a time - every lane gathers the corners of a different face. Degenerate faces get a 0 normal
+        //       so they don't add anything to the faces around them
+        static void ComputeFaceNormals(const Indices* index, const Vec3<float>* geoVertPtr, uint32 firstFace, uint32 endFace, const FaceNormals& faceNormals) {
+            
+            uint32 face = firstFace;
+            for(; face + 4 <= endFace; face+= 4) {
+                
+                const Indices* corner = index + 3*face;
+                
+                Float4 x[3], y[3], z[3];
+                for(uint32 i = 0; i < 3; ++i) {
+                    Transpose(LoadFloat4(geoVertPtr[corner[i].vertex]),   LoadFloat4(geoVertPtr[corner[3+i].vertex]),
+                              LoadFloat4(geoVertPtr[corner[6+i].vertex]), LoadFloat4(geoVertPtr[corner[9+i].vertex]),
+                              x+i, y+i, z+i);
+                }
+                
+                Float4 e1x = x[1] - x[0], e1y = y[1] - y[0], e1z = z[1] - z[0],
+                       e2x = x[2] - x[0], e2y = y[2] - y[0], e2z = z[2] - z[0];
+                
+                Float4 nx = e1y*e2z - e1z*e2y,
+                       ny = e1z*e2x - e1x*e2z,
+                       nz = e1x*e2y - e1y*e2x;
+                
+                //Note: a degenerate face's normal is 0 so the smallest float keeps it from turning into 0/0
+                Float4 scale = 1.f / (Sqrt(nx*nx + ny*ny + nz*nz) + __FLT_MIN__);
+                nx*= scale;
+                ny*= scale;
+                nz*= scale;
+                
+                //Note: face arrays aren't 16 byte aligned at every 'face'
+                memcpy(faceNormals.x + face, &nx, sizeof(nx));
+                memcpy(faceNormals.y + face, &ny, sizeof(ny));
+                memcpy(faceNormals.z + face, &nz, sizeof(nz));
+            }
+            
+            for(; face < endFace; ++face) {
+                const Indices* corner = index + 3*face;
+                
+                //Warn: Vec3 overloads unary '&' so use pointer arithmetic
+                const Vec3<float> *v1 = geoVertPtr + corner[0].vertex,
+                                  *v2 = geoVertPtr + corner[1].vertex,
+                                  *v3 = geoVertPtr + corner[2].vertex;
+                
+                Vec3<float> normal = (*v2 - *v1).Cross(*v3 - *v1);
+                normal/= normal.Norm() + __FLT_MIN__;
+                
+                faceNormals.x[face] = normal.x;
+                faceNormals.y[face] = normal.y;
+                faceNormals.z[face] = normal.z;
+            }
+        }
+        
+        // Work for one thread of GenerateNormals. Every phase splits its own range of faces, positions or corners between the chunks
+        struct NormalChunk {
+            const ObjMesh* mesh;
+            uint32 chunkIndex, chunkCount;
+            
+            uint32 firstFace, endFace;
+            uint32 firstVert, endVert;
+            uint32 firstCorner, endCorner;
+            
+            FaceNormals faceNormals;
+            Vec3<float>* cornerNormals;
+            Vec3<float>* vertNormals; //Note: 'chunkCount' partial sums of 'numVerts' normals. The first one gets the total
+            
+            //Note: set when normals are creased, see GenerateNormals
+            const uint32 *cornerListStart, *cornerList;
+            const Vec3<float>* cornerListNormals;
+            float minCos;
+        };
+        
+        static void* FaceNormalsThread(void* chunkPtr) {
+            NormalChunk* chunk = (NormalChunk*)chunkPtr;
+            ComputeFaceNormals(chunk->mesh->indices.Data(), chunk->mesh->geoVerts.Data(), chunk->firstFace, chunk->endFace, chunk->faceNormals);
+            return nullptr;
+        }
+        
+        // computes the chunk's face normals and adds them to its partial sum of the normals around every position
+        static void* AccumulateNormalsThread(void* chunkPtr) {
+            NormalChunk* chunk = (NormalChunk*)chunkPtr;
+            FaceNormalsThread(chunk);
+            
+            const Indices* index = chunk->mesh->indices.Data();
+            Vec3<float>* vertNormals = chunk->vertNormals + chunk->chunkIndex*chunk->mesh->geoVerts.Count();
+            
+            for(uint32 i = 3*chunk->firstFace; i < 3*chunk->endFace; ++i) vertNormals[index[i].vertex]+= chunk->faceNormals[i/3];
+            return nullptr;
+        }
+        
+        // sums the partial normals of the chunk's positions into the first partial and normalizes them
+        static void* ReduceNormalsThread(void* chunkPtr) {
+            NormalChunk* chunk = (NormalChunk*)chunkPtr;
+            uint32 numVerts = chunk->mesh->geoVerts.Count();
+            
+            for(uint32 i = chunk->firstVert; i < chunk->endVert; ++i) {
+                Vec3<float> normal = chunk->vertNormals[i];
+                for(uint32 j = 1; j < chunk->chunkCount; ++j) normal+= chunk->vertNormals[j*numVerts + i];
+                
+                chunk->vertNormals[i] = normal / (normal.Norm() + __FLT_MIN__);
+            }
+            return nullptr;
+        }
+        
+        static void* SmoothCornerNormalsThread(void* chunkPtr) {
+            NormalChunk* chunk = (NormalChunk*)chunkPtr;
+            const Indices* index = chunk->mesh->indices.Data();
+            
+            for(uint32 i = chunk->firstCorner; i < chunk->endCorner; ++i) chunk->cornerNormals[i] = chunk->vertNormals[index[i].vertex];
+            return nullptr;
+        }
+        
+        // averages the faces that are within the crease angle of each corner's face
+        // Note: goes a position at a time so the normals of the faces around it are read from one contiguous run.
+        //       4 corners of a position are averaged at a time - every lane tests the same adjacent face against a different corner
+        static void* CreasedCornerNormalsThread(void* chunkPtr) {
+            NormalChunk* chunk = (NormalChunk*)chunkPtr;
+            
+            for(uint32 vertex = chunk->firstVert; vertex < chunk->endVert; ++vertex) {
+                
+                uint32 listStart = chunk->cornerListStart[vertex],
+                       listCount = chunk->cornerListStart[vertex+1] - listStart;
+                
+                const Vec3<float>* adjacentNormals = chunk->cornerListNormals + listStart;
+                for(uint32 i = 0; i < listCount; i+= 4) {
+                    
+                    //Note: lanes past the end of the list repeat its last corner and aren't written
+                    uint32 lastCorner = listCount-1;
+                    Float4 faceX, faceY, faceZ;
+                    Transpose(LoadFloat4(adjacentNormals[i]),                      LoadFloat4(adjacentNormals[Min(i+1, lastCorner)]),
+                              LoadFloat4(adjacentNormals[Min(i+2, lastCorner)]),   LoadFloat4(adjacentNormals[Min(i+3, lastCorner)]),
+                              &faceX, &faceY, &faceZ);
+                    
+                    Float4 x = {}, y = {}, z = {};
+                    for(uint32 j = 0; j < listCount; ++j) {
+                        const Vec3<float>& adjacentNormal = adjacentNormals[j];
+                        
+                        Int4 keep = (faceX*adjacentNormal.x + faceY*adjacentNormal.y + faceZ*adjacentNormal.z) >= chunk->minCos;
+                        x+= (Float4)(keep & (Int4)(Float4{} + adjacentNormal.x));
+                        y+= (Float4)(keep & (Int4)(Float4{} + adjacentNormal.y));
+                        z+= (Float4)(keep & (Int4)(Float4{} + adjacentNormal.z));
+                    }
+                    
+                    Float4 scale = 1.f / (Sqrt(x*x + y*y + z*z) + __FLT_MIN__);
+                    x*= scale;
+                    y*= scale;
+                    z*= scale;
+                    
+                    for(uint32 lane = 0; lane < Min(4u, listCount - i); ++lane) {
+                        chunk->cornerNormals[chunk->cornerList[listStart + i + lane]] = Vec3<float>(x[lane], y[lane], z[lane]);
+                    }
+                }
+            }
+            return nullptr;
+        }
+        
+    public:
+        
+        // Computes a normal for every face corner by averaging the unit normals of the faces around the corner's position
+        // Note: faces more than 'creaseAngle' away from the corner's face are left out so hard edges stay hard.
+        //       Every face counts the same rather than by its angle or area at the corner so normals (and the meshes
+        //       and cache entries built from them) stay identical to the ones the app generated before.
+        //       Large meshes are split between up to 'maxThreads' threads. Smooth normals are summed into a buffer per thread
+        //       which are added together at the end so results can differ from a single thread by float rounding.
+        //       Corners that only touch degenerate faces get a 0 normal
+        void GenerateNormals(float creaseAngle, Vec3<float>* cornerNormals, Memory::Arena* scratchArena, uint32 maxThreads = DefaultParseThreadCount()) const {
+            
+            uint32 numCorners = indices.Count(),
+                   numFaces = numCorners/3,
+                   numVerts = geoVerts.Count();
+            
+            const Indices* index = indices.Data();
+            
+            bool creased = creaseAngle < Pi();
+            uint32 minChunkFaces = creased ? kMinCreasedNormalChunkFaces : kMinNormalChunkFaces;
+            uint32 chunkCount = Max(uint32(1), Min(Min(maxThreads, kMaxParseThreads), numFaces / minChunkFaces));
+            
+            Memory::Region tmpRegion = scratchArena->CreateRegion();
+            
+            FaceNormals faceNormals = {
+                .x = (float*)scratchArena->PushBytes(numFaces*sizeof(float), false, alignof(Float4)),
+                .y = (float*)scratchArena->PushBytes(numFaces*sizeof(float), false, alignof(Float4)),
+                .z = (float*)scratchArena->PushBytes(numFaces*sizeof(float), false, alignof(Float4)),
+            };
+            
+            //Note: creased normals don't sum around positions so they don't need the partial sums
+            Vec3<float>* vertNormals = creased ? nullptr :
+                                       (Vec3<float>*)scratchArena->PushBytes(chunkCount*numVerts*sizeof(Vec3<float>), true, alignof(Vec3<float>));
+            
+            //Note: every phase splits its range evenly between the chunks
+            NormalChunk chunks[kMaxParseThreads];
+            for(uint32 i = 0; i < chunkCount; ++i) {
+                chunks[i] = {
+                    .mesh = this,
+                    .chunkIndex = i,
+                    .chunkCount = chunkCount,
+                    .firstFace = uint32(uint64(numFaces)*i/chunkCount),
+                    .endFace = uint32(uint64(numFaces)*(i+1)/chunkCount),
+                    .firstVert = uint32(uint64(numVerts)*i/chunkCount),
+                    .endVert = uint32(uint64(numVerts)*(i+1)/chunkCount),
+                    .firstCorner = 3*uint32(uint64(numFaces)*i/chunkCount),
+                    .endCorner = 3*uint32(uint64(numFaces)*(i+1)/chunkCount),
+                    .faceNormals = faceNormals,
+                    .cornerNormals = cornerNormals,
+                    .vertNormals = vertNormals,
+                };
+            }
+            
+            if(!creased) {
+                
+                //Note: nothing is creased so every corner of a position gets the same smooth normal
+                RunChunks(chunks, chunkCount, AccumulateNormalsThread);
+                RunChunks(chunks, chunkCount, ReduceNormalsThread);
+                RunChunks(chunks, chunkCount, SmoothCornerNormalsThread);
+                
+            } else {
+                
+                RunChunks(chunks, chunkCount, FaceNormalsThread);
+                
+                // bucket the corners around every position along with a copy of their face's normal
+                // Note: cornerListStart[v] is where the corners that use position v start in cornerList and cornerListNormals.
+                //       Copying the normals costs a pass over the corners but saves a gather from 3 face arrays for every
+                //       pair of faces around a position
+                uint32* cornerListStart = (uint32*)scratchArena->PushBytes((numVerts+1)*sizeof(uint32), true, alignof(uint32));
+                for(uint32 i = 0; i < numCorners; ++i) ++cornerListStart[index[i].vertex + 1];
+                for(uint32 i = 0; i < numVerts; ++i)   cornerListStart[i+1]+= cornerListStart[i];
+                
+                uint32* cornerListEnd = (uint32*)scratchArena->PushBytes(numVerts*sizeof(uint32), false, alignof(uint32));
+                memcpy(cornerListEnd, cornerListStart, numVerts*sizeof(uint32));
+                
+                uint32* cornerList = (uint32*)scratchArena->PushBytes(numCorners*sizeof(uint32), false, alignof(uint32));
+                Vec3<float>* cornerListNormals = (Vec3<float>*)scratchArena->PushBytes(numCorners*sizeof(Vec3<float>), false, alignof(Vec3<float>));
+                for(uint32 i = 0; i < numCorners; ++i) {
+                    uint32 listIndex = cornerListEnd[index[i].vertex]++;
+                    cornerList[listIndex] = i;
+                    cornerListNormals[listIndex] = faceNormals[i/3];
+                }
+                
+                float minCos = FastCos(creaseAngle);
+                for(uint32 i = 0; i < chunkCount; ++i) {
+                    chunks[i].cornerListStart = cornerListStart;
+                    chunks[i].cornerList = cornerList;
+                    chunks[i].cornerListNormals = cornerListNormals;
+                    chunks[i].minCos = minCos;
+                }
+                
+                RunChunks(chunks, chunkCount, CreasedCornerNormalsThread);
+            }
+            
+            scratchArena->FreeBaseRegion(tmpRegion);
+        }
+        
+    private:
+        
+        // Points every face corner at the first geoVert with its position
+        // Note: objs exported per part write shared positions out more than once. Merging them lets normals smooth across
+        //       the copies and lets edges between parts be found when checking for holes or simplifying
+        void MergeDuplicatePositions(Memory::Arena* scratchArena) {
+            
+            constexpr uint32 kEmptySlot = ~uint32(0);
+            
+            uint32 numVerts = geoVerts.Count();
+            const Vec3<float>* geoVertPtr = geoVerts.Data();
+            
+            //Note: open addressing with linear probing like Weld
+            uint32 numSlots = Pow2RoundUp(Max(2*numVerts, uint32(16)));
+            uint32 slotMask = numSlots - 1;
+            
+            Memory::Region tmpRegion = scratchArena->CreateRegion();
+            uint32* slots = (uint32*)scratchArena->PushBytes(numSlots*sizeof(uint32), false, alignof(uint32));
+            memset(slots, 0xFF, numSlots*sizeof(uint32));
+            
+            uint32* positionRemap = (uint32*)scratchArena->PushBytes(numVerts*sizeof(uint32), false, alignof(uint32));
+            for(uint32 i = 0; i < numVerts; ++i) {
+                
+                //Warn: Vec3 overloads unary '&' so use pointer arithmetic
+                const Vec3<float>* position = geoVertPtr + i;
+                for(uint32 slot = Hash64(position, sizeof(Vec3<float>)) & slotMask;; slot = (slot+1) & slotMask) {
+                    
+                    uint32 vertex = slots[slot];
+                    if(vertex == kEmptySlot) vertex = slots[slot] = i;
+                    else if(memcmp(geoVertPtr + vertex, position, sizeof(Vec3<float>))) continue;
+                    
+                    positionRemap[i] = vertex;
+                    break;
+                }
+            }
+            
+            for(Indices& corner : indices) corner.vertex = positionRemap[corner.vertex];
+            
+            scratchArena->FreeBaseRegion(tmpRegion);
+        }
+        
+        // Welds face corners that have identical vertices together
+        // 'vertices' gets the unique vertices in the order they're first used and 'remap' gets the vertex of every corner.
+        // Returns the number of unique vertices
+        uint32 Weld(const Vec3<float>* cornerNormals, Vertex* vertices, uint32* remap, Memory::Arena* scratchArena) {
+            
+            constexpr uint32 kEmptySlot = ~uint32(0);
+            
+            uint32 numCorners = indices.Count();
+            const Indices* index = indices.Data();
+            
+            const Vec3<float>* geoVertPtr = geoVerts.Data();
+            const Vec2<float>* uvVertPtr = uvVerts.Data();
+            bool hasUvs = HasUvs();
+            
+            //Note: open addressing with linear probing. At most half full so probes stay short
+            uint32 numSlots = Pow2RoundUp(Max(2*numCorners, uint32(16)));
+            uint32 slotMask = numSlots - 1;
+            
+            Memory::Region tmpRegion = scratchArena->CreateRegion();
+            uint32* slots = (uint32*)scratchArena->PushBytes(numSlots*sizeof(uint32), false, alignof(uint32));
+            memset(slots, 0xFF, numSlots*sizeof(uint32));
+            
+            uint32 numVertices = 0;
+            for(uint32 i = 0; i < numCorners; ++i) {
+                
+                const Indices& corner = index[i];
+                Vertex vertex = {
+                    .position = geoVertPtr[corner.vertex],
+                    .normal = cornerNormals[i],
+                    .uv = hasUvs ? uvVertPtr[corner.uv] : Vec2<float>(0.f, 0.f),
+                };
+                
+                for(uint32 slot = Hash64(&vertex, sizeof(vertex)) & slotMask;; slot = (slot+1) & slotMask) {
+                    
+                    uint32 vertexIndex = slots[slot];
+                    if(vertexIndex == kEmptySlot) {
+                        vertexIndex = slots[slot] = numVertices++;
+                        vertices[vertexIndex] = vertex;
+                    
+                    } else if(memcmp(vertices + vertexIndex, &vertex, sizeof(vertex))) continue;
+                    
+                    remap[i] = vertexIndex;
+                    break;
+                }
+            }
+            
+            scratchArena->FreeBaseRegion(tmpRegion);
+            return numVertices;
+        }
+        
+        // Returns true if every edge is shared with a face that winds it the other way so only the outside can be seen
+        // Note: edges are matched by obj position index. Positions written out twice split the surface so it's
+        //       conservatively reported as open
+        bool IsClosed(Memory::Arena* scratchArena) const {
+            
+            constexpr uint64 kEmptySlot = ~uint64(0);
+            
+            uint32 numCorners = indices.Count();
+            const Indices* index = indices.Data();
+            
+            //Note: open addressing with linear probing like Weld. Keys are directed edges (from<<32 | to)
+            uint32 numSlots = Pow2RoundUp(Max(2*numCorners, uint32(16)));
+            uint32 slotMask = numSlots - 1;
+            
+            Memory::Region tmpRegion = scratchArena->CreateRegion();
+            uint64* slots = (uint64*)scratchArena->PushBytes(numSlots*sizeof(uint64), false, alignof(uint64));
+            memset(slots, 0xFF, numSlots*sizeof(uint64));
+            
+            auto Edge = [&](uint32 corner) {
+                uint32 next = corner%3 == 2 ? corner - 2 : corner + 1;
+                return (uint64(index[corner].vertex) << 32) | index[next].vertex;
+            };
+            
+            auto FindSlot = [&](uint64 edge) {
+                uint32 slot = Hash64(&edge, sizeof(edge)) & slotMask;
+                while(slots[slot] != kEmptySlot && slots[slot] != edge) slot = (slot+1) & slotMask;
+                return slot;
+            };
+            
+            for(uint32 i = 0; i < numCorners; ++i) {
+                uint64 edge = Edge(i);
+                slots[FindSlot(edge)] = edge;
+            }
+            
+            bool closed = numCorners;
+            for(uint32 i = 0; i < numCorners && closed; ++i) {
+                uint64 edge = Edge(i);
+                uint64 reverseEdge = (edge << 32) | (edge >> 32);
+                closed = slots[FindSlot(reverseEdge)] == reverseEdge;
+            }
+            
+            scratchArena->FreeBaseRegion(tmpRegion);
+            return closed;
+        }
+        
+        template<typename ElementT>
+        MeshFileView Interleave(Memory::Arena* arena, const Vertex* vertices, uint32 numVerts, const uint32* lodIndices, uint32 numIndices,
+                                const Memory::ArenaArray<Meshlet>& meshlets, const MeshLod* lods, uint32 lodCount, uint32 meshFlags,
+                                const MeshVertexFormat& format) {
+    
+            bool hasUvs = HasUvs();
+
+            // lay out the vbo
+            // Note: vbo always contain geoVerts & normals (we compute them if not provided). UV is optional.
+            //       Normals stored in 2 snorm16s are octahedral encoded, packed normals take up all 4 components of their uint32.
+            //       Attributes start on 4 byte boundaries so they're never fetched unaligned
+            uint32 normalComponents = format.normal == MESH_COMPONENT_SNORM16          ? 2 :
+                                      format.normal == MESH_COMPONENT_SNORM_10_10_10_2 ? 4 : 3;
+            
+            MeshAttribute attributes[] = {
+                { .type = MESH_ATTRIBUTE_POSITION, .componentType = format.position, .componentCount = 3 },
+                { .type = MESH_ATTRIBUTE_NORMAL,   .componentType = format.normal,   .componentCount = normalComponents },
+                { .type = MESH_ATTRIBUTE_UV,       .componentType = format.uv,       .componentCount = 2 },
+            };
+            uint32 attributeCount = hasUvs ? 3 : 2;
+            
+            uint32 vboStride = 0;
+            for(uint32 i = 0; i < attributeCount; ++i) {
+                uint32 attributeBytes = MeshAttributeBytes(attributes[i].componentType, attributes[i].componentCount);
+                RUNTIME_ASSERT(attributeBytes, "Unsupported vertex format { attributeType: %u, componentType: %u }",
+                               attributes[i].type, attributes[i].componentType);
+                
+                attributes[i].offset = vboStride;
+                vboStride+= (attributeBytes + 3) & ~3u;
+            }
+            
+            // allocate the mesh file
+            //Note: the file is zeroed so padding is deterministic in the cache
+            uint32 meshletCount = meshlets.Count();
+            uint32 vertexBytes = numVerts*vboStride,
+                   indexBytes = numIndices*sizeof(ElementT);
+            
+            MeshFileLayout layout = ComputeMeshFileLayout(attributeCount, vertexBytes, indexBytes, meshletCount, lodCount);
+            void* file = arena->PushBytes(layout.bytes, true, kMeshFileAlignment);
+            
+            MeshFileHeader* header = (MeshFileHeader*)file;
+            *header = {
+                .magic = kMeshFileMagic,
+                .version = kMeshFileVersion,
+                .flags = hasUvs ? meshFlags : meshFlags & ~MESH_FLAG_UV,
+                .attributeCount = attributeCount,
+                .vertexCount = numVerts,
+                .vertexStride = vboStride,
+                .indexCount = numIndices,
+                .indexStride = sizeof(ElementT),
+                .meshletCount = meshletCount,
+                .lodCount = lodCount,
+                .vertexBytes = vertexBytes,
+                .indexBytes = indexBytes,
+                .vertexOffset = layout.vertexOffset,
+                .indexOffset = layout.indexOffset,
+                .meshletOffset = layout.meshletOffset,
+                .lodOffset = layout.lodOffset,
+            };
+            memcpy(ByteOffset(file, sizeof(MeshFileHeader)), attributes, attributeCount*sizeof(MeshAttribute));
+            
+            // compute the bounds
+            //Note: quantized positions are relative to them so they have to come first
+            Vec3<float> boundsMin(0.f, 0.f, 0.f), boundsMax(0.f, 0.f, 0.f);
+            if(numVerts) boundsMin = boundsMax = vertices[0].position;
+            for(uint32 i = 0; i < numVerts; ++i) {
+                const Vec3<float>& v = vertices[i].position;
+                boundsMin = Vec3(Min(boundsMin.x, v.x), Min(boundsMin.y, v.y), Min(boundsMin.z, v.z));
+                boundsMax = Vec3(Max(boundsMax.x, v.x), Max(boundsMax.y, v.y), Max(boundsMax.z, v.z));
+            }
+            memcpy(header->boundsMin, &boundsMin.x, sizeof(header->boundsMin));
+            memcpy(header->boundsMax, &boundsMax.x, sizeof(header->boundsMax));
+            
+            MeshPositionTransform positionTransform = ComputeMeshPositionTransform(*header, attributes[0]);
+            
+            // interleave vertices
+            void* vbo = ByteOffset(file, layout.vertexOffset);
+            for(uint32 i = 0; i < numVerts; ++i) {
+                const Vertex& vertex = vertices[i];
+                
+                float position[3];
+                for(uint32 j = 0; j < 3; ++j) {
+                    float scale = positionTransform.scale.component[j];
+                    position[j] = scale ? (vertex.position.component[j] - positionTransform.offset.component[j]) / scale : 0.f;
+                }
+                
+                float normal[4] = { vertex.normal.x, vertex.normal.y, vertex.normal.z, 0.f };
+                if(normalComponents == 2) {
+                    Vec2<float> octahedral = OctahedralEncode(vertex.normal);
+                    normal[0] = octahedral.x;
+                    normal[1] = octahedral.y;
+                }
+                
+                const float* values[] = { position, normal, vertex.uv.component };
+                for(uint32 j = 0; j < attributeCount; ++j) {
+                    const MeshAttribute& attribute = attributes[j];
+                    EncodeMeshComponents(attribute.componentType, values[j], attribute.componentCount, ByteOffset(vbo, i*vboStride + attribute.offset));
+                }
+            }
+            
+            if(format.position != MESH_COMPONENT_FLOAT32 || format.normal != MESH_COMPONENT_FLOAT32 || (hasUvs && format.uv != MESH_COMPONENT_FLOAT32)) {
+                LogQuantizationError(*header, attributes, vertices);
+            }
+            
+            ElementT* elements = (ElementT*)ByteOffset(file, layout.indexOffset);
+            for(uint32 i = 0; i < numIndices; ++i) elements[i] = ElementT(lodIndices[i]);
+            
+            Meshlet* fileMeshlets = (Meshlet*)ByteOffset(file, layout.meshletOffset);
+            for(uint32 i = 0; i < meshletCount; ++i) fileMeshlets[i] = meshlets[i];
+            
+            memcpy(ByteOffset(file, layout.lodOffset), lods, lodCount*sizeof(MeshLod));
+            
+            MeshFileView view;
+            RUNTIME_ASSERT(ReadMeshFile(file, layout.bytes, &view), "Built an invalid mesh file { numVerts: %u, numIndices: %u }", numVerts, numIndices);
+            return view;
+        }
+        
+        // Decodes the vbo the way the vertex shader does and logs the furthest it strays from the unquantized 'vertices'
+        static void LogQuantizationError(const MeshFileHeader& header, const MeshAttribute* attributes, const Vertex* vertices) {
+            
+            MeshPositionTransform positionTransform = ComputeMeshPositionTransform(header, attributes[0]);
+            
+            float maxPositionError = 0.f, minNormalCos = 1.f, maxUvError = 0.f;
+            
+            const void* vbo = ByteOffset(&header, header.vertexOffset);
+            for(uint32 i = 0; i < header.vertexCount; ++i) {
+                const Vertex& vertex = vertices[i];
+                const void* vboVertex = ByteOffset(vbo, i*header.vertexStride);
+                
+                float values[4];
+                DecodeMeshComponents(attributes[0].componentType, ByteOffset(vboVertex, attributes[0].offset), 3, values);
+                for(uint32 j = 0; j < 3; ++j) {
+                    float position = positionTransform.offset.component[j] + positionTransform.scale.component[j]*values[j];
+                    maxPositionError = Max(maxPositionError, FastAbs(position - vertex.position.component[j]));
+                }
+                
+                DecodeMeshComponents(attributes[1].componentType, ByteOffset(vboVertex, attributes[1].offset), attributes[1].componentCount, values);
+                Vec3<float> normal = attributes[1].componentCount == 2 ? OctahedralDecode(Vec2<float>(values[0], values[1])) :
+                                                                         Vec3<float>(values[0], values[1], values[2]);
+                
+                //Note: degenerate triangles can leave a vertex without a normal
+                float normalNorm = normal.Norm();
+                if(normalNorm > 0.f && vertex.normal.Norm() > 0.f) minNormalCos = Min(minNormalCos, normal.Dot(vertex.normal) / (normalNorm * vertex.normal.Norm()));
+                
+                if(header.attributeCount > 2) {
+                    DecodeMeshComponents(attributes[2].componentType, ByteOffset(vboVertex, attributes[2].offset), 2, values);
+                    maxUvError = Max(maxUvError, FastAbs(values[0] - vertex.uv.x), FastAbs(values[1] - vertex.uv.y));
+                }
+            }
+            
+            float boundsSize = Max(header.boundsMax[0] - header.boundsMin[0], header.boundsMax[1] - header.boundsMin[1], header.boundsMax[2] - header.boundsMin[2]);
+            float maxNormalErrorDegrees = ToDegrees(__builtin_acosf(Max(-1.f, Min(1.f, minNormalCos))));
+            
+            Log("Quantized vertices { vertexStride: %u -> %u bytes, maxPositionError: %g (%g of bounds), maxNormalError: %g degrees, maxUvError: %g }",
+                header.attributeCount > 2 ? uint32(sizeof(Vertex)) : uint32(offsetof(Vertex, uv)), header.vertexStride,
+                maxPositionError, boundsSize > 0.f ? maxPositionError/boundsSize : 0.f, maxNormalErrorDegrees, maxUvError);
+        }
+        
+        struct RecordCounts {
+            uint32 geoVerts, uvVerts, normalVerts, faces;
+        };
+        
+        // A range of whole lines parsed by one thread
+        // Note: the first pass counts each chunk's records so every chunk knows where its records go in the arrays and
+        //       how many vertices came before it. That's all relative (negative) face indices need to be resolved in the
+        //       second pass exactly like the serial parser would resolve them
+        struct ParseChunk {
+            ObjMesh* mesh;
+            const char *start, *end, *bufferEnd;
+            
+            RecordCounts base;   //Note: records before this chunk
+            RecordCounts counts; //Note: records in this chunk
+            
+            uint32 flags;
+            bool terminated; //Note: the chunk hit a null terminator so parsing stops there
+        };
+        
+        static constexpr uint32 kMaxParseThreads = 8;
+        //Note: objs parse at ~2.5ns a byte so a 64KB chunk is ~160us of work, 10x what creating and joining its threads for both passes costs
+        static constexpr uint32 kMinParseChunkBytes = KB(64);
+        //Note: every extra chunk of smooth normals costs ~50us for its threads and partial sums and smooth normals take ~12ns a face.
+        //      Creased normals take ~40ns a face and an extra chunk only costs ~17us, so they're worth splitting much sooner
+        static constexpr uint32 kMinNormalChunkFaces        = 1<<15;
+        static constexpr uint32 kMinCreasedNormalChunkFaces = 1<<12;
+        
+        // Loops over each record that starts in [start, end). Records can read up to 'bufferEnd'
+        // Note: calls 'parseRecord(char* ptr, char c)' with the line's first character which returns where parsing stopped.
+        //       Returns false if a null terminator ended the loop early
+        template<typename ParseRecordT>
+        static bool ForEachRecord(const char* start, const char* end, const char* bufferEnd, ParseRecordT parseRecord) {
+            
+            //Note: parsers never write to the buffer, they just take char* so they can hand back where they stopped 
+            char* ptr = (char*)start;
+            for(;;) {
+                ptr = SkipWhiteSpace(ptr, bufferEnd);
+                if(ptr >= end) return true;
+                
+                char c = *ptr;
+                
+                //eof - Finish processing and return
+                if(!c) return false;
+                
+                ptr = parseRecord(ptr, c);
+
+                //advance to next line
+                ptr = SkipLine(ptr, bufferEnd);
+            }
+        }
+        
+        static RecordCounts CountRecords(ParseChunk* chunk) {
+            
+            RecordCounts counts = {};
+            bool finished = ForEachRecord(chunk->start, chunk->end, chunk->bufferEnd, [&](char* ptr, char c) {
+                switch(c) {
+                    case 'v': {
+                        char mode = StrPeek(ptr+1, chunk->bufferEnd);
+                             if(mode == ' ' || mode == '\t') ++counts.geoVerts;
+                        else if(mode == 't')                 ++counts.uvVerts;
+                        else if(mode == 'n')                 ++counts.normalVerts;
+                    } break;
+                    
+                    case 'f': ++counts.faces;
+                    break;
+                }
+                return ptr;
+            });
+            
+            chunk->terminated = !finished;
+            return counts;
+        }
+        
+        static char* LoadVertex(char* strPtr, const char* bufferEnd, ParseChunk* chunk, RecordCounts* parsed) {
+            
+            ObjMesh* mesh = chunk->mesh;
+            RecordCounts recordEnd = {
+                .geoVerts    = chunk->base.geoVerts    + chunk->counts.geoVerts,
+                .uvVerts     = chunk->base.uvVerts     + chunk->counts.uvVerts,
+                .normalVerts = chunk->base.normalVerts + chunk->counts.normalVerts,
+            };
+            
+            //Note: only fails if a malformed record ran onto the next line so the counts are off
+            auto assertInChunk = [](uint32 count, uint32 end) {
+                RUNTIME_ASSERT(count < end, "Malformed obj - vertex record spans multiple lines { count: %u, end: %u }", count, end);
+            };
+            
+            char mode = StrPeek(++strPtr, bufferEnd);
+            switch(mode) {
+        
+                //geometry vertex
+                case ' ':
+                case '\t': {
+                    assertInChunk(parsed->geoVerts, recordEnd.geoVerts);
+                    
+                    Vec3<float>* v = mesh->geoVerts.Data() + parsed->geoVerts++;
+                    v->x = StrToFloat(++strPtr, &strPtr, bufferEnd);
+                    v->y = StrToFloat(++strPtr, &strPtr, bufferEnd);
+                    v->z = StrToFloat(++strPtr, &strPtr, bufferEnd);
+            
+                } break;
+            
+                //texture vertex
+                case 't': {
+                    assertInChunk(parsed->uvVerts, recordEnd.uvVerts);
+                    
+                    Vec2<float>* v = mesh->uvVerts.Data() + parsed->uvVerts++;
+                    v->x = StrToFloat(++strPtr, &strPtr, bufferEnd);
+                    v->y = StrToFloat(++strPtr, &strPtr, bufferEnd);
+            
+                } break;
+
+                //normal vertex
+                case 'n': {
+                    assertInChunk(parsed->normalVerts, recordEnd.normalVerts);
+                    
+                    Vec3<float>* v = mesh->normalVerts.Data() + parsed->normalVerts++;
+                    v->x = StrToFloat(++strPtr, &strPtr, bufferEnd);
+                    v->y = StrToFloat(++strPtr, &strPtr, bufferEnd);
+                    v->z = StrToFloat(++strPtr, &strPtr, bufferEnd);
+            
+                } break;
+        
+                default: {
+                    Panic("Unsupported Vertex mode: %d[%c]", mode, mode);
+                }
+            }
+            return strPtr;
+        }
+        
+        // Note: relative indices are resolved against 'parsed' - the number of vertices before this face in the whole obj 
+        static char* LoadFace(char* strPtr, const char* bufferEnd, ParseChunk* chunk, RecordCounts* parsed) {
+            
+            auto assertValidVertexCount = [](int32 vertexCount) {
+                RUNTIME_ASSERT(vertexCount >= 0, "Overflowed maximum allowed number of vertices [%d]", MaxInt32());
+            };
+
+            int32 numGeoVerts    = parsed->geoVerts;
+            int32 numUvVerts     = parsed->uvVerts;
+            int32 numNormalVerts = parsed->normalVerts;
+
+            assertValidVertexCount(numGeoVerts);
+            assertValidVertexCount(numUvVerts);
+            assertValidVertexCount(numNormalVerts);
+            
+            RUNTIME_ASSERT(parsed->faces < chunk->base.faces + chunk->counts.faces,
+                           "Malformed obj - face record spans multiple lines { faces: %u }", parsed->faces);
+            Indices* indiciesArray = chunk->mesh->indices.Data() + 3*parsed->faces++;
+
+            // TODO: Right now we only support triangles, but obj files can have arbitrary number of vertices in polygon
+            //       at least throw a warning/error if we are truncating the polygon to just its first triangle 
+            for(int i = 0; i < 3; ++i) {
+
+                Indices& indicies = indiciesArray[i];
+                indicies = {};
+
+                // TODO: Pull out this code duplication into function
+
+                //get vertIndex
+                {
+                    int geoIndex = StrToInt(++strPtr, &strPtr, bufferEnd);
+                    indicies.vertex = (geoIndex <= 0) ? geoIndex + numGeoVerts : geoIndex - 1;
+                    RUNTIME_ASSERT(indicies.vertex < numGeoVerts, "Geometry vertex not defined { geoIndex: %d, numGeoVerts: %d }", geoIndex, numGeoVerts);
+                }
+ 
+                if(StrPeek(strPtr, bufferEnd) != '/') continue;
+
+                //get uvIndex
+                {
+                    chunk->flags|= MESH_FLAG_UV;
+            
+                    int uvIndex = StrToInt(++strPtr, &strPtr, bufferEnd);
+                    indicies.uv = (uvIndex <= 0) ? uvIndex + numUvVerts : uvIndex - 1; 
+                    RUNTIME_ASSERT(indicies.uv == 0 || indicies.uv < numUvVerts, "UV vertex not defined { uvIndex: %d, numUvVerts: %d }", uvIndex, numUvVerts);
+                }
+        
+                if(StrPeek(strPtr, bufferEnd) != '/') continue; 
+ 
+                //get normalIndex
+                {
+                    chunk->flags|= MESH_FLAG_NORMAL;
+            
+                    int normalIndex = StrToInt(++strPtr, &strPtr, bufferEnd);
+                    indicies.normal = (normalIndex <= 0) ? normalIndex + numNormalVerts : normalIndex - 1; 
+                    RUNTIME_ASSERT(indicies.normal < numNormalVerts, "Normal vertex not defined { normalIndex: %d, numNormalVerts: %d }", normalIndex, numNormalVerts);
+                }
+            }
+            
+            return strPtr;
+        }
+        
+        static void ParseRecords(ParseChunk* chunk) {
+            
+            RecordCounts parsed = chunk->base;
+            const char* bufferEnd = chunk->bufferEnd;
+            
+            ForEachRecord(chunk->start, chunk->end, bufferEnd, [&](char* ptr, char c) {
+                switch(c) {
+                    
+                    //ignore comments
+                    case '#': break;
+    
+                    //handle vertices
+                    case 'v': ptr = LoadVertex(ptr, bufferEnd, chunk, &parsed);
+                    break;
+                    
+                    //Note: faces - defined by indices in the form 'v/vt/vn' where vt and vn are optional
+                    case 'f': ptr = LoadFace(ptr, bufferEnd, chunk, &parsed);
+                    break;
+
+                    // TODO: this is just to stop annoying calls to panic for common obj tags
+                    //       we really should be checking the full word, not just the start character 
+                    case 'o': Warn("Ignoring objected tag 'o'?");
+                    break;
+
+                    case 's': Warn("Ignoring smooth shading tag 's'?");
+                    break;
+
+                    case 'm': Warn("Ignoring material tag 'mtllib'?");
+                    break;
+
+                    case 'u': Warn("Ignoring use material tag 'usemtl'?");
+                    break;
+                    
+                    default: {
+                        Panic("Unknown object command: %d[%c]", c, c);
+                    }
+                }
+                return ptr;
+            });
+        }
+        
+        static void* CountRecordsThread(void* chunk) {
+            ((ParseChunk*)chunk)->counts = CountRecords((ParseChunk*)chunk);
+            return nullptr;
+        }
+        
+        static void* ParseRecordsThread(void* chunk) {
+            ParseRecords((ParseChunk*)chunk);
+            return nullptr;
+        }
+        
+        // Runs 'func' on every chunk. The calling thread takes the first chunk
+        template<typename ChunkT>
+        static void RunChunks(ChunkT* chunks, uint32 chunkCount, void*(*func)(void*)) {
+            
+            pthread_t threads[kMaxParseThreads];
+            for(uint32 i = 1; i < chunkCount; ++i) {
+                RUNTIME_ASSERT(!pthread_create(threads + i, nullptr, func, chunks + i), "Failed to create obj thread { chunk: %u }", i);
+            }
+            
+            func(chunks);
+            
+            for(uint32 i = 1; i < chunkCount; ++i) pthread_join(threads[i], nullptr);
+        }
+        
+    public:
+        
+        static inline uint32 DefaultParseThreadCount() {
+            long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+            return Max(uint32(1), Min(uint32(numCores > 0 ? numCores : 1), kMaxParseThreads));
+        }
+        
+        // Parses the obj in 'data' and appends it to this mesh's arrays
+        // Note: 'data' doesn't have to be null terminated, parsing stops at 'bufferEnd' or the first null terminator.
+        //       Large objs are split into chunks of whole lines that are parsed on up to 'maxThreads' threads. 
+        //       The result is identical to parsing the whole obj on one thread
+        void Parse(const char* data, const char* bufferEnd, uint32 maxThreads = DefaultParseThreadCount()) {
+            
+            uint64 bytes = bufferEnd - data;
+            uint32 chunkCount = Max(uint32(1), Min(Min(maxThreads, kMaxParseThreads), uint32(bytes / kMinParseChunkBytes)));
+            
+            // split the obj at line boundaries
+            ParseChunk chunks[kMaxParseThreads];
+            const char* chunkStart = data;
+            for(uint32 i = 0; i < chunkCount; ++i) {
+                
+                const char* chunkEnd = (i+1 == chunkCount) ? bufferEnd : SkipLine((char*)data + (bytes*(i+1))/chunkCount, bufferEnd);
+                if(chunkEnd < chunkStart) chunkEnd = chunkStart;
+                
+                chunks[i] = {
+                    .mesh = this,
+                    .start = chunkStart,
+                    .end = chunkEnd,
+                    .bufferEnd = bufferEnd,
+                };
+                chunkStart = chunkEnd;
+            }
+            
+            // first pass - count records
+            RunChunks(chunks, chunkCount, CountRecordsThread);
+            
+            // prefix sum the counts so each chunk knows where its records go
+            RecordCounts base = {
+                .geoVerts    = geoVerts.Count(),
+                .uvVerts     = uvVerts.Count(),
+                .normalVerts = normalVerts.Count(),
+                .faces       = indices.Count()/3,
+            };
+            
+            for(uint32 i = 0; i < chunkCount; ++i) {
+                ParseChunk& chunk = chunks[i];
+                
+                chunk.base = base;
+                base.geoVerts+= chunk.counts.geoVerts;
+                base.uvVerts+= chunk.counts.uvVerts;
+                base.normalVerts+= chunk.counts.normalVerts;
+                base.faces+= chunk.counts.faces;
+                
+                //Note: a null terminator ends the obj so drop every chunk after it
+                if(chunk.terminated) {
+                    chunkCount = i+1;
+                    break;
+                }
+            }
+            
+            // allocate every record up front so chunks can write to their slice of the arrays in parallel
+            geoVerts.Push(base.geoVerts - geoVerts.Count());
+            uvVerts.Push(base.uvVerts - uvVerts.Count());
+            normalVerts.Push(base.normalVerts - normalVerts.Count());
+            indices.Push(3*base.faces - indices.Count());
+            
+            // second pass - parse records
+            RunChunks(chunks, chunkCount, ParseRecordsThread);
+            
+            for(uint32 i = 0; i < chunkCount; ++i) flags|= chunks[i].flags;
+        }
+        
+        // Builds a mesh file with an interleaved vbo [position, normal, (uv)] and indices in the smallest type that fits
+        // Note: every unique (position, normal, uv) gets one vertex so hard edges and uv seams split vertices and
+        //       nothing else does. When the obj has no normals they're generated on up to 'maxThreads' threads and creased at 'creaseAngle' radians.
+        //       Triangles and vertices are reordered for the vertex cache and, if 'optimizeOverdraw' is set, to draw
+        //       outward facing clusters first (see MeshOptimizer.h). Lower detail lods are simplified out of the same vertices,
+        //       every lod's triangles are split into meshlets for culling and closed meshes are flagged with MESH_FLAG_CLOSED.
+        //       Attributes are stored in 'vertexFormat' (see MeshFile.h).
+        //       The file is pushed onto 'arena'
+        MeshFileView Build(Memory::Arena* arena, float creaseAngle = kDefaultCreaseAngle, bool optimizeOverdraw = true,
+                           const MeshVertexFormat& vertexFormat = kMeshVertexFormatFloat32, uint32 maxThreads = DefaultParseThreadCount()) {
+            
+            uint32 numCorners = indices.Count();
+            
+            //Note: scratch gets its own arena since 'arena' can be the temporaryArena we'd otherwise use
+            Memory::Arena scratchArena;
+            
+            MergeDuplicatePositions(&scratchArena);
+            
+            Vec3<float>* cornerNormals = (Vec3<float>*)scratchArena.PushBytes(numCorners*sizeof(Vec3<float>), false, alignof(Vec3<float>));
+            if(flags&MESH_FLAG_NORMAL) {
+                const Vec3<float>* normalVertPtr = normalVerts.Data();
+                for(uint32 i = 0; i < numCorners; ++i) (cornerNormals[i] = normalVertPtr[indices[i].normal]).Normalize();
+                
+            } else {
+                Log("Normals not provided in obj file. Computing normals.");
+                GenerateNormals(creaseAngle, cornerNormals, &scratchArena, maxThreads);
+            }
+            
+            Vertex* vertices = (Vertex*)scratchArena.PushBytes(numCorners*sizeof(Vertex), false, alignof(Vertex));
+            uint32* remap = (uint32*)scratchArena.PushBytes(numCorners*sizeof(uint32), false, alignof(uint32));
+            uint32 numVerts = Weld(cornerNormals, vertices, remap, &scratchArena);
+            
+            VertexCacheStats originalStats = AnalyzeVertexCache(remap, numCorners, numVerts, &scratchArena);
+            
+            OptimizeVertexCache(remap, numCorners, numVerts, &scratchArena);
+            if(optimizeOverdraw) OptimizeOverdraw(remap, numCorners, ByteOffset(vertices, offsetof(Vertex, position)), sizeof(Vertex), numVerts, &scratchArena);
+            numVerts = OptimizeVertexFetch(vertices, sizeof(Vertex), numVerts, remap, numCorners, &scratchArena);
+            
+            VertexCacheStats optimizedStats = AnalyzeVertexCache(remap, numCorners, numVerts, &scratchArena);
+            Log("Optimized mesh { triangles: %u, vertices: %u, acmr: %.3f -> %.3f, atvr: %.3f -> %.3f }",
+                numCorners/3, numVerts, originalStats.acmr, optimizedStats.acmr, originalStats.atvr, optimizedStats.atvr);
+            
+            // build the lod chain
+            // Note: every lod aims for half the triangles of the lod before it and is simplified from it, so the whole chain
+            //       costs about as much as simplifying the full mesh once. Errors add up along the chain
+            const void* positions = ByteOffset(vertices, offsetof(Vertex, position));
+            
+            Vec3<float> boundsMin(0.f, 0.f, 0.f), boundsMax(0.f, 0.f, 0.f);
+            if(numVerts) boundsMin = boundsMax = vertices[0].position;
+            for(uint32 i = 0; i < numVerts; ++i) {
+                const Vec3<float>& v = vertices[i].position;
+                boundsMin = Vec3(Min(boundsMin.x, v.x), Min(boundsMin.y, v.y), Min(boundsMin.z, v.z));
+                boundsMax = Vec3(Max(boundsMax.x, v.x), Max(boundsMax.y, v.y), Max(boundsMax.z, v.z));
+            }
+            float maxLodError = kMaxLodError * .5f*(boundsMax - boundsMin).Norm();
+            
+            uint32* lodIndices = (uint32*)scratchArena.PushBytes(kMaxLodCount*numCorners*sizeof(uint32), false, alignof(uint32));
+            memcpy(lodIndices, remap, numCorners*sizeof(uint32));
+            
+            MeshLod lods[kMaxLodCount];
+            Memory::ArenaArray<Meshlet> meshlets(&scratchArena);
+            
+            uint32 lodCount = 0, numIndices = 0;
+            for(; lodCount < kMaxLodCount; ++lodCount) {
+                
+                uint32* lodIndexPtr = lodIndices + numIndices;
+                uint32 lodIndexCount = numCorners;
+                float lodError = 0.f;
+                
+                if(lodCount) {
+                    const MeshLod& previousLod = lods[lodCount-1];
+                    
+                    lodIndexCount = SimplifyMesh(lodIndexPtr, lodIndices + previousLod.indexOffset, previousLod.indexCount, positions, sizeof(Vertex),
+                                                 numVerts, (previousLod.indexCount/6)*3, Max(maxLodError - previousLod.error, 0.f), &scratchArena, &lodError);
+                    
+                    //Note: a lod that drops less than a quarter of the triangles isn't worth the memory
+                    if(!lodIndexCount || 4*lodIndexCount > 3*previousLod.indexCount) break;
+                    lodError+= previousLod.error;
+                    
+                    OptimizeVertexCache(lodIndexPtr, lodIndexCount, numVerts, &scratchArena);
+                    if(optimizeOverdraw) OptimizeOverdraw(lodIndexPtr, lodIndexCount, positions, sizeof(Vertex), numVerts, &scratchArena);
+                }
+                
+                //Note: meshlet index offsets are from the start of the whole index buffer
+                uint32 meshletOffset = meshlets.Count();
+                BuildMeshlets(&meshlets, lodIndexPtr, lodIndexCount, positions, sizeof(Vertex), numVerts, &scratchArena);
+                for(uint32 i = meshletOffset; i < meshlets.Count(); ++i) meshlets[i].indexOffset+= numIndices;
+                
+                lods[lodCount] = {
+                    .indexOffset = numIndices,
+                    .indexCount = lodIndexCount,
+                    .meshletOffset = meshletOffset,
+                    .meshletCount = meshlets.Count() - meshletOffset,
+                    .error = lodError,
+                };
+                numIndices+= lodIndexCount;
+                
+                Log("Built lod %u { triangles: %u, meshlets: %u, error: %g }", lodCount, lodIndexCount/3, lods[lodCount].meshletCount, lodError);
+            }
+            
+            uint32 meshFlags = IsClosed(&scratchArena) ? flags | MESH_FLAG_CLOSED : flags;
+            
+                 if(!LargerThan8Bit(numVerts))  return Interleave<uint8>(arena, vertices, numVerts, lodIndices, numIndices, meshlets, lods, lodCount, meshFlags, vertexFormat);
+            else if(!LargerThan16Bit(numVerts)) return Interleave<uint16>(arena, vertices, numVerts, lodIndices, numIndices, meshlets, lods, lodCount, meshFlags, vertexFormat);
+            else return Interleave<uint32>(arena, vertices, numVerts, lodIndices, numIndices, meshlets, lods, lodCount, meshFlags, vertexFormat);
+        }
+};
\ No newline at end of file
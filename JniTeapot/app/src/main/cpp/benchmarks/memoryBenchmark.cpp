@@ -0,0 +1,246 @@
+// Host benchmark for Memory::Arena. Compares arenas with different growth policies against each other and malloc.
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 memoryBenchmark.cpp -o memoryBenchmark && ./memoryBenchmark
+//
+// Note: every benchmark reports ns/op, the number of syscalls Memory made and the peak RSS of the process while it ran.
+//       Syscalls are only counted for Memory, malloc's own mmap/brk calls don't show up.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../types.h"
+#include "../Memory.h"
+#include "../Timer.h"
+
+// Number of allocations per round. Sizes and alignments are picked from kAllocationPattern so every
+// allocator sees the same sequence
+constexpr uint32 kNumAllocations = 1 << 20;
+constexpr uint32 kNumRounds = 8;
+
+struct AllocationPattern {
+    uint32 bytes;
+    uint8 alignment;
+};
+
+//Note: a mix of small structs, vertices and strings with every alignment the engine uses
+constexpr AllocationPattern kAllocationPattern[] = {
+    { 12,  4 }, { 8,   8  }, { 64, 16 }, { 3,   1 },
+    { 24,  4 }, { 200, 8  }, { 16, 16 }, { 37,  1 },
+    { 12,  4 }, { 512, 16 }, { 4,  4  }, { 100, 1 },
+};
+
+static inline const AllocationPattern& Pattern(uint32 i) { return kAllocationPattern[i % ArrayCount(kAllocationPattern)]; }
+
+// Resets the peak RSS (VmHWM) of the process so each benchmark reports its own peak
+// Note: needs linux 4.0+, older kernels keep reporting the peak of the whole run
+static void ResetPeakRss() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if(fd < 0) return;
+
+    if(write(fd, "5", 1) != 1) Warn("Failed to reset peak RSS { Linux errno: %d }", errno);
+    close(fd);
+}
+
+// Returns the peak RSS of the process in KB or 0 if it can't be read
+static uint32 PeakRssKb() {
+    char status[4096];
+
+    int fd = open("/proc/self/status", O_RDONLY);
+    if(fd < 0) return 0;
+
+    ssize_t bytes = read(fd, status, sizeof(status)-1);
+    close(fd);
+    if(bytes <= 0) return 0;
+
+    status[bytes] = '\0';
+
+    const char* vmHwm = strstr(status, "VmHWM:");
+    return vmHwm ? strtoul(vmHwm + sizeof("VmHWM:")-1, nullptr, 10) : 0;
+}
+
+static inline uint32 MemorySyscalls() { return Memory::GlobalStats().memorySyscallCount; }
+
+// Runs 'func' and prints how long each of its 'numOps' operations took
+template<typename FuncT>
+static void Benchmark(const char* name, uint64 numOps, const FuncT& func) {
+
+    ResetPeakRss();
+    uint32 startSyscalls = MemorySyscalls();
+
+    Timer timer(true);
+    func();
+    uint64 elapsedNs = timer.ElapsedNs();
+
+    uint32 syscalls = MemorySyscalls() - startSyscalls;
+    printf("%-48s | %10llu | %12.2f | %8u | %9u\n", name, (unsigned long long)numOps, double(elapsedNs)/numOps, syscalls, PeakRssKb());
+}
+
+//Note: keeps the optimizer from throwing away allocations we never read
+static inline void Touch(void* ptr) { *(volatile uint8*)ptr = 1; }
+
+static void BenchmarkPushBytes(const char* name, const Memory::GrowthPolicy& growthPolicy) {
+    Memory::Arena arena(0, growthPolicy);
+
+    Benchmark(name, uint64(kNumAllocations)*kNumRounds, [&]() {
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 i = 0; i < kNumAllocations; ++i) {
+                const AllocationPattern& pattern = Pattern(i);
+                Touch(arena.PushBytes(pattern.bytes, false, pattern.alignment));
+            }
+            arena.FreeAll();
+        }
+    });
+}
+
+static void BenchmarkPushBytesVirtual(const char* name) {
+    Memory::VirtualArena arena;
+
+    Benchmark(name, uint64(kNumAllocations)*kNumRounds, [&]() {
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 i = 0; i < kNumAllocations; ++i) {
+                const AllocationPattern& pattern = Pattern(i);
+                Touch(arena.PushBytes(pattern.bytes, false, pattern.alignment));
+            }
+            arena.FreeAll();
+        }
+    });
+}
+
+static void BenchmarkPushBytesMalloc(const char* name) {
+    void** allocations = (void**)malloc(kNumAllocations*sizeof(void*));
+
+    Benchmark(name, uint64(kNumAllocations)*kNumRounds, [&]() {
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 i = 0; i < kNumAllocations; ++i) {
+                const AllocationPattern& pattern = Pattern(i);
+
+                //Note: malloc is always 16 byte aligned which covers every alignment in the pattern
+                allocations[i] = malloc(pattern.bytes);
+                Touch(allocations[i]);
+            }
+            for(uint32 i = 0; i < kNumAllocations; ++i) free(allocations[i]);
+        }
+    });
+
+    free(allocations);
+}
+
+// Simulates per-frame/per-asset scratch memory: push a handful of allocations then pop them all
+static void BenchmarkRegionChurn(const char* name, const Memory::GrowthPolicy& growthPolicy, uint32 allocationsPerRegion) {
+    Memory::Arena arena(0, growthPolicy);
+
+    uint32 numRegions = kNumAllocations / allocationsPerRegion;
+    Benchmark(name, uint64(numRegions)*kNumRounds, [&]() {
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 r = 0, i = 0; r < numRegions; ++r) {
+                Memory::Region region = arena.CreateRegion();
+
+                for(uint32 j = 0; j < allocationsPerRegion; ++j, ++i) {
+                    const AllocationPattern& pattern = Pattern(i);
+                    Touch(arena.PushBytes(pattern.bytes, false, pattern.alignment));
+                }
+
+                arena.FreeBaseRegion(region);
+            }
+        }
+    });
+}
+
+static void BenchmarkRegionChurnMalloc(const char* name, uint32 allocationsPerRegion) {
+    void** allocations = (void**)malloc(allocationsPerRegion*sizeof(void*));
+
+    uint32 numRegions = kNumAllocations / allocationsPerRegion;
+    Benchmark(name, uint64(numRegions)*kNumRounds, [&]() {
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 r = 0, i = 0; r < numRegions; ++r) {
+
+                for(uint32 j = 0; j < allocationsPerRegion; ++j, ++i) {
+                    allocations[j] = malloc(Pattern(i).bytes);
+                    Touch(allocations[j]);
+                }
+
+                for(uint32 j = 0; j < allocationsPerRegion; ++j) free(allocations[j]);
+            }
+        }
+    });
+
+    free(allocations);
+}
+
+// Builds a 'bytes' sized region out of small pushes so it spans many blocks, then flattens it
+static void BenchmarkFlatten(const char* name, const Memory::GrowthPolicy& growthPolicy, uint32 bytes) {
+    Memory::Arena arena(0, growthPolicy);
+
+    constexpr uint32 kNumFlattens = 32;
+    constexpr uint32 kPushBytes = 64;
+
+    uint32 blockCount = 0;
+    Benchmark(name, kNumFlattens, [&]() {
+        for(uint32 n = 0; n < kNumFlattens; ++n) {
+            for(uint32 i = 0; i < bytes; i+= kPushBytes) FillMemory(arena.PushBytes(kPushBytes), i, kPushBytes);
+
+            blockCount = arena.BlockCount();
+            Touch(arena.Flatten(bytes));
+            arena.FreeAll();
+        }
+    });
+
+    printf("%-48s   (flattened %u blocks)\n", "", blockCount);
+}
+
+// Copies a region of Vec3s that spans many blocks to a packed buffer and to a strided (interleaved VBO) buffer
+static void BenchmarkCopyRegionsToBuffer(const char* name, uint32 bufferStride, bool nonTemporal) {
+    Memory::Arena arena;
+
+    constexpr uint32 kNumVerts = 1 << 20;
+    constexpr uint32 kNumCopies = 16;
+
+    for(uint32 i = 0; i < kNumVerts; ++i) *arena.PushType<Vec3<float>>() = Vec3<float>(i, i+1, i+2);
+
+    void* buffer = malloc(kNumVerts*bufferStride);
+    Touch(buffer);
+
+    Benchmark(name, uint64(kNumVerts)*kNumCopies, [&]() {
+        for(uint32 n = 0; n < kNumCopies; ++n) {
+            arena.CopyToBuffer<Vec3<float>>(kNumVerts, buffer, sizeof(Vec3<float>), bufferStride, nonTemporal);
+        }
+    });
+
+    RUNTIME_ASSERT(((Vec3<float>*)ByteOffset(buffer, (kNumVerts-1)*bufferStride))->x == kNumVerts-1,
+                   "CopyToBuffer produced the wrong result { bufferStride: %u }", bufferStride);
+
+    free(buffer);
+}
+
+int main() {
+
+    //Note: fixed 4KB blocks are what arenas did before they grew geometrically
+    constexpr Memory::GrowthPolicy kFixedPagePolicy = { .minBlockBytes = KB(4), .maxBlockBytes = KB(4), .hugePages = Memory::HUGE_PAGES_NONE };
+
+    printf("%-48s | %10s | %12s | %8s | %9s\n", "benchmark", "ops", "ns/op", "syscalls", "peakRssKB");
+
+    BenchmarkPushBytes("PushBytes mixed alignment [fixed 4KB blocks]", kFixedPagePolicy);
+    BenchmarkPushBytes("PushBytes mixed alignment [default policy]",   Memory::kDefaultGrowthPolicy);
+    BenchmarkPushBytes("PushBytes mixed alignment [large policy]",     Memory::kLargeGrowthPolicy);
+    BenchmarkPushBytesVirtual("PushBytes mixed alignment [VirtualArena]");
+    BenchmarkPushBytesMalloc("malloc/free mixed sizes");
+
+    BenchmarkRegionChurn("Create/FreeBaseRegion x16 [fixed 4KB blocks]", kFixedPagePolicy, 16);
+    BenchmarkRegionChurn("Create/FreeBaseRegion x16 [default policy]",   Memory::kDefaultGrowthPolicy, 16);
+    BenchmarkRegionChurn("Create/FreeBaseRegion x256 [default policy]",  Memory::kDefaultGrowthPolicy, 256);
+    BenchmarkRegionChurnMalloc("malloc/free x16", 16);
+    BenchmarkRegionChurnMalloc("malloc/free x256", 256);
+
+    BenchmarkFlatten("Flatten 8MB [fixed 4KB blocks]", kFixedPagePolicy, MB(8));
+    BenchmarkFlatten("Flatten 8MB [default policy]",   Memory::kDefaultGrowthPolicy, MB(8));
+
+    BenchmarkCopyRegionsToBuffer("CopyRegionsToBuffer Vec3 packed",             sizeof(Vec3<float>), false);
+    BenchmarkCopyRegionsToBuffer("CopyRegionsToBuffer Vec3 packed nonTemporal", sizeof(Vec3<float>), true);
+    BenchmarkCopyRegionsToBuffer("CopyRegionsToBuffer Vec3 stride 32",          32, false);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Host benchmark for MeshCodec.h. Builds objs into mesh files the way the app does, compresses their vertices and indices
+// and compares decoding them against copying the raw ones.
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 meshCodecBenchmark.cpp -lpthread -o meshCodecBenchmark
+//     ./meshCodecBenchmark ../../assets/meshes/cow.obj ../../assets/meshes/sphere.obj
+//
+// Note: throughput is decoded bytes per second so it lines up with 'memcpy'. 'ratio' is raw bytes over compressed bytes
+//       and 'bits' is compressed bits per vertex or per triangle. Every decode is checked against the raw data
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../types.h"
+#include "../Memory.h"
+#include "../ObjMesh.h"
+#include "../MeshCodec.h"
+#include "../Timer.h"
+
+//Note: decoding a small mesh is short enough that a context switch skews it so we report the fastest of a few runs
+constexpr uint32 kNumRuns = 32;
+
+// Runs 'run' and prints the throughput of producing 'bytes' with it
+template<typename FuncT>
+static void Benchmark(const char* name, uint64 bytes, uint64 compressedBytes, uint32 elements, const FuncT& run) {
+
+    uint64 elapsedNs = ~uint64(0);
+    for(uint32 i = 0; i < kNumRuns; ++i) {
+
+        Timer timer(true);
+        run();
+        elapsedNs = Min(elapsedNs, timer.ElapsedNs());
+    }
+
+    printf("%-24s | %10llu | %10llu | %6.2f | %6.2f | %8.3f | %6.2f\n", name, (unsigned long long)bytes, (unsigned long long)compressedBytes,
+           double(bytes)/compressedBytes, 8.*compressedBytes/elements, 1e-6*elapsedNs, double(bytes)/elapsedNs);
+}
+
+static void LoadObj(const char* objPath, ObjMesh* mesh) {
+
+    int fd = open(objPath, O_RDONLY);
+    RUNTIME_ASSERT(fd >= 0, "Failed to open obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    struct stat fileStat;
+    RUNTIME_ASSERT(!fstat(fd, &fileStat), "Failed to stat obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    uint64 objBytes = fileStat.st_size;
+    const char* obj = objBytes ? (const char*)mmap(nullptr, objBytes, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    RUNTIME_ASSERT(obj != MAP_FAILED, "Failed to map obj { objPath: %s, linux errno: %d }", objPath, errno);
+    close(fd);
+
+    mesh->Parse(obj, obj + objBytes);
+
+    if(objBytes) munmap((void*)obj, objBytes);
+}
+
+int main(int argc, char** argv) {
+
+    const char* defaultObjs[] = { "../../assets/meshes/cow.obj", "../../assets/meshes/sphere.obj" };
+
+    const char** objPaths = argc > 1 ? (const char**)argv + 1 : defaultObjs;
+    uint32 numObjs = argc > 1 ? argc - 1 : ArrayCount(defaultObjs);
+
+    for(uint32 i = 0; i < numObjs; ++i) {
+
+        ObjMesh obj;
+        LoadObj(objPaths[i], &obj);
+
+        const MeshVertexFormat* vertexFormats[] = { &kMeshVertexFormatCompact, &kMeshVertexFormatFloat32 };
+        for(const MeshVertexFormat* vertexFormat : vertexFormats) {
+
+            Memory::Arena arena;
+            MeshFileView mesh = obj.Build(&arena, ObjMesh::kDefaultCreaseAngle, true, *vertexFormat);
+            const MeshFileHeader& header = *mesh.header;
+
+            MeshFileView compressedMesh = CompressMeshFile(mesh, &arena);
+            const MeshFileHeader& compressedHeader = *compressedMesh.header;
+            RUNTIME_ASSERT(compressedHeader.flags&MESH_FLAG_COMPRESSED, "Mesh didn't compress { objPath: %s }", objPaths[i]);
+
+            uint32 vertexBytes = header.vertexBytes,
+                   indexBytes = header.indexBytes;
+
+            //Note: page aligned like a mapped gl buffer
+            void* vertices = arena.PushBytes(vertexBytes, false, 64);
+            void* indices = arena.PushBytes(indexBytes, false, 64);
+
+            printf("%s { vertices: %u, triangles: %u, vertexStride: %u, indexStride: %u, fileBytes: %llu -> %llu }\n",
+                   objPaths[i], header.vertexCount, header.indexCount/3, header.vertexStride, header.indexStride,
+                   (unsigned long long)mesh.bytes, (unsigned long long)compressedMesh.bytes);
+            printf("%-24s | %10s | %10s | %6s | %6s | %8s | %s\n", "decoder", "bytes", "compressed", "ratio", "bits", "ms", "GB/s");
+
+            Benchmark("memcpy vertices", vertexBytes, vertexBytes, header.vertexCount, [&]() { memcpy(vertices, mesh.vertices, vertexBytes); });
+            Benchmark("DecodeMeshVertices", vertexBytes, compressedHeader.vertexBytes, header.vertexCount, [&]() {
+                DecodeMeshVertices(vertices, header.vertexCount, header.vertexStride, (const uint8*)compressedMesh.vertices, compressedHeader.vertexBytes);
+            });
+            RUNTIME_ASSERT(!memcmp(vertices, mesh.vertices, vertexBytes), "Decoded vertices don't match { objPath: %s }", objPaths[i]);
+
+            Benchmark("memcpy indices", indexBytes, indexBytes, header.indexCount/3, [&]() { memcpy(indices, mesh.indices, indexBytes); });
+            Benchmark("DecodeMeshIndices", indexBytes, compressedHeader.indexBytes, header.indexCount/3, [&]() {
+                DecodeMeshIndices(indices, header.indexCount, header.indexStride, header.vertexCount, (const uint8*)compressedMesh.indices, compressedHeader.indexBytes);
+            });
+            RUNTIME_ASSERT(!memcmp(indices, mesh.indices, indexBytes), "Decoded indices don't match { objPath: %s }", objPaths[i]);
+
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
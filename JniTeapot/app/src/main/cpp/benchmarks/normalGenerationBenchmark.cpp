@@ -0,0 +1,168 @@
+// Host benchmark for ObjMesh::GenerateNormals. Compares the simd and threaded version against the scalar one it replaced
+// on smooth and creased normals.
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 normalGenerationBenchmark.cpp -lpthread -o normalGenerationBenchmark
+//     ./normalGenerationBenchmark ../../assets/meshes/cow.obj ../../assets/meshes/sphere.obj
+//
+// Note: 'maxDegrees' is the largest angle between a corner normal and the legacy one. Threads sum smooth normals in a
+//       different order so it won't always be 0. Meshes need 32K faces per thread (4K when creased) before GenerateNormals
+//       splits them so small ones run on one thread whatever the count
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../types.h"
+#include "../Memory.h"
+#include "../ObjMesh.h"
+#include "../Timer.h"
+
+//Note: normal generation is short enough that a context switch skews it so we report the fastest of a few runs
+constexpr uint32 kNumRuns = 8;
+
+// The single threaded GenerateNormals this repo used before it went simd. Kept here so we can see what we gained
+static void LegacyGenerateNormals(const ObjMesh& mesh, float creaseAngle, Vec3<float>* cornerNormals, Memory::Arena* scratchArena) {
+
+    uint32 numCorners = mesh.indices.Count(),
+           numFaces = numCorners/3,
+           numVerts = mesh.geoVerts.Count();
+
+    Memory::Region tmpRegion = scratchArena->CreateRegion();
+    Vec3<float>* faceNormals = (Vec3<float>*)scratchArena->PushBytes(numFaces*sizeof(Vec3<float>), false, alignof(Vec3<float>));
+
+    const ObjMesh::Indices* index = mesh.indices.Data();
+    const Vec3<float>* geoVertPtr = mesh.geoVerts.Data();
+    for(uint32 i = 0; i < numFaces; ++i, index+= 3) {
+
+        const Vec3<float> *v1 = geoVertPtr + index[0].vertex,
+                          *v2 = geoVertPtr + index[1].vertex,
+                          *v3 = geoVertPtr + index[2].vertex;
+
+        faceNormals[i] = (*v2 - *v1).Cross(*v3 - *v1).Normalize();
+    }
+
+    index = mesh.indices.Data();
+    if(creaseAngle >= Pi()) {
+        Vec3<float>* vertNormals = (Vec3<float>*)scratchArena->PushBytes(numVerts*sizeof(Vec3<float>), true, alignof(Vec3<float>));
+        for(uint32 i = 0; i < numCorners; ++i) vertNormals[index[i].vertex]+= faceNormals[i/3];
+        for(uint32 i = 0; i < numVerts; ++i)   vertNormals[i].Normalize();
+
+        for(uint32 i = 0; i < numCorners; ++i) cornerNormals[i] = vertNormals[index[i].vertex];
+
+    } else {
+
+        uint32* faceListStart = (uint32*)scratchArena->PushBytes((numVerts+1)*sizeof(uint32), true, alignof(uint32));
+        for(uint32 i = 0; i < numCorners; ++i) ++faceListStart[index[i].vertex + 1];
+        for(uint32 i = 0; i < numVerts; ++i)   faceListStart[i+1]+= faceListStart[i];
+
+        uint32* faceListEnd = (uint32*)scratchArena->PushBytes(numVerts*sizeof(uint32), false, alignof(uint32));
+        memcpy(faceListEnd, faceListStart, numVerts*sizeof(uint32));
+
+        uint32* faceList = (uint32*)scratchArena->PushBytes(numCorners*sizeof(uint32), false, alignof(uint32));
+        for(uint32 i = 0; i < numCorners; ++i) faceList[faceListEnd[index[i].vertex]++] = i/3;
+
+        float minCos = FastCos(creaseAngle);
+        for(uint32 i = 0; i < numCorners; ++i) {
+
+            uint32 vertex = index[i].vertex;
+            const Vec3<float>& faceNormal = faceNormals[i/3];
+
+            Vec3<float> normal(0.f, 0.f, 0.f);
+            for(uint32 j = faceListStart[vertex]; j < faceListEnd[vertex]; ++j) {
+                const Vec3<float>& adjacentNormal = faceNormals[faceList[j]];
+                if(faceNormal.Dot(adjacentNormal) >= minCos) normal+= adjacentNormal;
+            }
+
+            cornerNormals[i] = normal.Normalize();
+        }
+    }
+
+    scratchArena->FreeBaseRegion(tmpRegion);
+}
+
+// Generates normals with 'generate' and prints the time per face and how far they are from 'expected'
+template<typename FuncT>
+static void Benchmark(const char* name, const ObjMesh& mesh, const Vec3<float>* expected, Vec3<float>* cornerNormals, const FuncT& generate) {
+
+    uint64 elapsedNs = ~uint64(0);
+    for(uint32 run = 0; run < kNumRuns; ++run) {
+
+        Timer timer(true);
+        generate(cornerNormals);
+        elapsedNs = Min(elapsedNs, timer.ElapsedNs());
+    }
+
+    //Note: legacy normals of degenerate faces are nan so they're left out. atan2 keeps small angles accurate where acos doesn't
+    float maxAngle = 0.f;
+    for(uint32 i = 0; i < mesh.indices.Count(); ++i) {
+        float angle = atan2f(expected[i].Cross(cornerNormals[i]).Norm(), expected[i].Dot(cornerNormals[i]));
+        if(angle == angle) maxAngle = Max(maxAngle, angle);
+    }
+
+    uint32 numFaces = mesh.indices.Count()/3;
+    printf("%-24s | %10u | %8.2f | %8.3f | %g\n", name, numFaces, double(elapsedNs)/numFaces, 1e-6*elapsedNs,
+           ToDegrees(maxAngle));
+}
+
+static void LoadObj(const char* objPath, ObjMesh* mesh) {
+
+    int fd = open(objPath, O_RDONLY);
+    RUNTIME_ASSERT(fd >= 0, "Failed to open obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    struct stat fileStat;
+    RUNTIME_ASSERT(!fstat(fd, &fileStat), "Failed to stat obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    uint64 objBytes = fileStat.st_size;
+    const char* obj = objBytes ? (const char*)mmap(nullptr, objBytes, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    RUNTIME_ASSERT(obj != MAP_FAILED, "Failed to map obj { objPath: %s, linux errno: %d }", objPath, errno);
+    close(fd);
+
+    mesh->Parse(obj, obj + objBytes);
+
+    if(objBytes) munmap((void*)obj, objBytes);
+}
+
+int main(int argc, char** argv) {
+
+    const char* defaultObjs[] = { "../../assets/meshes/cow.obj", "../../assets/meshes/sphere.obj" };
+
+    const char** objPaths = argc > 1 ? (const char**)argv + 1 : defaultObjs;
+    uint32 numObjs = argc > 1 ? argc - 1 : ArrayCount(defaultObjs);
+
+    for(uint32 i = 0; i < numObjs; ++i) {
+
+        ObjMesh mesh;
+        LoadObj(objPaths[i], &mesh);
+
+        Memory::Arena arena;
+        uint32 numCorners = mesh.indices.Count();
+        Vec3<float>* expected = (Vec3<float>*)arena.PushBytes(numCorners*sizeof(Vec3<float>), false, alignof(Vec3<float>));
+        Vec3<float>* cornerNormals = (Vec3<float>*)arena.PushBytes(numCorners*sizeof(Vec3<float>), false, alignof(Vec3<float>));
+
+        const float creaseAngles[] = { float(Pi()), ObjMesh::kDefaultCreaseAngle };
+        for(float creaseAngle : creaseAngles) {
+
+            printf("%s { vertices: %u, creaseAngle: %g }\n", objPaths[i], mesh.geoVerts.Count(), ToDegrees(creaseAngle));
+            printf("%-24s | %10s | %8s | %8s | %s\n", "generator", "faces", "ns/face", "ms", "maxDegrees");
+
+            LegacyGenerateNormals(mesh, creaseAngle, expected, &arena);
+            Benchmark("LegacyGenerateNormals", mesh, expected, cornerNormals, [&](Vec3<float>* normals) { LegacyGenerateNormals(mesh, creaseAngle, normals, &arena); });
+
+            for(uint32 threads = 1; threads <= ObjMesh::DefaultParseThreadCount(); threads*= 2) {
+                char name[32];
+                snprintf(name, sizeof(name), "GenerateNormals x%u", threads);
+                Benchmark(name, mesh, expected, cornerNormals, [&](Vec3<float>* normals) { mesh.GenerateNormals(creaseAngle, normals, &arena, threads); });
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Host benchmark for StrToFloat. Compares it against the approximate parser it replaced and libc's strtof on the
+// numbers in real obj files.
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 numberParsingBenchmark.cpp -o numberParsingBenchmark
+//     ./numberParsingBenchmark ../../assets/meshes/cow.obj ../../assets/meshes/sphere.obj
+//
+// Note: every parser reads the same copy of the numbers so only parsing is timed. Accuracy is measured against strtof
+//       which is correctly rounded, 'wrong' counts numbers that didn't parse to the nearest float and 'maxUlps' is how
+//       far off the worst one was
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../types.h"
+#include "../Memory.h"
+#include "../stringUtil.h"
+#include "../Timer.h"
+
+constexpr uint32 kNumRounds = 16;
+
+//Note: parsing is short enough that a context switch skews it so we report the fastest of a few runs
+constexpr uint32 kNumRuns = 8;
+
+// The StrToFloat this repo used before it rounded correctly. Kept here so we can see what we gained
+static float LegacyStrToFloat(char* str, char** strEnd = nullptr, const char* bufferEnd = UnboundedStrEnd<char>()) {
+
+    str = SkipWhiteSpace(str, bufferEnd);
+    int sign = StrSign(str, &str, bufferEnd),
+        digits = StrDigits(str, 0xFFFFFF, &str, bufferEnd); //get leading digits
+
+    //get number of digits to decimal point
+    char* tmpStr = str;
+    while(InRange(StrPeek(str, bufferEnd), '0', '9')) ++str;
+    int power = str - tmpStr;
+
+    //check for decimal point
+    if(StrPeek(str, bufferEnd) == '.') {
+        ++str;
+
+        //add fractional sigfigs
+        tmpStr = str;
+        for(char c; InRange((c = StrPeek(str, bufferEnd)), '0', '9') && digits < 0xFFFFFF; ++str) {
+            digits = 10*digits + (c - '0');
+        }
+        power-= str - tmpStr;
+
+        //ignore remaining digits
+        while(InRange(StrPeek(str, bufferEnd), '0', '9')) ++str;
+    }
+
+    //check for E
+    if(LowerCase(StrPeek(str, bufferEnd)) == 'e') power+= StrToInt(++str, &str, bufferEnd);
+
+    if(strEnd) *strEnd = str;
+    return (sign*digits)*FastPow10(power);
+}
+
+// Null terminated copies of every number in the v/vt/vn records of the benchmarked objs
+struct Numbers {
+    Memory::Arena arena;
+    Memory::Arena startsArena;
+
+    Memory::ArenaArray<char*> starts = Memory::ArenaArray<char*>(&startsArena);
+    uint64 bytes = 0;
+};
+
+static void LoadNumbers(const char* objPath, Numbers* numbers) {
+
+    int fd = open(objPath, O_RDONLY);
+    RUNTIME_ASSERT(fd >= 0, "Failed to open obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    struct stat fileStat;
+    RUNTIME_ASSERT(!fstat(fd, &fileStat), "Failed to stat obj { objPath: %s, linux errno: %d }", objPath, errno);
+
+    uint64 objBytes = fileStat.st_size;
+    char* obj = objBytes ? (char*)mmap(nullptr, objBytes, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    RUNTIME_ASSERT(obj != MAP_FAILED, "Failed to map obj { objPath: %s, linux errno: %d }", objPath, errno);
+    close(fd);
+
+    char* objEnd = obj + objBytes;
+    for(char* line = obj; line < objEnd; line = SkipLine(line, objEnd)) {
+        if(line[0] != 'v') continue;
+
+        //skip over the record type
+        char* str = line;
+        while(str < objEnd && !IsWhiteSpace(*str)) ++str;
+
+        for(;;) {
+            while(str < objEnd && (*str == ' ' || *str == '\t')) ++str;
+            if(str >= objEnd || IsWhiteSpace(*str)) break;
+
+            char* numberStart = str;
+            while(str < objEnd && !IsWhiteSpace(*str)) ++str;
+
+            uint32 numberBytes = str - numberStart;
+            char* number = (char*)numbers->arena.PushBytes(numberBytes + 1);
+            memcpy(number, numberStart, numberBytes);
+            number[numberBytes] = '\0';
+
+            *numbers->starts.Push() = number;
+            numbers->bytes+= numberBytes;
+        }
+    }
+
+    if(objBytes) munmap(obj, objBytes);
+}
+
+static uint32 UlpDistance(float a, float b) {
+    int32 aBits, bBits;
+    memcpy(&aBits, &a, sizeof(a));
+    memcpy(&bBits, &b, sizeof(b));
+
+    //Note: map sign magnitude floats onto a line so the distance across 0 is right too
+    if(aBits < 0) aBits = int32(0x80000000) - aBits;
+    if(bBits < 0) bBits = int32(0x80000000) - bBits;
+    return Abs(int64(aBits) - int64(bBits));
+}
+
+// Parses every number 'kNumRounds' times with 'parse' and prints the time per number and how accurate it was
+template<typename FuncT>
+static void Benchmark(const char* name, const Numbers& numbers, float* expected, const FuncT& parse) {
+
+    float sum = 0;
+
+    uint64 elapsedNs = ~uint64(0);
+    for(uint32 run = 0; run < kNumRuns; ++run) {
+
+        Timer timer(true);
+        for(uint32 round = 0; round < kNumRounds; ++round) {
+            for(uint32 i = 0; i < numbers.starts.Count(); ++i) sum+= parse(numbers.starts[i]);
+        }
+        elapsedNs = Min(elapsedNs, timer.ElapsedNs());
+    }
+
+    uint32 wrong = 0, maxUlps = 0;
+    for(uint32 i = 0; i < numbers.starts.Count(); ++i) {
+        uint32 ulps = UlpDistance(parse(numbers.starts[i]), expected[i]);
+
+        wrong+= (ulps != 0);
+        maxUlps = Max(maxUlps, ulps);
+    }
+
+    uint64 numOps = uint64(numbers.starts.Count())*kNumRounds;
+    double seconds = 1e-9*elapsedNs;
+    printf("%-24s | %10llu | %8.2f | %8.1f | %8u | %8u | %g\n", name, (unsigned long long)numOps, double(elapsedNs)/numOps,
+           (1e-6*numbers.bytes*kNumRounds)/seconds, wrong, maxUlps, sum);
+}
+
+int main(int argc, char** argv) {
+
+    const char* defaultObjs[] = { "../../assets/meshes/cow.obj", "../../assets/meshes/sphere.obj" };
+
+    const char** objPaths = argc > 1 ? (const char**)argv + 1 : defaultObjs;
+    uint32 numObjs = argc > 1 ? argc - 1 : ArrayCount(defaultObjs);
+
+    Numbers numbers;
+    for(uint32 i = 0; i < numObjs; ++i) LoadNumbers(objPaths[i], &numbers);
+
+    RUNTIME_ASSERT(numbers.starts.Count(), "No numbers found in objs");
+
+    float* expected = (float*)numbers.arena.PushBytes(numbers.starts.Count()*sizeof(float));
+    for(uint32 i = 0; i < numbers.starts.Count(); ++i) expected[i] = strtof(numbers.starts[i], nullptr);
+
+    printf("%u numbers, %llu bytes\n", numbers.starts.Count(), (unsigned long long)numbers.bytes);
+    printf("%-24s | %10s | %8s | %8s | %8s | %8s | %s\n", "parser", "numbers", "ns/num", "MB/s", "wrong", "maxUlps", "checksum");
+
+    Benchmark("LegacyStrToFloat", numbers, expected, [](char* str) { return LegacyStrToFloat(str); });
+    Benchmark("StrToFloat",       numbers, expected, [](char* str) { return StrToFloat(str); });
+    Benchmark("strtof",           numbers, expected, [](char* str) { return strtof(str, nullptr); });
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "types.h"
+#include "memUtil.h"
+#include "mathUtil.h"
+
+// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) without the frame header.
+// Note: a block is a list of sequences: [token][literal length][literals][match offset][match length]
+//       the high nibble of token is the literal length and the low nibble is the match length - 4.
+//       Nibbles of 15 are continued by bytes until one is less than 255. The last sequence is literals only
+
+constexpr uint64 Lz4CompressBound(uint64 bytes) { return bytes + bytes/255 + 16; }
+
+// Decompresses 'srcBytes' of 'src' into exactly 'dstBytes' of 'dst'
+// Returns false if the block is corrupt or doesn't decompress to exactly 'dstBytes' - never reads or writes out of bounds
+inline bool Lz4DecompressBlock(const uint8* src, uint64 srcBytes, uint8* dst, uint64 dstBytes) {
+
+    const uint8* srcEnd = src + srcBytes;
+    uint8* out = dst;
+    uint8* outEnd = dst + dstBytes;
+
+    auto ReadLength = [&](uint64* length) -> bool {
+        for(uint8 b = 255; b == 255; *length+= b) {
+            if(src >= srcEnd) return false;
+            b = *src++;
+        }
+        return true;
+    };
+
+    while(src < srcEnd) {
+
+        uint8 token = *src++;
+
+        uint64 literalBytes = token >> 4;
+        if(literalBytes == 15 && !ReadLength(&literalBytes)) return false;
+        if(literalBytes > uint64(srcEnd - src) || literalBytes > uint64(outEnd - out)) return false;
+
+        __builtin_memcpy(out, src, literalBytes);
+        out+= literalBytes;
+        src+= literalBytes;
+
+        //Note: last sequence has no match
+        if(src == srcEnd) break;
+        if(srcEnd - src < 2) return false;
+
+        uint32 offset = src[0] | (uint32(src[1]) << 8);
+        src+= 2;
+        if(!offset || offset > uint64(out - dst)) return false;
+
+        uint64 matchBytes = token & 0xF;
+        if(matchBytes == 15 && !ReadLength(&matchBytes)) return false;
+        matchBytes+= 4;
+        if(matchBytes > uint64(outEnd - out)) return false;
+
+        //Note: matches can overlap the bytes they produce (ex. offset 1 repeats a byte) so only memcpy when they don't
+        const uint8* match = out - offset;
+        if(offset >= matchBytes) {
+            __builtin_memcpy(out, match, matchBytes);
+            out+= matchBytes;
+        } else {
+            for(uint8* matchEnd = out + matchBytes; out < matchEnd;) *out++ = *match++;
+        }
+    }
+
+    return out == outEnd;
+}
+
+constexpr uint32 kLz4HashBits = 16;
+constexpr uint32 kLz4HashTableSize = 1 << kLz4HashBits;
+
+// Greedy single pass LZ4 compressor. Returns the compressed size
+// Note: 'dst' must hold at least Lz4CompressBound(srcBytes) bytes and 'hashTable' kLz4HashTableSize entries.
+//       Meant for offline tools (ex. the asset packer) so it trades ratio for simplicity
+inline uint64 Lz4CompressBlock(const uint8* src, uint64 srcBytes, uint8* dst, uint32* hashTable) {
+
+    //Note: the spec requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+    constexpr uint64 kLastLiterals = 5;
+    constexpr uint64 kMatchFindLimit = 12;
+    constexpr uint64 kMaxOffset = 0xFFFF;
+
+    uint8* out = dst;
+
+    auto WriteLength = [&](uint64 length) {
+        for(; length >= 255; length-= 255) *out++ = 255;
+        *out++ = uint8(length);
+    };
+
+    auto WriteSequence = [&](const uint8* literals, uint64 literalBytes, uint32 offset, uint64 matchBytes) {
+        uint8* token = out++;
+        *token = uint8(Min(literalBytes, uint64(15)) << 4);
+        if(literalBytes >= 15) WriteLength(literalBytes - 15);
+
+        __builtin_memcpy(out, literals, literalBytes);
+        out+= literalBytes;
+
+        if(!matchBytes) return;
+
+        *out++ = uint8(offset);
+        *out++ = uint8(offset >> 8);
+
+        matchBytes-= 4;
+        *token|= uint8(Min(matchBytes, uint64(15)));
+        if(matchBytes >= 15) WriteLength(matchBytes - 15);
+    };
+
+    auto Read32 = [&](uint64 i) { uint32 v; __builtin_memcpy(&v, src + i, sizeof(v)); return v; };
+    auto Hash   = [&](uint32 v) { return (v * 2654435761u) >> (32 - kLz4HashBits); };
+
+    for(uint32 i = 0; i < kLz4HashTableSize; ++i) hashTable[i] = MaxUint32();
+
+    uint64 anchor = 0;
+    if(srcBytes > kMatchFindLimit) {
+
+        uint64 matchFindEnd = srcBytes - kMatchFindLimit;
+        uint64 matchEnd = srcBytes - kLastLiterals;
+
+        for(uint64 i = 0; i < matchFindEnd;) {
+
+            uint32 value = Read32(i);
+            uint32 h = Hash(value);
+            uint32 candidate = hashTable[h];
+            hashTable[h] = uint32(i);
+
+            if(candidate == MaxUint32() || i - candidate > kMaxOffset || Read32(candidate) != value) {
+                ++i;
+                continue;
+            }
+
+            uint64 matchBytes = 4;
+            while(i + matchBytes < matchEnd && src[candidate + matchBytes] == src[i + matchBytes]) ++matchBytes;
+
+            WriteSequence(src + anchor, i - anchor, uint32(i - candidate), matchBytes);
+            i+= matchBytes;
+            anchor = i;
+        }
+    }
+
+    WriteSequence(src + anchor, srcBytes - anchor, 0, 0);
+    return out - dst;
+}
@@ -5,6 +5,7 @@
 
 #include "types.h"
 #include "customAssert.h"
+#include "AllocationCounters.h"
 
 #define GL_ASSERT_INDENT "\n\t\t\t"
 #define GL_ASSERT_END GL_ASSERT_INDENT "}\n\t\t"
@@ -65,4 +66,12 @@ template<> struct GlAttributeInfo<uint32> { static constexpr uint32 kSize = 1; s
 
 //Note: specialization for Vec types
 template<typename T, template<typename, typename...> class VecTemplate>
-struct GlAttributeInfo<VecTemplate<T>> { static constexpr uint32 kSize = VecTemplate<T>::kNumDims; static constexpr GLenum kType = GlAttributeInfo<T>::kType; };
\ No newline at end of file
+struct GlAttributeInfo<VecTemplate<T>> { static constexpr uint32 kSize = VecTemplate<T>::kNumDims; static constexpr GLenum kType = GlAttributeInfo<T>::kType; };
+
+// glBufferData that counts towards AllocationCounters::COUNTER_GL_BUFFER_ALLOCATIONS
+// Note: glBufferData always (re)allocates the buffer's storage. Use glBufferSubData/glMapBufferRange to update
+//       buffers in the render loop
+inline void GlBufferData(GLenum target, GLsizeiptr bytes, const void* data, GLenum usage) {
+    AllocationCounters::Count(AllocationCounters::COUNTER_GL_BUFFER_ALLOCATIONS);
+    glBufferData(target, bytes, data, usage);
+}
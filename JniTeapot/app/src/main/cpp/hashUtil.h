@@ -0,0 +1,65 @@
+#pragma once
+
+#include "types.h"
+
+// 64 bit xxHash (XXH64) of 'bytes' of 'data' - https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+// Note: fast enough to hash whole assets (several GB/s) so it's used to content address derived data
+inline uint64 Hash64(const void* data, uint64 bytes, uint64 seed = 0) {
+
+    constexpr uint64 kPrime1 = 0x9E3779B185EBCA87ULL,
+                     kPrime2 = 0xC2B2AE3D27D4EB4FULL,
+                     kPrime3 = 0x165667B19E3779F9ULL,
+                     kPrime4 = 0x85EBCA77C2B2AE63ULL,
+                     kPrime5 = 0x27D4EB2F165667C5ULL;
+
+    auto RotL   = [](uint64 x, uint32 r) { return (x << r) | (x >> (64 - r)); };
+    auto Round  = [&](uint64 acc, uint64 lane) { return RotL(acc + lane*kPrime2, 31) * kPrime1; };
+    auto Merge  = [&](uint64 acc, uint64 value) { return (acc ^ Round(0, value))*kPrime1 + kPrime4; };
+    auto Read64 = [](const uint8* p) { uint64 v; __builtin_memcpy(&v, p, sizeof(v)); return v; };
+    auto Read32 = [](const uint8* p) { uint32 v; __builtin_memcpy(&v, p, sizeof(v)); return v; };
+
+    const uint8* p = (const uint8*)data;
+    const uint8* end = p + bytes;
+
+    uint64 hash;
+    if(bytes >= 32) {
+
+        //Note: 4 independent lanes so the multiplies pipeline
+        uint64 acc1 = seed + kPrime1 + kPrime2,
+               acc2 = seed + kPrime2,
+               acc3 = seed,
+               acc4 = seed - kPrime1;
+
+        for(const uint8* stripeEnd = end - 32; p <= stripeEnd; p+= 32) {
+            acc1 = Round(acc1, Read64(p));
+            acc2 = Round(acc2, Read64(p + 8));
+            acc3 = Round(acc3, Read64(p + 16));
+            acc4 = Round(acc4, Read64(p + 24));
+        }
+
+        hash = RotL(acc1, 1) + RotL(acc2, 7) + RotL(acc3, 12) + RotL(acc4, 18);
+        hash = Merge(hash, acc1);
+        hash = Merge(hash, acc2);
+        hash = Merge(hash, acc3);
+        hash = Merge(hash, acc4);
+
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash+= bytes;
+
+    for(; p + 8 <= end; p+= 8) hash = RotL(hash ^ Round(0, Read64(p)), 27)*kPrime1 + kPrime4;
+    if(p + 4 <= end) {
+        hash = RotL(hash ^ (Read32(p)*kPrime1), 23)*kPrime2 + kPrime3;
+        p+= 4;
+    }
+    for(; p < end; ++p) hash = RotL(hash ^ (*p * kPrime5), 11)*kPrime1;
+
+    hash^= hash >> 33;
+    hash*= kPrime2;
+    hash^= hash >> 29;
+    hash*= kPrime3;
+    hash^= hash >> 32;
+    return hash;
+}
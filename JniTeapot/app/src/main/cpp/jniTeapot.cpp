@@ -6,11 +6,14 @@
 #include "util.h"
 
 #include "FileManager.h"
+#include "AssetLoader.h"
+#include "AssetCache.h"
 #include "GlContext.h"
 #include "GlText.h"
 #include "Timer.h"
 
 #include "Memory.h"
+#include "AllocationCounters.h"
 
 #include "GlObject.h"
 #include "GlSkybox.h"
@@ -56,16 +59,46 @@ void InitGlesState() {
 inline
 Vec2<float> DrawMemoryStats(GlText* glText, Vec2<float> textBaseline, Vec2<float> lineAdvance) {
     #ifdef ENABLE_MEMORY_STATS
-        glText->PushString(textBaseline, "Memory Bytes: %u | Blocks: %u | Reserve Blocks: %u", Memory::memoryBytes, Memory::memoryBlockCount, Memory::memoryBlockReserveCount);
+        Memory::Stats stats = Memory::GlobalStats();
+
+        glText->PushString(textBaseline, "Memory Bytes: %u | Blocks: %u | Reserve Blocks: %u", stats.memoryBytes, stats.memoryBlockCount, stats.memoryBlockReserveCount);
         textBaseline+= lineAdvance;
         
-        glText->PushString(textBaseline, "Memory Unused Bytes: %u | Reserve Bytes: %u | Pad Bytes: %u", Memory::memoryUnusedBytes, Memory::memoryBlockReservedBytes,  Memory::memoryPadBytes);
+        glText->PushString(textBaseline, "Memory Unused Bytes: %u | Reserve Bytes: %u | Pad Bytes: %u", stats.memoryUnusedBytes, stats.memoryBlockReservedBytes,  stats.memoryPadBytes);
+        textBaseline+= lineAdvance;
+
+        glText->PushString(textBaseline, "Pooled Bytes: %u | Pooled Blocks: %u", stats.poolBytes, stats.poolBlockCount);
+        textBaseline+= lineAdvance;
+
+        glText->PushString(textBaseline, "Memory Syscalls: %u | Huge Page Blocks: %u", stats.memorySyscallCount, stats.memoryHugeBlockCount);
+        textBaseline+= lineAdvance;
+
+        glText->PushString(textBaseline, "Object Pool Slots: %u | Free Slots: %u", stats.objectPoolSlotCount, stats.objectPoolFreeSlotCount);
         textBaseline+= lineAdvance;
     #endif
     
     return textBaseline;
 }
 
+inline
+Vec2<float> DrawFrameAllocations(GlText* glText, const FrameAllocations& frameAllocations, Vec2<float> textBaseline, Vec2<float> lineAdvance) {
+    #if ENABLE_ALLOCATION_COUNTERS
+        const AllocationCounters::Counts& counts = frameAllocations.LastFrameCounts();
+
+        glText->PushString(textBaseline, "Frame Allocations - Heap Syscalls: %u | FreeType Mallocs: %u | GL Buffers: %u",
+                           counts[AllocationCounters::COUNTER_HEAP_SYSCALLS],
+                           counts[AllocationCounters::COUNTER_FREETYPE_MALLOCS],
+                           counts[AllocationCounters::COUNTER_GL_BUFFER_ALLOCATIONS]);
+        textBaseline+= lineAdvance;
+
+        glText->PushString(textBaseline, "Allocating Frames After Warm-up: %u%s",
+                           frameAllocations.AllocatingFrameCount(), frameAllocations.IsWarm() ? "" : " (warming up)");
+        textBaseline+= lineAdvance;
+    #endif
+
+    return textBaseline;
+}
+
 Vec2<float> DrawFPS(GlText* glText, float renderTime, float frameTime,
                     Vec2<float> textBaseline, Vec2<float> lineAdvance) {
 
@@ -140,10 +173,11 @@ Vec2<float> DrawTransform(GlText* glText, const GlTransform& transform,
 }
 
 inline
-void DrawStrings(GlText* glText, float renderTime, float frameTime, const GlTransform& transform, 
+void DrawStrings(GlText* glText, float renderTime, float frameTime, const GlTransform& transform, const FrameAllocations& frameAllocations,
                  Vec2<float> textBaseline, Vec2<float> lineAdvance) {
 
     textBaseline = DrawMemoryStats(glText, textBaseline, lineAdvance);
+    textBaseline = DrawFrameAllocations(glText, frameAllocations, textBaseline, lineAdvance);
     textBaseline = DrawFPS(glText, renderTime, frameTime, textBaseline, lineAdvance);
     textBaseline = DrawTransform(glText, transform, textBaseline, lineAdvance);
     
@@ -247,6 +281,8 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
 [[noreturn]] void* activityLoop(void* params_) {
 
     RenderThreadParams* params = (RenderThreadParams*) params_;
+    
+    Memory::temporaryArena.SetTraceName("temporaryArena");
 
     //Initialize EGL on current thread
     glContext.Init(params->androidNativeWindow);
@@ -254,8 +290,11 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
     //Set ArCore screen geometry
     ARWrapper::Instance()->UpdateScreenSize(glContext.Width(), glContext.Height());
 
+    //Note: assets load in the background while we render. Completed loads are uploaded at the start of each frame
+    AssetLoader assetLoader;
+
     //setup GlText
-    GlText glText(&glContext, "fonts/xolonium_regular.ttf");
+    GlText glText(&glContext, "fonts/xolonium_regular.ttf", 0, &assetLoader, AssetLoader::PRIORITY_HIGH);
     glText.RenderTexture(GlText::RenderParams {
         .targetGlyphSize = 25,
         .renderStringAttrib = { .rgba = RGBAf(1.f, 0, 0) },
@@ -382,15 +421,16 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
         // .camera = &backCamera,
         .camera = &frontCamera,
         .generateMipmaps = true, //Note: used for object roughness parameter
-    });
+    }, &assetLoader);
 
     //Setup object to render
 
     GlObject objects[] = {
-        GlObject("meshes/cow.obj",
+        GlObject("meshes/cow.mesh",
                  &backCamera,
                  &skybox,
-                 GlTransform(Vec3(0.f, -.1f, -1.f), Vec3(.03f, .03f, .03f))
+                 GlTransform(Vec3(0.f, -.1f, -1.f), Vec3(.03f, .03f, .03f)),
+                 &assetLoader
         ),
 
         GlObject("meshes/blenderUmbrella.obj",
@@ -400,11 +440,11 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
                     Vec3(0.f, 0.f, -1.f),   //position
                     Vec3(.01f, .01f, .01f), //scale
                     Vec3<float>(ToRadians(-90.f), ToRadians(0.f), ToRadians(25.f)) //rotation
-                )
+                ),
+                &assetLoader
         )
     };
 
-    //TODO: computed normals are incorrect this.. need to add verticies when normals change direction!    
     // GlObject obj("meshes/cube.obj",
     //              &backCamera,
     //              &skybox,
@@ -430,15 +470,49 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
     //             );
 
     
+    //Note: asset loading churns through a lot of temporary memory - let the kernel have it back once it's done
+    bool assetsLoading = true;
+    
+    //Note: frame data is kept around for 'kMaxFramesInFlight' frames so it can't be recycled while the GPU is still using it
+    constexpr uint32 kMaxFramesInFlight = 3;
+    Memory::FrameArena<kMaxFramesInFlight> frameArena;
+
+    //Note: the render loop shouldn't allocate once every buffer has grown to its steady state size.
+    //      Set kPanicOnSteadyStateAllocation for benchmark runs so a frame that allocates fails the run
+    constexpr uint32 kAllocationWarmupFrames = 2*kTargetFPS;
+    constexpr bool kPanicOnSteadyStateAllocation = false;
+    FrameAllocations frameAllocations(kAllocationWarmupFrames, kPanicOnSteadyStateAllocation);
+
     Timer fpsTimer(true);
     Timer physicsTimer(true);
     Timer frontCameraTimer(true);
 
     constexpr float kFrontCameraUpdateInterval = .5;
 
+    #if ENABLE_MEMORY_TRACING
+        //Note: dump once asset loading and a few seconds of steady state frames are in the trace
+        //      pull it with: adb shell run-as com.eecs487.jniteapot cat memoryTrace.txt
+        constexpr const char* kMemoryTracePath = "/data/data/com.eecs487.jniteapot/memoryTrace.txt";
+        constexpr uint32 kMemoryTraceFrame = 10*kTargetFPS;
+        uint32 traceFrameCount = 0;
+    #endif
+
     for(Timer loopTimer(true) ;; loopTimer.SleepLapMs(kTargetMsFrameTime) ) {
 
         float secElapsed = physicsTimer.LapSec();
+
+        //upload assets that finished loading
+        //Note: limit uploads per frame so a burst of completed loads doesn't stall a single frame
+        constexpr uint32 kMaxAssetUploadsPerFrame = 2;
+        assetLoader.Update(kMaxAssetUploadsPerFrame);
+
+        if(assetsLoading && !assetLoader.PendingJobCount()) {
+            assetsLoading = false;
+            Memory::DecommitBlockPool();
+
+            //Note: uploads allocate, steady state starts once they're done
+            frameAllocations.RestartWarmup();
+        }
         
         // TODO: POLL ANDROID MESSAGE LOOP FOR KEY EVENTS
 
@@ -518,12 +592,19 @@ void UpdateFrameCamera(ARInstance arInstance, GlCamera& camera) {
                     loopTimer.ElapsedSec(),
                     fpsTimer.LapSec(),
                     backCamera.GetTransform(),
+                    frameAllocations,
                     Vec2(50.f, 50.f), //textBaseline
                     Vec2(0.f, 50.f)   //textAdvance
                 );
         
         // present back buffer
         if(!glContext.SwapBuffers()) InitGlesState();
+        frameArena.NextFrame();
+        frameAllocations.NextFrame();
+
+        #if ENABLE_MEMORY_TRACING
+            if(++traceFrameCount == kMemoryTraceFrame) Memory::DumpTrace(kMemoryTracePath);
+        #endif
     }
 }
 
@@ -534,6 +615,8 @@ extern "C" {
         RUNTIME_ASSERT(surface, "Surface Is NULL!");
 
         FileManager::Init(jniEnv, jAssetManager);
+        FileManager::InitPack();
+        AssetCache::Init(jniEnv, jActivity);
     
         ARWrapper::Instance()->InitializeARWrapper(jniEnv, jActivity);
         ARWrapper::FrontInstance()->InitializeARWrapper(jniEnv, jActivity);
@@ -8,8 +8,17 @@
 	#include "memUtil.h"
 	#include "stringUtil.h"
 
-	#include <android/log.h>
 	#include <stdio.h>
+
+	#if defined(__ANDROID__)
+		#include <android/log.h>
+	#else
+		//Note: host builds (benchmarks) don't have liblog so logs are written to stderr instead of logcat
+		enum android_LogPriority { ANDROID_LOG_INFO = 4, ANDROID_LOG_WARN = 5, ANDROID_LOG_ERROR = 6 };
+
+		#define __android_log_print(priority, tag, ...) ((void)(priority), fprintf(stderr, __VA_ARGS__))
+		#define __android_log_write(priority, tag, text) ((void)(priority), fputs(text, stderr))
+	#endif
 	
 	enum LogLevel:  uint8 { LOG_LEVEL_MSG = 1, LOG_LEVEL_WARN, LOG_LEVEL_ERROR };
 	enum LogOption: uint8 { LOG_OPT_FLUSH = 1 };
@@ -94,6 +94,60 @@ inline float FastPow10(int n) {
     return pow10Table[n];
 }
 
+// Converts to an IEEE half float rounding to nearest even. Out of range floats become infinity
+inline unsigned short FloatToHalf(float n) {
+    unsigned int bits;
+    __builtin_memcpy(&bits, &n, sizeof(bits));
+    
+    unsigned int sign = (bits>>16) & 0x8000,
+                 magnitude = bits & 0x7FFFFFFF;
+    
+    if(magnitude >= 0x7F800000) return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0); //Note: inf and nan
+    if(magnitude >= 0x477FF000) return sign | 0x7C00; //Note: 65520 and up round past the largest half
+    
+    unsigned int half, remainder, halfway;
+    if(magnitude >= 0x38800000) {
+        
+        //Note: normal half - rebias the exponent and drop the bottom 13 bits of the mantissa
+        half = (magnitude - 0x38000000) >> 13;
+        remainder = magnitude & 0x1FFF;
+        halfway = 0x1000;
+    
+    } else {
+        
+        //Note: subnormal half - everything under 2^-25 rounds to zero
+        if(magnitude < 0x33000000) return sign;
+        
+        unsigned int mantissa = (magnitude & 0x7FFFFF) | 0x800000,
+                     shift = 126 - (magnitude>>23);
+        
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u<<shift) - 1);
+        halfway = 1u<<(shift-1);
+    }
+    
+    //Note: rounding up can carry into the exponent which is still the right answer
+    half+= remainder > halfway || (remainder == halfway && (half&1));
+    return sign | half;
+}
+
+inline float HalfToFloat(unsigned short half) {
+    unsigned int sign = (half & 0x8000u) << 16,
+                 exponent = (half>>10) & 0x1F,
+                 mantissa = half & 0x3FF;
+    
+    if(!exponent) {
+        float n = float(mantissa) * (1.f/16777216.f); //Note: subnormals are in units of 2^-24
+        return sign ? -n : n;
+    }
+    
+    unsigned int bits = sign | (exponent == 0x1F ? 0x7F800000 | (mantissa<<13) : ((exponent + 112)<<23) | (mantissa<<13));
+    
+    float n;
+    __builtin_memcpy(&n, &bits, sizeof(n));
+    return n;
+}
+
 constexpr int Round(float n) { return int(n + .5f); }
 constexpr int IPart(float n) { return int(n);}
 constexpr float FPart(float n) { return n - IPart(n);}
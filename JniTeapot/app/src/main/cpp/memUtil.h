@@ -2,6 +2,10 @@
 
 #include <sys/mman.h>
 
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
 struct HeapPointer {
     void* ptr;
     size_t bytes;
@@ -34,6 +38,63 @@ inline HeapPointer HeapAllocate(size_t bytes) {
     };
 }
 
+//Returns a pointer to Read/Write memory backed by explicit (hugetlbfs) huge pages on Success
+//Returns InvalidHeapPtr on failure or if the kernel has no huge pages reserved
+//Note: 'bytes' must be a multiple of the huge page size
+inline HeapPointer HeapAllocateHugePages(size_t bytes) {
+
+    #ifdef MAP_HUGETLB
+        return HeapPointer {
+            .ptr = mmap(nullptr,
+                    bytes,
+                    PROT_READ|PROT_WRITE,
+                    MAP_ANONYMOUS|MAP_PRIVATE|MAP_HUGETLB,
+                    -1, // some linux variations require fd to be -1
+                    0   // offset must be 0 with MAP_ANONYMOUS
+                ),
+
+            .bytes = bytes
+        };
+    #else
+        return HeapPointer { .ptr = MAP_FAILED, .bytes = bytes };
+    #endif
+}
+
+//Asks the kernel to back [ptr, ptr+bytes] with transparent huge pages
+//Returns true on success, false on error or if transparent huge pages are disabled
+inline bool HeapAdviseHugePages(void* ptr, size_t bytes) {
+    #ifdef MADV_HUGEPAGE
+        return !madvise(ptr, bytes, MADV_HUGEPAGE);
+    #else
+        return false;
+    #endif
+}
+
+//Reserves 'bytes' of address space without backing it with memory
+//Returns InvalidHeapPtr on failure
+//Note: pages must be committed with HeapCommit before they are accessed
+inline HeapPointer HeapReserve(size_t bytes) {
+
+    return HeapPointer {
+        .ptr = mmap(nullptr,
+                bytes,
+                PROT_NONE,
+                MAP_ANONYMOUS|MAP_PRIVATE|MAP_NORESERVE,
+                -1, // some linux variations require fd to be -1
+                0   // offset must be 0 with MAP_ANONYMOUS
+            ),
+
+        .bytes = bytes
+    };
+}
+
+//Makes the reserved pages in the range [ptr, ptr+bytes] Read/Write
+//Returns true on success, false on error.
+//Note: 'ptr' must be page aligned. Newly committed pages are zeroed
+inline bool HeapCommit(void* ptr, size_t bytes) {
+    return !mprotect(ptr, bytes, PROT_READ|PROT_WRITE);
+}
+
 //Frees all memory in the range [ptr, ptr+bytes]
 //Returns true on success, false on error.
 inline bool HeapFree(void* ptr, size_t bytes) {
@@ -46,6 +107,19 @@ inline bool HeapFree(const HeapPointer& heapPtr) {
     return HeapFree(heapPtr.ptr, heapPtr.bytes);
 }
 
+//Lets the kernel reclaim the physical pages backing [ptr, ptr+bytes] while keeping the address range mapped
+//Returns true on success, false on error.
+//Note: the contents of the range are undefined after this call until they are written to again
+inline bool HeapDecommit(void* ptr, size_t bytes) {
+
+    //Note: MADV_FREE is lazy and much cheaper than MADV_DONTNEED, but requires linux 4.5+
+    #ifdef MADV_FREE
+        if(!madvise(ptr, bytes, MADV_FREE)) return true;
+    #endif
+
+    return !madvise(ptr, bytes, MADV_DONTNEED);
+}
+
 template<typename T, size_t n> constexpr size_t ArrayCount(const T(&)[n]) { return n; }
 
 template<typename T> constexpr void* ByteOffset(const void* ptr, const T& bytes) { return (char*)ptr + bytes; }
@@ -78,4 +152,59 @@ constexpr void ZeroStruct(T* mem) {
 
 inline void FillMemory(void* mem, unsigned int value, unsigned int bytes) { __builtin_memset(mem, value, bytes); }
 
-inline void CopyMemory(void *dst, void* src, unsigned int bytes) { __builtin_memcpy(dst, src, bytes); }
\ No newline at end of file
+inline void CopyMemory(void *dst, void* src, unsigned int bytes) { __builtin_memcpy(dst, src, bytes); }
+
+//Copies 'bytes' from 'src' to 'dst' with stores that bypass the cache
+//Note: meant for write-only destinations like mapped GL buffers. Avoids pulling the destination into the cache
+//      and evicting data we actually use. Falls back to a normal memcpy if the compiler can't emit non-temporal stores
+inline void CopyMemoryNonTemporal(void* dst, const void* src, unsigned int bytes) {
+    
+    #if __has_builtin(__builtin_nontemporal_store)
+        typedef unsigned int Vec128 __attribute__((vector_size(16)));
+        
+        //Note: non-temporal stores need 16 byte aligned destinations
+        unsigned int headBytes = AlignUpOffsetPow2((char*)dst, 16);
+        if(headBytes >= bytes) {
+            __builtin_memcpy(dst, src, bytes);
+            return;
+        }
+        
+        __builtin_memcpy(dst, src, headBytes);
+        
+        char* dstBytes = (char*)dst + headBytes;
+        const char* srcBytes = (const char*)src + headBytes;
+        bytes-= headBytes;
+
+        for(; bytes >= 16; bytes-= 16, dstBytes+= 16, srcBytes+= 16) {
+            Vec128 v;
+            __builtin_memcpy(&v, srcBytes, 16);
+            __builtin_nontemporal_store(v, (Vec128*)dstBytes);
+        }
+
+        __builtin_memcpy(dstBytes, srcBytes, bytes);
+
+        //Note: x86 non-temporal stores are weakly ordered, fence them before anyone else (the GL driver) reads the buffer
+        #if defined(__SSE2__)
+            _mm_sfence();
+        #endif
+    #else
+        __builtin_memcpy(dst, src, bytes);
+    #endif
+}
+
+//Copies 'count' elements of 'elementBytes' from 'src' spaced 'srcStride' bytes apart to 'dst' spaced 'dstStride' bytes apart
+//Note: densely packed ranges are copied with a single memcpy. 'nonTemporal' uses non-temporal stores for densely
+//      packed ranges, strided stores always go through the cache
+inline void CopyStrided(void* dst, unsigned int dstStride, const void* src, unsigned int srcStride,
+                        unsigned int elementBytes, unsigned int count, bool nonTemporal = false) {
+
+    if(srcStride == elementBytes && dstStride == elementBytes) {
+        if(nonTemporal) CopyMemoryNonTemporal(dst, src, elementBytes*count);
+        else            __builtin_memcpy(dst, src, elementBytes*count);
+        return;
+    }
+
+    char* dstBytes = (char*)dst;
+    const char* srcBytes = (const char*)src;
+    for(; count; --count, dstBytes+= dstStride, srcBytes+= srcStride) __builtin_memcpy(dstBytes, srcBytes, elementBytes);
+}
\ No newline at end of file
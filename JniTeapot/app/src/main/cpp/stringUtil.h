@@ -3,15 +3,30 @@
 #include "types.h"
 #include "mathUtil.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
 template<auto n> constexpr auto StrCount(const char(&)[n]) 		{ return n-1; }
 template<auto n> constexpr auto StrCount(const wchar_t(&)[n]) 	{ return n-1; }
 
 constexpr char LowerCase(char c) { return c | (1<<5);}
 constexpr char UpperCase(char c) { return c & (~(1<<5));}
 
+// Note: every parser below stops at a null terminator or at 'bufferEnd', whichever comes first.
+//       Pass 'bufferEnd' when parsing a buffer that isn't null terminated (ex. a mapped asset)
 template<typename T>
-inline T* SkipLine(T* str) {
-    while(*str && *str++ != '\n');
+inline const T* UnboundedStrEnd() { return (const T*)MaxSizeT(); }
+
+template<typename T>
+inline T* SkipLine(T* str, const T* bufferEnd = UnboundedStrEnd<T>()) {
+    while(str < bufferEnd && *str && *str++ != '\n');
     return str;
 }
 
@@ -27,14 +42,19 @@ constexpr bool IsWhiteSpace(char c) {
 }
 
 template<typename T>
-inline T* SkipWhiteSpace(T* str) {
-    for(char c; (c = *str) && IsWhiteSpace(c); ++str);
+inline T* SkipWhiteSpace(T* str, const T* bufferEnd = UnboundedStrEnd<T>()) {
+    for(char c; str < bufferEnd && (c = *str) && IsWhiteSpace(c); ++str);
     return str;
-} 
+}
 
-inline auto StrSign(char* str, char** strEnd = nullptr) {
+// Returns the character at 'str' or 0 if 'str' is at 'bufferEnd'
+inline char StrPeek(const char* str, const char* bufferEnd = UnboundedStrEnd<char>()) {
+    return str < bufferEnd ? *str : 0;
+}
+
+inline auto StrSign(char* str, char** strEnd = nullptr, const char* bufferEnd = UnboundedStrEnd<char>()) {
     
-    switch(*str) {
+    switch(StrPeek(str, bufferEnd)) {
         case '-': {
             if(strEnd) *strEnd = str+1;
             return -1;
@@ -54,14 +74,14 @@ inline auto StrSign(char* str, char** strEnd = nullptr) {
 }
 
 template<typename T>
-inline T StrDigits(char* str, T maxValue, char** strEnd = nullptr) {
+inline T StrDigits(char* str, T maxValue, char** strEnd = nullptr, const char* bufferEnd = UnboundedStrEnd<char>()) {
     
     //skip over leading 0's
-    while(*str == '0') ++str;
+    while(StrPeek(str, bufferEnd) == '0') ++str;
     
     //grab digits
     T digits = 0;
-    for(char c; InRange((c = *str), '0', '9'); ++str) {
+    for(char c; InRange((c = StrPeek(str, bufferEnd)), '0', '9'); ++str) {
         
         //Note: we check in separate variable to prevent overflow
         T newDigits = 10*digits + (c - '0');
@@ -74,41 +94,457 @@ inline T StrDigits(char* str, T maxValue, char** strEnd = nullptr) {
     return digits;
 }
 
-inline int32 StrToInt(char* str, char** strEnd = nullptr) {
-    str = SkipWhiteSpace(str);
-    int sign = StrSign(str, &str);
-    return sign*StrDigits(str, MaxInt32(), strEnd);
+#if defined(__ARM_NEON)
+    constexpr uint32 kDigitMaskBitsPerChar = 4; //Note: neon has no movemask so every char gets a nibble
+#else
+    constexpr uint32 kDigitMaskBitsPerChar = 1;
+#endif
+
+// Returns true if 'bytes' bytes can be read at 'str' without crossing 'bufferEnd' or a page boundary
+// Note: a load that stays in the page can't fault even if it reads past the null terminator of an unbounded string
+inline bool StrCanLoad(const char* str, uint32 bytes, const char* bufferEnd = UnboundedStrEnd<char>()) {
+    constexpr uintptr_t kPageBytes = 4096;
+    return uintptr_t(bufferEnd) - uintptr_t(str) >= bytes && (uintptr_t(str) & (kPageBytes-1)) <= kPageBytes - bytes;
 }
 
-inline float StrToFloat(char* str, char** strEnd = nullptr) {
-    
-    str = SkipWhiteSpace(str);
-    int sign = StrSign(str, &str),
-        digits = StrDigits(str, 0xFFFFFF, &str); //get leading digits
-    
-    //get number of digits to decimal point
-    char* tmpStr = str;
-    while(InRange(*str, '0', '9')) ++str;
-    int power = str - tmpStr;
-    
+// Returns a mask with 'kDigitMaskBitsPerChar' bits set for every digit in the 16 chars at 'str'
+// Warn: always reads 16 bytes, check StrCanLoad first
+inline uint64 StrDigitMask16(const char* str) {
+
+    #if defined(__ARM_NEON)
+        uint8x16_t chars = vld1q_u8((const uint8*)str);
+        uint8x16_t isDigit = vcltq_u8(vsubq_u8(chars, vdupq_n_u8('0')), vdupq_n_u8(10));
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(isDigit), 4)), 0);
+
+    #elif defined(__SSE2__)
+        __m128i chars = _mm_loadu_si128((const __m128i*)str);
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0'-1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9'+1)));
+        return uint32(_mm_movemask_epi8(isDigit));
+
+    #else
+        uint64 digitMask = 0;
+        for(uint32 i = 0; i < 16; ++i) digitMask|= uint64(InRange(str[i], '0', '9')) << i;
+        return digitMask;
+    #endif
+}
+
+// Returns the number of digits before the first non digit in a StrDigitMask16 mask
+inline uint32 DigitMaskRun(uint64 digitMask) {
+    //Note: only a neon mask can fill all 64 bits, smaller masks always have a non digit past the 16th char
+    uint64 nonDigits = ~digitMask;
+    return nonDigits ? __builtin_ctzll(nonDigits) / kDigitMaskBitsPerChar : 16;
+}
+
+// Returns the number of consecutive digits at the start of 'str'
+// Note: scans 16 bytes at a time
+inline uint32 StrDigitRun(const char* str, const char* bufferEnd = UnboundedStrEnd<char>()) {
+
+    const char* runStart = str;
+    while(StrCanLoad(str, 16, bufferEnd)) {
+        uint32 run = DigitMaskRun(StrDigitMask16(str));
+        if(run < 16) return (str - runStart) + run;
+
+        str+= 16;
+    }
+
+    while(InRange(StrPeek(str, bufferEnd), '0', '9')) ++str;
+    return str - runStart;
+}
+
+// Converts 8 digit chars packed in a little endian uint64 to an integer with a few multiplies instead of 8 dependent ones
+// Note: 0 bytes are treated like '0' so shorter runs can be shifted up to the top of 'chars'
+inline uint32 StrEightDigits(uint64 chars) {
+    chars = ((chars & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;               //pairs of digits
+    chars = ((chars & 0x00FF00FF00FF00FF) * 6553601) >> 16;           //groups of 4
+    return uint32(((chars & 0x0000FFFF0000FFFF) * 42949672960001) >> 32);
+}
+
+// Converts the first 'count' (at most 8) of 8 digit chars at 'str'
+// Warn: always reads 8 bytes
+inline uint32 StrShortDigits(const char* str, uint32 count) {
+    if(!count) return 0;
+
+    uint64 chars;
+    memcpy(&chars, str, sizeof(chars));
+    return StrEightDigits(chars << 8*(8 - count));
+}
+
+// Appends 'count' digits at 'str' to 'value'
+// Warn: doesn't check for overflow, keep 'count' small enough that the result fits
+inline uint64 StrAppendDigits(const char* str, uint32 count, uint64 value = 0) {
+    for(; count >= 8; count-= 8, str+= 8) value = 100000000*value + StrShortDigits(str, 8);
+    for(; count; --count, ++str) value = 10*value + (*str - '0');
+    return value;
+}
+
+inline int32 StrToInt(char* str, char** strEnd = nullptr, const char* bufferEnd = UnboundedStrEnd<char>()) {
+    str = SkipWhiteSpace(str, bufferEnd);
+    int sign = StrSign(str, &str, bufferEnd);
+
+    while(StrPeek(str, bufferEnd) == '0') ++str;
+
+    //Note: 9 digits always fit in an int32, longer runs stop before they overflow in StrDigits
+    uint32 numDigits = StrDigitRun(str, bufferEnd);
+    if(numDigits > 9) return sign*StrDigits(str, MaxInt32(), strEnd, bufferEnd);
+
+    if(strEnd) *strEnd = str + numDigits;
+    return sign*int32(StrAppendDigits(str, numDigits));
+}
+
+struct UInt128 { uint64 low, high; };
+
+inline UInt128 Multiply128(uint64 a, uint64 b) {
+    #if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = (unsigned __int128)a * b;
+        return { uint64(product), uint64(product >> 64) };
+    #else
+        //Note: 32 bit targets (x86 emulator) don't have a 128 bit type so we multiply 32 bit halves
+        uint64 aLow = uint32(a), aHigh = a >> 32,
+               bLow = uint32(b), bHigh = b >> 32;
+
+        uint64 lowLow = aLow*bLow, lowHigh = aLow*bHigh, highLow = aHigh*bLow, highHigh = aHigh*bHigh;
+        uint64 middle = (lowLow >> 32) + uint32(lowHigh) + uint32(highLow);
+
+        return { (middle << 32) | uint32(lowLow), highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32) };
+    #endif
+}
+
+//Note: powers of 10 past 10^10 aren't exact floats
+constexpr float kExactFloatPow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+// Correctly rounds 'mantissa' * 10^'power' to the nearest float (ties to even) and stores it in 'result'
+// Returns false without touching 'result' if the product lands too close to a rounding boundary to decide with
+// 128 bits of 5^power. Callers have to fall back to an exact conversion then
+//
+// Note: this is the Eisel-Lemire algorithm. The mantissa is normalized to 64 bits and multiplied by a 128 bit
+//       truncation of 5^power, the top bits of the product are the float mantissa and the rest tell us how to round.
+//       See "Number Parsing at a Gigabyte per Second" (Lemire 2021)
+inline bool DecimalToFloat(uint64 mantissa, int32 power, float* result) {
+
+    constexpr int32 kMinPower = -65, //Note: 2^64 * 10^-65 rounds to 0
+                    kMaxPower = 38;  //      1 * 10^39 rounds to infinity
+
+    //Note: trailing zeros (ex. 5.2573100e-001) can push an otherwise short mantissa out of the exact range below
+    if(mantissa > (1<<24) && mantissa <= MaxUint32()) {
+        uint32 trimmed = mantissa;
+        while(trimmed > (1<<24) && trimmed % 10 == 0) {
+            trimmed/= 10;
+            ++power;
+        }
+        mantissa = trimmed;
+    }
+
+    //Note: when the mantissa and the power of 10 are exact floats IEEE multiplication/division already rounds correctly.
+    //      This is the common case for obj files
+    if(mantissa <= (1<<24) && InRange(power, -10, 10)) {
+        *result = power < 0 ? float(mantissa) / kExactFloatPow10[-power] : float(mantissa) * kExactFloatPow10[power];
+        return true;
+    }
+
+    if(!mantissa || power < kMinPower) {
+        *result = 0.f;
+        return true;
+    }
+
+    if(power > kMaxPower) {
+        *result = Infinity();
+        return true;
+    }
+
+    //Note: 5^power normalized so its top bit is set. Negative powers are rounded up, positive ones are truncated.
+    //      entries are { high, low } for powers in [kMinPower, kMaxPower]
+    static const uint64 pow5Table[][2] = {
+        { 0x86CCBB52EA94BAEAULL, 0x98E947129FC2B4E9ULL }, { 0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL },
+        { 0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL }, { 0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL },
+        { 0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL }, { 0xCDB02555653131B6ULL, 0x3792F412CB06794DULL },
+        { 0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL }, { 0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL },
+        { 0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL }, { 0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL },
+        { 0x9CED737BB6C4183DULL, 0x55464DD69685606BULL }, { 0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL },
+        { 0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL }, { 0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL },
+        { 0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL }, { 0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL },
+        { 0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL }, { 0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL },
+        { 0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL }, { 0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL },
+        { 0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL }, { 0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL },
+        { 0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL }, { 0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL },
+        { 0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL }, { 0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL },
+        { 0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL }, { 0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL },
+        { 0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL }, { 0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL },
+        { 0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL }, { 0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL },
+        { 0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL }, { 0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL },
+        { 0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL }, { 0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL },
+        { 0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL }, { 0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL },
+        { 0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL }, { 0xC612062576589DDAULL, 0x95364AFE032A819EULL },
+        { 0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL }, { 0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL },
+        { 0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL }, { 0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL },
+        { 0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL }, { 0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL },
+        { 0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL }, { 0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL },
+        { 0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL }, { 0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL },
+        { 0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL }, { 0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL },
+        { 0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL }, { 0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL },
+        { 0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL }, { 0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL },
+        { 0x89705F4136B4A597ULL, 0x31680A88F8953031ULL }, { 0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL },
+        { 0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL }, { 0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL },
+        { 0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL }, { 0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL },
+        { 0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL }, { 0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL },
+        { 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL }, { 0x8000000000000000ULL, 0x0000000000000000ULL },
+        { 0xA000000000000000ULL, 0x0000000000000000ULL }, { 0xC800000000000000ULL, 0x0000000000000000ULL },
+        { 0xFA00000000000000ULL, 0x0000000000000000ULL }, { 0x9C40000000000000ULL, 0x0000000000000000ULL },
+        { 0xC350000000000000ULL, 0x0000000000000000ULL }, { 0xF424000000000000ULL, 0x0000000000000000ULL },
+        { 0x9896800000000000ULL, 0x0000000000000000ULL }, { 0xBEBC200000000000ULL, 0x0000000000000000ULL },
+        { 0xEE6B280000000000ULL, 0x0000000000000000ULL }, { 0x9502F90000000000ULL, 0x0000000000000000ULL },
+        { 0xBA43B74000000000ULL, 0x0000000000000000ULL }, { 0xE8D4A51000000000ULL, 0x0000000000000000ULL },
+        { 0x9184E72A00000000ULL, 0x0000000000000000ULL }, { 0xB5E620F480000000ULL, 0x0000000000000000ULL },
+        { 0xE35FA931A0000000ULL, 0x0000000000000000ULL }, { 0x8E1BC9BF04000000ULL, 0x0000000000000000ULL },
+        { 0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL }, { 0xDE0B6B3A76400000ULL, 0x0000000000000000ULL },
+        { 0x8AC7230489E80000ULL, 0x0000000000000000ULL }, { 0xAD78EBC5AC620000ULL, 0x0000000000000000ULL },
+        { 0xD8D726B7177A8000ULL, 0x0000000000000000ULL }, { 0x878678326EAC9000ULL, 0x0000000000000000ULL },
+        { 0xA968163F0A57B400ULL, 0x0000000000000000ULL }, { 0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL },
+        { 0x84595161401484A0ULL, 0x0000000000000000ULL }, { 0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL },
+        { 0xCECB8F27F4200F3AULL, 0x0000000000000000ULL }, { 0x813F3978F8940984ULL, 0x4000000000000000ULL },
+        { 0xA18F07D736B90BE5ULL, 0x5000000000000000ULL }, { 0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL },
+        { 0xFC6F7C4045812296ULL, 0x4D00000000000000ULL }, { 0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL },
+        { 0xC5371912364CE305ULL, 0x6C28000000000000ULL }, { 0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL },
+        { 0x9A130B963A6C115CULL, 0x3C7F400000000000ULL }, { 0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL },
+        { 0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL }, { 0x96769950B50D88F4ULL, 0x1314448000000000ULL },
+    };
+
+    constexpr int32 kMantissaBits = 23,
+                    kExponentBias = 127;
+
+    const uint64* pow5 = pow5Table[power - kMinPower];
+
+    int32 leadingZeros = __builtin_clzll(mantissa);
+    mantissa<<= leadingZeros;
+
+    //Note: we need kMantissaBits+3 bits of the product. Only look at the low half of 5^power when the high half
+    //      leaves those bits ambiguous
+    UInt128 product = Multiply128(mantissa, pow5[0]);
+    constexpr uint64 kPrecisionMask = ~uint64(0) >> (kMantissaBits+3);
+    if((product.high & kPrecisionMask) == kPrecisionMask) {
+        UInt128 lowProduct = Multiply128(mantissa, pow5[1]);
+        product.low+= lowProduct.high;
+        if(lowProduct.high > product.low) ++product.high;
+
+        //Note: the bits of 5^power past the table could still carry into a product that's all ones below the bits we keep.
+        //      Powers in [-27, 55] are exact enough that they can't so only the rest are ambiguous
+        if(product.low == ~uint64(0) && !InRange(power, -27, 55)) return false;
+    }
+
+    uint32 upperBit = product.high >> 63;
+    uint32 shift = upperBit + 64 - kMantissaBits - 3;
+
+    uint64 bits = product.high >> shift;
+
+    //Note: floor(log2(10^power)) + 63 without a loop. 217706 = log2(10) * 2^16
+    int32 exponent = ((217706*power) >> 16) + 63 + upperBit - leadingZeros + kExponentBias;
+
+    if(exponent <= 0) {
+        //subnormal
+        if(-exponent + 1 >= 64) {
+            *result = 0.f;
+            return true;
+        }
+
+        bits>>= -exponent + 1;
+        bits+= bits & 1;
+        bits>>= 1;
+
+        //Note: rounding can carry a subnormal up to the smallest normal float
+        exponent = bits < (uint64(1) << kMantissaBits) ? 0 : 1;
+
+    } else {
+
+        //Note: product is exact so we're exactly halfway between two floats and have to round to even.
+        //      this can only happen with small powers where 5^power fits in 64 bits
+        if(product.low <= 1 && InRange(power, -17, 10) && (bits & 3) == 1 && (bits << shift) == product.high) bits&= ~uint64(1);
+
+        bits+= bits & 1;
+        bits>>= 1;
+
+        if(bits >= (uint64(2) << kMantissaBits)) {
+            bits = uint64(1) << kMantissaBits;
+            ++exponent;
+        }
+
+        bits&= ~(uint64(1) << kMantissaBits);
+        if(exponent >= 0xFF) {
+            *result = Infinity();
+            return true;
+        }
+    }
+
+    uint32 floatBits = uint32(bits) | (uint32(exponent) << kMantissaBits);
+    memcpy(result, &floatBits, sizeof(*result));
+    return true;
+}
+
+// Parses the short numbers that make up most text assets (at most 8 digits, an optional '.' and at most 8 more) out
+// of a single 16 byte load. Returns false without parsing anything if the number at 'str' isn't short
+inline bool StrShortDecimal(char* str, char** strEnd, uint64* mantissa, int64* power, const char* bufferEnd = UnboundedStrEnd<char>()) {
+    static const uint32 pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+    if(!StrCanLoad(str, 16, bufferEnd)) return false;
+
+    uint64 digitMask = StrDigitMask16(str);
+    uint32 intDigits = DigitMaskRun(digitMask);
+    if(intDigits > 8) return false;
+
+    uint32 fractionDigits = 0,
+           numChars = intDigits;
+
+    if(str[intDigits] == '.') {
+        //Note: the fraction is converted with an 8 byte load that has to stay inside the 16 we checked
+        if(intDigits == 8) return false;
+
+        fractionDigits = DigitMaskRun(digitMask >> (intDigits+1)*kDigitMaskBitsPerChar);
+        numChars+= 1 + fractionDigits;
+
+        //Note: the fraction has to end inside the load or there could be more digits after it
+        if(fractionDigits > 8 || numChars >= 16) return false;
+
+        //Note: trailing zeros (ex. 5.2573100e-001) are dropped so more mantissas fit DecimalToFloat's exact range
+        if(fractionDigits) {
+            uint64 fraction;
+            memcpy(&fraction, str + intDigits + 1, sizeof(fraction));
+
+            uint64 nonZeros = (fraction ^ 0x3030303030303030) << 8*(8 - fractionDigits);
+            fractionDigits = nonZeros ? fractionDigits - __builtin_clzll(nonZeros)/8 : 0;
+        }
+    }
+
+    *mantissa = uint64(StrShortDigits(str, intDigits))*pow10[fractionDigits] + StrShortDigits(str + intDigits + 1, fractionDigits);
+    *power = -int64(fractionDigits);
+    *strEnd = str + numChars;
+    return true;
+}
+
+// Parses the digits and decimal point of a number at 'str' into a mantissa of at most 19 significant digits and a power of 10
+// Returns true if digits had to be dropped from the mantissa
+inline bool StrDecimal(char* str, char** strEnd, uint64* mantissa, int64* power, const char* bufferEnd = UnboundedStrEnd<char>()) {
+
+    //Note: 19 digits always fit in a uint64
+    constexpr uint32 kMaxMantissaDigits = 19;
+
+    //skip over leading 0's
+    while(StrPeek(str, bufferEnd) == '0') ++str;
+
+    //get leading digits
+    uint32 numDigits = StrDigitRun(str, bufferEnd),
+           mantissaDigits = Min(numDigits, kMaxMantissaDigits);
+
+    *mantissa = StrAppendDigits(str, mantissaDigits);
+    *power = numDigits - mantissaDigits;
+    bool truncated = numDigits > mantissaDigits;
+    str+= numDigits;
+
     //check for decimal point
-    if(*str == '.') {
+    if(StrPeek(str, bufferEnd) == '.') {
         ++str;
-        
+
+        //Note: zeros after the decimal point aren't significant until we find a nonzero digit
+        if(!*mantissa) {
+            char* zeros = str;
+            while(StrPeek(str, bufferEnd) == '0') ++str;
+            *power-= str - zeros;
+        }
+
         //add fractional sigfigs
-        tmpStr = str;
-        for(char c; InRange((c = *str), '0', '9') && digits < 0xFFFFFF; ++str) {
-            digits = 10*digits + (c - '0');
+        numDigits = StrDigitRun(str, bufferEnd);
+        uint32 fractionDigits = Min(numDigits, kMaxMantissaDigits - mantissaDigits);
+
+        *mantissa = StrAppendDigits(str, fractionDigits, *mantissa);
+        *power-= fractionDigits;
+        truncated|= numDigits > fractionDigits;
+        str+= numDigits;
+    }
+
+    *strEnd = str;
+    return truncated;
+}
+
+// Correctly rounds the number in ['numberStart', 'mantissaEnd') * 10^'exponent' with libc
+// Note: only used when DecimalToFloat can't decide the rounding, in practice for numbers with more than 19 significant digits.
+//       libc gets a null terminated copy of the digits so it never reads past the buffer
+// Warn: digits past the end of the copy are dropped. Floats never need more than 112 significant digits to round correctly
+//       but a halfway number followed by hundreds of zeros and then a nonzero digit can round the wrong way
+inline float StrToFloatSlow(const char* numberStart, const char* mantissaEnd, int32 exponent) {
+
+    char number[256];
+    uint32 numberChars = 0;
+    number[numberChars++] = *numberStart == '-' ? '-' : '+';
+
+    int64 lastDigitPower = exponent;
+    bool inFraction = false;
+    for(const char* c = numberStart; c < mantissaEnd; ++c) {
+        if(*c == '.') { inFraction = true; continue; }
+        if(!InRange(*c, '0', '9')) continue;
+
+        bool leadingZero = (numberChars == 1 && *c == '0');
+        if(!leadingZero) {
+            //Note: dropped integer digits still scale the number
+            if(numberChars >= sizeof(number) - 32) {
+                if(!inFraction) ++lastDigitPower;
+                continue;
+            }
+            number[numberChars++] = *c;
         }
-        power-= str - tmpStr;
-        
-        //ignore remaining digits
-        while(InRange(*str, '0', '9')) ++str;
+        if(inFraction) --lastDigitPower;
     }
-    
+    snprintf(number + numberChars, sizeof(number) - numberChars, "e%lld", (long long)lastDigitPower);
+
+    return strtof(number, nullptr);
+}
+
+// Parses a float rounded to the nearest representable value so printing a float with 9 significant digits
+// and parsing it back gives the same float
+//
+// Note: digits are found 16 at a time with StrDigitMask16 and converted 8 at a time with StrEightDigits. The first 19
+//       significant digits are converted exactly by DecimalToFloat, longer numbers only fall back to libc when the
+//       dropped digits could change the rounding. So do the rare products DecimalToFloat can't round
+inline float StrToFloat(char* str, char** strEnd = nullptr, const char* bufferEnd = UnboundedStrEnd<char>()) {
+
+    str = SkipWhiteSpace(str, bufferEnd);
+    char* numberStart = str;
+
+    int sign = StrSign(str, &str, bufferEnd);
+
+    uint64 mantissa;
+    int64 power;
+    bool truncated = false;
+    if(StrShortDecimal(str, &str, &mantissa, &power, bufferEnd)) {
+
+        //Note: most obj numbers are short with no exponent and an exact float mantissa so a single IEEE division rounds them.
+        //      Returning before the general path below is ~15% faster on them
+        if(mantissa <= (1<<24) && LowerCase(StrPeek(str, bufferEnd)) != 'e') {
+            if(strEnd) *strEnd = str;
+
+            float result = float(mantissa) / kExactFloatPow10[-power];
+            return sign < 0 ? -result : result;
+        }
+    } else {
+        truncated = StrDecimal(str, &str, &mantissa, &power, bufferEnd);
+    }
+
+    char* mantissaEnd = str;
+
     //check for E
-    if(LowerCase(*str) == 'e') power+= StrToInt(++str, &str);
-    
+    int32 exponent = 0;
+    if(LowerCase(StrPeek(str, bufferEnd)) == 'e') {
+        int exponentSign = StrSign(++str, &str, bufferEnd);
+        exponent = exponentSign*StrDigits(str, int32(1<<30), &str, bufferEnd);
+    }
     if(strEnd) *strEnd = str;
-    return (sign*digits)*FastPow10(power);
-}
\ No newline at end of file
+
+    //Note: clamp so absurd exponents can't overflow. Anything past the clamp is 0 or infinity anyways
+    constexpr int64 kMaxPower = 1<<30;
+    power = Max(Min(power + exponent, kMaxPower), -kMaxPower);
+
+    //Note: when digits were dropped the exact value is between mantissa and mantissa+1 so if they round to the same float we're done
+    float result, upperResult;
+    if(!DecimalToFloat(mantissa, power, &result) ||
+       (truncated && (!DecimalToFloat(mantissa+1, power, &upperResult) || result != upperResult))) {
+        return StrToFloatSlow(numberStart, mantissaEnd, exponent);
+    }
+
+    return sign < 0 ? -result : result;
+}
@@ -154,6 +154,578 @@ TEST_FUNC(Quaternion) {
 }
 
 
+#include "Memory.h"
+TEST_FUNC(Memory) {
+
+    //test that recycled blocks are zeroed on request
+    {
+        Memory::Arena arena;
+        
+        uint8* bytes = (uint8*)arena.PushBytes(KB(8));
+        FillMemory(bytes, 0xFF, KB(8));
+        arena.FreeAll();
+        arena.Pack();
+
+        //Note: freed block now lives in the block pool and gets handed back to us dirty
+        uint8* zeroedBytes = (uint8*)arena.PushBytes(KB(8), true);
+        for(uint32 i = 0; i < KB(8); ++i) TEST_CONDITION(zeroedBytes[i] == 0);
+    }
+
+    //test that alignment holds across block boundaries
+    {
+        Memory::Arena arena;
+        for(uint32 i = 0; i < 1000; ++i) {
+            void* ptr = arena.PushBytes(i, false, 16);
+            TEST_CONDITION(IsAlignedPow2(ptr, 16));
+        }
+    }
+
+    //test that virtual arenas stay flat as they commit more pages
+    {
+        Memory::VirtualArena arena(MB(16));
+        for(uint32 i = 0; i < KB(64); ++i) *arena.PushType<uint32>() = i;
+
+        TEST_CONDITION(arena.IsFlat(arena.BaseRegion(), KB(64)*sizeof(uint32)));
+
+        uint32* values = (uint32*)arena.Flatten(KB(64)*sizeof(uint32));
+        for(uint32 i = 0; i < KB(64); ++i) TEST_CONDITION(values[i] == i);
+    }
+
+    //test that frames are recycled after kNumFrames frames and threads without a frame arena don't get one
+    {
+        TEST_CONDITION(!Memory::CurrentFrameArena());
+        
+        Memory::FrameArena<2> frameArena(MB(1));
+        TEST_CONDITION(Memory::CurrentFrameArena() == frameArena.Current());
+        
+        void* frameBytes = frameArena.Current()->PushBytes(64);
+        frameArena.NextFrame();
+        frameArena.NextFrame();
+        TEST_CONDITION(frameArena.Current()->PushBytes(64) == frameBytes);
+    }
+
+    //test that pools recycle slots and detect stale handles
+    {
+        Memory::Pool<Vec3<float>, true> pool;
+        
+        Vec3<float>* v = pool.Allocate();
+        auto handle = pool.GetHandle(v);
+        TEST_CONDITION(pool.Resolve(handle) == v);
+
+        pool.Free(v);
+        TEST_CONDITION(pool.Resolve(handle) == nullptr);
+        TEST_CONDITION(pool.Allocate() == v);
+    }
+
+    //test that strided and non-temporal copies match a byte by byte copy for odd counts and unaligned pointers
+    {
+        uint8 src[KB(1)+3], dst[KB(2)+3], expected[KB(2)+3];
+        for(uint32 i = 0; i < sizeof(src); ++i) src[i] = uint8(i*7 + 1);
+
+        const uint32 dstStrides[] = { 12, 16, 24, 32 };
+        for(uint32 dstStride : dstStrides) {
+            for(uint32 count = 0; count <= 9; ++count) {
+                for(uint32 offset = 0; offset < 4; ++offset) {
+                    FillMemory(dst, 0xCD, sizeof(dst));
+                    FillMemory(expected, 0xCD, sizeof(expected));
+                    for(uint32 i = 0; i < count; ++i) {
+                        for(uint32 b = 0; b < 12; ++b) expected[offset + i*dstStride + b] = src[3-offset + i*12 + b];
+                    }
+
+                    CopyStrided(dst + offset, dstStride, src + 3-offset, 12, 12, count, dstStride == 12);
+                    TEST_CONDITION(!memcmp(dst, expected, sizeof(dst)));
+                }
+            }
+        }
+
+        for(uint32 bytes = 0; bytes <= 67; ++bytes) {
+            FillMemory(dst, 0xCD, sizeof(dst));
+            CopyMemoryNonTemporal(dst + bytes%16, src + 3, bytes);
+            TEST_CONDITION(!memcmp(dst + bytes%16, src + 3, bytes) && dst[bytes%16 + bytes] == 0xCD);
+        }
+    }
+
+    //test that copying a region that spans blocks into a wider stride leaves the padding alone
+    {
+        Memory::Arena arena(KB(4));
+        constexpr uint32 kCount = KB(1);
+        for(uint32 i = 0; i < kCount; ++i) *arena.PushType<Vec3<float>>() = Vec3<float>(i, i+1, i+2);
+        TEST_CONDITION(!arena.IsFlat(arena.BaseRegion(), kCount*sizeof(Vec3<float>)));
+
+        Vec3<float> buffer[2*kCount];
+        FillMemory(buffer, 0, sizeof(buffer));
+        arena.CopyToBuffer<Vec3<float>>(kCount, buffer, sizeof(Vec3<float>), 2*sizeof(Vec3<float>));
+        for(uint32 i = 0; i < kCount; ++i) {
+            TEST_CONDITION(buffer[2*i].x == i && buffer[2*i].z == i+2 && buffer[2*i+1].y == 0.f);
+        }
+    }
+}
+
+#include "stringUtil.h"
+TEST_FUNC(StringUtil) {
+
+    //test that bounded parsers stop at bufferEnd instead of the null terminator
+    {
+        char str[] = "12.5 -34 789";
+        char* end;
+        
+        TEST_CONDITION(StrToFloat(str, &end, str+4) == 12.5f && end == str+4);
+        TEST_CONDITION(StrToInt(end, &end, str+8) == -34 && end == str+8);
+        TEST_CONDITION(StrToInt(end, &end, str+10) == 7 && end == str+10);
+        TEST_CONDITION(SkipWhiteSpace(str+4, str+4) == str+4);
+        TEST_CONDITION(SkipLine(str, str+6) == str+6);
+    }
+
+    //test that floats are rounded to nearest even including halfway cases, subnormals and long mantissas
+    {
+        char str[] = "0.1 16777217 3.4028235e38 1.4e-45 1.000000059604644775390625 1.0000000596046447753906250000001 -5.2573100e-001";
+        char* end = str;
+
+        TEST_CONDITION(StrToFloat(end, &end) == 0.1f);
+        TEST_CONDITION(StrToFloat(end, &end) == 16777216.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 3.4028235e38f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.4e-45f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.00000012f);
+        TEST_CONDITION(StrToFloat(end, &end) == -0.525731f && !*end);
+    }
+
+    //test numbers exactly halfway between two floats and a hair to either side of halfway
+    {
+        char str[] = "16777217 16777219 16777217.000001 16777216.999999 7.0064923216240854e-46 7.0064923216240853e-46 "
+                     "1.000000059604644775390624 1.000000059604644775390626 3.4028235677973366e38 3.4028235677973367e38";
+        char* end = str;
+
+        TEST_CONDITION(StrToFloat(end, &end) == 16777216.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 16777220.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 16777218.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 16777216.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.4e-45f);
+        TEST_CONDITION(StrToFloat(end, &end) == 0.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.f);
+        TEST_CONDITION(StrToFloat(end, &end) == 1.00000012f);
+        TEST_CONDITION(StrToFloat(end, &end) == 3.4028235e38f);
+        TEST_CONDITION(StrToFloat(end, &end) == Infinity() && !*end);
+    }
+}
+
+#include "AssetPack.h"
+#include "compressionUtil.h"
+TEST_FUNC(AssetPack) {
+
+    //test that lz4 blocks round trip, including matches that overlap the bytes they produce
+    {
+        Memory::Arena arena;
+        
+        const char src[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+                           "abcabcabcabcabcabcabcabcabcabcabcabcabcabc0123456789";
+        constexpr uint32 srcBytes = sizeof(src);
+        
+        uint32* hashTable = (uint32*)arena.PushBytes(kLz4HashTableSize*sizeof(uint32));
+        uint8* compressed = (uint8*)arena.PushBytes(Lz4CompressBound(srcBytes));
+        uint8* decompressed = (uint8*)arena.PushBytes(srcBytes);
+        
+        uint64 compressedBytes = Lz4CompressBlock((const uint8*)src, srcBytes, compressed, hashTable);
+        TEST_CONDITION(compressedBytes < srcBytes);
+        
+        TEST_CONDITION(Lz4DecompressBlock(compressed, compressedBytes, decompressed, srcBytes));
+        for(uint32 i = 0; i < srcBytes; ++i) TEST_CONDITION(decompressed[i] == uint8(src[i]));
+        
+        //Note: blocks must decompress to exactly the size we were told
+        TEST_CONDITION(!Lz4DecompressBlock(compressed, compressedBytes, decompressed, srcBytes-1));
+        TEST_CONDITION(!Lz4DecompressBlock(compressed, compressedBytes-1, decompressed, srcBytes));
+    }
+    
+    //test that the pack index finds every entry by path and nothing else
+    {
+        //Note: entries are sorted by hash and their paths point into 'pack'
+        const char pack[] = "cowspheretriangle";
+        AssetPackEntry entries[] = {
+            { .pathHash = AssetPathHash("cow"),      .pathLength = 3, .pathOffset = 0 },
+            { .pathHash = AssetPathHash("sphere"),   .pathLength = 6, .pathOffset = 3 },
+            { .pathHash = AssetPathHash("triangle"), .pathLength = 8, .pathOffset = 9 },
+        };
+        for(uint32 i = 1; i < ArrayCount(entries); ++i) {
+            for(uint32 j = i; j && entries[j-1].pathHash > entries[j].pathHash; --j) Swap(entries[j-1], entries[j]);
+        }
+        
+        TEST_CONDITION(FindAssetPackEntry(pack, entries, ArrayCount(entries), "cow")->pathOffset == 0);
+        TEST_CONDITION(FindAssetPackEntry(pack, entries, ArrayCount(entries), "sphere")->pathOffset == 3);
+        TEST_CONDITION(FindAssetPackEntry(pack, entries, ArrayCount(entries), "triangle")->pathOffset == 9);
+        
+        TEST_CONDITION(!FindAssetPackEntry(pack, entries, ArrayCount(entries), "cube"));
+        TEST_CONDITION(!FindAssetPackEntry(pack, entries, 0, "cow"));
+        
+        //Note: a path that collides with an entry's hash must not return that entry. Point cow's entry at "sph" to fake one
+        AssetPackEntry* cow = (AssetPackEntry*)FindAssetPackEntry(pack, entries, ArrayCount(entries), "cow");
+        cow->pathOffset = 3;
+        TEST_CONDITION(!FindAssetPackEntry(pack, entries, ArrayCount(entries), "cow"));
+    }
+}
+
+#include "ObjMesh.h"
+TEST_FUNC(ObjMesh) {
+    
+    //test that an obj builds into a valid mesh file with its positions interleaved
+    const char obj[] = "v 0 0 0\nv 1 0 0\nv 0 2 0\nf 1 2 3\n";
+    
+    Memory::Arena arena;
+    ObjMesh objMesh;
+    objMesh.Parse(obj, obj + sizeof(obj)-1);
+    MeshFileView mesh = objMesh.Build(&arena);
+    
+    MeshFileView readMesh;
+    TEST_CONDITION(ReadMeshFile(mesh.data, mesh.bytes, &readMesh));
+    TEST_CONDITION(mesh.header->vertexCount == 3 && mesh.header->indexCount == 3 && mesh.header->indexStride == sizeof(uint8));
+    TEST_CONDITION(mesh.header->boundsMax[0] == 1.f && mesh.header->boundsMax[1] == 2.f && mesh.header->boundsMin[2] == 0.f);
+    
+    const Vec3<float>* position = (const Vec3<float>*)ByteOffset(mesh.vertices, 2*mesh.header->vertexStride);
+    TEST_CONDITION(position->x == 0.f && position->y == 2.f);
+    
+    //Note: truncated files must be rejected
+    TEST_CONDITION(!ReadMeshFile(mesh.data, mesh.bytes-1, &readMesh));
+    
+    //Note: so must indices past the last vertex
+    {
+        uint8* corruptData = (uint8*)arena.PushBytes(mesh.bytes, false, alignof(MeshFileHeader));
+        memcpy(corruptData, mesh.data, mesh.bytes);
+        corruptData[mesh.header->indexOffset + 2] = 3;
+        TEST_CONDITION(!ReadMeshFile(corruptData, mesh.bytes, &readMesh));
+    }
+    
+    //test that generated normals split a cube's corners at its hard edges and nowhere else
+    {
+        const char cubeObj[] = "v -1 -1 -1\nv 1 -1 -1\nv -1 1 -1\nv 1 1 -1\nv -1 -1 1\nv 1 -1 1\nv -1 1 1\nv 1 1 1\n"
+                               "f 1 3 2\nf 2 3 4\nf 5 6 7\nf 6 8 7\nf 1 2 5\nf 2 6 5\nf 3 7 4\nf 4 7 8\nf 1 5 3\nf 3 5 7\nf 2 4 6\nf 4 8 6\n";
+        
+        ObjMesh cube;
+        cube.Parse(cubeObj, cubeObj + sizeof(cubeObj)-1);
+        
+        TEST_CONDITION(cube.Build(&arena).header->vertexCount == 24);
+        TEST_CONDITION(cube.Build(&arena, Pi()).header->vertexCount == 8);
+        
+        //test that the cube is closed, its meshlets cover every index and one of its faces culls from the opposite side
+        MeshFileView cubeMesh = cube.Build(&arena);
+        TEST_CONDITION((cubeMesh.header->flags&MESH_FLAG_CLOSED) && !(mesh.header->flags&MESH_FLAG_CLOSED));
+        
+        uint32 meshletIndices = 0;
+        for(uint32 i = 0; i < cubeMesh.header->meshletCount; ++i) {
+            TEST_CONDITION(cubeMesh.meshlets[i].indexOffset == meshletIndices);
+            meshletIndices+= cubeMesh.meshlets[i].indexCount;
+        }
+        TEST_CONDITION(meshletIndices == cubeMesh.header->indexCount);
+        
+        //Note: faces 3 and 4 are the +z side
+        const uint32 faceIndices[] = { 4, 5, 6, 5, 7, 6 };
+        Memory::ArenaArray<Meshlet> faceMeshlets(&arena);
+        BuildMeshlets(&faceMeshlets, faceIndices, ArrayCount(faceIndices), cube.geoVerts.Data(), sizeof(Vec3<float>), 8, &arena);
+        TEST_CONDITION(faceMeshlets.Count() == 1 && faceMeshlets[0].coneAxis[2] == 1.f);
+        
+        //Note: the cube's corners are all hard so it can't be simplified and only has the full detail lod
+        TEST_CONDITION(cubeMesh.header->lodCount == 1 && cubeMesh.lods[0].indexCount == cubeMesh.header->indexCount);
+        TEST_CONDITION(MeshletBackFacing(faceMeshlets[0], Vec3<float>(0.f, 0.f, -5.f)) && !MeshletBackFacing(faceMeshlets[0], Vec3<float>(0.f, 0.f, 5.f)));
+    }
+    
+    //test that compact vertices are half the size and decode back to the same positions and normals
+    {
+        MeshFileView compactMesh = objMesh.Build(&arena, ObjMesh::kDefaultCreaseAngle, true, kMeshVertexFormatCompact);
+        TEST_CONDITION(2*compactMesh.header->vertexStride == mesh.header->vertexStride);
+        
+        MeshPositionTransform positionTransform = ComputeMeshPositionTransform(*compactMesh.header, compactMesh.attributes[0]);
+        
+        float values[3];
+        DecodeMeshComponents(compactMesh.attributes[0].componentType, ByteOffset(compactMesh.vertices, 2*compactMesh.header->vertexStride), 3, values);
+        TEST_CONDITION(Approx(positionTransform.offset.y + positionTransform.scale.y*values[1], 2.f, 1e-4f));
+        
+        //Note: the triangle faces +z
+        DecodeMeshComponents(compactMesh.attributes[1].componentType, ByteOffset(compactMesh.vertices, compactMesh.attributes[1].offset), 2, values);
+        TEST_CONDITION(OctahedralDecode(Vec2<float>(values[0], values[1])).z == 1.f);
+    }
+
+    //test that an obj split into chunks parses to exactly what one thread parses
+    {
+        //Note: over 4 64KB chunks (kMinParseChunkBytes) so 4 threads get 4 chunks. Faces mix absolute and negative indices
+        constexpr uint32 kQuads = 2048, kObjBytes = 512*kQuads;
+        char* quadsObj = (char*)arena.PushBytes(kObjBytes);
+        uint32 quadsObjLength = 0;
+
+        for(uint32 i = 0; i < kQuads; ++i) {
+            if(!(i%64)) quadsObjLength+= snprintf(quadsObj + quadsObjLength, kObjBytes - quadsObjLength, "# strip %u\no strip%u\ns %u\n", i/64, i/64, i%2);
+
+            for(uint32 j = 0; j < 4; ++j) {
+                quadsObjLength+= snprintf(quadsObj + quadsObjLength, kObjBytes - quadsObjLength, "v %u.5 %u -%u.25\nvt 0.%u 0.%u\nvn 0 %u 1\n",
+                                          i, j, i+j, j, i%10, j&1);
+            }
+
+            uint32 v = 4*i + 1;
+            quadsObjLength+= snprintf(quadsObj + quadsObjLength, kObjBytes - quadsObjLength, "f %u/%u/%u %u/%u/%u %u/%u/%u\nf -3/-3/-3 -1/-1/-1 -2/-2/-2\n",
+                                      v, v, v, v+1, v+1, v+1, v+2, v+2, v+2);
+        }
+        TEST_CONDITION(quadsObjLength > KB(256) && quadsObjLength < kObjBytes);
+
+        ObjMesh serial, parallel;
+        serial.Parse(quadsObj, quadsObj + quadsObjLength, 1);
+        parallel.Parse(quadsObj, quadsObj + quadsObjLength, 4);
+
+        TEST_CONDITION(serial.geoVerts.Count() == 4*kQuads && serial.indices.Count() == 6*kQuads && serial.flags == parallel.flags);
+        TEST_CONDITION(serial.geoVerts.Count() == parallel.geoVerts.Count() && !memcmp(serial.geoVerts.Data(), parallel.geoVerts.Data(), serial.geoVerts.Bytes()));
+        TEST_CONDITION(serial.uvVerts.Count() == parallel.uvVerts.Count() && !memcmp(serial.uvVerts.Data(), parallel.uvVerts.Data(), serial.uvVerts.Bytes()));
+        TEST_CONDITION(serial.normalVerts.Count() == parallel.normalVerts.Count() &&
+                       !memcmp(serial.normalVerts.Data(), parallel.normalVerts.Data(), serial.normalVerts.Bytes()));
+        TEST_CONDITION(serial.indices.Count() == parallel.indices.Count() && !memcmp(serial.indices.Data(), parallel.indices.Data(), serial.indices.Bytes()));
+
+        //Note: the last face of every quad points back at the quad's own vertices
+        TEST_CONDITION(parallel.indices[6*kQuads-1].vertex == 4*kQuads-2 && parallel.indices[6*kQuads-1].normal == 4*kQuads-2);
+    }
+
+    //test that normals generated in chunks on 4 threads match the ones generated on one thread
+    {
+        //Note: 2*199^2 faces is enough for 2 smooth chunks (kMinNormalChunkFaces) and all 4 creased ones (kMinCreasedNormalChunkFaces)
+        constexpr uint32 kGridSize = 200;
+        ObjMesh wave;
+        for(uint32 y = 0; y < kGridSize; ++y) {
+            for(uint32 x = 0; x < kGridSize; ++x) *wave.geoVerts.Push() = Vec3<float>(x, y, 4.f*__builtin_sinf(.3f*x)*__builtin_cosf(.2f*y));
+        }
+        for(uint32 y = 0; y+1 < kGridSize; ++y) {
+            for(uint32 x = 0; x+1 < kGridSize; ++x) {
+                uint32 v = y*kGridSize + x;
+                ObjMesh::Indices* corners = wave.indices.Push(6);
+                const uint32 quad[] = { v, v+1, v+kGridSize, v+1, v+kGridSize+1, v+kGridSize };
+                for(uint32 i = 0; i < 6; ++i) corners[i] = { .vertex = quad[i] };
+            }
+        }
+        
+        uint32 numCorners = wave.indices.Count();
+        Vec3<float>* serialNormals = (Vec3<float>*)arena.PushBytes(numCorners*sizeof(Vec3<float>));
+        Vec3<float>* parallelNormals = (Vec3<float>*)arena.PushBytes(numCorners*sizeof(Vec3<float>));
+        
+        const float creaseAngles[] = { ObjMesh::kDefaultCreaseAngle, Pi() };
+        for(float creaseAngle : creaseAngles) {
+            wave.GenerateNormals(creaseAngle, serialNormals, &arena, 1);
+            wave.GenerateNormals(creaseAngle, parallelNormals, &arena, 4);
+            
+            //Note: partial sums are added in a different order so allow a few ulps of rounding
+            for(uint32 i = 0; i < numCorners; ++i) TEST_CONDITION(serialNormals[i].Dot(parallelNormals[i]) > .99999f);
+        }
+    }
+}
+
+#include "GltfMesh.h"
+TEST_FUNC(GltfMesh) {
+    
+    //test that an interleaved glb is viewed in place and falls back to a rebuild once a node moves it
+    auto WriteGlb = [](const char* json, const void* bin, uint32 binBytes, uint8* glb) {
+        
+        //Note: chunks are padded to 4 bytes, json with spaces
+        uint32 jsonBytes = (strlen(json) + 3) & ~3u;
+        
+        GlbHeader header = { .magic = kGlbMagic, .version = kGlbVersion, .length = uint32(sizeof(GlbHeader) + 2*sizeof(GlbChunkHeader) + jsonBytes + binBytes) };
+        GlbChunkHeader jsonHeader = { .length = jsonBytes, .type = kGlbChunkJson },
+                       binHeader  = { .length = binBytes, .type = kGlbChunkBin };
+        
+        uint8* dst = glb;
+        memcpy(dst, &header, sizeof(header));         dst+= sizeof(header);
+        memcpy(dst, &jsonHeader, sizeof(jsonHeader)); dst+= sizeof(jsonHeader);
+        memset(dst, ' ', jsonBytes);
+        memcpy(dst, json, strlen(json));              dst+= jsonBytes;
+        memcpy(dst, &binHeader, sizeof(binHeader));   dst+= sizeof(binHeader);
+        memcpy(dst, bin, binBytes);
+        return header.length;
+    };
+    
+    //Note: a position and normal per vertex followed by 3 byte indices
+    struct { float vertices[3][6]; uint8 indices[4]; } bin = {
+        .vertices = { { 0, 0, 0, 0, 0, 1 }, { 1, 0, 0, 0, 0, 1 }, { 0, 1, 0, 0, 0, 1 } },
+        .indices = { 0, 1, 2 },
+    };
+    
+    const char json[] =
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0%s}],"
+        "\"buffers\":[{\"byteLength\":76}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":72,\"byteStride\":24},{\"buffer\":0,\"byteOffset\":72,\"byteLength\":3}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[1,1,0]},"
+                       "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+                       "{\"bufferView\":1,\"componentType\":5121,\"count\":3,\"type\":\"SCALAR\"}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"material\":0}]}],"
+        "\"materials\":[{\"name\":\"red\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[1,0,0,1]}}]}";
+    
+    Memory::Arena arena;
+    uint8 glb[1024];
+    char nodeJson[sizeof(json) + 32];
+    
+    snprintf(nodeJson, sizeof(nodeJson), json, "");
+    uint32 glbBytes = WriteGlb(nodeJson, &bin, sizeof(bin), glb);
+    {
+        GltfMesh gltf;
+        TEST_CONDITION(gltf.Parse(glb, glbBytes));
+        TEST_CONDITION(gltf.materials.Count() == 1 && gltf.materials[0].baseColor[0] == 1.f && gltf.materials[0].baseColor[1] == 0.f);
+        
+        MeshFileView view;
+        TEST_CONDITION(gltf.ViewMeshFile(&arena, &view));
+        TEST_CONDITION(view.header->vertexCount == 3 && view.header->vertexStride == 24 && view.header->indexStride == sizeof(uint8));
+        TEST_CONDITION(view.vertices == ByteOffset(glb, glbBytes - sizeof(bin)) && view.attributes[MESH_ATTRIBUTE_NORMAL].offset == 12);
+        TEST_CONDITION(view.header->boundsMax[0] == 1.f && view.lods[0].indexCount == 3);
+        
+        //Note: truncated files must be rejected
+        GltfMesh truncated;
+        TEST_CONDITION(!truncated.Parse(glb, glbBytes-1));
+    }
+    
+    snprintf(nodeJson, sizeof(nodeJson), json, ",\"scale\":[2,2,2]");
+    glbBytes = WriteGlb(nodeJson, &bin, sizeof(bin), glb);
+    {
+        GltfMesh gltf;
+        TEST_CONDITION(gltf.Parse(glb, glbBytes));
+        
+        MeshFileView view;
+        TEST_CONDITION(!gltf.ViewMeshFile(&arena, &view));
+        
+        MeshFileView mesh = gltf.Build(&arena);
+        TEST_CONDITION(mesh.header->vertexCount == 3 && mesh.header->boundsMax[0] == 2.f && mesh.header->boundsMax[1] == 2.f);
+    }
+}
+
+#include "MeshCodec.h"
+TEST_FUNC(MeshCodec) {
+    
+    //test that a grid compresses and decodes back to the same vertices and indices
+    constexpr uint32 kGridSize = 16;
+    char obj[16*1024];
+    uint32 objLength = 0;
+    
+    for(uint32 y = 0; y < kGridSize; ++y) {
+        for(uint32 x = 0; x < kGridSize; ++x) objLength+= snprintf(obj + objLength, sizeof(obj) - objLength, "v %u %u 0\n", x, y);
+    }
+    for(uint32 y = 0; y+1 < kGridSize; ++y) {
+        for(uint32 x = 0; x+1 < kGridSize; ++x) {
+            uint32 v = y*kGridSize + x + 1;
+            objLength+= snprintf(obj + objLength, sizeof(obj) - objLength, "f %u %u %u\nf %u %u %u\n", v, v+1, v+kGridSize, v+1, v+kGridSize+1, v+kGridSize);
+        }
+    }
+    
+    Memory::Arena arena;
+    ObjMesh grid;
+    grid.Parse(obj, obj + objLength);
+    MeshFileView mesh = grid.Build(&arena),
+                 compressed = CompressMeshFile(mesh, &arena);
+    
+    const MeshFileHeader &header = *mesh.header,
+                         &compressedHeader = *compressed.header;
+    
+    TEST_CONDITION((compressedHeader.flags&MESH_FLAG_COMPRESSED) && compressed.bytes < mesh.bytes);
+    TEST_CONDITION(compressedHeader.vertexCount == header.vertexCount && compressedHeader.indexCount == header.indexCount);
+    
+    MeshFileView readMesh;
+    TEST_CONDITION(ReadMeshFile(compressed.data, compressed.bytes, &readMesh) && readMesh.lods[0].indexCount == compressed.lods[0].indexCount);
+    
+    uint8* vertices = (uint8*)arena.PushBytes(header.vertexBytes);
+    TEST_CONDITION(DecodeMeshVertices(vertices, header.vertexCount, header.vertexStride, (const uint8*)compressed.vertices, compressedHeader.vertexBytes));
+    TEST_CONDITION(!memcmp(vertices, mesh.vertices, header.vertexBytes));
+    
+    uint8* indices = (uint8*)arena.PushBytes(header.indexBytes);
+    TEST_CONDITION(DecodeMeshIndices(indices, header.indexCount, header.indexStride, header.vertexCount, (const uint8*)compressed.indices, compressedHeader.indexBytes));
+    TEST_CONDITION(!memcmp(indices, mesh.indices, header.indexBytes));
+    
+    //Note: truncated data and indices past the last vertex must be rejected
+    TEST_CONDITION(!DecodeMeshVertices(vertices, header.vertexCount, header.vertexStride, (const uint8*)compressed.vertices, compressedHeader.vertexBytes-1));
+    TEST_CONDITION(!DecodeMeshIndices(indices, header.indexCount, header.indexStride, header.vertexCount, (const uint8*)compressed.indices, compressedHeader.indexBytes-1));
+    TEST_CONDITION(!DecodeMeshIndices(indices, header.indexCount, header.indexStride, header.vertexCount-1, (const uint8*)compressed.indices, compressedHeader.indexBytes));
+    
+    //test that a triangle that can't reuse anything round trips through deltas
+    {
+        const uint32 deltaIndices[] = { 70000, 3, 69999, 3, 70000, 5 };
+        uint8 encoded[MeshIndexEncodeBound(ArrayCount(deltaIndices))];
+        uint64 encodedBytes = EncodeMeshIndices(encoded, deltaIndices, ArrayCount(deltaIndices), sizeof(uint32));
+        
+        uint32 decoded[ArrayCount(deltaIndices)];
+        TEST_CONDITION(DecodeMeshIndices(decoded, ArrayCount(deltaIndices), sizeof(uint32), 70001, encoded, encodedBytes));
+        TEST_CONDITION(!memcmp(decoded, deltaIndices, sizeof(deltaIndices)));
+    }
+}
+
+#include "MeshOptimizer.h"
+TEST_FUNC(MeshOptimizer) {
+    
+    //test that a grid drawn in a cache hostile order gets cheaper to draw without losing any triangles
+    constexpr uint32 kGridSize = 16,
+                     kNumQuads = kGridSize*kGridSize,
+                     kIndexCount = kNumQuads*6,
+                     kVertexCount = (kGridSize+1)*(kGridSize+1);
+    
+    Memory::Arena arena;
+    uint32* indices = (uint32*)arena.PushBytes(kIndexCount*sizeof(uint32));
+    for(uint32 i = 0; i < kNumQuads; ++i) {
+        
+        //Note: 7 is coprime with kNumQuads so this visits every quad once while jumping around the grid
+        uint32 quad = (7*i) % kNumQuads,
+               v0 = (quad/kGridSize)*(kGridSize+1) + quad%kGridSize,
+               v1 = v0 + 1,
+               v2 = v0 + kGridSize+1,
+               v3 = v2 + 1;
+        
+        uint32 quadIndices[] = { v0, v1, v2, v2, v1, v3 };
+        memcpy(indices + 6*i, quadIndices, sizeof(quadIndices));
+    }
+    
+    uint64 indexSum = 0;
+    for(uint32 i = 0; i < kIndexCount; ++i) indexSum+= indices[i];
+    
+    VertexCacheStats originalStats = AnalyzeVertexCache(indices, kIndexCount, kVertexCount, &arena);
+    OptimizeVertexCache(indices, kIndexCount, kVertexCount, &arena);
+    VertexCacheStats optimizedStats = AnalyzeVertexCache(indices, kIndexCount, kVertexCount, &arena);
+    
+    TEST_CONDITION(optimizedStats.acmr < originalStats.acmr && optimizedStats.atvr < originalStats.atvr);
+    
+    for(uint32 i = 0; i < kIndexCount; ++i) indexSum-= indices[i];
+    TEST_CONDITION(indexSum == 0);
+    
+    //Note: after a fetch reorder each new vertex referenced is the next one in memory
+    uint32 vertices[kVertexCount];
+    for(uint32 i = 0; i < kVertexCount; ++i) vertices[i] = i;
+    TEST_CONDITION(OptimizeVertexFetch(vertices, sizeof(uint32), kVertexCount, indices, kIndexCount, &arena) == kVertexCount);
+    
+    uint32 nextVertex = 0;
+    for(uint32 i = 0; i < kIndexCount; ++i) {
+        TEST_CONDITION(indices[i] <= nextVertex);
+        if(indices[i] == nextVertex) ++nextVertex;
+    }
+    
+    //test that simplifying the flat grid drops triangles without moving its surface or its border
+    //Note: 'vertices' holds the grid vertex every reordered vertex came from
+    Vec3<float>* positions = (Vec3<float>*)arena.PushBytes(kVertexCount*sizeof(Vec3<float>));
+    for(uint32 i = 0; i < kVertexCount; ++i) positions[i] = Vec3<float>(float(vertices[i]%(kGridSize+1)), float(vertices[i]/(kGridSize+1)), 0.f);
+    
+    float simplifiedError;
+    uint32* simplified = (uint32*)arena.PushBytes(kIndexCount*sizeof(uint32));
+    uint32 simplifiedCount = SimplifyMesh(simplified, indices, kIndexCount, positions, sizeof(Vec3<float>), kVertexCount,
+                                          kIndexCount/4, 1e-3f, &arena, &simplifiedError);
+    
+    TEST_CONDITION(simplifiedCount <= kIndexCount/4 && simplifiedError < 1e-3f);
+    
+    //Note: the grid faces +z so every triangle has a positive area and they add up to the whole grid
+    float simplifiedArea = 0.f;
+    for(uint32 i = 0; i < simplifiedCount; i+= 3) {
+        const Vec3<float> *v1 = positions + simplified[i], *v2 = positions + simplified[i+1], *v3 = positions + simplified[i+2];
+        
+        float area = .5f*(*v2 - *v1).Cross(*v3 - *v1).z;
+        TEST_CONDITION(area > 0.f);
+        simplifiedArea+= area;
+    }
+    TEST_CONDITION(Approx(simplifiedArea, float(kNumQuads), 1e-3f));
+}
+
+#include "hashUtil.h"
+TEST_FUNC(HashUtil) {
+
+    //Note: cached assets are keyed by Hash64 so it has to match the reference XXH64 across builds
+    TEST_CONDITION(Hash64("", 0) == 0xEF46DB3751D8E999ULL);
+    TEST_CONDITION(Hash64("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+    const char longStr[] = "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz";
+    TEST_CONDITION(Hash64(longStr, sizeof(longStr)-1) != Hash64(longStr, sizeof(longStr)-2));
+    TEST_CONDITION(Hash64(longStr, sizeof(longStr)-1, 1) != Hash64(longStr, sizeof(longStr)-1, 0));
+}
+
 static CrtGlobalPreTestFunc InitTests() {
     Log("Testing code...");
 }
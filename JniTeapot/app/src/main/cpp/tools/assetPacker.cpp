@@ -0,0 +1,194 @@
+// Host tool that packs the assets directory into a single asset pack (see AssetPack.h)
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 assetPacker.cpp -o assetPacker
+//     ./assetPacker ../../assets assets.pack [--no-compress]
+//
+// Note: gradle builds and runs this before the apk when passed -PpackAssets (see build.gradle).
+//       Entries are lz4 compressed only when it saves at least an 8th of their size - compressed entries have to be
+//       decompressed when they're mapped instead of being handed out straight from the pack
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "../types.h"
+#include "../panic.h"
+#include "../AssetPack.h"
+#include "../compressionUtil.h"
+
+constexpr uint32 kMaxAssets = 4096;
+
+struct PackedAsset {
+    char* path;     //Note: relative to the assets directory with '/' separators. This is what the app hashes
+    char* filePath;
+    AssetPackEntry entry;
+};
+
+static PackedAsset assets[kMaxAssets];
+static uint32 assetCount;
+
+static size_t assetDirectoryLength;
+
+static int CollectAsset(const char* filePath, const struct stat* fileStat, int type, struct FTW*) {
+    if(type != FTW_F) return 0;
+
+    const char* path = filePath + assetDirectoryLength;
+    while(*path == '/') ++path;
+
+    //Note: don't pack an old pack if it was written to the assets directory
+    if(!strcmp(path, kAssetPackPath)) return 0;
+
+    RUNTIME_ASSERT(assetCount < kMaxAssets, "Too many assets { kMaxAssets: %u }", kMaxAssets);
+
+    PackedAsset& asset = assets[assetCount++];
+    asset.path = strdup(path);
+    asset.filePath = strdup(filePath);
+    asset.entry = {
+        .pathHash = AssetPathHash(path),
+        .bytes = uint64(fileStat->st_size),
+    };
+
+    return 0;
+}
+
+static int CompareAssets(const void* a, const void* b) {
+    uint64 hashA = ((const PackedAsset*)a)->entry.pathHash,
+           hashB = ((const PackedAsset*)b)->entry.pathHash;
+
+    return (hashA > hashB) - (hashA < hashB);
+}
+
+static uint8* ReadFile(const char* filePath, uint64 bytes) {
+
+    uint8* data = (uint8*)malloc(Max(bytes, uint64(1)));
+
+    int fd = open(filePath, O_RDONLY);
+    RUNTIME_ASSERT(fd >= 0, "Failed to open asset { filePath: %s, linux errno: %d }", filePath, errno);
+
+    for(uint64 position = 0; position < bytes;) {
+        ssize_t readBytes = read(fd, data + position, bytes - position);
+        RUNTIME_ASSERT(readBytes > 0, "Failed to read asset { filePath: %s, position: %llu, linux errno: %d }",
+                       filePath, (unsigned long long)position, errno);
+        position+= readBytes;
+    }
+
+    close(fd);
+    return data;
+}
+
+static void Write(FILE* file, uint64 offset, const void* data, uint64 bytes, const char* packPath) {
+    RUNTIME_ASSERT(!fseeko(file, offset, SEEK_SET), "Failed to seek pack { packPath: %s, offset: %llu }", packPath, (unsigned long long)offset);
+    RUNTIME_ASSERT(fwrite(data, 1, bytes, file) == bytes, "Failed to write pack { packPath: %s, bytes: %llu }", packPath, (unsigned long long)bytes);
+}
+
+int main(int argc, char** argv) {
+
+    if(argc < 3 || (argc == 4 && strcmp(argv[3], "--no-compress")) || argc > 4) {
+        fprintf(stderr, "usage: %s <assetDirectory> <packPath> [--no-compress]\n", argv[0]);
+        return 1;
+    }
+
+    const char* assetDirectory = argv[1];
+    const char* packPath = argv[2];
+    bool compress = (argc == 3);
+
+    assetDirectoryLength = strlen(assetDirectory);
+    RUNTIME_ASSERT(!nftw(assetDirectory, CollectAsset, 16, FTW_PHYS), "Failed to walk assets { assetDirectory: %s, linux errno: %d }", assetDirectory, errno);
+
+    //Note: the app binary searches the index so it has to be sorted and every hash has to be unique.
+    //      The app would still miss the pack on a collision since it checks paths, but one of the assets would never load from it
+    qsort(assets, assetCount, sizeof(PackedAsset), CompareAssets);
+    for(uint32 i = 1; i < assetCount; ++i) {
+        if(assets[i-1].entry.pathHash == assets[i].entry.pathHash) {
+            fprintf(stderr, "Asset path hash collision - rename one of the assets { path1: %s, path2: %s }\n", assets[i-1].path, assets[i].path);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(packPath, "wb");
+    RUNTIME_ASSERT(file, "Failed to create pack { packPath: %s, linux errno: %d }", packPath, errno);
+
+    uint32* hashTable = (uint32*)malloc(kLz4HashTableSize*sizeof(uint32));
+
+    //Note: paths are written right after the index
+    uint64 offset = sizeof(AssetPackHeader) + uint64(assetCount)*sizeof(AssetPackEntry);
+    for(uint32 i = 0; i < assetCount; ++i) {
+        AssetPackEntry& entry = assets[i].entry;
+
+        entry.pathLength = strlen(assets[i].path);
+        entry.pathOffset = offset;
+
+        Write(file, offset, assets[i].path, entry.pathLength, packPath);
+        offset+= entry.pathLength;
+    }
+
+    uint64 totalBytes = 0, totalStoredBytes = 0;
+
+    for(uint32 i = 0; i < assetCount; ++i) {
+        PackedAsset& asset = assets[i];
+        AssetPackEntry& entry = asset.entry;
+
+        uint8* data = ReadFile(asset.filePath, entry.bytes);
+        uint8* storedData = data;
+
+        entry.compression = ASSET_COMPRESSION_NONE;
+        entry.storedBytes = entry.bytes;
+
+        uint8* compressedData = nullptr;
+        if(compress && entry.bytes) {
+            compressedData = (uint8*)malloc(Lz4CompressBound(entry.bytes));
+
+            uint64 compressedBytes = Lz4CompressBlock(data, entry.bytes, compressedData, hashTable);
+            if(compressedBytes <= entry.bytes - entry.bytes/8) {
+                entry.compression = ASSET_COMPRESSION_LZ4;
+                entry.storedBytes = compressedBytes;
+                storedData = compressedData;
+            }
+        }
+
+        //Note: padding between entries is left as a hole that reads back as zeros
+        offset+= AlignUpOffsetPow2((void*)offset, kAssetPackAlignment);
+        entry.offset = offset;
+
+        if(entry.storedBytes) Write(file, offset, storedData, entry.storedBytes, packPath);
+        offset+= entry.storedBytes;
+
+        totalBytes+= entry.bytes;
+        totalStoredBytes+= entry.storedBytes;
+
+        printf("%-48s | %10llu | %10llu | %s\n", asset.path, (unsigned long long)entry.bytes, (unsigned long long)entry.storedBytes,
+               entry.compression == ASSET_COMPRESSION_LZ4 ? "lz4" : "none");
+
+        free(compressedData);
+        free(data);
+    }
+
+    AssetPackHeader header = {
+        .magic = kAssetPackMagic,
+        .version = kAssetPackVersion,
+        .entryCount = assetCount,
+        .alignment = kAssetPackAlignment,
+    };
+
+    Write(file, 0, &header, sizeof(header), packPath);
+    for(uint32 i = 0; i < assetCount; ++i) {
+        Write(file, sizeof(AssetPackHeader) + uint64(i)*sizeof(AssetPackEntry), &assets[i].entry, sizeof(AssetPackEntry), packPath);
+    }
+
+    //Note: make sure a pack that ends in an empty entry still covers that entry's offset
+    fflush(file);
+    RUNTIME_ASSERT(!ftruncate(fileno(file), offset), "Failed to size pack { packPath: %s, bytes: %llu }", packPath, (unsigned long long)offset);
+    RUNTIME_ASSERT(!fclose(file), "Failed to close pack { packPath: %s, linux errno: %d }", packPath, errno);
+
+    printf("Packed %u assets into %s { bytes: %llu, storedBytes: %llu, packBytes: %llu }\n",
+           assetCount, packPath, (unsigned long long)totalBytes, (unsigned long long)totalStoredBytes, (unsigned long long)offset);
+
+    free(hashTable);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Host tool that converts an obj or a glb into a binary mesh file (see MeshFile.h) that GlObject uploads straight from its mapping
+//
+// Build and run on a linux host from this directory with the same flags as the app:
+//     clang++ -std=c++2a -fno-exceptions -fno-rtti -fdeclspec -O2 -DOPTIMIZED_BUILD=0 meshConverter.cpp -o meshConverter
+//     ./meshConverter ../../assets/meshes/cow.obj ../../assets/meshes/cow.mesh
+//
+// Note: uses the same parsers and builder as the app (ObjMesh.h, GltfMesh.h) so a 'raw' mesh is byte for byte what
+//       the app would build and cache from the obj or glb. glbs are always rebuilt so they get meshlets and lods.
+//       Vertices are compact (see kMeshVertexFormatCompact) like the app's unless 'float32' is passed as the vertex format
+//
+// Note: meshes are compressed (see MeshCodec.h) unless 'raw' is passed so they take up less of the apk.
+//       The checked in meshes are raw since decoding is slower than uploading them straight from the apk. They're regenerated
+//       with gradle's -PconvertMeshes (see build.gradle) whenever their obj or the format changes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../types.h"
+#include "../Memory.h"
+#include "../MeshFile.h"
+#include "../ObjMesh.h"
+#include "../GltfMesh.h"
+#include "../MeshCodec.h"
+
+int main(int argc, char** argv) {
+
+    bool float32Vertices = false, raw = false, validArgs = (argc >= 3);
+    for(int i = 3; i < argc; ++i) {
+        if(!strcmp(argv[i], "float32")) float32Vertices = true;
+        else if(!strcmp(argv[i], "raw")) raw = true;
+        else validArgs&= !strcmp(argv[i], "compact");
+    }
+    
+    if(!validArgs) {
+        fprintf(stderr, "usage: %s <objPath|glbPath> <meshPath> [compact|float32] [raw]\n", argv[0]);
+        return 1;
+    }
+
+    const char* sourcePath = argv[1];
+    const char* meshPath = argv[2];
+    const MeshVertexFormat& vertexFormat = float32Vertices ? kMeshVertexFormatFloat32 : kMeshVertexFormatCompact;
+
+    int fd = open(sourcePath, O_RDONLY);
+    RUNTIME_ASSERT(fd >= 0, "Failed to open source mesh { sourcePath: %s, linux errno: %d }", sourcePath, errno);
+
+    struct stat fileStat;
+    RUNTIME_ASSERT(!fstat(fd, &fileStat), "Failed to stat source mesh { sourcePath: %s, linux errno: %d }", sourcePath, errno);
+
+    uint64 sourceBytes = fileStat.st_size;
+    const char* source = sourceBytes ? (const char*)mmap(nullptr, sourceBytes, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    RUNTIME_ASSERT(source != MAP_FAILED, "Failed to map source mesh { sourcePath: %s, linux errno: %d }", sourcePath, errno);
+    close(fd);
+
+    Memory::Arena arena;
+
+    MeshFileView mesh;
+    size_t pathLength = strlen(sourcePath), extensionLength = strlen(kGlbExtension);
+    if(pathLength >= extensionLength && !strcmp(sourcePath + pathLength - extensionLength, kGlbExtension)) {
+        
+        GltfMesh glb;
+        RUNTIME_ASSERT(glb.Parse(source, sourceBytes), "Invalid glb { sourcePath: %s, bytes: %llu }", sourcePath, (unsigned long long)sourceBytes);
+        mesh = glb.Build(&arena, ObjMesh::kDefaultCreaseAngle, true, vertexFormat);
+        
+    } else {
+        
+        ObjMesh objMesh;
+        objMesh.Parse(source, source + sourceBytes);
+        mesh = objMesh.Build(&arena, ObjMesh::kDefaultCreaseAngle, true, vertexFormat);
+    }
+
+    uint64 rawBytes = mesh.bytes;
+    if(!raw) mesh = CompressMeshFile(mesh, &arena);
+
+    FILE* file = fopen(meshPath, "wb");
+    RUNTIME_ASSERT(file, "Failed to create mesh { meshPath: %s, linux errno: %d }", meshPath, errno);
+    RUNTIME_ASSERT(fwrite(mesh.data, 1, mesh.bytes, file) == mesh.bytes, "Failed to write mesh { meshPath: %s, bytes: %llu }", meshPath, (unsigned long long)mesh.bytes);
+    RUNTIME_ASSERT(!fclose(file), "Failed to close mesh { meshPath: %s, linux errno: %d }", meshPath, errno);
+
+    const MeshFileHeader& header = *mesh.header;
+    printf("Converted %s to %s { sourceBytes: %llu, rawBytes: %llu, meshBytes: %llu, compressed: %d, vertexCount: %u, indexCount: %u, vertexStride: %u, indexStride: %u,"
+           " meshletCount: %u, closed: %d, bounds: [%g %g %g] - [%g %g %g] }\n",
+           sourcePath, meshPath, (unsigned long long)sourceBytes, (unsigned long long)rawBytes, (unsigned long long)mesh.bytes,
+           bool(header.flags&MESH_FLAG_COMPRESSED),
+           header.vertexCount, header.indexCount, header.vertexStride, header.indexStride,
+           header.meshletCount, bool(header.flags&MESH_FLAG_CLOSED),
+           header.boundsMin[0], header.boundsMin[1], header.boundsMin[2], header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    if(sourceBytes) munmap((void*)source, sourceBytes);
+    return 0;
+}
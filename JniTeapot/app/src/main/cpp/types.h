@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 using int64 = int64_t;
 using int32 = int32_t;